@@ -0,0 +1,285 @@
+/*--------------------------------------------------------------------*/
+/* atom.c                                                             */
+/* Author: Jacob Santelli and Joshua Yang                             */
+/*--------------------------------------------------------------------*/
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <assert.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "atom.h"
+
+/* The number of buckets the table starts with once it is needed */
+static const size_t MIN_BUCKETS = 64;
+
+/* An interned string, allocated together with its characters */
+struct atom {
+   /* the next atom in the same bucket */
+   struct atom *psNext;
+   /* the hash the string was interned with */
+   unsigned long ulHash;
+   /* the string length of acStr */
+   size_t ulLength;
+   /* the number of outstanding references to the atom */
+   size_t ulRefs;
+   /* the '\0'-terminated string itself, which extends past the end
+      of the struct */
+   char acStr[1];
+};
+
+/* The number of shards the table is split into, each with a lock of
+   its own, so that threads interning different strings rarely wait for
+   each other; a power of 2, so that the low bits of a hash choose the
+   shard and the rest choose the bucket within it */
+enum { ATOM_SHARDS = 64 };
+
+/* The size of a cache line, to which each shard is padded so that
+   threads locking different shards do not share a line */
+enum { ATOM_LINE_SIZE = 64 };
+
+/* One shard of the table, which holds the atoms whose hashes are
+   congruent to its index modulo ATOM_SHARDS; every field but sLock is
+   touched only with sLock held */
+struct shardFields {
+   /* the lock guarding the shard */
+   pthread_mutex_t sLock;
+   /* the array of bucket chains, or NULL before the first atom */
+   struct atom **ppsBuckets;
+   /* the number of elements in ppsBuckets */
+   size_t ulBucketCount;
+   /* the number of atoms in the shard */
+   size_t ulAtomCount;
+   /* the total number of references to atoms in the shard */
+   size_t ulRefCount;
+   /* the bytes of string data, counting each '\0', in the shard */
+   size_t ulByteCount;
+   /* the bytes of string data, counting each '\0', that would be
+      stored if every reference had its own copy */
+   size_t ulRefByteCount;
+};
+
+/* A shard, padded to whole cache lines of its own */
+union shard {
+   /* the shard's fields */
+   struct shardFields s;
+   /* padding */
+   char acPad[2 * ATOM_LINE_SIZE];
+};
+
+/*
+  The table is an AO with these state variables:
+*/
+
+/* 1. the shards, whose locks are initialized by Atom_init */
+static union shard asShards[ATOM_SHARDS];
+/* 2. makes sure Atom_init runs once, before the first atom is added
+      or the statistics are read; every atom is reached only after it
+      was added, so Atom_dup and Atom_free need not check */
+static pthread_once_t sInitOnce = PTHREAD_ONCE_INIT;
+
+/* Initializes the lock of every shard. */
+static void Atom_init(void) {
+   size_t i;
+
+   for(i = 0; i < ATOM_SHARDS; i++)
+      (void) pthread_mutex_init(&asShards[i].s.sLock, NULL);
+}
+
+/* Returns the shard that holds the atoms hashed to ulHash. */
+static struct shardFields *Atom_shard(unsigned long ulHash) {
+   return &asShards[ulHash & (ATOM_SHARDS - 1)].s;
+}
+
+/* Returns the bucket of a shard with ulBucketCount buckets that holds
+   the atoms hashed to ulHash. */
+static size_t Atom_bucket(unsigned long ulHash, size_t ulBucketCount) {
+   return (ulHash / ATOM_SHARDS) & (ulBucketCount - 1);
+}
+
+/* Returns the atom struct that holds the string pcAtom. */
+static struct atom *Atom_fromString(const char *pcAtom) {
+   assert(pcAtom != NULL);
+
+   return (struct atom *)(void *)
+      (pcAtom - offsetof(struct atom, acStr));
+}
+
+/*
+  Doubles the number of buckets in psShard, or allocates the first
+  MIN_BUCKETS if there are none. psShard's lock must be held. Returns
+  1 (TRUE) if successful, or 0 (FALSE) if insufficient memory is
+  available, in which case the shard is unchanged.
+*/
+static int Atom_grow(struct shardFields *psShard) {
+   struct atom **ppsNew;
+   struct atom *psAtom;
+   struct atom *psNext;
+   size_t ulNewCount;
+   size_t i;
+
+   assert(psShard != NULL);
+
+   if(psShard->ulBucketCount == 0)
+      ulNewCount = MIN_BUCKETS;
+   else
+      ulNewCount = 2 * psShard->ulBucketCount;
+
+   ppsNew = calloc(ulNewCount, sizeof(struct atom *));
+   if(ppsNew == NULL)
+      return 0;
+
+   /* rehash every atom into the new buckets */
+   for(i = 0; i < psShard->ulBucketCount; i++) {
+      for(psAtom = psShard->ppsBuckets[i]; psAtom != NULL;
+          psAtom = psNext) {
+         size_t ulBucket = Atom_bucket(psAtom->ulHash, ulNewCount);
+         psNext = psAtom->psNext;
+         psAtom->psNext = ppsNew[ulBucket];
+         ppsNew[ulBucket] = psAtom;
+      }
+   }
+
+   free(psShard->ppsBuckets);
+   psShard->ppsBuckets = ppsNew;
+   psShard->ulBucketCount = ulNewCount;
+   return 1;
+}
+
+const char *Atom_new(const char *pcStr, size_t ulLength,
+                     unsigned long ulHash) {
+   struct shardFields *psShard;
+   struct atom *psAtom;
+   size_t ulBucket;
+
+   assert(pcStr != NULL);
+
+   (void) pthread_once(&sInitOnce, Atom_init);
+   psShard = Atom_shard(ulHash);
+   (void) pthread_mutex_lock(&psShard->sLock);
+
+   if(psShard->ulBucketCount != 0) {
+      ulBucket = Atom_bucket(ulHash, psShard->ulBucketCount);
+      for(psAtom = psShard->ppsBuckets[ulBucket]; psAtom != NULL;
+          psAtom = psAtom->psNext) {
+         if(psAtom->ulHash == ulHash && psAtom->ulLength == ulLength
+            && memcmp(psAtom->acStr, pcStr, ulLength) == 0) {
+            psAtom->ulRefs++;
+            psShard->ulRefCount++;
+            psShard->ulRefByteCount += ulLength + 1;
+            (void) pthread_mutex_unlock(&psShard->sLock);
+            return psAtom->acStr;
+         }
+      }
+   }
+
+   /* keep the average chain length at most 1 */
+   if(psShard->ulAtomCount >= psShard->ulBucketCount)
+      if(!Atom_grow(psShard)) {
+         (void) pthread_mutex_unlock(&psShard->sLock);
+         return NULL;
+      }
+
+   psAtom = malloc(offsetof(struct atom, acStr) + ulLength + 1);
+   if(psAtom == NULL) {
+      (void) pthread_mutex_unlock(&psShard->sLock);
+      return NULL;
+   }
+   psAtom->ulHash = ulHash;
+   psAtom->ulLength = ulLength;
+   psAtom->ulRefs = 1;
+   memcpy(psAtom->acStr, pcStr, ulLength);
+   psAtom->acStr[ulLength] = '\0';
+
+   ulBucket = Atom_bucket(ulHash, psShard->ulBucketCount);
+   psAtom->psNext = psShard->ppsBuckets[ulBucket];
+   psShard->ppsBuckets[ulBucket] = psAtom;
+
+   psShard->ulAtomCount++;
+   psShard->ulRefCount++;
+   psShard->ulByteCount += ulLength + 1;
+   psShard->ulRefByteCount += ulLength + 1;
+   (void) pthread_mutex_unlock(&psShard->sLock);
+   return psAtom->acStr;
+}
+
+const char *Atom_dup(const char *pcAtom) {
+   struct atom *psAtom = Atom_fromString(pcAtom);
+   struct shardFields *psShard = Atom_shard(psAtom->ulHash);
+
+   (void) pthread_mutex_lock(&psShard->sLock);
+   assert(psAtom->ulRefs > 0);
+   psAtom->ulRefs++;
+   psShard->ulRefCount++;
+   psShard->ulRefByteCount += psAtom->ulLength + 1;
+   (void) pthread_mutex_unlock(&psShard->sLock);
+   return pcAtom;
+}
+
+void Atom_free(const char *pcAtom) {
+   struct shardFields *psShard;
+   struct atom *psAtom;
+   struct atom **ppsLink;
+
+   if(pcAtom == NULL)
+      return;
+
+   psAtom = Atom_fromString(pcAtom);
+   psShard = Atom_shard(psAtom->ulHash);
+   (void) pthread_mutex_lock(&psShard->sLock);
+   assert(psAtom->ulRefs > 0);
+
+   psAtom->ulRefs--;
+   psShard->ulRefCount--;
+   psShard->ulRefByteCount -= psAtom->ulLength + 1;
+   if(psAtom->ulRefs != 0) {
+      (void) pthread_mutex_unlock(&psShard->sLock);
+      return;
+   }
+
+   /* unlink from its bucket chain */
+   ppsLink = &psShard->ppsBuckets[Atom_bucket(psAtom->ulHash,
+                                              psShard->ulBucketCount)];
+   while(*ppsLink != psAtom)
+      ppsLink = &(*ppsLink)->psNext;
+   *ppsLink = psAtom->psNext;
+
+   psShard->ulAtomCount--;
+   psShard->ulByteCount -= psAtom->ulLength + 1;
+   (void) pthread_mutex_unlock(&psShard->sLock);
+   free(psAtom);
+}
+
+size_t Atom_getLength(const char *pcAtom) {
+   return Atom_fromString(pcAtom)->ulLength;
+}
+
+unsigned long Atom_getHash(const char *pcAtom) {
+   return Atom_fromString(pcAtom)->ulHash;
+}
+
+void Atom_getStats(struct AtomStats *psStats) {
+   struct shardFields *psShard;
+   size_t ulRefBytes = 0;
+   size_t i;
+
+   assert(psStats != NULL);
+
+   (void) pthread_once(&sInitOnce, Atom_init);
+   psStats->ulAtoms = 0;
+   psStats->ulReferences = 0;
+   psStats->ulBytes = 0;
+   for(i = 0; i < ATOM_SHARDS; i++) {
+      psShard = &asShards[i].s;
+      (void) pthread_mutex_lock(&psShard->sLock);
+      psStats->ulAtoms += psShard->ulAtomCount;
+      psStats->ulReferences += psShard->ulRefCount;
+      psStats->ulBytes += psShard->ulByteCount;
+      ulRefBytes += psShard->ulRefByteCount;
+      (void) pthread_mutex_unlock(&psShard->sLock);
+   }
+   psStats->ulBytesSaved = ulRefBytes - psStats->ulBytes;
+}
@@ -0,0 +1,74 @@
+/*--------------------------------------------------------------------*/
+/* atom.h                                                             */
+/* Author: Jacob Santelli and Joshua Yang                             */
+/*--------------------------------------------------------------------*/
+
+#ifndef ATOM_INCLUDED
+#define ATOM_INCLUDED
+
+#include <stddef.h>
+
+/*
+  An atom is a pointer to a unique, immutable, '\0'-terminated string
+  held in a process-wide table. Interning the same characters twice
+  yields the same pointer, so two atoms are equal strings exactly when
+  they are equal pointers. Atoms are reference counted: each Atom_new
+  must be matched by an Atom_free.
+
+  The table is safe to use from several threads at once: it is split
+  into shards by hash, each guarded by a mutex of its own, so threads
+  that intern, duplicate or free atoms of different shards do not wait
+  for each other. An atom's characters, length and hash never change,
+  so reading them needs no lock.
+*/
+
+/* Statistics describing the contents of the atom table */
+struct AtomStats {
+   /* the number of distinct strings in the table */
+   size_t ulAtoms;
+   /* the number of outstanding references to them, i.e., the
+      number of strings that would be stored without interning */
+   size_t ulReferences;
+   /* the bytes of string data (including each '\0') in the table */
+   size_t ulBytes;
+   /* the bytes of string data that interning avoided storing */
+   size_t ulBytesSaved;
+};
+
+/*
+  Returns the atom for the ulLength characters starting at pcStr,
+  which need not be '\0'-terminated and must not contain '\0',
+  adding it to the table if it is not already there. ulHash must be a
+  hash of those characters, the same for every call with equal
+  characters (paths use Path_hashComponent). Returns NULL if memory
+  could not be allocated to complete the request.
+*/
+const char *Atom_new(const char *pcStr, size_t ulLength,
+                     unsigned long ulHash);
+
+/*
+  Returns another reference to pcAtom, an atom returned by Atom_new,
+  which must also be released with Atom_free.
+*/
+const char *Atom_dup(const char *pcAtom);
+
+/*
+  Releases one reference to pcAtom, an atom returned by Atom_new or
+  Atom_dup, removing it from the table once no references remain.
+  Does nothing if pcAtom is NULL.
+*/
+void Atom_free(const char *pcAtom);
+
+/* Returns the string length of pcAtom. */
+size_t Atom_getLength(const char *pcAtom);
+
+/* Returns the hash that pcAtom was interned with. */
+unsigned long Atom_getHash(const char *pcAtom);
+
+/*
+  Fills *psStats with the current statistics of the atom table. The
+  deduplication ratio is psStats->ulReferences / psStats->ulAtoms.
+*/
+void Atom_getStats(struct AtomStats *psStats);
+
+#endif
@@ -6,6 +6,7 @@
 #include "dynarray.h"
 #include <assert.h>
 #include <stdlib.h>
+#include <string.h>
 
 /*--------------------------------------------------------------------*/
 
@@ -51,19 +52,17 @@ static int DynArray_isValid(DynArray_T oDynArray)
 
 /*--------------------------------------------------------------------*/
 
-/* Increase the physical length of oDynArray.  Return 1 (TRUE) if
-   successful and 0 (FALSE) if insufficient memory is available. */
+/* Set the physical length of oDynArray to uNewLength, which must be
+   at least its length.  Return 1 (TRUE) if successful and 0 (FALSE)
+   if insufficient memory is available. */
 
-static int DynArray_grow(DynArray_T oDynArray)
+static int DynArray_resize(DynArray_T oDynArray, size_t uNewLength)
 {
-   const size_t GROWTH_FACTOR = 2;
-
-   size_t uNewLength;
    const void **ppvNewArray;
 
    assert(oDynArray != NULL);
-
-   uNewLength = GROWTH_FACTOR * oDynArray->uPhysLength;
+   assert(uNewLength >= oDynArray->uLength);
+   assert(uNewLength >= MIN_PHYS_LENGTH);
 
    ppvNewArray = (const void**)
       realloc(oDynArray->ppvArray, sizeof(void*) * uNewLength);
@@ -77,6 +76,31 @@ static int DynArray_grow(DynArray_T oDynArray)
 
 /*--------------------------------------------------------------------*/
 
+/* Increase the physical length of oDynArray so that it can hold
+   uCount more elements, at least doubling it if it must grow at all.
+   Return 1 (TRUE) if successful and 0 (FALSE) if insufficient memory
+   is available. */
+
+static int DynArray_grow(DynArray_T oDynArray, size_t uCount)
+{
+   const size_t GROWTH_FACTOR = 2;
+
+   size_t uNewLength;
+
+   assert(oDynArray != NULL);
+
+   if (uCount > oDynArray->uPhysLength - oDynArray->uLength)
+   {
+      uNewLength = GROWTH_FACTOR * oDynArray->uPhysLength;
+      if (uNewLength < oDynArray->uLength + uCount)
+         uNewLength = oDynArray->uLength + uCount;
+      return DynArray_resize(oDynArray, uNewLength);
+   }
+   return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
 DynArray_T DynArray_new(size_t uLength)
 {
    DynArray_T oDynArray;
@@ -161,7 +185,7 @@ int DynArray_add(DynArray_T oDynArray, const void *pvElement)
    assert(DynArray_isValid(oDynArray));
 
    if (oDynArray->uLength == oDynArray->uPhysLength)
-      if (! DynArray_grow(oDynArray))
+      if (! DynArray_grow(oDynArray, 1))
          return 0;
 
    oDynArray->ppvArray[oDynArray->uLength] = pvElement;
@@ -177,18 +201,17 @@ int DynArray_add(DynArray_T oDynArray, const void *pvElement)
 int DynArray_addAt(DynArray_T oDynArray, size_t uIndex,
                    const void *pvElement)
 {
-   size_t u;
-
    assert(oDynArray != NULL);
    assert(uIndex <= oDynArray->uLength);
    assert(DynArray_isValid(oDynArray));
 
    if (oDynArray->uLength == oDynArray->uPhysLength)
-      if (! DynArray_grow(oDynArray))
+      if (! DynArray_grow(oDynArray, 1))
          return 0;
 
-   for (u = oDynArray->uLength; u > uIndex; u--)
-      oDynArray->ppvArray[u] = oDynArray->ppvArray[u-1];
+   memmove(&oDynArray->ppvArray[uIndex + 1],
+           &oDynArray->ppvArray[uIndex],
+           (oDynArray->uLength - uIndex) * sizeof(void*));
 
    oDynArray->ppvArray[uIndex] = pvElement;
    oDynArray->uLength++;
@@ -203,7 +226,6 @@ int DynArray_addAt(DynArray_T oDynArray, size_t uIndex,
 void *DynArray_removeAt(DynArray_T oDynArray, size_t uIndex)
 {
    const void *pvOldElement;
-   size_t u;
 
    assert(oDynArray != NULL);
    assert(uIndex < oDynArray->uLength);
@@ -213,8 +235,9 @@ void *DynArray_removeAt(DynArray_T oDynArray, size_t uIndex)
 
    oDynArray->uLength--;
 
-   for (u = uIndex; u < oDynArray->uLength; u++)
-      oDynArray->ppvArray[u] = oDynArray->ppvArray[u+1];
+   memmove(&oDynArray->ppvArray[uIndex],
+           &oDynArray->ppvArray[uIndex + 1],
+           (oDynArray->uLength - uIndex) * sizeof(void*));
 
    assert(DynArray_isValid(oDynArray));
 
@@ -223,16 +246,101 @@ void *DynArray_removeAt(DynArray_T oDynArray, size_t uIndex)
 
 /*--------------------------------------------------------------------*/
 
-void DynArray_toArray(DynArray_T oDynArray, void **ppvArray)
+int DynArray_reserve(DynArray_T oDynArray, size_t uPhysLength)
 {
-   size_t u;
+   assert(oDynArray != NULL);
+   assert(DynArray_isValid(oDynArray));
+
+   if (uPhysLength <= oDynArray->uPhysLength)
+      return 1;
+   return DynArray_resize(oDynArray, uPhysLength);
+}
+
+/*--------------------------------------------------------------------*/
+
+int DynArray_addAll(DynArray_T oDynArray, void **ppvArray,
+                    size_t uCount)
+{
+   assert(oDynArray != NULL);
+   assert(DynArray_isValid(oDynArray));
+
+   return DynArray_insertRange(oDynArray, oDynArray->uLength,
+                               ppvArray, uCount);
+}
+
+/*--------------------------------------------------------------------*/
+
+int DynArray_insertRange(DynArray_T oDynArray, size_t uIndex,
+                         void **ppvArray, size_t uCount)
+{
+   assert(oDynArray != NULL);
+   assert(ppvArray != NULL || uCount == 0);
+   assert(uIndex <= oDynArray->uLength);
+   assert(DynArray_isValid(oDynArray));
+
+   if (uCount == 0)
+      return 1;
+
+   if (! DynArray_grow(oDynArray, uCount))
+      return 0;
+
+   memmove(&oDynArray->ppvArray[uIndex + uCount],
+           &oDynArray->ppvArray[uIndex],
+           (oDynArray->uLength - uIndex) * sizeof(void*));
+   memcpy(&oDynArray->ppvArray[uIndex], ppvArray,
+          uCount * sizeof(void*));
+   oDynArray->uLength += uCount;
+
+   assert(DynArray_isValid(oDynArray));
 
+   return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+void DynArray_removeRange(DynArray_T oDynArray, size_t uIndex,
+                          size_t uCount)
+{
+   assert(oDynArray != NULL);
+   assert(uIndex <= oDynArray->uLength);
+   assert(uCount <= oDynArray->uLength - uIndex);
+   assert(DynArray_isValid(oDynArray));
+
+   memmove(&oDynArray->ppvArray[uIndex],
+           &oDynArray->ppvArray[uIndex + uCount],
+           (oDynArray->uLength - uIndex - uCount) * sizeof(void*));
+   oDynArray->uLength -= uCount;
+
+   assert(DynArray_isValid(oDynArray));
+}
+
+/*--------------------------------------------------------------------*/
+
+int DynArray_shrinkToFit(DynArray_T oDynArray)
+{
+   size_t uNewLength;
+
+   assert(oDynArray != NULL);
+   assert(DynArray_isValid(oDynArray));
+
+   uNewLength = oDynArray->uLength;
+   if (uNewLength < MIN_PHYS_LENGTH)
+      uNewLength = MIN_PHYS_LENGTH;
+   if (uNewLength == oDynArray->uPhysLength)
+      return 1;
+   return DynArray_resize(oDynArray, uNewLength);
+}
+
+/*--------------------------------------------------------------------*/
+
+void DynArray_toArray(DynArray_T oDynArray, void **ppvArray)
+{
    assert(oDynArray != NULL);
    assert(ppvArray != NULL);
    assert(DynArray_isValid(oDynArray));
 
-   for (u = 0; u < oDynArray->uLength; u++)
-      ppvArray[u] = (void*)oDynArray->ppvArray[u];
+   memcpy(ppvArray, oDynArray->ppvArray,
+          oDynArray->uLength * sizeof(void*));
 }
 
 /*--------------------------------------------------------------------*/
@@ -71,6 +71,50 @@ void *DynArray_removeAt(DynArray_T oDynArray, size_t uIndex);
 
 /*--------------------------------------------------------------------*/
 
+/* Make the physical length of oDynArray at least uPhysLength, so that
+   it can reach that length without reallocating.  Return 1 (TRUE) if
+   successful, or 0 (FALSE) if insufficient memory is available. */
+
+int DynArray_reserve(DynArray_T oDynArray, size_t uPhysLength);
+
+/*--------------------------------------------------------------------*/
+
+/* Add the uCount elements of ppvArray to the end of oDynArray, in
+   order.  Return 1 (TRUE) if successful, or 0 (FALSE) if insufficient
+   memory is available, in which case oDynArray is unchanged. */
+
+int DynArray_addAll(DynArray_T oDynArray, void **ppvArray,
+                    size_t uCount);
+
+/*--------------------------------------------------------------------*/
+
+/* Add the uCount elements of ppvArray to oDynArray, in order, such
+   that the first is the uIndex'th element.  Return 1 (TRUE) if
+   successful, or 0 (FALSE) if insufficient memory is available, in
+   which case oDynArray is unchanged. */
+
+int DynArray_insertRange(DynArray_T oDynArray, size_t uIndex,
+                         void **ppvArray, size_t uCount);
+
+/*--------------------------------------------------------------------*/
+
+/* Remove the uCount elements of oDynArray starting with the uIndex'th
+   element. */
+
+void DynArray_removeRange(DynArray_T oDynArray, size_t uIndex,
+                          size_t uCount);
+
+/*--------------------------------------------------------------------*/
+
+/* Reduce the physical length of oDynArray to its length, or to the
+   minimum physical length if that is greater.  Return 1 (TRUE) if
+   successful, or 0 (FALSE) if the memory could not be reallocated, in
+   which case oDynArray is unchanged. */
+
+int DynArray_shrinkToFit(DynArray_T oDynArray);
+
+/*--------------------------------------------------------------------*/
+
 /* Fill ppvArray with the elements of oDynArray.  ppvArray must point
    to an area of memory that is large enough to hold all elements of
    oDynArray. */
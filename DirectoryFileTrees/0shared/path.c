@@ -7,159 +7,218 @@
 #include <stdlib.h>
 #include <string.h>
 
-#include "dynarray.h"
+#include "atom.h"
 #include "path.h"
 
-/* An absolute path */
+/* The location of one component within a path's buffer */
+struct component {
+   /* The offset of the component's first character from the
+      start of the pathname */
+   size_t ulOffset;
+   /* The string length of the component */
+   size_t ulLength;
+   /* The hash of the component's characters */
+   unsigned long ulHash;
+   /* The component as an atom: equal components of any two paths
+      are the same pointer */
+   const char *pcAtom;
+};
+
+/* The storage shared by a path and all of its prefixes and copies.
+   It is allocated as a single block: the struct is followed directly
+   by the psViews array and then by the pcBuffer characters. */
+struct pathStore {
+   /* The number of Path_T handles that refer to this storage */
+   size_t ulRefs;
+   /* The full pathname, which uses '/' as the component delimiter */
+   char *pcBuffer;
+   /* The string length of the full pathname in pcBuffer */
+   size_t ulLength;
+   /* The number of components in the full pathname */
+   size_t ulDepth;
+   /* The array of ulDepth prefix views: element i is the prefix of
+      depth i+1, and so the full path is the last element */
+   struct path *psViews;
+};
+
+/* An absolute path: a view of the leading ulDepth components of
+   a shared pathStore */
 struct path {
-   /* The string representation of the path,
-      which uses '/' as the component delimiter */
-   const char *pcPath;
-   /* The string length of pcPath */
+   /* The storage this path is a prefix of */
+   struct pathStore *psStore;
+   /* The number of components in the path */
+   size_t ulDepth;
+   /* The string length of the path's pathname */
    size_t ulLength;
-   /* The ordered collection of component strings in the path */
-   DynArray_T oDComponents;
+   /* The extent of the path's last component, i.e., the component
+      at level ulDepth-1 of every path that shares psStore */
+   struct component sLast;
+   /* The hash of the sequence of components in the path, built by
+      Path_extendHash from each component's hash in turn */
+   unsigned long ulPrefixHash;
+   /* A separately allocated '\0'-terminated copy of the pathname,
+      built by Path_getPathname when first asked for if the path is a
+      proper prefix, or NULL if not yet built */
+   char *pcPathname;
 };
 
-/*
-  Frees pcStr. This wrapper is used to match the requirements of the
-  callback function pointer passed to DynArray_map. pvExtra is unused.
-*/
-static void Path_freeString(char *pcStr, void *pvExtra) {
-   /* pcStr may be NULL, as this is a no-op to free.
-      pvExtra may be NULL, as it is unused. */
-   free(pcStr);
-}
+/* FNV-1a parameters for a 64-bit unsigned long */
+static const unsigned long PATH_HASH_BASIS = 14695981039346656037UL;
+static const unsigned long PATH_HASH_PRIME = 1099511628211UL;
 
 /*
-  Sets *poDComponents to be an ordered collection of component strings
-  in pcPath, or NULL if an error occurs.
-  Returns one of the following statuses:
+  Validates pcPath and counts its components. Returns one of the
+  following statuses, storing the number of components in *pulDepth
+  and the string length of pcPath in *pulLength if SUCCESS:
   * SUCCESS if no error occurrs
   * BAD_PATH if pcPath is the empty string,
              or begins or ends with a '/',
              or contains consecutive '/' delimiters
-  * MEMORY_ERROR if memory could not be allocated to complete request
+
+  The scan is done with strlen and memchr rather than a loop over
+  every character: the C library implements both with vector
+  instructions chosen for the running processor, so only the
+  delimiters themselves are visited one at a time.
 */
-static int Path_split(const char *pcPath, DynArray_T *poDComponents) {
-   const char *pcStart = pcPath;
-   const char *pcEnd = pcPath;
-   char *pcCopy;
-   DynArray_T oDSubstrings;
+static int Path_scan(const char *pcPath, size_t *pulDepth,
+                     size_t *pulLength) {
+   const char *pcDelim;
+   const char *pcEnd;
+   size_t ulDepth = 1;
+   size_t ulLength;
 
    assert(pcPath != NULL);
-   assert(poDComponents != NULL);
+   assert(pulDepth != NULL);
+   assert(pulLength != NULL);
+
+   ulLength = strlen(pcPath);
 
-   /* path cannot be empty string */
-   if(*pcPath == '\0') {
-      *poDComponents = NULL;
+   /* path cannot be empty string, or start or end with delimiter */
+   if(ulLength == 0 || pcPath[0] == '/' || pcPath[ulLength-1] == '/')
       return BAD_PATH;
-   }
 
-   oDSubstrings = DynArray_new(0);
-   if(oDSubstrings == NULL) {
-      *poDComponents = NULL;
-      return MEMORY_ERROR;
+   pcEnd = pcPath + ulLength;
+   for(pcDelim = memchr(pcPath, '/', ulLength); pcDelim != NULL;
+       pcDelim = memchr(pcDelim + 1, '/', (size_t)(pcEnd-pcDelim-1))) {
+      /* no consecutive delimiters */
+      if(pcDelim[1] == '/')
+         return BAD_PATH;
+      ulDepth++;
    }
 
-   /* validate and split pcPath */
-   while(*pcEnd != '\0') {
-      pcEnd = pcStart;
-      /* component can't start with delimiter */
-      if(*pcEnd == '/') {
-         DynArray_map(oDSubstrings,
-                      (void (*)(void*, void*)) Path_freeString, NULL);
-         DynArray_free(oDSubstrings);
-         *poDComponents = NULL;
-         return BAD_PATH;
-      }
+   *pulDepth = ulDepth;
+   *pulLength = ulLength;
+   return SUCCESS;
+}
 
-      /* advance pcEnd to end of next token */
-      while(*pcEnd != '/' && *pcEnd != '\0')
-         pcEnd++;
+/*
+  Allocates new path storage with room for a pathname of string
+  length ulLength and ulDepth components, with a reference count of 1.
+  The storage, its views and its pathname share one allocation, sized
+  exactly, so that building a path of any length costs a single call
+  to the allocator. Only the allocation is made: the pathname and the
+  views are left for the caller to fill in.
+  Returns the new storage, or NULL if memory could not be allocated.
+*/
+static struct pathStore *Path_allocStore(size_t ulLength,
+                                         size_t ulDepth) {
+   struct pathStore *psNew;
 
-      /* final component can't end with slash */
-      if(*pcEnd == '\0' && *(pcEnd-1) == '/') {
-         DynArray_map(oDSubstrings,
-                      (void (*)(void*, void*)) Path_freeString, NULL);
-         DynArray_free(oDSubstrings);
-         *poDComponents = NULL;
-         return BAD_PATH;
-      }
+   assert(ulDepth > 0);
 
-      pcCopy = calloc((size_t)(pcEnd-pcStart+1), sizeof(char));
-      if(pcCopy == NULL) {
-         DynArray_map(oDSubstrings,
-                      (void (*)(void*, void*)) Path_freeString, NULL);
-         DynArray_free(oDSubstrings);
-         *poDComponents = NULL;
-         return MEMORY_ERROR;
-      }
+   psNew = calloc(1, sizeof(struct pathStore)
+                     + ulDepth * sizeof(struct path)
+                     + ulLength + 1);
+   if(psNew == NULL)
+      return NULL;
 
-      if( DynArray_add(oDSubstrings, pcCopy) == 0) {
-         DynArray_map(oDSubstrings,
-                      (void (*)(void*, void*)) Path_freeString, NULL);
-         DynArray_free(oDSubstrings);
-         *poDComponents = NULL;
-         return MEMORY_ERROR;
-      }
+   psNew->psViews = (struct path *)(psNew + 1);
+   psNew->pcBuffer = (char *)(psNew->psViews + ulDepth);
+   psNew->ulRefs = 1;
+   psNew->ulLength = ulLength;
+   psNew->ulDepth = ulDepth;
 
-      while(pcStart != pcEnd) {
-         *pcCopy = *pcStart;
-         pcCopy++;
-         pcStart++;
-      }
+   return psNew;
+}
 
-      pcStart++;
-   }
+int Path_validate(const char *pcPath) {
+   size_t ulDepth, ulLength;
 
-   *poDComponents = oDSubstrings;
-   return SUCCESS;
-}
+   assert(pcPath != NULL);
 
+   return Path_scan(pcPath, &ulDepth, &ulLength);
+}
 
 int Path_new(const char *pcPath, Path_T *poPResult) {
-   struct path *psNew;
-   int iSplitResult;
+   struct pathStore *psStore;
+   struct path *psView;
+   const char *pcDelim;
+   size_t ulDepth, ulLength;
+   size_t ulLevel, ulStart, ulEnd;
+   unsigned long ulPrefixHash = 0;
+   int iStatus;
 
    assert(pcPath != NULL);
    assert(poPResult != NULL);
 
-   psNew = calloc(1, sizeof(struct path));
-   if(psNew == NULL) {
+   iStatus = Path_scan(pcPath, &ulDepth, &ulLength);
+   if(iStatus != SUCCESS) {
       *poPResult = NULL;
-      return MEMORY_ERROR;
+      return iStatus;
    }
 
-   /* instantiate and fill list of components */
-   iSplitResult = Path_split(pcPath, &psNew->oDComponents);
-   if(iSplitResult != SUCCESS) {
-      Path_free(psNew);
+   psStore = Path_allocStore(ulLength, ulDepth);
+   if(psStore == NULL) {
       *poPResult = NULL;
-      return iSplitResult;
+      return MEMORY_ERROR;
    }
 
-   psNew->ulLength = strlen(pcPath);
-   psNew->pcPath = malloc(psNew->ulLength+1);
-   if(psNew->pcPath == NULL) {
-      Path_free(psNew);
-      *poPResult = NULL;
-      return MEMORY_ERROR;
+   memcpy(psStore->pcBuffer, pcPath, ulLength + 1);
+
+   /* set up the view of each prefix, ending at each delimiter, and
+      intern each component */
+   ulLevel = 0;
+   ulStart = 0;
+   while(ulLevel < ulDepth) {
+      if(ulLevel + 1 < ulDepth) {
+         pcDelim = memchr(pcPath + ulStart, '/', ulLength - ulStart);
+         assert(pcDelim != NULL);
+         ulEnd = (size_t)(pcDelim - pcPath);
+      }
+      else
+         ulEnd = ulLength;
+
+      psView = &psStore->psViews[ulLevel];
+      psView->psStore = psStore;
+      psView->ulDepth = ulLevel + 1;
+      psView->ulLength = ulEnd;
+      psView->sLast.ulOffset = ulStart;
+      psView->sLast.ulLength = ulEnd - ulStart;
+      psView->sLast.ulHash = Path_hashComponent(pcPath + ulStart,
+                                                ulEnd - ulStart);
+      psView->sLast.pcAtom = Atom_new(pcPath + ulStart,
+                                      ulEnd - ulStart,
+                                      psView->sLast.ulHash);
+      if(psView->sLast.pcAtom == NULL) {
+         /* the views set up so far are released with the store */
+         psStore->ulDepth = ulLevel;
+         Path_free(psView);
+         *poPResult = NULL;
+         return MEMORY_ERROR;
+      }
+      ulPrefixHash = Path_extendHash(ulPrefixHash,
+                                     psView->sLast.ulHash);
+      psView->ulPrefixHash = ulPrefixHash;
+      ulLevel++;
+      ulStart = ulEnd + 1;
    }
-   strcpy((char *)psNew->pcPath, pcPath);
+   assert(ulLevel == ulDepth);
 
-   *poPResult = psNew;
+   *poPResult = &psStore->psViews[ulDepth - 1];
    return SUCCESS;
 }
 
 int Path_prefix(Path_T oPPath, size_t ulDepth, Path_T *poPResult) {
-   struct path *psNew;
-   size_t ulIndex, ulLength, ulSum;
-   const char *pcComponent;
-   char *pcCopy;
-   char *pcBuild;
-   char *pcInsert;
-
    assert(oPPath != NULL);
    assert(poPResult != NULL);
 
@@ -175,62 +234,9 @@ int Path_prefix(Path_T oPPath, size_t ulDepth, Path_T *poPResult) {
       return NO_SUCH_PATH;
    }
 
-   psNew = calloc(1, sizeof(struct path));
-   if(psNew == NULL) {
-      *poPResult = NULL;
-      return MEMORY_ERROR;
-   }
-
-   psNew->oDComponents = DynArray_new(ulDepth);
-   if(psNew->oDComponents == NULL) {
-      Path_free(psNew);
-      *poPResult = NULL;
-      return MEMORY_ERROR;
-   }
-
-   pcBuild = calloc(Path_getStrLength(oPPath)+1, sizeof(char));
-   if(pcBuild == NULL) {
-      Path_free(psNew);
-      *poPResult = NULL;
-      return MEMORY_ERROR;
-   }
-
-   pcInsert = pcBuild;
-   ulSum = 0;
-
-   for(ulIndex = 0; ulIndex < ulDepth; ulIndex++) {
-      /* deep copy each component to new DynArray */
-      pcComponent = Path_getComponent(oPPath, ulIndex);
-      ulLength = strlen(pcComponent);
-      pcCopy = calloc(ulLength + 1, sizeof(char));
-      if(pcCopy == NULL) {
-         free(pcBuild);
-         Path_free(psNew);
-         *poPResult = NULL;
-         return MEMORY_ERROR;
-      }
-      strcpy(pcCopy, pcComponent);
-      (void) DynArray_set(psNew->oDComponents, ulIndex, pcCopy);
-      /* construct prefix's pathname string */
-      strcpy(pcInsert, pcComponent);
-      pcInsert[ulLength] = '/';
-      ulSum += ulLength + 1;
-      pcInsert += ulLength + 1;
-   }
-   pcBuild[ulSum-1] = '\0';
-
-   /* shrink allocation to fit prefix's pathname string if needed */
-   pcInsert = realloc(pcBuild, ulSum);
-   if(pcInsert == NULL) {
-      free(pcBuild);
-      Path_free(psNew);
-      *poPResult = NULL;
-      return MEMORY_ERROR;
-   }
-   psNew->ulLength = ulSum-1;
-   psNew->pcPath = pcInsert;
-
-   *poPResult = psNew;
+   /* every prefix of the storage already has a view */
+   oPPath->psStore->ulRefs++;
+   *poPResult = &oPPath->psStore->psViews[ulDepth - 1];
    return SUCCESS;
 }
 
@@ -242,22 +248,56 @@ int Path_dup(Path_T oPPath, Path_T *poPResult) {
 }
 
 void Path_free(Path_T oPPath) {
-   if(oPPath != NULL) {
-      free((char *)oPPath->pcPath);
+   struct pathStore *psStore;
+   size_t ulLevel;
 
-      if(oPPath->oDComponents != NULL) {
-         DynArray_map(oPPath->oDComponents,
-                      (void (*)(void*, void*)) Path_freeString, NULL);
-         DynArray_free(oPPath->oDComponents);
-      }
+   if(oPPath == NULL)
+      return;
+
+   psStore = oPPath->psStore;
+   assert(psStore->ulRefs > 0);
+   psStore->ulRefs--;
+   if(psStore->ulRefs != 0)
+      return;
+
+   for(ulLevel = 0; ulLevel < psStore->ulDepth; ulLevel++) {
+      Atom_free(psStore->psViews[ulLevel].sLast.pcAtom);
+      free(psStore->psViews[ulLevel].pcPathname);
    }
-   free((struct path*) oPPath);
+   free(psStore);
 }
 
 const char *Path_getPathname(Path_T oPPath) {
+   struct path *psPath;
+
+   assert(oPPath != NULL);
+
+   /* the full path's pathname is the start of the storage buffer */
+   if(oPPath->ulDepth == oPPath->psStore->ulDepth)
+      return oPPath->psStore->pcBuffer;
+
+   /* a proper prefix's pathname is not '\0'-terminated there, so
+      build it the first time it is asked for, in the prefix's view,
+      which the storage holds, and keep it for later requests */
+   psPath = &oPPath->psStore->psViews[oPPath->ulDepth - 1];
+   if(psPath->pcPathname == NULL) {
+      psPath->pcPathname = malloc(oPPath->ulLength + 1);
+      if(psPath->pcPathname == NULL)
+         return NULL;
+      memcpy(psPath->pcPathname, oPPath->psStore->pcBuffer,
+             oPPath->ulLength);
+      psPath->pcPathname[oPPath->ulLength] = '\0';
+   }
+   return psPath->pcPathname;
+}
+
+char *Path_writePathname(Path_T oPPath, char *pcDest) {
    assert(oPPath != NULL);
+   assert(pcDest != NULL);
 
-   return oPPath->pcPath;
+   memcpy(pcDest, oPPath->psStore->pcBuffer, oPPath->ulLength);
+   pcDest[oPPath->ulLength] = '\0';
+   return pcDest + oPPath->ulLength;
 }
 
 size_t Path_getStrLength(Path_T oPPath) {
@@ -267,23 +307,53 @@ size_t Path_getStrLength(Path_T oPPath) {
 }
 
 int Path_comparePath(Path_T oPPath1, Path_T oPPath2) {
+   size_t ulMin;
+   int iCompare;
+
    assert(oPPath1 != NULL);
    assert(oPPath2 != NULL);
 
-   return strcmp(oPPath1->pcPath, oPPath2->pcPath);
+   /* prefixes of the same storage differ only in length */
+   if(oPPath1->psStore != oPPath2->psStore) {
+      if(oPPath1->ulLength < oPPath2->ulLength)
+         ulMin = oPPath1->ulLength;
+      else
+         ulMin = oPPath2->ulLength;
+      iCompare = memcmp(oPPath1->psStore->pcBuffer,
+                        oPPath2->psStore->pcBuffer, ulMin);
+      if(iCompare != 0)
+         return iCompare;
+   }
+
+   if(oPPath1->ulLength < oPPath2->ulLength)
+      return -1;
+   else if(oPPath1->ulLength > oPPath2->ulLength)
+      return 1;
+   else
+      return 0;
 }
 
 int Path_compareString(Path_T oPPath, const char *pcStr) {
+   const unsigned char *pucPath;
+   const unsigned char *pucStr = (const unsigned char *)pcStr;
+   size_t ulIndex;
+
    assert(oPPath != NULL);
    assert(pcStr != NULL);
 
-   return strcmp(oPPath->pcPath, pcStr);
+   /* strcmp, but stopping at the end of oPPath's pathname */
+   pucPath = (const unsigned char *)oPPath->psStore->pcBuffer;
+   for(ulIndex = 0; ulIndex < oPPath->ulLength; ulIndex++) {
+      if(pucPath[ulIndex] != pucStr[ulIndex])
+         return (int)pucPath[ulIndex] - (int)pucStr[ulIndex];
+   }
+   return -(int)pucStr[oPPath->ulLength];
 }
 
 size_t Path_getDepth(Path_T oPPath) {
    assert(oPPath != NULL);
 
-   return DynArray_getLength(oPPath->oDComponents);
+   return oPPath->ulDepth;
 }
 
 size_t Path_getSharedPrefixDepth(Path_T oPPath1, Path_T oPPath2) {
@@ -298,9 +368,15 @@ size_t Path_getSharedPrefixDepth(Path_T oPPath1, Path_T oPPath2) {
       ulMin = ulDepth1;
    else
       ulMin = ulDepth2;
+
+   /* prefixes of the same storage share all their components */
+   if(oPPath1->psStore == oPPath2->psStore)
+      return ulMin;
+
+   /* interned components are equal exactly when their atoms are */
    for(i = 0; i < ulMin; i++) {
-      if(strcmp(Path_getComponent(oPPath1, i),
-                Path_getComponent(oPPath2, i)))
+      if(oPPath1->psStore->psViews[i].sLast.pcAtom !=
+         oPPath2->psStore->psViews[i].sLast.pcAtom)
          return i;
    }
    return ulMin;
@@ -312,5 +388,44 @@ const char *Path_getComponent(Path_T oPPath, size_t ulLevel) {
    if(ulLevel >= Path_getDepth(oPPath))
       return NULL;
 
-   return DynArray_get(oPPath->oDComponents, ulLevel);
+   return oPPath->psStore->psViews[ulLevel].sLast.pcAtom;
+}
+
+unsigned long Path_getComponentHash(Path_T oPPath, size_t ulLevel) {
+   assert(oPPath != NULL);
+   assert(ulLevel < Path_getDepth(oPPath));
+
+   return oPPath->psStore->psViews[ulLevel].sLast.ulHash;
+}
+
+unsigned long Path_getPrefixHash(Path_T oPPath, size_t ulDepth) {
+   assert(oPPath != NULL);
+   assert(ulDepth > 0);
+   assert(ulDepth <= Path_getDepth(oPPath));
+
+   return oPPath->psStore->psViews[ulDepth - 1].ulPrefixHash;
+}
+
+unsigned long Path_hashComponent(const char *pcComponent,
+                                 size_t ulLength) {
+   const unsigned char *pucCurr = (const unsigned char *)pcComponent;
+   const unsigned char *pucEnd = pucCurr + ulLength;
+   unsigned long ulHash = PATH_HASH_BASIS;
+
+   assert(pcComponent != NULL);
+
+   while(pucCurr != pucEnd) {
+      ulHash ^= *pucCurr++;
+      ulHash *= PATH_HASH_PRIME;
+   }
+   return ulHash;
+}
+
+unsigned long Path_extendHash(unsigned long ulPrefixHash,
+                              unsigned long ulComponentHash) {
+   unsigned long ulHash;
+
+   /* mix so that the hash depends on the order of the components */
+   ulHash = (ulPrefixHash ^ ulComponentHash) * PATH_HASH_PRIME;
+   return ulHash ^ (ulHash >> 29);
 }
@@ -9,7 +9,12 @@
 #include <stddef.h>
 #include "a4def.h"
 
-/* An object representing an absolute path in a tree */
+/*
+  An object representing an absolute path in a tree. A path shares
+  its storage with its copies and prefixes, which update it without
+  locks, so a path and all the paths made from it must be used by
+  only one thread at a time.
+*/
 typedef const struct path * Path_T;
 
 /*
@@ -24,7 +29,19 @@ typedef const struct path * Path_T;
 int Path_new(const char *pcPath, Path_T *poPResult);
 
 /*
-  Creates a "deep copy" of oPPath, duplicating all its contents.
+  Checks that pcPath is a well-formatted absolute path, without
+  creating a path object or allocating any memory. Returns status:
+  * SUCCESS if Path_new would accept pcPath
+  * BAD_PATH if the string argument is the empty string
+             or begins with or ends with a '/'
+             or contains consecutive '/' delimiters
+*/
+int Path_validate(const char *pcPath);
+
+/*
+  Creates a copy of oPPath. The copy shares oPPath's storage, which is
+  reference counted, so this takes constant time and allocates no
+  memory. The copy must still be freed separately with Path_free.
   Returns an int SUCCESS status and sets *poPResult to be the new path
   if successful. Otherwise, sets *poPResult to NULL and returns status:
   * MEMORY_ERROR if memory could not be allocated to complete request
@@ -35,7 +52,9 @@ int Path_dup(Path_T oPPath, Path_T *poPResult);
 /*
   Creates a new path object representing a prefix (i.e., ancestor) of
   oPPath with depth ulDepth. In the case that ulDepth is the same as
-  oPPath's depth, this is equivalent to Path_dup.
+  oPPath's depth, this is equivalent to Path_dup. Like Path_dup, the
+  prefix shares oPPath's storage: this takes constant time and
+  allocates no memory, but the prefix must be freed with Path_free.
   Returns an int SUCCESS status and sets *poPResult to be the new path
   if successful. Otherwise, sets *poPResult to NULL and returns status:
   * MEMORY_ERROR if memory could not be allocated to complete request
@@ -43,12 +62,29 @@ int Path_dup(Path_T oPPath, Path_T *poPResult);
 */
 int Path_prefix(Path_T oPPath, size_t ulDepth, Path_T *poPResult);
 
-/* Destroys and frees all memory allocated for oPPath. */
+/*
+  Destroys oPPath, freeing the storage it shares with its copies and
+  prefixes once the last of them has been freed.
+*/
 void Path_free(Path_T oPPath);
 
-/* Returns the string representation of the absolute path oPPath. */
+/*
+  Returns the string representation of the absolute path oPPath.
+  For a path made by Path_prefix, the string is built (and then kept
+  for later calls) on the first call, so NULL is returned if memory
+  could not be allocated for it. Path_prefix and the comparison
+  functions below never build it.
+*/
 const char *Path_getPathname(Path_T oPPath);
 
+/*
+  Writes the string representation of oPPath, followed by a '\0',
+  into pcDest, which must have room for Path_getStrLength(oPPath) + 1
+  chars, allocating nothing. Returns a pointer to the '\0' written,
+  where more text may be appended.
+*/
+char *Path_writePathname(Path_T oPPath, char *pcDest);
+
 /*
   Returns the length (not including trailing '\0') of the string
   representation of the absolute path oPPath.
@@ -88,9 +124,46 @@ size_t Path_getSharedPrefixDepth(Path_T oPPath1, Path_T oPPath2);
 /*
   Returns the string version of the component of oPPath at level
   ulLevel. This count is from 0, so with level 0 the root of oPPath
-  would be returned.
+  would be returned. The string is an atom (see atom.h), so equal
+  components of any paths are returned as the same pointer, which
+  stays valid for as long as oPPath does.
   Returns NULL if ulLevel is greater than oPPath's maxium level.
 */
 const char *Path_getComponent(Path_T oPPath, size_t ulLevel);
 
+/*
+  Returns the hash of the component of oPPath at level ulLevel, which
+  is the value Path_hashComponent gives for that component's
+  characters. Equal components of any two paths have equal hashes, so
+  components with unequal hashes differ. ulLevel must be less than
+  oPPath's depth.
+*/
+unsigned long Path_getComponentHash(Path_T oPPath, size_t ulLevel);
+
+/*
+  Returns the hash of the prefix of oPPath with depth ulDepth, without
+  building that prefix: starting from 0, the hash of no components,
+  Path_extendHash is applied with each component's hash in turn.
+  Equal paths have equal hashes. ulDepth must be from 1 to oPPath's
+  depth, inclusive.
+*/
+unsigned long Path_getPrefixHash(Path_T oPPath, size_t ulDepth);
+
+/*
+  Returns the hash of the ulLength characters starting at pcComponent,
+  taken as a single path component. All path hashes are computed once,
+  when a path is created by Path_new, with this function and
+  Path_extendHash; clients can use them to hash names that are not
+  (yet) paths in a compatible way.
+*/
+unsigned long Path_hashComponent(const char *pcComponent,
+                                 size_t ulLength);
+
+/*
+  Returns the hash of the path made by appending a component with
+  hash ulComponentHash to a path with hash ulPrefixHash.
+*/
+unsigned long Path_extendHash(unsigned long ulPrefixHash,
+                              unsigned long ulComponentHash);
+
 #endif
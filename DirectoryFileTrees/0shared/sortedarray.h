@@ -0,0 +1,132 @@
+/*--------------------------------------------------------------------*/
+/* sortedarray.h                                                      */
+/* Author: Jacob Santelli and Joshua Yang                             */
+/*--------------------------------------------------------------------*/
+
+#ifndef SORTEDARRAY_INCLUDED
+#define SORTEDARRAY_INCLUDED
+
+#include <assert.h>
+#include <stddef.h>
+#include <string.h>
+
+/*
+  These macros generate functions over a plain C array of elements of
+  one type, kept sorted by one comparison function. Unlike DynArray's
+  functions, which work on void pointers and call their comparison
+  function through a pointer on every probe, the generated functions
+  are static and name the comparison function directly, so the
+  compiler can inline it into the search. The array itself and its
+  storage belong to the client, which passes the elements and their
+  number to each call.
+
+  Each macro is used once at file scope and defines functions whose
+  names begin with Prefix, for example:
+
+     SORTEDARRAY_SEARCH(NodeArray, Node_T, struct name,
+                        Node_compareName)
+
+  defines NodeArray_search over arrays of Node_T searched by a struct
+  name key. The two macros are separate so that a file that only
+  searches does not define (unused) functions to edit.
+*/
+
+/*
+  C90 has no inline keyword, and at -O2 GCC will not inline a
+  comparison function that is called from more than one place (or
+  that calls other functions). Clients mark their comparison function
+  SORTEDARRAY_INLINE, as the generated functions are, so that with
+  GCC it is inlined into every search; other compilers are left to
+  decide for themselves.
+*/
+#ifdef __GNUC__
+#define SORTEDARRAY_INLINE __inline__ __attribute__((always_inline))
+#else
+#define SORTEDARRAY_INLINE
+#endif
+
+/*
+  Defines
+
+     static int Prefix_search(Element *paElements, size_t ulLength,
+                              const Key *pKey, size_t *pulIndex)
+
+  which binary-searches the ulLength elements of paElements, which
+  must be sorted by Compare, for an element equal to *pKey. Compare
+  must be a function or macro taking (Element, const Key *) and
+  returning <0, 0, or >0 depending upon whether the element is less
+  than, equal to, or greater than the key, respectively. The search
+  returns 1 (TRUE) and stores the element's index in *pulIndex if
+  there is such an element; otherwise it returns 0 (FALSE) and stores
+  in *pulIndex the index where it would be inserted.
+*/
+#define SORTEDARRAY_SEARCH(Prefix, Element, Key, Compare)             \
+static SORTEDARRAY_INLINE int                                        \
+Prefix##_search(Element *paElements, size_t ulLength,                 \
+                const Key *pKey, size_t *pulIndex) {                  \
+   size_t ulLo = 0;                                                   \
+   size_t ulHi = ulLength;                                            \
+   size_t ulMid;                                                      \
+   int iCompare;                                                      \
+                                                                      \
+   assert(paElements != NULL || ulLength == 0);                       \
+   assert(pKey != NULL);                                              \
+   assert(pulIndex != NULL);                                          \
+                                                                      \
+   while(ulLo < ulHi) {                                               \
+      ulMid = ulLo + (ulHi - ulLo) / 2;                               \
+      iCompare = Compare(paElements[ulMid], pKey);                    \
+      if(iCompare > 0)                                                \
+         ulHi = ulMid;                                                \
+      else if(iCompare < 0)                                           \
+         ulLo = ulMid + 1;                                            \
+      else {                                                          \
+         *pulIndex = ulMid;                                           \
+         return 1;                                                    \
+      }                                                               \
+   }                                                                  \
+   *pulIndex = ulLo;                                                  \
+   return 0;                                                          \
+}
+
+/*
+  Defines
+
+     static void Prefix_insertAt(Element *paElements, size_t ulLength,
+                                 size_t ulIndex, Element element)
+     static Element Prefix_removeAt(Element *paElements,
+                                    size_t ulLength, size_t ulIndex)
+
+  Prefix_insertAt stores element at index ulIndex of the ulLength
+  elements of paElements, which must have room for one more, moving
+  the elements from ulIndex on up one index. ulIndex must be at most
+  ulLength. Prefix_removeAt removes and returns the element at index
+  ulIndex, which must be less than ulLength, moving the later
+  elements down one index. Neither changes the array's storage: the
+  client grows and shrinks it, and keeps its length.
+*/
+#define SORTEDARRAY_SHIFT(Prefix, Element)                            \
+static void Prefix##_insertAt(Element *paElements, size_t ulLength,   \
+                              size_t ulIndex, Element element) {      \
+   assert(paElements != NULL);                                        \
+   assert(ulIndex <= ulLength);                                       \
+                                                                      \
+   memmove(&paElements[ulIndex + 1], &paElements[ulIndex],            \
+           (ulLength - ulIndex) * sizeof(Element));                   \
+   paElements[ulIndex] = element;                                     \
+}                                                                     \
+                                                                      \
+static Element Prefix##_removeAt(Element *paElements,                 \
+                                 size_t ulLength, size_t ulIndex) {   \
+   Element removed;                                                   \
+                                                                      \
+   assert(paElements != NULL);                                        \
+   assert(ulIndex < ulLength);                                        \
+                                                                      \
+   removed = paElements[ulIndex];                                     \
+   memmove(&paElements[ulIndex], &paElements[ulIndex + 1],            \
+           (ulLength - ulIndex - 1) * sizeof(Element));               \
+   return removed;                                                    \
+}
+
+#endif
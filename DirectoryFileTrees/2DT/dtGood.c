@@ -365,16 +365,20 @@ static void DT_strlenAccumulate(Node_T oNNode, size_t *pulAcc) {
 }
 
 /*
-  Alternate version of strcat that inverts the typical argument
-  order, appending oNNode's path onto pcAcc, and also always adds one
-  newline at the end of the concatenated string.
+  Copies oNNode's path, followed by a newline and a '\0', to the write
+  cursor *ppcCursor, and advances the cursor to that '\0', where the
+  next path goes. Unlike strcat, never rescans what has been written,
+  so writing all the paths takes time linear in their total length.
 */
-static void DT_strcatAccumulate(Node_T oNNode, char *pcAcc) {
-   assert(pcAcc != NULL);
+static void DT_writeAccumulate(Node_T oNNode, char **ppcCursor) {
+   assert(ppcCursor != NULL);
+   assert(*ppcCursor != NULL);
 
    if(oNNode != NULL) {
-      strcat(pcAcc, Path_getPathname(Node_getPath(oNNode)));
-      strcat(pcAcc, "\n");
+      *ppcCursor = Path_writePathname(Node_getPath(oNNode),
+                                      *ppcCursor);
+      *(*ppcCursor)++ = '\n';
+      **ppcCursor = '\0';
    }
 }
 /*--------------------------------------------------------------------*/
@@ -383,6 +387,7 @@ char *DT_toString(void) {
    DynArray_T nodes;
    size_t totalStrlen = 1;
    char *result = NULL;
+   char *pcCursor;
 
    if(!bIsInitialized)
       return NULL;
@@ -400,8 +405,10 @@ char *DT_toString(void) {
    }
    *result = '\0';
 
-   DynArray_map(nodes, (void (*)(void *, void*)) DT_strcatAccumulate,
-                (void *) result);
+   pcCursor = result;
+   DynArray_map(nodes, (void (*)(void *, void*)) DT_writeAccumulate,
+                (void *) &pcCursor);
+   assert(pcCursor == result + totalStrlen - 1);
 
    DynArray_free(nodes);
 
@@ -46,6 +46,9 @@ Path_T Node_getPath(Node_T oNNode);
   identifier (as used in Node_getChild). If oNParent does not have
   such a child, stores in *pulChildID the identifier that such a
   child _would_ have if inserted.
+
+  oPPath must be one level below oNParent's path. Only its last
+  component is compared, so the cost does not depend on its depth.
 */
 boolean Node_hasChild(Node_T oNParent, Path_T oPPath,
                          size_t *pulChildID);
@@ -6,9 +6,10 @@
 #include <stdlib.h>
 #include <assert.h>
 #include <string.h>
-#include "dynarray.h"
+#include "atom.h"
 #include "nodeDT.h"
 #include "checkerDT.h"
+#include "sortedarray.h"
 
 /* A node in a DT */
 struct node {
@@ -16,10 +17,28 @@ struct node {
    Path_T oPPath;
    /* this node's parent */
    Node_T oNParent;
-   /* the object containing links to this node's children */
-   DynArray_T oDChildren;
+   /* the node's children in sorted order, or NULL if it has never
+      had any */
+   Node_T *poNChildren;
+   /* the number of children */
+   size_t ulChildCount;
+   /* the number of elements allocated for poNChildren */
+   size_t ulChildCapacity;
 };
 
+/* The number of elements first allocated for a children array */
+enum { MIN_CHILD_CAPACITY = 2 };
+
+/* A component name being searched for among a node's children */
+struct name {
+   /* the first character of the name */
+   const char *pcName;
+   /* the string length of the name */
+   size_t ulLength;
+};
+
+/* NodeArray_insertAt and NodeArray_removeAt shift arrays of children */
+SORTEDARRAY_SHIFT(NodeArray, Node_T)
 
 /*
   Links new child oNChild into oNParent's children array at index
@@ -28,29 +47,78 @@ struct node {
 */
 static int Node_addChild(Node_T oNParent, Node_T oNChild,
                          size_t ulIndex) {
+   Node_T *poNChildren;
+   size_t ulCapacity;
+
    assert(oNParent != NULL);
    assert(oNChild != NULL);
+   assert(ulIndex <= oNParent->ulChildCount);
+
+   if(oNParent->ulChildCount == oNParent->ulChildCapacity) {
+      if(oNParent->ulChildCapacity == 0)
+         ulCapacity = MIN_CHILD_CAPACITY;
+      else
+         ulCapacity = 2 * oNParent->ulChildCapacity;
+      poNChildren = realloc(oNParent->poNChildren,
+                            ulCapacity * sizeof(Node_T));
+      if(poNChildren == NULL)
+         return MEMORY_ERROR;
+      oNParent->poNChildren = poNChildren;
+      oNParent->ulChildCapacity = ulCapacity;
+   }
 
-   if(DynArray_addAt(oNParent->oDChildren, ulIndex, oNChild))
-      return SUCCESS;
-   else
-      return MEMORY_ERROR;
+   NodeArray_insertAt(oNParent->poNChildren, oNParent->ulChildCount,
+                      ulIndex, oNChild);
+   oNParent->ulChildCount++;
+   return SUCCESS;
+}
+
+/*
+  Sets *psName to the last component of oPPath, whose length is known
+  without scanning because the component is an atom.
+*/
+static void Node_lastName(Path_T oPPath, struct name *psName) {
+   assert(oPPath != NULL);
+   assert(psName != NULL);
+
+   psName->pcName = Path_getComponent(oPPath, Path_getDepth(oPPath) - 1);
+   psName->ulLength = Atom_getLength(psName->pcName);
 }
 
 /*
-  Compares the string representation of oNfirst with a string
-  pcSecond representing a node's path.
+  Compares the last component of oNFirst's path with the name
+  psSecond lexicographically. Among siblings, whose paths differ only
+  in that component, this orders nodes the same way as their paths.
   Returns <0, 0, or >0 if oNFirst is "less than", "equal to", or
-  "greater than" pcSecond, respectively.
+  "greater than" psSecond, respectively.
 */
-static int Node_compareString(const Node_T oNFirst,
-                                 const char *pcSecond) {
-   assert(oNFirst != NULL);
-   assert(pcSecond != NULL);
+static SORTEDARRAY_INLINE int Node_compareName(
+   const Node_T oNFirst, const struct name *psSecond) {
+   struct name sFirst;
+   int iCompare;
 
-   return Path_compareString(oNFirst->oPPath, pcSecond);
+   assert(oNFirst != NULL);
+   assert(psSecond != NULL);
+
+   Node_lastName(oNFirst->oPPath, &sFirst);
+   /* equal atoms are equal names */
+   if(sFirst.pcName == psSecond->pcName)
+      return 0;
+   if(sFirst.ulLength < psSecond->ulLength) {
+      iCompare = memcmp(sFirst.pcName, psSecond->pcName,
+                        sFirst.ulLength);
+      return iCompare != 0 ? iCompare : -1;
+   }
+   iCompare = memcmp(sFirst.pcName, psSecond->pcName,
+                     psSecond->ulLength);
+   if(iCompare != 0 || sFirst.ulLength == psSecond->ulLength)
+      return iCompare;
+   return 1;
 }
 
+/* NodeArray_search finds a name in an array of children, with
+   Node_compareName inlined rather than called through a pointer */
+SORTEDARRAY_SEARCH(NodeArray, Node_T, struct name, Node_compareName)
 
 /*
   Creates a new node with path oPPath and parent oNParent.  Returns an
@@ -135,13 +203,9 @@ int Node_new(Path_T oPPath, Node_T oNParent, Node_T *poNResult) {
    psNew->oNParent = oNParent;
 
    /* initialize the new node */
-   psNew->oDChildren = DynArray_new(0);
-   if(psNew->oDChildren == NULL) {
-      Path_free(psNew->oPPath);
-      free(psNew);
-      *poNResult = NULL;
-      return MEMORY_ERROR;
-   }
+   psNew->poNChildren = NULL;
+   psNew->ulChildCount = 0;
+   psNew->ulChildCapacity = 0;
 
    /* Link into parent's children list */
    if(oNParent != NULL) {
@@ -163,35 +227,48 @@ int Node_new(Path_T oPPath, Node_T oNParent, Node_T *poNResult) {
 }
 
 size_t Node_free(Node_T oNNode) {
+   Node_T oNCurr;
+   Node_T oNParent;
    size_t ulIndex;
    size_t ulCount = 0;
+   boolean bDone;
 
    assert(oNNode != NULL);
    assert(CheckerDT_Node_isValid(oNNode));
 
-   /* remove from parent's list */
+   /* remove from parent's list; of the subtree, only its root has to
+      be unlinked */
    if(oNNode->oNParent != NULL) {
-      if(DynArray_bsearch(
-            oNNode->oNParent->oDChildren,
-            oNNode, &ulIndex,
-            (int (*)(const void *, const void *)) Node_compare)
-        )
-         (void) DynArray_removeAt(oNNode->oNParent->oDChildren,
-                                  ulIndex);
+      if(Node_hasChild(oNNode->oNParent, oNNode->oPPath, &ulIndex)) {
+         (void) NodeArray_removeAt(oNNode->oNParent->poNChildren,
+                                   oNNode->oNParent->ulChildCount,
+                                   ulIndex);
+         oNNode->oNParent->ulChildCount--;
+      }
    }
 
-   /* recursively remove children */
-   while(DynArray_getLength(oNNode->oDChildren) != 0) {
-      ulCount += Node_free(DynArray_get(oNNode->oDChildren, 0));
+   /* free the subtree bottom-up without recursing: go down through
+      last children, dropping each from the end of its parent's array
+      on the way so nothing shifts, and free each node once it has no
+      children left, going back up through its parent link */
+   oNCurr = oNNode;
+   for(;;) {
+      if(oNCurr->ulChildCount != 0) {
+         oNCurr->ulChildCount--;
+         oNCurr = oNCurr->poNChildren[oNCurr->ulChildCount];
+         continue;
+      }
+      oNParent = oNCurr->oNParent;
+      bDone = (boolean) (oNCurr == oNNode);
+      free(oNCurr->poNChildren);
+      Path_free(oNCurr->oPPath);
+      free(oNCurr);
+      ulCount++;
+      if(bDone)
+         break;
+      oNCurr = oNParent;
    }
-   DynArray_free(oNNode->oDChildren);
 
-   /* remove path */
-   Path_free(oNNode->oPPath);
-
-   /* finally, free the struct node */
-   free(oNNode);
-   ulCount++;
    return ulCount;
 }
 
@@ -203,20 +280,26 @@ Path_T Node_getPath(Node_T oNNode) {
 
 boolean Node_hasChild(Node_T oNParent, Path_T oPPath,
                          size_t *pulChildID) {
+   struct name sName;
+
    assert(oNParent != NULL);
    assert(oPPath != NULL);
    assert(pulChildID != NULL);
-
-   /* *pulChildID is the index into oNParent->oDChildren */
-   return DynArray_bsearch(oNParent->oDChildren,
-            (char*) Path_getPathname(oPPath), pulChildID,
-            (int (*)(const void*,const void*)) Node_compareString);
+   /* siblings differ only in their last component */
+   assert(Path_getDepth(oPPath) == Path_getDepth(oNParent->oPPath) + 1);
+   assert(Path_getSharedPrefixDepth(oPPath, oNParent->oPPath)
+          == Path_getDepth(oNParent->oPPath));
+
+   /* *pulChildID is the index into oNParent->poNChildren */
+   Node_lastName(oPPath, &sName);
+   return (boolean) NodeArray_search(oNParent->poNChildren,
+                       oNParent->ulChildCount, &sName, pulChildID);
 }
 
 size_t Node_getNumChildren(Node_T oNParent) {
    assert(oNParent != NULL);
 
-   return DynArray_getLength(oNParent->oDChildren);
+   return oNParent->ulChildCount;
 }
 
 int  Node_getChild(Node_T oNParent, size_t ulChildID,
@@ -225,13 +308,13 @@ int  Node_getChild(Node_T oNParent, size_t ulChildID,
    assert(oNParent != NULL);
    assert(poNResult != NULL);
 
-   /* ulChildID is the index into oNParent->oDChildren */
+   /* ulChildID is the index into oNParent->poNChildren */
    if(ulChildID >= Node_getNumChildren(oNParent)) {
       *poNResult = NULL;
       return NO_SUCH_PATH;
    }
    else {
-      *poNResult = DynArray_get(oNParent->oDChildren, ulChildID);
+      *poNResult = oNParent->poNChildren[ulChildID];
       return SUCCESS;
    }
 }
@@ -257,6 +340,6 @@ char *Node_toString(Node_T oNNode) {
    copyPath = malloc(Path_getStrLength(Node_getPath(oNNode))+1);
    if(copyPath == NULL)
       return NULL;
-   else
-      return strcpy(copyPath, Path_getPathname(Node_getPath(oNNode)));
+   (void) Path_writePathname(Node_getPath(oNNode), copyPath);
+   return copyPath;
 }
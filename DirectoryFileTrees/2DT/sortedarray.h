@@ -0,0 +1 @@
+../0shared/sortedarray.h
\ No newline at end of file
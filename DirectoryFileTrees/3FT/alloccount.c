@@ -0,0 +1,116 @@
+/*--------------------------------------------------------------------*/
+/* alloccount.c                                                       */
+/* Author: Jacob Santelli and Joshua Yang                             */
+/*--------------------------------------------------------------------*/
+
+#include <assert.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "alloccount.h"
+
+/* The real allocation functions, provided by the linker */
+void *__real_malloc(size_t ulSize);
+void *__real_realloc(void *pvOld, size_t ulSize);
+void __real_free(void *pv);
+
+/* The header stored in front of every counted block, padded so that
+   the block that follows it is suitably aligned for any type */
+union header {
+   size_t ulSize;
+   long double ld;
+   void *pv;
+   long l;
+};
+
+/* The statistics so far */
+static struct AllocStats sStats;
+
+/* Returns the block that follows the header at pvHeader. */
+static void *AllocCount_block(void *pvHeader) {
+   return (union header *) pvHeader + 1;
+}
+
+/* Returns the header in front of the counted block pv. */
+static union header *AllocCount_header(void *pv) {
+   return (union header *) pv - 1;
+}
+
+/* Records that a block of ulSize bytes was allocated. */
+static void AllocCount_add(size_t ulSize) {
+   sStats.ulLiveBlocks++;
+   sStats.ulLiveBytes += ulSize;
+   if(sStats.ulLiveBytes > sStats.ulPeakBytes)
+      sStats.ulPeakBytes = sStats.ulLiveBytes;
+}
+
+/* Records that a block of ulSize bytes was freed. */
+static void AllocCount_remove(size_t ulSize) {
+   assert(sStats.ulLiveBlocks > 0);
+   assert(sStats.ulLiveBytes >= ulSize);
+
+   sStats.ulLiveBlocks--;
+   sStats.ulLiveBytes -= ulSize;
+}
+
+void *__wrap_malloc(size_t ulSize) {
+   union header *psHeader;
+
+   sStats.ulCalls++;
+   psHeader = __real_malloc(sizeof(union header) + ulSize);
+   if(psHeader == NULL)
+      return NULL;
+   psHeader->ulSize = ulSize;
+   AllocCount_add(ulSize);
+   return AllocCount_block(psHeader);
+}
+
+void *__wrap_calloc(size_t ulCount, size_t ulSize) {
+   void *pv;
+
+   if(ulSize != 0 && ulCount > ((size_t) -1) / ulSize)
+      return NULL;
+   pv = __wrap_malloc(ulCount * ulSize);
+   if(pv != NULL)
+      memset(pv, 0, ulCount * ulSize);
+   return pv;
+}
+
+void *__wrap_realloc(void *pvOld, size_t ulSize) {
+   union header *psHeader;
+   size_t ulOldSize;
+
+   if(pvOld == NULL)
+      return __wrap_malloc(ulSize);
+
+   sStats.ulCalls++;
+   ulOldSize = AllocCount_header(pvOld)->ulSize;
+   psHeader = __real_realloc(AllocCount_header(pvOld),
+                             sizeof(union header) + ulSize);
+   if(psHeader == NULL)
+      return NULL;
+   psHeader->ulSize = ulSize;
+   AllocCount_remove(ulOldSize);
+   AllocCount_add(ulSize);
+   return AllocCount_block(psHeader);
+}
+
+void __wrap_free(void *pv) {
+   union header *psHeader;
+
+   if(pv == NULL)
+      return;
+   psHeader = AllocCount_header(pv);
+   AllocCount_remove(psHeader->ulSize);
+   __real_free(psHeader);
+}
+
+void AllocCount_get(struct AllocStats *psStats) {
+   assert(psStats != NULL);
+
+   *psStats = sStats;
+}
+
+void AllocCount_resetPeak(void) {
+   sStats.ulPeakBytes = sStats.ulLiveBytes;
+}
@@ -0,0 +1,40 @@
+/*--------------------------------------------------------------------*/
+/* alloccount.h                                                       */
+/* Author: Jacob Santelli and Joshua Yang                             */
+/*--------------------------------------------------------------------*/
+
+#ifndef ALLOCCOUNT_INCLUDED
+#define ALLOCCOUNT_INCLUDED
+
+#include <stddef.h>
+
+/*
+  Accounting of the heap use of a program linked with
+     -Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc,--wrap=free
+  which routes every allocation made by the program's own objects
+  through this module. Allocations made inside the C library itself
+  are not seen.
+*/
+
+/* Statistics describing the program's heap use so far */
+struct AllocStats {
+   /* the number of calls to malloc, calloc, and realloc */
+   size_t ulCalls;
+   /* the number of blocks allocated and not yet freed */
+   size_t ulLiveBlocks;
+   /* the bytes requested for those blocks */
+   size_t ulLiveBytes;
+   /* the largest value ulLiveBytes has had */
+   size_t ulPeakBytes;
+};
+
+/* Fills *psStats with the current allocation statistics. */
+void AllocCount_get(struct AllocStats *psStats);
+
+/*
+  Lowers the peak to the bytes live now, so that the peak read after
+  some work shows how far that work alone raised heap use.
+*/
+void AllocCount_resetPeak(void);
+
+#endif
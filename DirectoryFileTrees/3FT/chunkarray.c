@@ -0,0 +1,458 @@
+/*--------------------------------------------------------------------*/
+/* chunkarray.c                                                       */
+/* Author: Jacob Santelli and Joshua Yang                             */
+/*--------------------------------------------------------------------*/
+
+#include <assert.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "chunkarray.h"
+
+/* The most elements a chunk holds */
+enum { CHUNK_CAPACITY = 256 };
+/* The elements put in each chunk by ChunkArray_new, leaving room for
+   later insertions */
+enum { CHUNK_FILL = CHUNK_CAPACITY / 4 * 3 };
+/* The number of chunk slots first allocated */
+enum { MIN_CHUNK_SLOTS = 4 };
+
+/* A run of consecutive elements */
+struct chunk {
+   /* the number of elements in the chunk, always at least 1 */
+   size_t ulCount;
+   /* the elements, each with its key */
+   struct ChunkEntry asEntries[CHUNK_CAPACITY];
+};
+
+/* An array of pointers split into chunks */
+struct ChunkArray {
+   /* the slab that the object and its chunks are allocated from */
+   Slab_T oSSlab;
+   /* the chunks, in order */
+   struct chunk **ppsChunks;
+   /* a Fenwick tree over the chunks' counts: element i (from 1) holds
+      the total count of chunks i - (i & -i) through i - 1 */
+   size_t *pulTree;
+   /* the number of chunks */
+   size_t ulChunks;
+   /* the number of slots allocated in ppsChunks and, plus one, in
+      pulTree */
+   size_t ulSlots;
+   /* the number of elements */
+   size_t ulLength;
+   /* a chunk recently looked up, which makes reading the elements in
+      order cheap, and the index of its first element; valid only if
+      bCursor */
+   size_t ulCursorChunk;
+   size_t ulCursorBase;
+   int bCursor;
+};
+
+/* Returns the lowest set bit of ul. */
+static size_t ChunkArray_lowBit(size_t ul) {
+   return ul & (~ul + 1);
+}
+
+/* Recomputes oChunkArray's Fenwick tree from its chunks' counts. */
+static void ChunkArray_rebuild(ChunkArray_T oChunkArray) {
+   size_t *pulTree = oChunkArray->pulTree;
+   size_t ulChunks = oChunkArray->ulChunks;
+   size_t i, j;
+
+   for(i = 1; i <= ulChunks; i++)
+      pulTree[i] = oChunkArray->ppsChunks[i - 1]->ulCount;
+   for(i = 1; i <= ulChunks; i++) {
+      j = i + ChunkArray_lowBit(i);
+      if(j <= ulChunks)
+         pulTree[j] += pulTree[i];
+   }
+   oChunkArray->bCursor = 0;
+}
+
+/* Records that chunk ulChunk of oChunkArray gained one element if
+   bGrew, or lost one if not. */
+static void ChunkArray_adjust(ChunkArray_T oChunkArray, size_t ulChunk,
+                              int bGrew) {
+   size_t i;
+
+   for(i = ulChunk + 1; i <= oChunkArray->ulChunks;
+       i += ChunkArray_lowBit(i)) {
+      if(bGrew)
+         oChunkArray->pulTree[i]++;
+      else
+         oChunkArray->pulTree[i]--;
+   }
+}
+
+/* Returns the total count of the chunks of oChunkArray before chunk
+   ulChunk, i.e., the index of ulChunk's first element. */
+static size_t ChunkArray_prefix(ChunkArray_T oChunkArray,
+                                size_t ulChunk) {
+   size_t ulSum = 0;
+   size_t i;
+
+   for(i = ulChunk; i > 0; i -= ChunkArray_lowBit(i))
+      ulSum += oChunkArray->pulTree[i];
+   return ulSum;
+}
+
+/*
+  Returns the chunk of oChunkArray holding the element at index
+  ulIndex, storing its position among the chunks in *pulChunk and the
+  element's position in it in *pulOffset.
+*/
+static struct chunk *ChunkArray_locate(ChunkArray_T oChunkArray,
+                                       size_t ulIndex,
+                                       size_t *pulChunk,
+                                       size_t *pulOffset) {
+   size_t ulChunk;
+   size_t ulBase;
+   size_t ulStep;
+   size_t ulRest;
+
+   assert(ulIndex < oChunkArray->ulLength);
+
+   ulChunk = oChunkArray->ulCursorChunk;
+   ulBase = oChunkArray->ulCursorBase;
+   if(oChunkArray->bCursor && ulIndex >= ulBase) {
+      /* in the cursor's chunk, or the next one */
+      if(ulIndex - ulBase >= oChunkArray->ppsChunks[ulChunk]->ulCount) {
+         ulBase += oChunkArray->ppsChunks[ulChunk]->ulCount;
+         ulChunk++;
+      }
+      if(ulChunk < oChunkArray->ulChunks && ulIndex - ulBase
+            < oChunkArray->ppsChunks[ulChunk]->ulCount) {
+         oChunkArray->ulCursorChunk = ulChunk;
+         oChunkArray->ulCursorBase = ulBase;
+         *pulChunk = ulChunk;
+         *pulOffset = ulIndex - ulBase;
+         return oChunkArray->ppsChunks[ulChunk];
+      }
+   }
+
+   /* descend the Fenwick tree to the last chunk starting at or
+      before ulIndex */
+   ulChunk = 0;
+   ulRest = ulIndex;
+   for(ulStep = 1; ulStep * 2 <= oChunkArray->ulChunks; ulStep *= 2)
+      ;
+   for(; ulStep > 0; ulStep /= 2) {
+      if(ulChunk + ulStep <= oChunkArray->ulChunks
+         && oChunkArray->pulTree[ulChunk + ulStep] <= ulRest) {
+         ulChunk += ulStep;
+         ulRest -= oChunkArray->pulTree[ulChunk];
+      }
+   }
+
+   oChunkArray->ulCursorChunk = ulChunk;
+   oChunkArray->ulCursorBase = ulIndex - ulRest;
+   oChunkArray->bCursor = 1;
+   *pulChunk = ulChunk;
+   *pulOffset = ulRest;
+   return oChunkArray->ppsChunks[ulChunk];
+}
+
+/*
+  Inserts a new, empty chunk into oChunkArray at position ulChunk
+  among its chunks, growing the chunk slots if they are full, and
+  returns it. The caller must fill it and then rebuild the Fenwick
+  tree. Returns NULL if insufficient memory is available, in which
+  case oChunkArray is unchanged.
+*/
+static struct chunk *ChunkArray_insertChunk(ChunkArray_T oChunkArray,
+                                            size_t ulChunk) {
+   struct chunk *psChunk;
+   struct chunk **ppsChunks;
+   size_t *pulTree;
+   size_t ulSlots;
+
+   assert(ulChunk <= oChunkArray->ulChunks);
+
+   if(oChunkArray->ulChunks == oChunkArray->ulSlots) {
+      ulSlots = 2 * oChunkArray->ulSlots;
+      pulTree = Slab_alloc(oChunkArray->oSSlab,
+                           (ulSlots + 1) * sizeof(size_t));
+      if(pulTree == NULL)
+         return NULL;
+      ppsChunks = Slab_resize(oChunkArray->oSSlab,
+                     oChunkArray->ppsChunks,
+                     oChunkArray->ulSlots * sizeof(struct chunk *),
+                     ulSlots * sizeof(struct chunk *));
+      if(ppsChunks == NULL) {
+         Slab_release(oChunkArray->oSSlab, pulTree,
+                      (ulSlots + 1) * sizeof(size_t));
+         return NULL;
+      }
+      Slab_release(oChunkArray->oSSlab, oChunkArray->pulTree,
+                   (oChunkArray->ulSlots + 1) * sizeof(size_t));
+      oChunkArray->ppsChunks = ppsChunks;
+      oChunkArray->pulTree = pulTree;
+      oChunkArray->ulSlots = ulSlots;
+      ChunkArray_rebuild(oChunkArray);
+   }
+
+   psChunk = Slab_alloc(oChunkArray->oSSlab, sizeof(struct chunk));
+   if(psChunk == NULL)
+      return NULL;
+   psChunk->ulCount = 0;
+
+   memmove(&oChunkArray->ppsChunks[ulChunk + 1],
+           &oChunkArray->ppsChunks[ulChunk],
+           (oChunkArray->ulChunks - ulChunk) * sizeof(struct chunk *));
+   oChunkArray->ppsChunks[ulChunk] = psChunk;
+   oChunkArray->ulChunks++;
+   return psChunk;
+}
+
+/* Removes the chunk at position ulChunk from oChunkArray's chunks and
+   releases it. The caller must then rebuild the Fenwick tree. */
+static void ChunkArray_removeChunk(ChunkArray_T oChunkArray,
+                                   size_t ulChunk) {
+   assert(ulChunk < oChunkArray->ulChunks);
+
+   Slab_release(oChunkArray->oSSlab, oChunkArray->ppsChunks[ulChunk],
+                sizeof(struct chunk));
+   oChunkArray->ulChunks--;
+   memmove(&oChunkArray->ppsChunks[ulChunk],
+           &oChunkArray->ppsChunks[ulChunk + 1],
+           (oChunkArray->ulChunks - ulChunk) * sizeof(struct chunk *));
+}
+
+ChunkArray_T ChunkArray_new(Slab_T oSSlab,
+                            const struct ChunkEntry *psEntries,
+                            size_t ulLength) {
+   ChunkArray_T oChunkArray;
+   struct chunk *psChunk;
+   size_t ulSlots = MIN_CHUNK_SLOTS;
+   size_t ulCount;
+   size_t i;
+
+   assert(oSSlab != NULL);
+   assert(psEntries != NULL || ulLength == 0);
+
+   while(ulSlots * CHUNK_FILL < ulLength)
+      ulSlots *= 2;
+
+   oChunkArray = Slab_alloc(oSSlab, sizeof(struct ChunkArray));
+   if(oChunkArray == NULL)
+      return NULL;
+   oChunkArray->oSSlab = oSSlab;
+   oChunkArray->ulChunks = 0;
+   oChunkArray->ulSlots = ulSlots;
+   oChunkArray->ulLength = 0;
+   oChunkArray->bCursor = 0;
+   oChunkArray->ppsChunks = Slab_alloc(oSSlab,
+                               ulSlots * sizeof(struct chunk *));
+   oChunkArray->pulTree = Slab_alloc(oSSlab,
+                             (ulSlots + 1) * sizeof(size_t));
+   if(oChunkArray->ppsChunks == NULL || oChunkArray->pulTree == NULL) {
+      ChunkArray_free(oChunkArray);
+      return NULL;
+   }
+
+   for(i = 0; i < ulLength; i += ulCount) {
+      psChunk = ChunkArray_insertChunk(oChunkArray,
+                                       oChunkArray->ulChunks);
+      if(psChunk == NULL) {
+         ChunkArray_free(oChunkArray);
+         return NULL;
+      }
+      ulCount = ulLength - i < CHUNK_FILL ? ulLength - i : CHUNK_FILL;
+      memcpy(psChunk->asEntries, &psEntries[i],
+             ulCount * sizeof(struct ChunkEntry));
+      psChunk->ulCount = ulCount;
+      oChunkArray->ulLength += ulCount;
+   }
+   ChunkArray_rebuild(oChunkArray);
+   return oChunkArray;
+}
+
+void ChunkArray_free(ChunkArray_T oChunkArray) {
+   Slab_T oSSlab;
+   size_t i;
+
+   if(oChunkArray == NULL)
+      return;
+
+   oSSlab = oChunkArray->oSSlab;
+   for(i = 0; i < oChunkArray->ulChunks; i++)
+      Slab_release(oSSlab, oChunkArray->ppsChunks[i],
+                   sizeof(struct chunk));
+   Slab_release(oSSlab, oChunkArray->ppsChunks,
+                oChunkArray->ulSlots * sizeof(struct chunk *));
+   Slab_release(oSSlab, oChunkArray->pulTree,
+                (oChunkArray->ulSlots + 1) * sizeof(size_t));
+   Slab_release(oSSlab, oChunkArray, sizeof(struct ChunkArray));
+}
+
+size_t ChunkArray_getLength(ChunkArray_T oChunkArray) {
+   assert(oChunkArray != NULL);
+
+   return oChunkArray->ulLength;
+}
+
+void *ChunkArray_get(ChunkArray_T oChunkArray, size_t ulIndex) {
+   struct chunk *psChunk;
+   size_t ulChunk;
+   size_t ulOffset;
+
+   assert(oChunkArray != NULL);
+
+   psChunk = ChunkArray_locate(oChunkArray, ulIndex, &ulChunk,
+                               &ulOffset);
+   return psChunk->asEntries[ulOffset].pvElement;
+}
+
+void *ChunkArray_set(ChunkArray_T oChunkArray, size_t ulIndex,
+                     void *pvElement) {
+   struct chunk *psChunk;
+   size_t ulChunk;
+   size_t ulOffset;
+   void *pvOld;
+
+   assert(oChunkArray != NULL);
+
+   psChunk = ChunkArray_locate(oChunkArray, ulIndex, &ulChunk,
+                               &ulOffset);
+   pvOld = psChunk->asEntries[ulOffset].pvElement;
+   psChunk->asEntries[ulOffset].pvElement = pvElement;
+   return pvOld;
+}
+
+size_t ChunkArray_getChunkCount(ChunkArray_T oChunkArray) {
+   assert(oChunkArray != NULL);
+
+   return oChunkArray->ulChunks;
+}
+
+struct ChunkEntry *ChunkArray_getChunk(ChunkArray_T oChunkArray,
+                                       size_t ulChunk,
+                                       size_t *pulCount) {
+   assert(oChunkArray != NULL);
+   assert(ulChunk < oChunkArray->ulChunks);
+   assert(pulCount != NULL);
+
+   *pulCount = oChunkArray->ppsChunks[ulChunk]->ulCount;
+   return oChunkArray->ppsChunks[ulChunk]->asEntries;
+}
+
+size_t ChunkArray_getChunkBase(ChunkArray_T oChunkArray,
+                               size_t ulChunk) {
+   assert(oChunkArray != NULL);
+   assert(ulChunk < oChunkArray->ulChunks);
+
+   oChunkArray->ulCursorChunk = ulChunk;
+   oChunkArray->ulCursorBase = ChunkArray_prefix(oChunkArray, ulChunk);
+   oChunkArray->bCursor = 1;
+   return oChunkArray->ulCursorBase;
+}
+
+int ChunkArray_addAt(ChunkArray_T oChunkArray, size_t ulIndex,
+                     void *pvElement, unsigned long ulKey) {
+   struct chunk *psChunk;
+   struct chunk *psNew;
+   size_t ulChunk;
+   size_t ulOffset;
+
+   assert(oChunkArray != NULL);
+   assert(ulIndex <= oChunkArray->ulLength);
+
+   if(oChunkArray->ulChunks == 0) {
+      if(ChunkArray_insertChunk(oChunkArray, 0) == NULL)
+         return 0;
+      ChunkArray_rebuild(oChunkArray);
+   }
+
+   /* find the chunk and position to insert at */
+   if(ulIndex == oChunkArray->ulLength) {
+      ulChunk = oChunkArray->ulChunks - 1;
+      psChunk = oChunkArray->ppsChunks[ulChunk];
+      ulOffset = psChunk->ulCount;
+   }
+   else
+      psChunk = ChunkArray_locate(oChunkArray, ulIndex, &ulChunk,
+                                  &ulOffset);
+
+   if(psChunk->ulCount == CHUNK_CAPACITY) {
+      psNew = ChunkArray_insertChunk(oChunkArray, ulChunk + 1);
+      if(psNew == NULL)
+         return 0;
+      if(ulOffset == CHUNK_CAPACITY) {
+         /* appending past a full chunk: start the next one, which
+            keeps chunks full when elements arrive in order */
+         psChunk = psNew;
+         ulChunk++;
+         ulOffset = 0;
+      }
+      else {
+         /* split the chunk in half */
+         psNew->ulCount = CHUNK_CAPACITY / 2;
+         memcpy(psNew->asEntries,
+                &psChunk->asEntries[CHUNK_CAPACITY / 2],
+                psNew->ulCount * sizeof(struct ChunkEntry));
+         psChunk->ulCount = CHUNK_CAPACITY / 2;
+         if(ulOffset > CHUNK_CAPACITY / 2) {
+            psChunk = psNew;
+            ulChunk++;
+            ulOffset -= CHUNK_CAPACITY / 2;
+         }
+      }
+      ChunkArray_rebuild(oChunkArray);
+   }
+
+   memmove(&psChunk->asEntries[ulOffset + 1],
+           &psChunk->asEntries[ulOffset],
+           (psChunk->ulCount - ulOffset) * sizeof(struct ChunkEntry));
+   psChunk->asEntries[ulOffset].ulKey = ulKey;
+   psChunk->asEntries[ulOffset].pvElement = pvElement;
+   psChunk->ulCount++;
+   oChunkArray->ulLength++;
+   ChunkArray_adjust(oChunkArray, ulChunk, 1);
+   oChunkArray->bCursor = 0;
+   return 1;
+}
+
+void *ChunkArray_removeAt(ChunkArray_T oChunkArray, size_t ulIndex) {
+   struct chunk *psChunk;
+   struct chunk *psNext;
+   size_t ulChunk;
+   size_t ulOffset;
+   void *pvElement;
+
+   assert(oChunkArray != NULL);
+   assert(ulIndex < oChunkArray->ulLength);
+
+   psChunk = ChunkArray_locate(oChunkArray, ulIndex, &ulChunk,
+                               &ulOffset);
+   pvElement = psChunk->asEntries[ulOffset].pvElement;
+   psChunk->ulCount--;
+   memmove(&psChunk->asEntries[ulOffset],
+           &psChunk->asEntries[ulOffset + 1],
+           (psChunk->ulCount - ulOffset) * sizeof(struct ChunkEntry));
+   oChunkArray->ulLength--;
+   oChunkArray->bCursor = 0;
+
+   if(psChunk->ulCount == 0) {
+      ChunkArray_removeChunk(oChunkArray, ulChunk);
+      ChunkArray_rebuild(oChunkArray);
+   }
+   else if(ulChunk + 1 < oChunkArray->ulChunks
+           && psChunk->ulCount
+              + oChunkArray->ppsChunks[ulChunk + 1]->ulCount
+              <= CHUNK_CAPACITY / 2) {
+      /* merge with the next chunk so chunks stay at least a quarter
+         full on average */
+      psNext = oChunkArray->ppsChunks[ulChunk + 1];
+      memcpy(&psChunk->asEntries[psChunk->ulCount],
+             psNext->asEntries,
+             psNext->ulCount * sizeof(struct ChunkEntry));
+      psChunk->ulCount += psNext->ulCount;
+      ChunkArray_removeChunk(oChunkArray, ulChunk + 1);
+      ChunkArray_rebuild(oChunkArray);
+   }
+   else
+      ChunkArray_adjust(oChunkArray, ulChunk, 0);
+
+   return pvElement;
+}
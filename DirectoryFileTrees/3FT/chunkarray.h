@@ -0,0 +1,105 @@
+/*--------------------------------------------------------------------*/
+/* chunkarray.h                                                       */
+/* Author: Jacob Santelli and Joshua Yang                             */
+/*--------------------------------------------------------------------*/
+
+#ifndef CHUNKARRAY_INCLUDED
+#define CHUNKARRAY_INCLUDED
+
+#include <stddef.h>
+#include "slab.h"
+
+/*
+  A ChunkArray_T object is an array of pointers kept as a sequence of
+  bounded chunks rather than in one block, for arrays too long to
+  shift on every insertion. Inserting or removing an element moves
+  only part of one chunk, and an index over the chunks' lengths finds
+  the chunk holding any index in logarithmic time. Reading the
+  elements in index order is constant time per element.
+*/
+typedef struct ChunkArray *ChunkArray_T;
+
+/*
+  An element of a ChunkArray_T, stored in the chunk beside the key
+  that the client gave with it. The array does not interpret the key;
+  a client searching the chunks itself can use it to order elements
+  without following pvElement.
+*/
+struct ChunkEntry {
+   /* the element's key */
+   unsigned long ulKey;
+   /* the element */
+   void *pvElement;
+};
+
+/*
+  Returns a new ChunkArray_T object, allocated from oSSlab, holding
+  the ulLength elements and keys of psEntries in order, or NULL if
+  insufficient memory is available.
+*/
+ChunkArray_T ChunkArray_new(Slab_T oSSlab,
+                            const struct ChunkEntry *psEntries,
+                            size_t ulLength);
+
+/* Frees oChunkArray, which must have been allocated from oSSlab. */
+void ChunkArray_free(ChunkArray_T oChunkArray);
+
+/* Returns the number of elements in oChunkArray. */
+size_t ChunkArray_getLength(ChunkArray_T oChunkArray);
+
+/*
+  Returns the element of oChunkArray at index ulIndex, which must be
+  less than its length.
+*/
+void *ChunkArray_get(ChunkArray_T oChunkArray, size_t ulIndex);
+
+/*
+  Replaces the element of oChunkArray at index ulIndex, which must be
+  less than its length, with pvElement, keeping its key. Returns the
+  element replaced.
+*/
+void *ChunkArray_set(ChunkArray_T oChunkArray, size_t ulIndex,
+                     void *pvElement);
+
+/* Returns the number of chunks oChunkArray's elements are kept in. */
+size_t ChunkArray_getChunkCount(ChunkArray_T oChunkArray);
+
+/*
+  Returns the entries of chunk ulChunk of oChunkArray, which must be
+  less than its chunk count, and stores their number (always at least
+  1) in *pulCount. The entries may be read, and searched in place,
+  until oChunkArray is next changed. A client searching a sorted
+  ChunkArray_T this way can use a comparison that its compiler
+  inlines (see sortedarray.h) and that looks at the keys first.
+*/
+struct ChunkEntry *ChunkArray_getChunk(ChunkArray_T oChunkArray,
+                                       size_t ulChunk,
+                                       size_t *pulCount);
+
+/*
+  Returns the index in oChunkArray of the first element of chunk
+  ulChunk, which must be less than its chunk count. Accessing,
+  inserting or removing an element near there afterwards does not
+  need to find the chunk again.
+*/
+size_t ChunkArray_getChunkBase(ChunkArray_T oChunkArray,
+                               size_t ulChunk);
+
+/*
+  Inserts pvElement, with key ulKey, into oChunkArray at index
+  ulIndex, which must be at most its length, moving later elements up
+  one index. Returns 1 (TRUE) if successful, or 0 (FALSE) if
+  insufficient memory is available, in which case oChunkArray is
+  unchanged.
+*/
+int ChunkArray_addAt(ChunkArray_T oChunkArray, size_t ulIndex,
+                     void *pvElement, unsigned long ulKey);
+
+/*
+  Removes the element of oChunkArray at index ulIndex, which must be
+  less than its length, moving later elements down one index. Returns
+  the removed element.
+*/
+void *ChunkArray_removeAt(ChunkArray_T oChunkArray, size_t ulIndex);
+
+#endif
@@ -0,0 +1,323 @@
+/*--------------------------------------------------------------------*/
+/* epoch.c                                                            */
+/* Author: Jacob Santelli and Joshua Yang                             */
+/*--------------------------------------------------------------------*/
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <assert.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <stdlib.h>
+
+#include "epoch.h"
+
+/* The size of a cache line, to which each reader slot is padded so
+   that a reader only ever writes a line of its own */
+enum { EPOCH_LINE_SIZE = 64 };
+
+/* The slot in which one thread announces the epoch its read started
+   in, claimed by the thread on its first read and given up when it
+   exits */
+struct slotFields {
+   /* the epoch the thread's read started in, or 0 if it is not
+      reading; written only by the thread */
+   unsigned long ulEpoch;
+   /* the number of reads the thread has nested in the slot; touched
+      only by the thread */
+   size_t ulDepth;
+   /* 1 if a thread holds the slot, or 0 if it is free */
+   int iOwned;
+   /* the next slot, set once before the slot is listed */
+   union readerSlot *psNext;
+};
+
+/* A reader slot, padded to a cache line of its own */
+union readerSlot {
+   /* the slot's fields */
+   struct slotFields s;
+   /* padding */
+   char acPad[EPOCH_LINE_SIZE];
+};
+
+/* The current epoch, advanced by each retirement. 0 is never an
+   epoch, so that it can mean a slot is not reading. */
+static unsigned long ulCurrentEpoch = 1;
+
+/* Every reader slot ever allocated, listed newest first; slots are
+   reused but never freed */
+static union readerSlot *psSlots = NULL;
+
+/* The number of reads in progress on threads that could get no slot;
+   while any are, nothing is freed */
+static unsigned long ulSlotlessReads = 0;
+
+/* The key under which each thread keeps its slot, and whether it
+   could be created */
+static pthread_key_t sSlotKey;
+static int iKeyCreated = 0;
+static pthread_once_t sKeyOnce = PTHREAD_ONCE_INIT;
+
+/* A list of retired records */
+struct EpochList {
+   /* guards the other fields */
+   pthread_mutex_t sLock;
+   /* the records retired and not yet freed, oldest first, so in the
+      order of their epochs, and the last of them; psFirst is stored
+      atomically, for Epoch_reclaim to check without the lock */
+   struct EpochRetired *psFirst;
+   struct EpochRetired *psLast;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* Frees the slot pvSlot of a thread that is exiting, for another
+   thread to claim. */
+static void Epoch_releaseSlot(void *pvSlot) {
+   union readerSlot *psSlot = pvSlot;
+
+   assert(psSlot != NULL);
+   assert(psSlot->s.ulDepth == 0);
+
+   __atomic_store_n(&psSlot->s.iOwned, 0, __ATOMIC_RELEASE);
+}
+
+/* Creates the key under which each thread keeps its slot. */
+static void Epoch_createKey(void) {
+   if(pthread_key_create(&sSlotKey, Epoch_releaseSlot) == 0)
+      iKeyCreated = 1;
+}
+
+/*
+  Returns the calling thread's slot, claiming it a free one or, if
+  there is none, allocating a new one on its first call. Returns NULL
+  if the thread has no slot and none could be had.
+*/
+static union readerSlot *Epoch_slot(void) {
+   union readerSlot *psSlot;
+   union readerSlot *psFirst;
+   int iFree;
+   void *pvSlot;
+
+   if(pthread_once(&sKeyOnce, Epoch_createKey) != 0 || !iKeyCreated)
+      return NULL;
+
+   psSlot = pthread_getspecific(sSlotKey);
+   if(psSlot != NULL)
+      return psSlot;
+
+   /* claim the slot of a thread that has exited */
+   for(psSlot = __atomic_load_n(&psSlots, __ATOMIC_ACQUIRE);
+       psSlot != NULL; psSlot = psSlot->s.psNext) {
+      iFree = 0;
+      if(__atomic_load_n(&psSlot->s.iOwned, __ATOMIC_RELAXED) == 0 &&
+         __atomic_compare_exchange_n(&psSlot->s.iOwned, &iFree, 1, 0,
+                                     __ATOMIC_ACQUIRE,
+                                     __ATOMIC_RELAXED))
+         break;
+   }
+
+   /* or list a new one */
+   if(psSlot == NULL) {
+      if(posix_memalign(&pvSlot, EPOCH_LINE_SIZE,
+                        sizeof(union readerSlot)) != 0)
+         return NULL;
+      psSlot = pvSlot;
+      psSlot->s.ulEpoch = 0;
+      psSlot->s.ulDepth = 0;
+      psSlot->s.iOwned = 1;
+      psFirst = __atomic_load_n(&psSlots, __ATOMIC_RELAXED);
+      do
+         psSlot->s.psNext = psFirst;
+      while(!__atomic_compare_exchange_n(&psSlots, &psFirst, psSlot, 0,
+                                         __ATOMIC_RELEASE,
+                                         __ATOMIC_RELAXED));
+   }
+
+   if(pthread_setspecific(sSlotKey, psSlot) != 0) {
+      Epoch_releaseSlot(psSlot);
+      return NULL;
+   }
+   return psSlot;
+}
+
+/*--------------------------------------------------------------------*/
+
+void Epoch_enter(void) {
+   union readerSlot *psSlot;
+   unsigned long ulEpoch;
+   unsigned long ulCurrent;
+
+   psSlot = Epoch_slot();
+   if(psSlot == NULL) {
+      __atomic_fetch_add(&ulSlotlessReads, 1, __ATOMIC_SEQ_CST);
+      /* see below */
+      (void) __atomic_load_n(&ulCurrentEpoch, __ATOMIC_SEQ_CST);
+      return;
+   }
+
+   if(psSlot->s.ulDepth++ > 0)
+      return;
+
+   /* announce the epoch, then read it back, both sequentially
+      consistently, as Epoch_retire advances it and Epoch_reclaim then
+      reads the slots: if Epoch_reclaim read the slot before the
+      announcement, the epoch read back is the advanced one, and this
+      read sees everything unlinked before it was advanced */
+   ulEpoch = __atomic_load_n(&ulCurrentEpoch, __ATOMIC_ACQUIRE);
+   for(;;) {
+      __atomic_store_n(&psSlot->s.ulEpoch, ulEpoch, __ATOMIC_SEQ_CST);
+      ulCurrent = __atomic_load_n(&ulCurrentEpoch, __ATOMIC_SEQ_CST);
+      if(ulCurrent == ulEpoch)
+         break;
+      ulEpoch = ulCurrent;
+   }
+}
+
+void Epoch_leave(void) {
+   union readerSlot *psSlot = NULL;
+
+   if(iKeyCreated)
+      psSlot = pthread_getspecific(sSlotKey);
+
+   /* a thread's slotless reads all started before it got a slot, so
+      they are the outermost ones */
+   if(psSlot == NULL || psSlot->s.ulDepth == 0) {
+      assert(__atomic_load_n(&ulSlotlessReads, __ATOMIC_RELAXED) > 0);
+      __atomic_fetch_sub(&ulSlotlessReads, 1, __ATOMIC_RELEASE);
+      return;
+   }
+
+   if(--psSlot->s.ulDepth == 0)
+      __atomic_store_n(&psSlot->s.ulEpoch, 0, __ATOMIC_RELEASE);
+}
+
+/*--------------------------------------------------------------------*/
+
+EpochList_T Epoch_newList(void) {
+   EpochList_T oEList;
+
+   oEList = malloc(sizeof(struct EpochList));
+   if(oEList == NULL)
+      return NULL;
+   if(pthread_mutex_init(&oEList->sLock, NULL) != 0) {
+      free(oEList);
+      return NULL;
+   }
+   oEList->psFirst = NULL;
+   oEList->psLast = NULL;
+   return oEList;
+}
+
+void Epoch_freeList(EpochList_T oEList) {
+   if(oEList == NULL)
+      return;
+
+   assert(oEList->psFirst == NULL);
+
+   (void) pthread_mutex_destroy(&oEList->sLock);
+   free(oEList);
+}
+
+void Epoch_retire(EpochList_T oEList, struct EpochRetired *psRetired) {
+   assert(oEList != NULL);
+   assert(psRetired != NULL);
+   assert(psRetired->pfFree != NULL);
+
+   psRetired->psNext = NULL;
+   (void) pthread_mutex_lock(&oEList->sLock);
+   /* reads that see the advanced epoch start after the unlink; taking
+      the epoch under the lock keeps the list in the order of the
+      epochs, though writers of other lists advance it too */
+   psRetired->ulEpoch =
+      __atomic_fetch_add(&ulCurrentEpoch, 1, __ATOMIC_SEQ_CST);
+   if(oEList->psLast == NULL)
+      __atomic_store_n(&oEList->psFirst, psRetired, __ATOMIC_RELAXED);
+   else
+      oEList->psLast->psNext = psRetired;
+   oEList->psLast = psRetired;
+   (void) pthread_mutex_unlock(&oEList->sLock);
+}
+
+/*
+  Unlinks from oEList the records retired in an epoch before ulOldest,
+  which are at its start, and returns the first of them, linked in
+  order, or NULL if there are none.
+*/
+static struct EpochRetired *Epoch_detach(EpochList_T oEList,
+                                         unsigned long ulOldest) {
+   struct EpochRetired *psFirst;
+   struct EpochRetired *psLast = NULL;
+   struct EpochRetired *psRetired;
+
+   assert(oEList != NULL);
+
+   (void) pthread_mutex_lock(&oEList->sLock);
+   psFirst = oEList->psFirst;
+   for(psRetired = psFirst;
+       psRetired != NULL && psRetired->ulEpoch < ulOldest;
+       psRetired = psRetired->psNext)
+      psLast = psRetired;
+   if(psLast == NULL)
+      psFirst = NULL;
+   else {
+      __atomic_store_n(&oEList->psFirst, psLast->psNext,
+                       __ATOMIC_RELAXED);
+      if(oEList->psFirst == NULL)
+         oEList->psLast = NULL;
+      psLast->psNext = NULL;
+   }
+   (void) pthread_mutex_unlock(&oEList->sLock);
+   return psFirst;
+}
+
+/* Frees the records linked from psRetired with their pfFree. Returns
+   the number freed. */
+static size_t Epoch_freeRecords(struct EpochRetired *psRetired) {
+   struct EpochRetired *psNext;
+   size_t ulFreed = 0;
+
+   for(; psRetired != NULL; psRetired = psNext) {
+      psNext = psRetired->psNext;
+      psRetired->pfFree(psRetired);
+      ulFreed++;
+   }
+   return ulFreed;
+}
+
+size_t Epoch_reclaim(EpochList_T oEList) {
+   union readerSlot *psSlot;
+   unsigned long ulOldest;
+   unsigned long ulEpoch;
+
+   assert(oEList != NULL);
+
+   /* a writer that finds the list empty need not scan the slots; one
+      that misses a record being retired leaves it to the next */
+   if(__atomic_load_n(&oEList->psFirst, __ATOMIC_RELAXED) == NULL)
+      return 0;
+
+   /* read sequentially consistently, after Epoch_retire advanced the
+      epoch the same way (see Epoch_enter) */
+   if(__atomic_load_n(&ulSlotlessReads, __ATOMIC_SEQ_CST) > 0)
+      return 0;
+
+   /* find the epoch of the oldest read in progress; records retired
+      from now on are tagged with this epoch or a later one, so are
+      kept */
+   ulOldest = __atomic_load_n(&ulCurrentEpoch, __ATOMIC_SEQ_CST);
+   for(psSlot = __atomic_load_n(&psSlots, __ATOMIC_ACQUIRE);
+       psSlot != NULL; psSlot = psSlot->s.psNext) {
+      ulEpoch = __atomic_load_n(&psSlot->s.ulEpoch, __ATOMIC_SEQ_CST);
+      if(ulEpoch != 0 && ulEpoch < ulOldest)
+         ulOldest = ulEpoch;
+   }
+
+   return Epoch_freeRecords(Epoch_detach(oEList, ulOldest));
+}
+
+void Epoch_flush(EpochList_T oEList) {
+   assert(oEList != NULL);
+
+   (void) Epoch_freeRecords(Epoch_detach(oEList, (unsigned long) -1));
+}
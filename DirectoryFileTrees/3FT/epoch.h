@@ -0,0 +1,106 @@
+/*--------------------------------------------------------------------*/
+/* epoch.h                                                            */
+/* Author: Jacob Santelli and Joshua Yang                             */
+/*--------------------------------------------------------------------*/
+
+#ifndef EPOCH_INCLUDED
+#define EPOCH_INCLUDED
+
+#include <stddef.h>
+
+/*
+  Epoch-based reclamation lets readers follow pointers with no locks
+  while a writer unlinks what they point to: the writer retires what
+  it unlinked rather than freeing it, and it is freed only once every
+  reader that might have reached it has finished reading.
+
+  There is a single process-wide epoch counter. A reader announces
+  the epoch it starts in, in a slot of its own that no other thread
+  writes, so reading writes no memory that other threads write.
+  Retiring something tags it with the current epoch and then advances
+  the counter, so readers starting afterwards cannot reach it; it is
+  freed once no reader announces an epoch at or before its tag.
+
+  What is retired waits in a list that the client keeps, such as one
+  per tree, so that writers to different trees never touch the same
+  list. Each list locks itself, so any number of writers may retire
+  to it and reclaim from it at once; the functions it frees with run
+  outside the lock, but may run on any writer's thread. Readers need
+  no exclusion at all.
+*/
+
+/*
+  The record that something retired is kept in until it is freed,
+  usually the first member of the retired object itself, so retiring
+  allocates no memory
+*/
+struct EpochRetired {
+   /* the next retired record, in the order they were retired */
+   struct EpochRetired *psNext;
+   /* the epoch the record was retired in */
+   unsigned long ulEpoch;
+   /* the function that frees the retired object */
+   void (*pfFree)(struct EpochRetired *psRetired);
+};
+
+#ifdef __GNUC__
+/* Loads the pointer at pLink, seeing all that was written before a
+   writer published it there with EPOCH_PUBLISH */
+#define EPOCH_LOAD(pLink) __atomic_load_n((pLink), __ATOMIC_ACQUIRE)
+/* Stores pValue at pLink so that a reader that loads it with
+   EPOCH_LOAD sees everything written before */
+#define EPOCH_PUBLISH(pLink, pValue) \
+   __atomic_store_n((pLink), (pValue), __ATOMIC_RELEASE)
+#else
+#error "epoch.h needs the __atomic builtins of GCC or a compatible one"
+#endif
+
+/*
+  Starts a read: until the matching Epoch_leave, nothing retired from
+  now on is freed. Reads may nest, and only the outermost pair counts.
+  Never blocks. The first read on a thread claims it a slot, which is
+  only allocated when no slot of an exited thread is free; if that
+  fails, the thread holds off all reclamation while it reads instead.
+*/
+void Epoch_enter(void);
+
+/* Ends a read started with Epoch_enter. */
+void Epoch_leave(void);
+
+/* A list of retired records waiting to be freed */
+typedef struct EpochList *EpochList_T;
+
+/*
+  Returns a new, empty list of retired records, or NULL if
+  insufficient memory is available.
+*/
+EpochList_T Epoch_newList(void);
+
+/*
+  Frees oEList, which must be empty: flushed with Epoch_flush if
+  anything was retired to it.
+*/
+void Epoch_freeList(EpochList_T oEList);
+
+/*
+  Retires psRetired to oEList. The caller has set its pfFree, and must
+  have unlinked it so that no read starting from now on can reach it.
+  It is freed by a later Epoch_reclaim or Epoch_flush of oEList.
+*/
+void Epoch_retire(EpochList_T oEList, struct EpochRetired *psRetired);
+
+/*
+  Frees, with their pfFree, the records of oEList retired before any
+  read now in progress started. Returns the number freed. The caller
+  must not be reading, or it would hold off what it retired itself.
+*/
+size_t Epoch_reclaim(EpochList_T oEList);
+
+/*
+  Frees, with their pfFree, all the records of oEList, however
+  recently retired. The client must know that no reader can still
+  reach them, as when it is freeing the tree they were retired from.
+*/
+void Epoch_flush(EpochList_T oEList);
+
+#endif
@@ -3,16 +3,29 @@
 /* Authors: Jacob Santelli and Joshua Yang                            */
 /*--------------------------------------------------------------------*/
 
+/* for the POSIX threads mutex, open, fsync and fchmod */
+#define _POSIX_C_SOURCE 200112L
+
 #include <stddef.h>
 #include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
-#include "dynarray.h"
+#include "atom.h"
+#include "epoch.h"
+#include "image.h"
 #include "path.h"
 #include "nodeFT.h"
+#include "pathindex.h"
+#include "slab.h"
 #include "ft.h"
+#include "ftslab.h"
 #include "a4def.h"
 
 /*
@@ -21,81 +34,501 @@
   may be internal nodes or leaves, and files are always leaves.
 */
 
-/* 1. a flag for being in an initialized state (TRUE) or not (FALSE) */
-static boolean bIsInitialized;
-/* 2. a pointer to the root node in the hierarchy */
-static Node_T oNRoot;
-/* 3. a counter of the number of nodes in the hierarchy */
-static size_t ulCount;
+/* A File Tree */
+struct FT {
+   /* 1. a pointer to the root node in the hierarchy, published with
+         EPOCH_PUBLISH */
+   Node_T oNRoot;
+   /* 2. a counter of the number of nodes in the hierarchy */
+   size_t ulCount;
+   /* 3. the slab that the nodes are allocated from */
+   Slab_T oSSlab;
+   /* 4. an index of every node by the hash of its absolute path, or
+         NULL if it is not enabled (see FT_setPathIndexIn) */
+   PathIndex_T oPathIndex;
+   /* 5. TRUE if threads may use the FT at once (see
+         FT_newConcurrent), in which case its nodes are concurrent (see
+         Node_makeConcurrent) */
+   boolean bConcurrent;
+   /* 6. TRUE if the FT is a snapshot (see FT_snapshotIn), which cannot
+         be changed */
+   boolean bReadOnly;
+   /* 7. TRUE once the FT has shared its nodes with a snapshot, after
+         which its writers copy the shared nodes they change (see
+         Node_copy) */
+   boolean bShared;
+   /* 8. what the FT shares with its snapshots, or NULL if it has
+         never been snapshotted and is not concurrent */
+   struct family *psFamily;
+   /* 9. the image the FT was loaded from (see FT_load), which stays
+         mapped for as long as its files' contents may be in use, or
+         NULL */
+   Image_T oIImage;
+   /* 10. TRUE while the FT is read from oIImage, which it is until it
+          is first changed, when its nodes are made from the image */
+   boolean bInImage;
+   /* 11. in a concurrent FT, the lock that writers hold shared while
+          they change it, each locking only the directories it changes
+          (see Node_makeConcurrent), and that a writer holds
+          exclusively to change the root or to keep the FT still */
+   pthread_rwlock_t sWriters;
+   /* 12. TRUE while a writer holds sWriters exclusively */
+   boolean bExclusive;
+   /* 13. the FT's record while FT_free retires it, which FT_reclaim
+          finds the FT from */
+   struct EpochRetired sRetired;
+   /* 14. the nodes that FT_free left to be released once no reader of
+          another FT can be looking at them (see Node_freeShared) */
+   Node_T oNDead;
+   /* 15. TRUE if the path index is enabled while the FT is read from
+          oIImage, so is to be built along with its nodes */
+   boolean bIndexImage;
+   /* 16. the number of children above which a directory keeps a
+          child index (see FT_setIndexThresholdIn) */
+   size_t ulIndexThreshold;
+};
+
+/*
+  What an FT and its snapshots (see FT_snapshotIn), or a concurrent FT
+  from the start, have in common, so that each may be used by its own
+  threads at once. They share oSSlab and oIImage, which are freed
+  along with the last of them.
+*/
+struct family {
+   /* the number of the FTs not yet freed, changed atomically */
+   size_t ulMembers;
+   /* the list that the FTs retire to what readers of any of them may
+      still be looking at (see epoch.h) */
+   EpochList_T oEList;
+   /* the lock and list of the versions of the tree that the FTs hold
+      (see Node_newVersions) */
+   NodeVersions_T oVVersions;
+};
+
+/* The status with which a change to a concurrent FT starts over,
+   when another writer changed what it found first, or once it has
+   the FT to itself to change the root (see FT_lockExclusive) */
+enum { FT_RETRY = BAD_IMAGE + 1 };
+
+/* The FT that the functions not taking an FT_T work on, or NULL if
+   they are not in an initialized state */
+static FT_T oFTDefault;
+
+/* A pathname being looked up in an FT's path index */
+struct pathname {
+   /* the pathname, which must be well-formatted */
+   const char *pcPath;
+   /* its string length */
+   size_t ulLength;
+};
+
+/* --------------------------------------------------------------------
+
+  The following auxiliary functions synchronize the threads using a
+  concurrent FT, or an FT and its snapshots. For any other FT they do
+  nothing.
+*/
+
+/*
+  Starts a read of oFT, which in a concurrent oFT or one with
+  snapshots keeps what it reads from being freed, without keeping
+  writers waiting, until FT_endRead.
+*/
+static void FT_beginRead(FT_T oFT) {
+   assert(oFT != NULL);
+
+   if(oFT->psFamily != NULL)
+      Epoch_enter();
+}
+
+/* Ends a read of oFT started with FT_beginRead. */
+static void FT_endRead(FT_T oFT) {
+   assert(oFT != NULL);
+
+   if(oFT->psFamily != NULL)
+      Epoch_leave();
+}
+
+/*
+  Starts a change to a concurrent oFT, which waits for the writer that
+  has it to itself, if any. Writers change the FT beside one another
+  unless bExclusive is TRUE: then waits for all other writers and has
+  oFT to itself until FT_unlockWriters. Either way, keeps what the
+  writer reads from being freed meanwhile, as FT_beginRead does.
+*/
+static void FT_lockWriters(FT_T oFT, boolean bExclusive) {
+   int iStatus;
+
+   assert(oFT != NULL);
+
+   if(oFT->bConcurrent) {
+      if(bExclusive)
+         iStatus = pthread_rwlock_wrlock(&oFT->sWriters);
+      else
+         iStatus = pthread_rwlock_rdlock(&oFT->sWriters);
+      assert(iStatus == 0);
+      (void) iStatus;
+      if(bExclusive)
+         oFT->bExclusive = TRUE;
+   }
+   FT_beginRead(oFT);
+}
+
+/*
+  Ends a change to oFT started with FT_lockWriters, then frees what
+  was retired that readers can no longer be looking at.
+*/
+static void FT_unlockWriters(FT_T oFT) {
+   int iStatus;
+
+   assert(oFT != NULL);
+
+   FT_endRead(oFT);
+   if(oFT->bConcurrent) {
+      /* only the writer with oFT to itself writes the flag */
+      if(oFT->bExclusive)
+         oFT->bExclusive = FALSE;
+      iStatus = pthread_rwlock_unlock(&oFT->sWriters);
+      assert(iStatus == 0);
+      (void) iStatus;
+   }
+   if(oFT->psFamily != NULL)
+      (void) Epoch_reclaim(oFT->psFamily->oEList);
+}
+
+/*
+  Has the writer to the concurrent oFT that is changing it beside
+  others have it to itself instead, to change its root. The FT may
+  change while the writer waits, so it must start over. Returns
+  FT_RETRY, for it to return.
+*/
+static int FT_lockExclusive(FT_T oFT) {
+   assert(oFT != NULL);
+   assert(oFT->bConcurrent);
+   assert(!oFT->bExclusive);
+
+   FT_unlockWriters(oFT);
+   FT_lockWriters(oFT, TRUE);
+   return FT_RETRY;
+}
+
+/*
+  Returns the Node_walk flags for a walk of oFT with the FT_WALK_
+  flags iFlags, one that in a concurrent oFT or one with snapshots
+  reads in an epoch per directory rather than one for the whole walk,
+  however long the client takes over each node (see Node_walk).
+*/
+static int FT_walkFlags(FT_T oFT, int iFlags) {
+   assert(oFT != NULL);
+
+   iFlags &= FT_WALK_PREORDER | FT_WALK_POSTORDER | FT_WALK_FILES_FIRST;
+   if(oFT->psFamily != NULL)
+      iFlags |= NODE_WALK_REENTER;
+   return iFlags;
+}
+
+/* Adds ulAdded to oFT's count of nodes and subtracts ulRemoved. */
+static void FT_recount(FT_T oFT, size_t ulAdded, size_t ulRemoved) {
+   assert(oFT != NULL);
+
+   /* concurrent writers count beside one another; the count may
+      wrap while one that removes a node another added counts first,
+      but is right again once both have */
+   if(oFT->bConcurrent)
+      (void) __atomic_fetch_add(&oFT->ulCount, ulAdded - ulRemoved,
+                                __ATOMIC_RELAXED);
+   else
+      oFT->ulCount += ulAdded - ulRemoved;
+}
+
+
+/* --------------------------------------------------------------------
+
+  The following auxiliary functions keep an FT's path index up to date.
+*/
+
+/*
+  Returns the hash of the well-formatted path pcPath, the same as
+  Path_getPrefixHash gives for it, and stores its length in
+  *pulLength.
+*/
+static unsigned long FT_hashPathname(const char *pcPath,
+                                     size_t *pulLength) {
+   const char *pcCurr = pcPath;
+   unsigned long ulHash = 0;
+   size_t ulLength;
+
+   assert(pcPath != NULL);
+   assert(pulLength != NULL);
+
+   for(;;) {
+      ulLength = strcspn(pcCurr, "/");
+      ulHash = Path_extendHash(ulHash,
+                               Path_hashComponent(pcCurr, ulLength));
+      pcCurr += ulLength;
+      if(*pcCurr == '\0')
+         break;
+      pcCurr++;
+   }
+   *pulLength = (size_t) (pcCurr - pcPath);
+   return ulHash;
+}
+
+/*
+  Returns TRUE if the absolute path of pvNode, a Node_T, is the
+  struct pathname pvPathname, or FALSE if not. Compares names from
+  the last up, so allocates no memory.
+*/
+static int FT_hasPathname(const void *pvNode, const void *pvPathname) {
+   Node_T oNNode = (Node_T) pvNode;
+   const struct pathname *psPathname = pvPathname;
+   const char *pcEnd;
+   const char *pcName;
+   size_t ulLength;
+
+   assert(pvNode != NULL);
+   assert(pvPathname != NULL);
+
+   if(Node_getPathLength(oNNode) != psPathname->ulLength)
+      return FALSE;
+   pcEnd = psPathname->pcPath + psPathname->ulLength;
+   for(; oNNode != NULL; oNNode = Node_getParent(oNNode)) {
+      pcName = Node_getName(oNNode);
+      ulLength = Atom_getLength(pcName);
+      pcEnd -= ulLength;
+      if(memcmp(pcEnd, pcName, ulLength) != 0)
+         return FALSE;
+      /* the lengths match, so the root's name starts pcPath */
+      if(pcEnd != psPathname->pcPath && *--pcEnd != '/')
+         return FALSE;
+   }
+   return TRUE;
+}
+
+/*
+  Adds the nodes from oNFirst down to oNLast, the new nodes on the way
+  to oPPath, to oFT's path index, which must have room for them.
+*/
+static void FT_indexNewNodes(FT_T oFT, Path_T oPPath, Node_T oNFirst,
+                             Node_T oNLast) {
+   int iAdded;
+
+   assert(oFT != NULL);
+   assert(oPPath != NULL);
+   assert(oNFirst != NULL);
+   assert(oNLast != NULL);
+   assert(oFT->oPathIndex != NULL);
+
+   for(;;) {
+      iAdded = PathIndex_add(oFT->oPathIndex,
+                  Path_getPrefixHash(oPPath, Node_getDepth(oNLast)),
+                  oNLast);
+      assert(iAdded);
+      (void) iAdded;
+      if(oNLast == oNFirst)
+         break;
+      oNLast = Node_getParent(oNLast);
+   }
+}
+
+/* The state of a walk adding a subtree's nodes to a path index or
+   removing them */
+struct indexer {
+   /* the path index */
+   PathIndex_T oPathIndex;
+   /* the hash of the absolute path of the last node visited at each
+      level of the subtree, so of each ancestor of the node being
+      visited, by its depth below the subtree's root */
+   unsigned long *pulHashes;
+   /* the depth of the subtree's root */
+   size_t ulRootDepth;
+   /* TRUE to add the nodes, FALSE to remove them */
+   boolean bAdd;
+};
+
+/*
+  Node_walk visitor that raises the size_t that pvDepth points to to
+  oNNode's depth, if that is greater.
+*/
+static int FT_maxDepth(Node_T oNNode, int iOrder, void *pvDepth) {
+   assert(oNNode != NULL);
+   assert(pvDepth != NULL);
+   (void) iOrder;
+
+   if(Node_getDepth(oNNode) > *(size_t *) pvDepth)
+      *(size_t *) pvDepth = Node_getDepth(oNNode);
+   return SUCCESS;
+}
+
+/*
+  Node_walk visitor that hashes oNNode's absolute path from its
+  parent's, visited just before it at the level above, and adds it
+  to or removes it from the path index of the indexer pvIndexer
+  points to, as that says.
+*/
+static int FT_indexNode(Node_T oNNode, int iOrder, void *pvIndexer) {
+   struct indexer *psIndexer = pvIndexer;
+   size_t ulLevel;
+   int iAdded;
+
+   assert(oNNode != NULL);
+   assert(psIndexer != NULL);
+   assert(psIndexer->oPathIndex != NULL);
+   (void) iOrder;
+
+   ulLevel = Node_getDepth(oNNode) - psIndexer->ulRootDepth;
+   if(ulLevel != 0)
+      psIndexer->pulHashes[ulLevel] = Path_extendHash(
+         psIndexer->pulHashes[ulLevel - 1],
+         Atom_getHash(Node_getName(oNNode)));
+
+   if(psIndexer->bAdd) {
+      iAdded = PathIndex_add(psIndexer->oPathIndex,
+                             psIndexer->pulHashes[ulLevel], oNNode);
+      assert(iAdded);
+      (void) iAdded;
+   }
+   else
+      PathIndex_remove(psIndexer->oPathIndex,
+                       psIndexer->pulHashes[ulLevel], oNNode);
+   return SUCCESS;
+}
+
+/*
+  Adds oNNode, whose absolute path has hash ulHash, and all its
+  descendants to oFT's path index, which must have room for them, if
+  bAdd is TRUE, or removes them from it if not. Walks the subtree
+  rather than recursing, with one hash per level of it. Returns
+  SUCCESS, or MEMORY_ERROR, leaving the index unchanged, if memory for
+  the hashes could not be allocated.
+*/
+static int FT_indexSubtree(FT_T oFT, Node_T oNNode,
+                           unsigned long ulHash, boolean bAdd) {
+   struct indexer sIndexer;
+   size_t ulMaxDepth = 0;
+   int iStatus;
+
+   assert(oFT != NULL);
+   assert(oNNode != NULL);
+   assert(oFT->oPathIndex != NULL);
+
+   /* size the hashes to the subtree's height first, so that running
+      out of memory cannot leave the index half changed */
+   iStatus = Node_walk(oNNode, FT_maxDepth, &ulMaxDepth,
+                       FT_WALK_PREORDER);
+   assert(iStatus == SUCCESS);
+   sIndexer.oPathIndex = oFT->oPathIndex;
+   sIndexer.ulRootDepth = Node_getDepth(oNNode);
+   sIndexer.bAdd = bAdd;
+   sIndexer.pulHashes = malloc((ulMaxDepth - sIndexer.ulRootDepth + 1)
+                               * sizeof(unsigned long));
+   if(sIndexer.pulHashes == NULL)
+      return MEMORY_ERROR;
+   sIndexer.pulHashes[0] = ulHash;
+
+   iStatus = Node_walk(oNNode, FT_indexNode, &sIndexer,
+                       FT_WALK_PREORDER);
+   assert(iStatus == SUCCESS);
+   (void) iStatus;
+
+   free(sIndexer.pulHashes);
+   return SUCCESS;
+}
+
+/*
+  Removes oNNode, whose absolute path has hash ulHash, and all its
+  descendants from oFT's path index. Returns SUCCESS, or MEMORY_ERROR,
+  leaving the index unchanged, if memory could not be allocated.
+*/
+static int FT_unindexSubtree(FT_T oFT, Node_T oNNode,
+                             unsigned long ulHash) {
+   assert(oFT != NULL);
+   assert(oNNode != NULL);
+   assert(oFT->oPathIndex != NULL);
+
+   /* removing the root removes everything */
+   if(oNNode == oFT->oNRoot) {
+      PathIndex_clear(oFT->oPathIndex);
+      return SUCCESS;
+   }
+   /* a file is removed alone */
+   if(Node_getState(oNNode) == A_FILE) {
+      PathIndex_remove(oFT->oPathIndex, ulHash, oNNode);
+      return SUCCESS;
+   }
+   return FT_indexSubtree(oFT, oNNode, ulHash, FALSE);
+}
+
+/*
+  Enables oFT's path index, which must not be enabled, adding every
+  node to it. Returns SUCCESS, or MEMORY_ERROR, leaving the index
+  disabled, if memory could not be allocated for it.
+*/
+static int FT_buildPathIndex(FT_T oFT) {
+   assert(oFT != NULL);
+   assert(oFT->oPathIndex == NULL);
+
+   oFT->oPathIndex = PathIndex_new(oFT->oSSlab);
+   if(oFT->oPathIndex == NULL)
+      return MEMORY_ERROR;
+   if(!PathIndex_reserve(oFT->oPathIndex, oFT->ulCount)) {
+      PathIndex_free(oFT->oPathIndex);
+      oFT->oPathIndex = NULL;
+      return MEMORY_ERROR;
+   }
+   if(oFT->oNRoot != NULL
+      && FT_indexSubtree(oFT, oFT->oNRoot, Path_extendHash(0,
+                            Atom_getHash(Node_getName(oFT->oNRoot))),
+                         TRUE) != SUCCESS) {
+      PathIndex_free(oFT->oPathIndex);
+      oFT->oPathIndex = NULL;
+      return MEMORY_ERROR;
+   }
+   return SUCCESS;
+}
 
 /* --------------------------------------------------------------------
 
-  Traverses the FT starting at the root as far as possible towards
+  Traverses oFT starting at the root as far as possible towards
   absolute path oPPath. If able to traverse, returns an int SUCCESS
   status and sets *poNFurthest to the furthest node reached (which may
   be only a prefix of oPPath, or even NULL if the root is NULL).
   Otherwise, sets *poNFurthest to NULL and returns with status:
   * CONFLICTING_PATH if the root's path is not a prefix of oPPath
-  * MEMORY_ERROR if memory could not be allocated to complete request
   * NOT_A_DIRECTORY if path contains a file anywhere instead of a directory
    (if checkFilesInPath is true)
+  Looks each child up by oPPath itself, so allocates no memory.
 */
-static int FT_traversePath(Path_T oPPath, Node_T *poNFurthest, 
-      enum bool checkFilesInPath) {
-   int iStatus;
-   Path_T oPPrefix = NULL;
+static int FT_traversePath(FT_T oFT, Path_T oPPath,
+      Node_T *poNFurthest, enum bool checkFilesInPath) {
    Node_T oNCurr;
    Node_T oNChild = NULL;
    size_t ulDepth;
    size_t i;
-   size_t ulChildID;
 
+   assert(oFT != NULL);
    assert(oPPath != NULL);
    assert(poNFurthest != NULL);
 
    /* root is NULL -> won't find anything */
-   if(oNRoot == NULL) {
+   if(oFT->oNRoot == NULL) {
       *poNFurthest = NULL;
       return SUCCESS;
    }
  
-   /* set oPPrefix to the value of the root node, 
-      make sure that it returns success */
-   iStatus = Path_prefix(oPPath, 1, &oPPrefix);
-
-   /* checks that there is a value in the root node */
-   if(iStatus != SUCCESS) {
-      *poNFurthest = NULL;
-      return iStatus;
-   }
-
-   /* checks that the given path exists under the root node */
-   if(Path_comparePath(Node_getPath(oNRoot), oPPrefix)) {
-      Path_free(oPPrefix);
+   /* checks that the given path exists under the root node; names
+      are atoms, so equal names are equal pointers */
+   if(Path_getComponent(oPPath, 0) != Node_getName(oFT->oNRoot)) {
       *poNFurthest = NULL;
       return CONFLICTING_PATH;
    }
-   Path_free(oPPrefix);
-   oPPrefix = NULL;
 
    /* iterates down the given path */
-   oNCurr = oNRoot;
+   oNCurr = oFT->oNRoot;
    ulDepth = Path_getDepth(oPPath);
    for(i = 2; i <= ulDepth; i++) {
-      iStatus = Path_prefix(oPPath, i, &oPPrefix);
-      if(iStatus != SUCCESS) {
-         *poNFurthest = NULL;
-         return iStatus;
-      }
-      if(Node_hasChild(oNCurr, oPPrefix, &ulChildID)) {
-         /* go to that child and continue with next prefix */
-         Path_free(oPPrefix);
-         oPPrefix = NULL;
-         iStatus = Node_getChild(oNCurr, ulChildID, &oNChild);
-         if(iStatus != SUCCESS) {
-            *poNFurthest = NULL;
-            return iStatus;
-         }
+      if(Node_findChild(oNCurr, oPPath, &oNChild)) {
+         /* go to that child and continue one level down */
          if (checkFilesInPath == 
                TRUE && Node_getState(oNChild) != DIRECTORY) {
             return NOT_A_DIRECTORY;
@@ -103,252 +536,396 @@ static int FT_traversePath(Path_T oPPath, Node_T *poNFurthest,
          oNCurr = oNChild;
       }
       else {
-         /* oNCurr doesn't have child with path oPPrefix:
+         /* oNCurr doesn't have the child on oPPath's way:
             this is as far as we can go */
          break;
       }
    }
 
-   Path_free(oPPrefix);
    *poNFurthest = oNCurr;
    return SUCCESS;
 }
 
-int FT_insertDir(const char *pcPath) { 
+/*
+  Traverses oFT to find a node with absolute path pcPath, walking
+  pcPath's components in place rather than building a Path_T for it,
+  so that no memory is allocated. Returns an int SUCCESS status and
+  sets *poNResult to be the node, if found. Otherwise, sets *poNResult
+  to NULL and returns with status:
+  * BAD_PATH if pcPath does not represent a well-formatted path
+  * CONFLICTING_PATH if the root's path is not a prefix of pcPath
+  * NO_SUCH_PATH if no node with pcPath exists in the hierarchy
+
+  In a concurrent oFT, a reader must call it between FT_beginRead and
+  FT_endRead, and may look at *poNResult until FT_endRead.
+*/
+static int FT_findNode(FT_T oFT, const char *pcPath,
+                       Node_T *poNResult) {
+   const char *pcName;
+   const char *pcRootName;
+   size_t ulLength;
+   Node_T oNRoot;
+   Node_T oNCurr;
+   struct pathname sPathname;
+   unsigned long ulHash;
    int iStatus;
-   Path_T oPPath = NULL;
-   Node_T oNFirstNew = NULL;
-   Node_T oNCurr = NULL;
-   size_t ulDepth, ulIndex;
-   size_t ulNewNodes = 0;
 
+   assert(oFT != NULL);
    assert(pcPath != NULL);
+   assert(poNResult != NULL);
 
-   /* validate pcPath and generate a Path_T for it */
-   if(!bIsInitialized)
-      return INITIALIZATION_ERROR;
+   *poNResult = NULL;
 
-   iStatus = Path_new(pcPath, &oPPath);
+   iStatus = Path_validate(pcPath);
    if(iStatus != SUCCESS)
       return iStatus;
 
-   /* find the closest ancestor of oPPath already in the tree */
-   iStatus= FT_traversePath(oPPath, &oNCurr, TRUE);
-   if(iStatus != SUCCESS)
-   {
-      Path_free(oPPath);
-      return iStatus;
-   }
+   oNRoot = EPOCH_LOAD(&oFT->oNRoot);
+   if(oNRoot == NULL)
+      return NO_SUCH_PATH;
 
-   /* no ancestor node found, so if root is not NULL,
-      pcPath isn't underneath root. */
-   if(oNCurr == NULL && oNRoot != NULL) {
-      Path_free(oPPath);
+   /* the first component must name the root */
+   ulLength = strcspn(pcPath, "/");
+   pcRootName = Node_getName(oNRoot);
+   if(strncmp(pcRootName, pcPath, ulLength) != 0 ||
+      pcRootName[ulLength] != '\0')
       return CONFLICTING_PATH;
-   }
-
-   ulDepth = Path_getDepth(oPPath);
-   /* only possible if root is in fact NULL, in which case the first
-   Node is being added to the tree */
-   if(oNCurr == NULL)
-      ulIndex = 1;
 
-   /* checks to see if the whole path being inserted is in 
-      the tree already */
-   else {
-      ulIndex = Path_getDepth(Node_getPath(oNCurr))+1;
-
-      /* oNCurr is the node with the longest shared prefix with the
-      path that we are trying to insert */
-      if(ulIndex == ulDepth+1 && !Path_comparePath(oPPath,
-                                       Node_getPath(oNCurr))) {
-         Path_free(oPPath);
-         return ALREADY_IN_TREE;
-      }
+   /* the index, if enabled, holds every node, so need not be
+      followed by a traversal */
+   if(oFT->oPathIndex != NULL) {
+      sPathname.pcPath = pcPath;
+      ulHash = FT_hashPathname(pcPath, &sPathname.ulLength);
+      *poNResult = PathIndex_find(oFT->oPathIndex, ulHash,
+                                  FT_hasPathname, &sPathname);
+      return *poNResult != NULL ? SUCCESS : NO_SUCH_PATH;
    }
 
-   /* starting at oNCurr, build rest of the path one level at a time */
-   while(ulIndex <= ulDepth) {
-      Path_T oPPrefix = NULL;
-      Node_T oNNewNode = NULL;
-      /* generate a Path_T for this level */
-      iStatus = Path_prefix(oPPath, ulIndex, &oPPrefix);
-      if(iStatus != SUCCESS) {
-         Path_free(oPPath);
-         if(oNFirstNew != NULL)
-            (void) Node_free(oNFirstNew);
-         return iStatus;
-      }
-      /* insert the new node for this level */
-      iStatus = Node_new(oPPrefix, oNCurr, &oNNewNode, DIRECTORY);
-      if(iStatus != SUCCESS) {
-         Path_free(oPPath);
-         Path_free(oPPrefix);
-         if(oNFirstNew != NULL)
-            (void) Node_free(oNFirstNew);
-         return iStatus;
-      }
-      /* set up for next level */
-      Path_free(oPPrefix);
-      oNCurr = oNNewNode;
-      ulNewNodes++;
-      if(oNFirstNew == NULL)
-         oNFirstNew = oNCurr;
-      ulIndex++;
+   /* each later component must name a child of the node before */
+   oNCurr = oNRoot;
+   pcName = pcPath + ulLength;
+   while(*pcName != '\0') {
+      pcName++;
+      ulLength = strcspn(pcName, "/");
+      if(!Node_findChildNamed(oNCurr, pcName, ulLength, &oNCurr))
+         return NO_SUCH_PATH;
+      pcName += ulLength;
    }
 
-   Path_free(oPPath);
-   /* update DT state variables to reflect insertion */
-   if(oNRoot == NULL)
-      oNRoot = oNFirstNew;
-   ulCount += ulNewNodes;
-
+   *poNResult = oNCurr;
    return SUCCESS;
 }
 
-boolean FT_containsDir(const char *pcPath) {
-   int iStatus;
+/* What FT_lookup finds at a path */
+struct found {
+   /* TRUE if it is a file, or FALSE if it is a directory */
+   boolean bIsFile;
+   /* a file's contents */
+   void *pvContents;
+   /* the length of a file's contents */
+   size_t ulLength;
+};
+
+/*
+  Looks up the node of oFT with absolute path pcPath, among its nodes
+  or in the image it is read from, and fills *psFound with what it
+  is. Returns SUCCESS, or a status as FT_findNode does, or BAD_IMAGE
+  if the image is malformed. Allocates no memory.
+*/
+static int FT_lookup(FT_T oFT, const char *pcPath,
+                     struct found *psFound) {
    Node_T oNFound = NULL;
-   Path_T oPPath = NULL;
+   size_t ulRecord;
+   int iStatus;
 
+   assert(oFT != NULL);
    assert(pcPath != NULL);
-   assert(Path_new(pcPath, &oPPath) == SUCCESS);
-
-   if (!bIsInitialized)
-      return FALSE;
+   assert(psFound != NULL);
 
-   if (oNRoot == NULL)
-      return FALSE;
+   if(oFT->bInImage) {
+      iStatus = Image_find(oFT->oIImage, pcPath, &ulRecord);
+      if(iStatus != SUCCESS)
+         return iStatus;
+      psFound->bIsFile = Image_isFile(oFT->oIImage, ulRecord);
+      if(psFound->bIsFile) {
+         psFound->pvContents = Image_getContents(oFT->oIImage,
+                                                 ulRecord);
+         psFound->ulLength = Image_getLength(oFT->oIImage, ulRecord);
+      }
+      return SUCCESS;
+   }
 
-   iStatus = FT_traversePath(oPPath, &oNFound, FALSE);
-   if (iStatus != SUCCESS)
-      return FALSE;
+   FT_beginRead(oFT);
+   iStatus = FT_findNode(oFT, pcPath, &oNFound);
+   if(iStatus == SUCCESS) {
+      psFound->bIsFile = (boolean) (Node_getState(oNFound) == A_FILE);
+      if(psFound->bIsFile) {
+         psFound->pvContents = Node_getFileContents(oNFound,
+                                                    &psFound->ulLength);
+      }
+   }
+   FT_endRead(oFT);
+   return iStatus;
+}
 
-   if (Path_comparePath(Node_getPath(oNFound), oPPath) != 0)
-      return FALSE;
+/*
+  Node_new for a node of oFT, or Node_newFile with contents pvContents
+  of length ulLength if state is A_FILE, which makes a new root of a
+  concurrent oFT concurrent. Returns as Node_new does, or MEMORY_ERROR
+  if the root's lock could not be allocated.
+*/
+static int FT_newNode(FT_T oFT, Path_T oPPath, Node_T oNParent,
+                      Node_T *poNResult, int state, void *pvContents,
+                      size_t ulLength) {
+   int iStatus;
 
-   if (Node_getState(oNFound) == DIRECTORY) {
-      return (boolean) (iStatus == SUCCESS);
+   assert(oFT != NULL);
+   assert(oPPath != NULL);
+   assert(poNResult != NULL);
+
+   if(state == A_FILE)
+      return Node_newFile(oPPath, oNParent, oFT->oSSlab,
+                          oFT->ulIndexThreshold, poNResult,
+                          pvContents, ulLength);
+   iStatus = Node_new(oPPath, oNParent, oFT->oSSlab,
+                      oFT->ulIndexThreshold, poNResult, state);
+   if(iStatus == SUCCESS && oFT->bConcurrent && oNParent == NULL) {
+      iStatus = Node_makeConcurrent(*poNResult, oFT->oSSlab,
+                                    oFT->psFamily->oVVersions);
+      if(iStatus != SUCCESS) {
+         (void) Node_free(*poNResult, oFT->oSSlab);
+         *poNResult = NULL;
+      }
    }
-   return FALSE;
+   return iStatus;
 }
 
-
-int FT_rmDir(const char *pcPath) {
+/*
+  Makes the nodes of oFT from the root down to depth ulDepth of
+  pcPath, a well-formatted path whose nodes to that depth are all in
+  oFT, oFT's own: replaces each that a snapshot still shares with a
+  copy (see Node_copy), also in oFT's path index, if enabled. Stores
+  the node at depth ulDepth in *poNResult and returns SUCCESS, or
+  returns MEMORY_ERROR if a copy could not be allocated, leaving oFT
+  with those made so far, which hold what the nodes they replaced did,
+  or FT_RETRY if another writer to a concurrent oFT changed the path
+  first, or the root is to be copied and the writer does not have oFT
+  to itself (see FT_lockExclusive).
+*/
+static int FT_ownPath(FT_T oFT, const char *pcPath, size_t ulDepth,
+                      Node_T *poNResult) {
+   const char *pcName = pcPath;
+   size_t ulLength;
+   unsigned long ulHash = 0;
+   Node_T oNParent = NULL;
+   Node_T oNNode;
+   Node_T oNCopy;
+   size_t i;
    int iStatus;
-   Node_T oNFound = NULL;
-   Path_T oPPath = NULL;
+   int iAdded;
 
+   assert(oFT != NULL);
    assert(pcPath != NULL);
-   assert(Path_new(pcPath, &oPPath) == SUCCESS);
+   assert(ulDepth >= 1);
+   assert(poNResult != NULL);
+   assert(oFT->bShared);
+
+   oNNode = EPOCH_LOAD(&oFT->oNRoot);
+   for(i = 1; ; i++) {
+      ulLength = strcspn(pcName, "/");
+      ulHash = Path_extendHash(ulHash,
+                               Path_hashComponent(pcName, ulLength));
+      if(i > 1) {
+         oNParent = oNNode;
+         if(!Node_findChildNamed(oNParent, pcName, ulLength, &oNNode)) {
+            assert(oFT->bConcurrent);
+            return FT_RETRY;
+         }
+      }
 
-   if (!bIsInitialized)
-      return INITIALIZATION_ERROR;
+      oNCopy = oNNode;
+      if(Node_isShared(oNNode)) {
+         /* writers to a concurrent oFT find its root without a lock */
+         if(oNParent == NULL && oFT->bConcurrent && !oFT->bExclusive)
+            return FT_lockExclusive(oFT);
+         iStatus = Node_copy(oNNode, oNParent, oFT->oSSlab,
+                             oFT->psFamily->oVVersions,
+                             oFT->ulIndexThreshold, &oNCopy);
+         /* another writer copied or unlinked it first */
+         if(iStatus == NO_SUCH_PATH)
+            return FT_RETRY;
+         if(iStatus != SUCCESS)
+            return iStatus;
+      }
 
-   /* call traverse path to find the last node in pcPath, and then 
-      check if that is actually a directory */
-   iStatus = FT_traversePath(oPPath, &oNFound, FALSE);
+      /* the snapshots may have let go of oNNode meanwhile */
+      if(oNCopy != oNNode) {
+         /* the index has room, since it loses oNNode first */
+         if(oFT->oPathIndex != NULL) {
+            PathIndex_remove(oFT->oPathIndex, ulHash, oNNode);
+            iAdded = PathIndex_add(oFT->oPathIndex, ulHash, oNCopy);
+            assert(iAdded);
+            (void) iAdded;
+         }
+         if(oNParent == NULL)
+            EPOCH_PUBLISH(&oFT->oNRoot, oNCopy);
+         oNNode = oNCopy;
+      }
 
-   if(iStatus != SUCCESS)
-       return iStatus;
+      if(i == ulDepth)
+         break;
+      pcName += ulLength + 1;
+   }
 
-   if (oNFound == NULL || 
-         Path_comparePath(Node_getPath(oNFound), oPPath) != 0)
-      return NO_SUCH_PATH;
+   *poNResult = oNNode;
+   return SUCCESS;
+}
 
-   if (Node_getState(oNFound) != DIRECTORY) {
-      return NOT_A_DIRECTORY;
-   }
+/*
+  Node_walk visitor that counts the nodes in the size_t that pvCount
+  points to.
+*/
+static int FT_countNode(Node_T oNNode, int iOrder, void *pvCount) {
+   assert(oNNode != NULL);
+   assert(pvCount != NULL);
+   (void) oNNode;
+   (void) iOrder;
+
+   (*(size_t *) pvCount)++;
+   return SUCCESS;
+}
+
+/*
+  Unlinks oNNode and its descendants from oFT and frees them, or if
+  readers of a concurrent oFT may reach them, retires them to be freed
+  once no reader can still be looking at them. What snapshots of oFT
+  share is left to them. oNNode must not be shared (see
+  FT_ownPath). Stores the number of nodes removed in *pulCount and
+  returns SUCCESS, or returns MEMORY_ERROR, leaving oFT unchanged, if
+  memory could not be allocated to unlink them, or NO_SUCH_PATH if
+  another writer to a concurrent oFT unlinked them first.
+*/
+static int FT_freeSubtree(FT_T oFT, Node_T oNNode, size_t *pulCount) {
+   int iStatus;
 
-   ulCount -= Node_free(oNFound);
-   if(ulCount == 0)
-      oNRoot = NULL;
+   assert(oFT != NULL);
+   assert(oNNode != NULL);
+   assert(pulCount != NULL);
+
+   if(oFT->bConcurrent
+      && (Node_getParent(oNNode) != NULL || oNNode == oFT->oNRoot))
+      return Node_retire(oNNode, &oFT->oNRoot, oFT->oSSlab, pulCount);
+
+   /* Node_free counts only the nodes it frees */
+   if(oFT->bShared) {
+      *pulCount = 0;
+      iStatus = Node_walk(oNNode, FT_countNode, pulCount,
+                          FT_WALK_PREORDER);
+      assert(iStatus == SUCCESS);
+      (void) iStatus;
+   }
 
+   /* oFT holds the newest version of the tree, whose frees move no
+      parent link, so the nodes are released at once */
+   if(oNNode == oFT->oNRoot)
+      oFT->oNRoot = NULL;
+   if(oFT->bShared)
+      (void) Node_freeShared(oNNode, oFT->oSSlab,
+                             oFT->psFamily->oVVersions, NULL);
+   else
+      *pulCount = Node_free(oNNode, oFT->oSSlab);
    return SUCCESS;
 }
 
-int FT_insertFile(const char *pcPath, void *pvContents,
-                  size_t ulLength) {
+/*
+  Inserts into oFT a new node with absolute path oPPath, the Path_T
+  of pcPath, with any directories missing above it: a directory, or if
+  state is A_FILE, a file with contents pvContents of length ulLength.
+  Returns as FT_insertDir and FT_insertFile do, or FT_RETRY. In a
+  concurrent oFT, the directories inserted before a failure stay, as
+  other threads may have seen them and inserted below them already.
+*/
+static int FT_insertNodes(FT_T oFT, Path_T oPPath, const char *pcPath,
+                          int state, void *pvContents,
+                          size_t ulLength) {
    int iStatus;
-   Path_T oPPath = NULL;
+   Node_T oNAncestor = NULL;
    Node_T oNFirstNew = NULL;
    Node_T oNCurr = NULL;
    size_t ulDepth, ulIndex;
    size_t ulNewNodes = 0;
 
+   assert(oFT != NULL);
+   assert(oPPath != NULL);
    assert(pcPath != NULL);
 
-   /* validate pcPath and generate a Path_T for it */
-   if(!bIsInitialized)
-      return INITIALIZATION_ERROR;
-
-   iStatus = Path_new(pcPath, &oPPath);
-   if(iStatus != SUCCESS)
-      return iStatus;
-
    /* find the closest ancestor of oPPath already in the tree */
-   iStatus= FT_traversePath(oPPath, &oNCurr, TRUE);
+   iStatus= FT_traversePath(oFT, oPPath, &oNAncestor, TRUE);
    if(iStatus != SUCCESS)
-   {
-      Path_free(oPPath);
       return iStatus;
-   }
 
    /* no ancestor node found, so if root is not NULL,
       pcPath isn't underneath root. */
-   if(oNCurr == NULL && oNRoot != NULL) {
-      Path_free(oPPath);
+   if(oNAncestor == NULL && oFT->oNRoot != NULL)
       return CONFLICTING_PATH;
-   }
 
    ulDepth = Path_getDepth(oPPath);
-   /* only possible if root is in fact NULL, in which case we do
-   not insert a file into the root */
-   if(oNCurr == NULL)
-      return CONFLICTING_PATH;
+   /* only possible if root is in fact NULL, in which case the first
+   Node is being added to the tree, which cannot be a file */
+   if(oNAncestor == NULL) {
+      if(state == A_FILE)
+         return CONFLICTING_PATH;
+      if(oFT->bConcurrent && !oFT->bExclusive)
+         return FT_lockExclusive(oFT);
+      ulIndex = 1;
+   }
+
+   /* checks to see if the whole path being inserted is in 
+      the tree already */
    else {
-      ulIndex = Path_getDepth(Node_getPath(oNCurr))+1;
+      ulIndex = Node_getDepth(oNAncestor)+1;
 
-      /* oNCurr is the node with the longest shared prefix with the
-      path that we are trying to insert */
-      if(ulIndex == ulDepth+1 && !Path_comparePath(oPPath,
-                                       Node_getPath(oNCurr))) {
-         Path_free(oPPath);
+      /* oNAncestor is the node with the longest shared prefix with the
+      path that we are trying to insert, so if it is as deep as that
+      path it is that path */
+      if(ulIndex == ulDepth+1)
          return ALREADY_IN_TREE;
-      }
    }
 
-   /* starting at oNCurr, build rest of the path one level at a time */
-   while(ulIndex <= ulDepth) {
+   /* make room in the index first, so that adding the new nodes to it
+      cannot fail */
+   if(oFT->oPathIndex != NULL
+      && !PathIndex_reserve(oFT->oPathIndex, ulDepth - ulIndex + 1))
+      iStatus = MEMORY_ERROR;
+
+   /* the new nodes' parent must not be one that snapshots share */
+   if(iStatus == SUCCESS && oFT->bShared && oNAncestor != NULL)
+      iStatus = FT_ownPath(oFT, pcPath, ulIndex - 1, &oNAncestor);
+
+   /* starting at oNAncestor, build rest of the path one level at a
+      time */
+   oNCurr = oNAncestor;
+   while(iStatus == SUCCESS && ulIndex <= ulDepth) {
       Path_T oPPrefix = NULL;
       Node_T oNNewNode = NULL;
       /* generate a Path_T for this level */
       iStatus = Path_prefix(oPPath, ulIndex, &oPPrefix);
-      if(iStatus != SUCCESS) {
-         Path_free(oPPath);
-         if(oNFirstNew != NULL)
-            (void) Node_free(oNFirstNew);
-         return iStatus;
-      }
-      /* insert the new node for this level, depending on whether 
-         it is the final file node */
-      if (ulIndex < ulDepth) {
-         iStatus = Node_new(oPPrefix, oNCurr, &oNNewNode, DIRECTORY);
-      }
-      else {
-         iStatus = Node_new(oPPrefix, oNCurr, &oNNewNode, A_FILE);
-         Node_setFile(oNNewNode, pvContents);
-         Node_setFileLength(oNNewNode, ulLength);
-      }
-      if(iStatus != SUCCESS) {
-         Path_free(oPPath);
-         Path_free(oPPrefix);
-         if(oNFirstNew != NULL)
-            (void) Node_free(oNFirstNew);
-         return iStatus;
-      }
-      /* set up for next level */
+      if(iStatus != SUCCESS)
+         break;
+      /* insert the new node for this level, depending on whether
+         it is the final node */
+      iStatus = FT_newNode(oFT, oPPrefix, oNCurr, &oNNewNode,
+                           ulIndex < ulDepth ? DIRECTORY : state,
+                           pvContents, ulLength);
       Path_free(oPPrefix);
+      /* another writer to a concurrent oFT inserted the node first,
+         or removed its parent */
+      if(oFT->bConcurrent
+         && (iStatus == ALREADY_IN_TREE || iStatus == NO_SUCH_PATH))
+         iStatus = FT_RETRY;
+      if(iStatus != SUCCESS)
+         break;
+      /* set up for next level */
       oNCurr = oNNewNode;
       ulNewNodes++;
       if(oNFirstNew == NULL)
@@ -356,203 +933,776 @@ int FT_insertFile(const char *pcPath, void *pvContents,
       ulIndex++;
    }
 
+   if(iStatus == SUCCESS) {
+      if(oFT->oPathIndex != NULL)
+         FT_indexNewNodes(oFT, oPPath, oNFirstNew, oNCurr);
+      /* update FT state variables to reflect insertion */
+      if(oFT->oNRoot == NULL)
+         EPOCH_PUBLISH(&oFT->oNRoot, oNFirstNew);
+      FT_recount(oFT, ulNewNodes, 0);
+   }
+   /* a concurrent oFT's new nodes below its root are in use already;
+      the others, and a new root not yet published, are freed
+      outright, which cannot fail */
+   else if(oFT->bConcurrent && oNAncestor != NULL)
+      FT_recount(oFT, ulNewNodes, 0);
+   else if(oNFirstNew != NULL)
+      (void) FT_freeSubtree(oFT, oNFirstNew, &ulNewNodes);
+
+   return iStatus;
+}
+
+/*
+  Inserts into oFT a new node with absolute path pcPath, with any
+  directories missing above it: a directory, or if state is A_FILE, a
+  file with contents pvContents of length ulLength. Returns as
+  FT_insertDir and FT_insertFile do.
+*/
+static int FT_insertPath(FT_T oFT, const char *pcPath, int state,
+                         void *pvContents, size_t ulLength) {
+   int iStatus;
+   Path_T oPPath = NULL;
+
+   assert(oFT != NULL);
+   assert(pcPath != NULL);
+
+   /* validate pcPath and generate a Path_T for it */
+   iStatus = Path_new(pcPath, &oPPath);
+   if(iStatus != SUCCESS)
+      return iStatus;
+
+   do
+      iStatus = FT_insertNodes(oFT, oPPath, pcPath, state, pvContents,
+                               ulLength);
+   while(iStatus == FT_RETRY);
+
    Path_free(oPPath);
-   /* update DT state variables to reflect insertion */
-   if(oNRoot == NULL)
-      oNRoot = oNFirstNew;
-   ulCount += ulNewNodes;
+   return iStatus;
+}
 
-   return SUCCESS;
+/*
+  Removes oNNode, found at absolute path pcPath, and its descendants
+  from oFT. Returns SUCCESS, or MEMORY_ERROR, leaving oFT unchanged
+  but for copies of nodes that snapshots share, if memory to copy
+  those or to update the path index could not be allocated, or
+  FT_RETRY.
+*/
+static int FT_removeNode(FT_T oFT, Node_T oNNode, const char *pcPath) {
+   size_t ulLength;
+   size_t ulRemoved;
+   int iStatus = SUCCESS;
+
+   assert(oFT != NULL);
+   assert(oNNode != NULL);
+   assert(pcPath != NULL);
+
+   if(oFT->bConcurrent && Node_getParent(oNNode) == NULL
+      && !oFT->bExclusive)
+      return FT_lockExclusive(oFT);
+
+   /* oNNode is unlinked from its parent, so both must be oFT's own;
+      a root need only be let go of */
+   if(oFT->bShared && Node_getParent(oNNode) != NULL)
+      iStatus = FT_ownPath(oFT, pcPath, Node_getDepth(oNNode), &oNNode);
+
+   /* only an FT that is not concurrent has an index, and only a
+      concurrent one can fail to free the subtree */
+   if(iStatus == SUCCESS && oFT->oPathIndex != NULL)
+      iStatus = FT_unindexSubtree(oFT, oNNode,
+                                  FT_hashPathname(pcPath, &ulLength));
+   if(iStatus == SUCCESS)
+      iStatus = FT_freeSubtree(oFT, oNNode, &ulRemoved);
+   if(iStatus == SUCCESS)
+      FT_recount(oFT, 0, ulRemoved);
+   /* another writer removed oNNode since it was found */
+   if(iStatus == NO_SUCH_PATH)
+      iStatus = FT_RETRY;
+   return iStatus;
 }
 
-boolean FT_containsFile(const char *pcPath) {
+/*
+  Removes the node of oFT with absolute path pcPath, which must be in
+  state state, and its descendants. Returns as FT_rmDir and FT_rmFile
+  do.
+*/
+static int FT_removePath(FT_T oFT, const char *pcPath, int state) {
+   Node_T oNFound = NULL;
    int iStatus;
+
+   assert(oFT != NULL);
+   assert(pcPath != NULL);
+
+   do {
+      iStatus = FT_findNode(oFT, pcPath, &oNFound);
+      if(iStatus == SUCCESS && Node_getState(oNFound) != state)
+         iStatus = state == DIRECTORY ? NOT_A_DIRECTORY : NOT_A_FILE;
+      if(iStatus == SUCCESS)
+         iStatus = FT_removeNode(oFT, oNFound, pcPath);
+   } while(iStatus == FT_RETRY);
+   return iStatus;
+}
+
+/*
+  Gives the file of oFT with absolute path pcPath contents pvContents
+  of length ulLength, and stores its old contents in *ppvOld. Returns
+  SUCCESS, or a status as FT_findNode does, or NOT_A_FILE if pcPath
+  is a directory, or MEMORY_ERROR if a node that snapshots share could
+  not be copied or, in a concurrent oFT, the file's new record could
+  not be allocated.
+*/
+static int FT_replaceFile(FT_T oFT, const char *pcPath,
+                          void *pvContents, size_t ulLength,
+                          void **ppvOld) {
    Node_T oNFound = NULL;
-   Path_T oPPath = NULL;
+   int iStatus;
 
+   assert(oFT != NULL);
    assert(pcPath != NULL);
-   assert(Path_new(pcPath, &oPPath) == SUCCESS);
+   assert(ppvOld != NULL);
+
+   do {
+      iStatus = FT_findNode(oFT, pcPath, &oNFound);
+      if(iStatus == SUCCESS && Node_getState(oNFound) != A_FILE)
+         iStatus = NOT_A_FILE;
+      /* the file's contents are shared with snapshots until it is
+         copied */
+      if(iStatus == SUCCESS && oFT->bShared)
+         iStatus = FT_ownPath(oFT, pcPath, Node_getDepth(oNFound),
+                              &oNFound);
+      if(iStatus == SUCCESS) {
+         iStatus = Node_replaceFile(oNFound, pvContents, ulLength,
+                                    ppvOld);
+         /* another writer removed the file since it was found */
+         if(iStatus == NO_SUCH_PATH)
+            iStatus = FT_RETRY;
+      }
+   } while(iStatus == FT_RETRY);
+   return iStatus;
+}
 
-   if (!bIsInitialized)
-      return FALSE;
+/*
+  Image_walk visitor that inserts ulRecord, the node of oIImage with
+  absolute path pcPath, into the FT pvFT points to, with the contents
+  it has in oIImage. Returns as FT_insertPath does.
+*/
+static int FT_unpackNode(Image_T oIImage, size_t ulRecord,
+                         const char *pcPath, int iOrder, void *pvFT) {
+   assert(oIImage != NULL);
+   assert(pcPath != NULL);
+   assert(pvFT != NULL);
+   (void) iOrder;
+
+   if(Image_isFile(oIImage, ulRecord))
+      return FT_insertPath(pvFT, pcPath, A_FILE,
+                           Image_getContents(oIImage, ulRecord),
+                           Image_getLength(oIImage, ulRecord));
+   return FT_insertPath(pvFT, pcPath, DIRECTORY, NULL, 0);
+}
 
-   if (oNRoot == NULL)
-      return FALSE;
+/*
+  Makes oFT's nodes from the image it is read from, if it still is, as
+  it must be before it is changed, in time linear in the image's size.
+  Its files' contents stay in the image. Returns SUCCESS, or
+  MEMORY_ERROR if memory could not be allocated or BAD_IMAGE if the
+  image is malformed, leaving oFT read from the image.
+*/
+static int FT_unpackImage(FT_T oFT) {
+   size_t ulCount;
+   int iStatus;
 
-   iStatus = FT_traversePath(oPPath, &oNFound, FALSE);
-   if (iStatus != SUCCESS)
-      return FALSE;
+   assert(oFT != NULL);
 
-   if (oNFound == NULL || 
-         Path_comparePath(Node_getPath(oNFound), oPPath) != 0)
-      return FALSE;
+   if(!oFT->bInImage)
+      return SUCCESS;
 
-   if (Node_getState(oNFound) == A_FILE) {
-      return (boolean) (iStatus == SUCCESS);
+   assert(oFT->oNRoot == NULL);
+   assert(oFT->oPathIndex == NULL);
+   /* an index enabled meanwhile starts empty, with room for all the
+      nodes, which are added to it as they are inserted */
+   if(oFT->bIndexImage) {
+      iStatus = FT_buildPathIndex(oFT);
+      if(iStatus != SUCCESS)
+         return iStatus;
    }
-   return FALSE;
+   oFT->bInImage = FALSE;
+   ulCount = oFT->ulCount;
+   oFT->ulCount = 0;
+   iStatus = Image_walk(oFT->oIImage, FT_unpackNode, oFT,
+                        FT_WALK_PREORDER);
+   if(iStatus != SUCCESS) {
+      if(oFT->oNRoot != NULL) {
+         (void) Node_free(oFT->oNRoot, oFT->oSSlab);
+         oFT->oNRoot = NULL;
+      }
+      if(oFT->oPathIndex != NULL) {
+         PathIndex_free(oFT->oPathIndex);
+         oFT->oPathIndex = NULL;
+      }
+      oFT->ulCount = ulCount;
+      oFT->bInImage = TRUE;
+      /* a name that is not a path component, or one that is there
+         twice */
+      if(iStatus != MEMORY_ERROR)
+         iStatus = BAD_IMAGE;
+   }
+   else
+      oFT->bIndexImage = FALSE;
+   return iStatus;
 }
 
-int FT_rmFile(const char *pcPath) {
+int FT_insertDirIn(FT_T oFT, const char *pcPath) {
    int iStatus;
-   Node_T oNFound = NULL;
-   Path_T oPPath = NULL;
 
+   assert(oFT != NULL);
    assert(pcPath != NULL);
-   assert(Path_new(pcPath, &oPPath) == SUCCESS);
 
-   if (!bIsInitialized)
-      return INITIALIZATION_ERROR;
+   if(oFT->bReadOnly)
+      return READ_ONLY;
 
-   /* call traverse path to find the last node in pcPath, and 
-   then check if that is actually a directory */
-   iStatus = FT_traversePath(oPPath, &oNFound, FALSE);
+   FT_lockWriters(oFT, FALSE);
+   iStatus = FT_unpackImage(oFT);
+   if(iStatus == SUCCESS)
+      iStatus = FT_insertPath(oFT, pcPath, DIRECTORY, NULL, 0);
+   FT_unlockWriters(oFT);
+   return iStatus;
+}
 
-   if(iStatus != SUCCESS)
-       return iStatus;
+boolean FT_containsDirIn(FT_T oFT, const char *pcPath) {
+   struct found sFound;
 
-   if (oNFound == NULL || 
-         Path_comparePath(Node_getPath(oNFound), oPPath) != 0)
-      return NO_SUCH_PATH;
+   assert(oFT != NULL);
+   assert(pcPath != NULL);
 
-   if (Node_getState(oNFound) != A_FILE) {
-      return NOT_A_FILE;
-   }
+   return (boolean) (FT_lookup(oFT, pcPath, &sFound) == SUCCESS
+                     && !sFound.bIsFile);
+}
 
-   ulCount -= Node_free(oNFound);
-   if(ulCount == 0)
-      oNRoot = NULL;
 
-   return SUCCESS;
+int FT_rmDirIn(FT_T oFT, const char *pcPath) {
+   int iStatus;
+
+   assert(oFT != NULL);
+   assert(pcPath != NULL);
+
+   if(oFT->bReadOnly)
+      return READ_ONLY;
+
+   FT_lockWriters(oFT, FALSE);
+   /* find the node at pcPath, check that it is actually a directory,
+      and remove it */
+   iStatus = FT_unpackImage(oFT);
+   if(iStatus == SUCCESS)
+      iStatus = FT_removePath(oFT, pcPath, DIRECTORY);
+   FT_unlockWriters(oFT);
+   return iStatus;
 }
 
-void *FT_getFileContents(const char *pcPath) {
+int FT_insertFileIn(FT_T oFT, const char *pcPath, void *pvContents,
+                    size_t ulLength) {
    int iStatus;
-   Node_T oNFound = NULL;
-   Path_T oPPath = NULL;
 
+   assert(oFT != NULL);
    assert(pcPath != NULL);
-   assert(Path_new(pcPath, &oPPath) == SUCCESS);
 
-   if (!bIsInitialized)
-      return NULL;
+   if(oFT->bReadOnly)
+      return READ_ONLY;
 
-   iStatus = FT_traversePath(oPPath, &oNFound, FALSE);
+   FT_lockWriters(oFT, FALSE);
+   iStatus = FT_unpackImage(oFT);
+   if(iStatus == SUCCESS)
+      iStatus = FT_insertPath(oFT, pcPath, A_FILE, pvContents,
+                              ulLength);
+   FT_unlockWriters(oFT);
+   return iStatus;
+}
 
-   if(iStatus != SUCCESS)
-       return NULL;
+boolean FT_containsFileIn(FT_T oFT, const char *pcPath) {
+   struct found sFound;
 
-   if (oNFound == NULL || 
-         Path_comparePath(Node_getPath(oNFound), oPPath) != 0)
-      return NULL;
+   assert(oFT != NULL);
+   assert(pcPath != NULL);
 
-   if (Node_getState(oNFound) != A_FILE) {
-      return NULL;
-   }
-   return Node_getFile(oNFound);
+   return (boolean) (FT_lookup(oFT, pcPath, &sFound) == SUCCESS
+                     && sFound.bIsFile);
 }
 
-void *FT_replaceFileContents(const char *pcPath, void *pvNewContents,
-                             size_t ulNewLength) {
+int FT_rmFileIn(FT_T oFT, const char *pcPath) {
    int iStatus;
-   Node_T oNFound = NULL;
-   Path_T oPPath = NULL;
-   void *pvTempOne;
 
+   assert(oFT != NULL);
    assert(pcPath != NULL);
-   assert(Path_new(pcPath, &oPPath) == SUCCESS);
 
-   if (!bIsInitialized)
-      return NULL;
+   if(oFT->bReadOnly)
+      return READ_ONLY;
+
+   FT_lockWriters(oFT, FALSE);
+   /* find the node at pcPath, check that it is actually a file,
+      and remove it */
+   iStatus = FT_unpackImage(oFT);
+   if(iStatus == SUCCESS)
+      iStatus = FT_removePath(oFT, pcPath, A_FILE);
+   FT_unlockWriters(oFT);
+   return iStatus;
+}
 
-   iStatus = FT_traversePath(oPPath, &oNFound, FALSE);
-   if (iStatus != SUCCESS) {
-      Path_free(oPPath);
-      return NULL;
-   }
-   if(oNFound == NULL || 
-         Path_comparePath(Node_getPath(oNFound), oPPath) != 0) {
-      Path_free(oPPath);
+void *FT_getFileContentsIn(FT_T oFT, const char *pcPath) {
+   struct found sFound;
+
+   assert(oFT != NULL);
+   assert(pcPath != NULL);
+
+   if(FT_lookup(oFT, pcPath, &sFound) != SUCCESS || !sFound.bIsFile)
       return NULL;
-   }
+   return sFound.pvContents;
+}
+
+void *FT_replaceFileContentsIn(FT_T oFT, const char *pcPath,
+                               void *pvNewContents,
+                               size_t ulNewLength) {
+   int iStatus;
+   void *pvTempOne = NULL;
+
+   assert(oFT != NULL);
+   assert(pcPath != NULL);
 
-   if (Node_getState(oNFound) != A_FILE) {
-      Path_free(oPPath);
+   if(oFT->bReadOnly)
       return NULL;
-   }
 
-   pvTempOne = Node_getFile(oNFound);
-   Node_setFile(oNFound, pvNewContents);
-   Node_setFileLength(oNFound, ulNewLength);
+   FT_lockWriters(oFT, FALSE);
+   iStatus = FT_unpackImage(oFT);
+   if(iStatus == SUCCESS)
+      (void) FT_replaceFile(oFT, pcPath, pvNewContents, ulNewLength,
+                            &pvTempOne);
+   FT_unlockWriters(oFT);
 
    return pvTempOne;
 }
 
-int FT_stat(const char *pcPath, boolean *pbIsFile, size_t *pulSize) {
+int FT_statIn(FT_T oFT, const char *pcPath, boolean *pbIsFile,
+              size_t *pulSize) {
+   struct found sFound;
    int iStatus;
-   Path_T oPPath = NULL;
-   Node_T oNFound = NULL;
 
+   assert(oFT != NULL);
    assert(pcPath != NULL);
    assert(pbIsFile != NULL);
    assert(pulSize != NULL);
 
-   /* checks for initialization error */
-   if(!bIsInitialized) return INITIALIZATION_ERROR;
-
-   /* checks for memory error and bad path */
-   iStatus = Path_new(pcPath, &oPPath);
-   if(iStatus != SUCCESS) {
-      Path_free(oPPath);
+   /* checks for bad path, conflicting path and no such path */
+   iStatus = FT_lookup(oFT, pcPath, &sFound);
+   if(iStatus != SUCCESS)
       return iStatus;
+
+   /* change booleans depending on if node is directory or Node */
+   *pbIsFile = sFound.bIsFile;
+   if(sFound.bIsFile)
+      *pulSize = sFound.ulLength;
+
+   return SUCCESS;
+}
+
+/*
+  Returns a new family for an FT that has no snapshots yet, of which
+  it is the only member, or NULL if memory could not be allocated.
+*/
+static struct family *FT_newFamily(void) {
+   struct family *psFamily;
+
+   psFamily = malloc(sizeof(struct family));
+   if(psFamily == NULL)
+      return NULL;
+   psFamily->oEList = Epoch_newList();
+   if(psFamily->oEList == NULL) {
+      free(psFamily);
+      return NULL;
+   }
+   psFamily->oVVersions = Node_newVersions(psFamily->oEList);
+   if(psFamily->oVVersions == NULL) {
+      Epoch_freeList(psFamily->oEList);
+      free(psFamily);
+      return NULL;
    }
+   psFamily->ulMembers = 1;
+   return psFamily;
+}
 
-   /* checks for no such path and conflicting path */
-   iStatus = FT_traversePath(oPPath, &oNFound, 0);
-   if (iStatus == CONFLICTING_PATH) return CONFLICTING_PATH;
-   if(oNFound == NULL || 
-         Path_comparePath(Node_getPath(oNFound), oPPath) != 0) {
-      Path_free(oPPath);
-      return NO_SUCH_PATH;
+/*
+  Returns a new, empty FT_T object, concurrent if bConcurrent is TRUE,
+  or NULL if memory could not be allocated.
+
+  A concurrent FT's readers write no memory that other threads use,
+  so never slow one another down: each directory publishes its
+  children in an array that is never changed once readers may see it
+  (see Node_makeConcurrent), and what a writer unlinks, down to whole
+  subtrees, is retired to the family's list and freed, by a later
+  writer or by FT_free, only once no reader that might have reached
+  it is still reading (see epoch.h), so removing a subtree never
+  waits for its readers. Writers hold sWriters shared and the lock of
+  each directory they change, and start over (see FT_RETRY) when
+  another has just changed what they are about to change.
+*/
+static FT_T FT_create(boolean bConcurrent) {
+   FT_T oFT;
+
+   oFT = malloc(sizeof(struct FT));
+   if(oFT == NULL)
+      return NULL;
+   /* a concurrent FT's writers share its slab */
+   oFT->oSSlab = bConcurrent ? Slab_newLocked() : Slab_new();
+   if(oFT->oSSlab == NULL) {
+      free(oFT);
+      return NULL;
+   }
+   oFT->bConcurrent = bConcurrent;
+   oFT->bExclusive = FALSE;
+   oFT->psFamily = NULL;
+   if(bConcurrent) {
+      oFT->psFamily = FT_newFamily();
+      if(oFT->psFamily == NULL) {
+         Slab_free(oFT->oSSlab);
+         free(oFT);
+         return NULL;
+      }
+      if(pthread_rwlock_init(&oFT->sWriters, NULL) != 0) {
+         Node_freeVersions(oFT->psFamily->oVVersions);
+         Epoch_freeList(oFT->psFamily->oEList);
+         free(oFT->psFamily);
+         Slab_free(oFT->oSSlab);
+         free(oFT);
+         return NULL;
+      }
    }
 
-   /* change booleans depending on if node is directory or Node */
-   if (Node_getState(oNFound) == DIRECTORY) {
-      *pbIsFile = FALSE;
+   oFT->oNRoot = NULL;
+   oFT->ulCount = 0;
+   oFT->oPathIndex = NULL;
+   oFT->bReadOnly = FALSE;
+   oFT->bShared = FALSE;
+   oFT->oIImage = NULL;
+   oFT->bInImage = FALSE;
+   oFT->oNDead = NULL;
+   oFT->bIndexImage = FALSE;
+   oFT->ulIndexThreshold = NODE_INDEX_THRESHOLD;
+
+   return oFT;
+}
+
+FT_T FT_new(void) {
+   return FT_create(FALSE);
+}
+
+FT_T FT_newConcurrent(void) {
+   return FT_create(TRUE);
+}
+
+/*
+  Epoch_retire callback that frees the FT whose record psRetired is,
+  once no reader of another FT of its family can still be looking at
+  the nodes FT_free left in it.
+*/
+static void FT_reclaim(struct EpochRetired *psRetired) {
+   FT_T oFT;
+
+   assert(psRetired != NULL);
+
+   oFT = (FT_T) (void *) ((char *) psRetired
+                          - offsetof(struct FT, sRetired));
+   Node_releaseDead(oFT->oNDead, oFT->oSSlab);
+   free(oFT);
+}
+
+void FT_free(FT_T oFT) {
+   struct family *psFamily;
+   Slab_T oSSlab;
+   Image_T oIImage;
+
+   assert(oFT != NULL);
+
+   psFamily = oFT->psFamily;
+   oSSlab = oFT->oSSlab;
+   oIImage = oFT->oIImage;
+   if(oFT->bConcurrent)
+      (void) pthread_rwlock_destroy(&oFT->sWriters);
+   if(oFT->oPathIndex != NULL)
+      PathIndex_free(oFT->oPathIndex);
+
+   if(psFamily == NULL) {
+      if(oFT->oNRoot != NULL)
+         (void) Node_free(oFT->oNRoot, oSSlab);
+      free(oFT);
    }
    else {
-      *pbIsFile = TRUE;
-      *pulSize = Node_getFileLength(oNFound);
+      /* what other FTs of the family share is left to them, and what
+         only oFT held goes once their readers are done with it */
+      oFT->oNDead = NULL;
+      if(oFT->oNRoot != NULL)
+         (void) Node_freeShared(oFT->oNRoot, oSSlab,
+                                psFamily->oVVersions, &oFT->oNDead);
+      oFT->sRetired.pfFree = FT_reclaim;
+      Epoch_retire(psFamily->oEList, &oFT->sRetired);
+      (void) Epoch_reclaim(psFamily->oEList);
+      if(__atomic_sub_fetch(&psFamily->ulMembers, 1,
+                            __ATOMIC_ACQ_REL) != 0)
+         return;
+      /* no thread can be using the family any more, so what was
+         retired can go at once */
+      Epoch_flush(psFamily->oEList);
+      Epoch_freeList(psFamily->oEList);
+      Node_freeVersions(psFamily->oVVersions);
+      free(psFamily);
    }
 
-   Path_free(oPPath);
-   return SUCCESS;
+   /* the last of an FT and its snapshots frees their slab, and
+      unmaps the image their files' contents may lie in */
+   Slab_free(oSSlab);
+   if(oIImage != NULL)
+      Image_close(oIImage);
 }
 
-int FT_init(void) {
+FT_T FT_snapshotIn(FT_T oFT) {
+   FT_T oFTSnapshot;
 
-   if(bIsInitialized)
-      return INITIALIZATION_ERROR;
+   assert(oFT != NULL);
 
-   bIsInitialized = TRUE;
-   oNRoot = NULL;
-   ulCount = 0;
+   /* the snapshot shares all oFT's nodes, each of which counts the
+      trees and directories that hold it, so costs constant time;
+      before oFT is changed, the nodes on the path to the change that
+      are still shared are copied (see FT_ownPath), so a change on a
+      path of shared nodes takes time linear in their children, and
+      nodes are freed once the last tree holding them is */
+   oFTSnapshot = malloc(sizeof(struct FT));
+   if(oFTSnapshot == NULL)
+      return NULL;
+   /* the first snapshot makes oFT's slab and nodes fit for the
+      threads of both */
+   if(oFT->psFamily == NULL) {
+      if(!Slab_makeLocked(oFT->oSSlab)) {
+         free(oFTSnapshot);
+         return NULL;
+      }
+      oFT->psFamily = FT_newFamily();
+      if(oFT->psFamily == NULL) {
+         free(oFTSnapshot);
+         return NULL;
+      }
+   }
+
+   /* no writer may be changing the nodes the snapshot shares */
+   FT_lockWriters(oFT, TRUE);
+   (void) __atomic_add_fetch(&oFT->psFamily->ulMembers, 1,
+                             __ATOMIC_RELAXED);
+   if(oFT->oNRoot != NULL)
+      Node_share(oFT->oNRoot);
+   oFTSnapshot->oNRoot = oFT->oNRoot;
+   oFTSnapshot->ulCount = oFT->ulCount;
+   oFTSnapshot->oSSlab = oFT->oSSlab;
+   oFTSnapshot->oPathIndex = NULL;
+   oFTSnapshot->bConcurrent = FALSE;
+   oFTSnapshot->bExclusive = FALSE;
+   oFTSnapshot->psFamily = oFT->psFamily;
+   oFTSnapshot->bReadOnly = TRUE;
+   oFTSnapshot->bShared = TRUE;
+   oFTSnapshot->oIImage = oFT->oIImage;
+   oFTSnapshot->bInImage = oFT->bInImage;
+   oFTSnapshot->oNDead = NULL;
+   oFTSnapshot->bIndexImage = FALSE;
+   oFTSnapshot->ulIndexThreshold = oFT->ulIndexThreshold;
+   oFT->bShared = TRUE;
+   FT_unlockWriters(oFT);
+
+   return oFTSnapshot;
+}
 
+int FT_newFromImage(const char *pcFilename, FT_T *poFTResult) {
+   Image_T oIImage;
+   int iStatus;
+
+   assert(pcFilename != NULL);
+   assert(poFTResult != NULL);
+
+   /* only the header is read: until the FT is first changed,
+      lookups and walks read the image where it lies, binary-searching
+      each directory's children without allocating a node, and cost
+      only the pages of the image they touch */
+   *poFTResult = NULL;
+   iStatus = Image_open(pcFilename, &oIImage);
+   if(iStatus != SUCCESS)
+      return iStatus;
+
+   *poFTResult = FT_create(FALSE);
+   if(*poFTResult == NULL) {
+      Image_close(oIImage);
+      return MEMORY_ERROR;
+   }
+   (*poFTResult)->oIImage = oIImage;
+   (*poFTResult)->bInImage = TRUE;
+   (*poFTResult)->ulCount = Image_getCount(oIImage);
    return SUCCESS;
 }
 
-int FT_destroy(void) {
-   if(!bIsInitialized)
-      return INITIALIZATION_ERROR;
+/* The most characters FT_createTemp adds to a file's name */
+enum { FT_TEMP_SUFFIX = 48 };
 
-   if(oNRoot) {
-      ulCount -= Node_free(oNRoot);
-      oNRoot = NULL;
+/*
+  Creates a new file, for writing, in the directory of the file named
+  pcFilename, with a name made from that name, which it stores in
+  pcTemp, which must have room for FT_TEMP_SUFFIX characters more than
+  pcFilename. Returns its file descriptor, or -1 (with errno set) if
+  it could not be created.
+*/
+static int FT_createTemp(const char *pcFilename, char *pcTemp) {
+   unsigned long ulTry;
+   int iFd;
+
+   assert(pcFilename != NULL);
+   assert(pcTemp != NULL);
+
+   /* another process or thread may be saving to the same name */
+   for(ulTry = 0; ; ulTry++) {
+      sprintf(pcTemp, "%s.%ld.%lu.tmp", pcFilename, (long) getpid(),
+              ulTry);
+      iFd = open(pcTemp, O_WRONLY | O_CREAT | O_EXCL, 0666);
+      if(iFd >= 0 || errno != EEXIST)
+         return iFd;
    }
+}
 
-   bIsInitialized = FALSE;
+/*
+  Flushes the directory of the file named pcFilename to the disk, so
+  that a file just renamed into it stays there after a crash, storing
+  the directory's name in pcDir, which must have room for pcFilename.
+  Returns SUCCESS, or WRITE_ERROR (with errno set by the call that
+  failed) if it could not be opened or flushed.
+*/
+static int FT_syncDirectory(const char *pcFilename, char *pcDir) {
+   const char *pcSlash;
+   size_t ulLength;
+   int iFd;
+   int iStatus = SUCCESS;
+
+   assert(pcFilename != NULL);
+   assert(pcDir != NULL);
+
+   pcSlash = strrchr(pcFilename, '/');
+   if(pcSlash == NULL)
+      strcpy(pcDir, ".");
+   else {
+      /* a file in the root directory keeps its slash */
+      ulLength = (size_t) (pcSlash - pcFilename);
+      if(ulLength == 0)
+         ulLength = 1;
+      memcpy(pcDir, pcFilename, ulLength);
+      pcDir[ulLength] = '\0';
+   }
 
-   return SUCCESS;
+   iFd = open(pcDir, O_RDONLY);
+   if(iFd < 0)
+      return WRITE_ERROR;
+   if(fsync(iFd) != 0)
+      iStatus = WRITE_ERROR;
+   (void) close(iFd);
+   return iStatus;
+}
+
+int FT_saveIn(FT_T oFT, const char *pcFilename) {
+   struct stat sOld;
+   boolean bReplacing;
+   char *pcTemp;
+   int iFd;
+   int iStatus;
+   int iErrno;
+
+   assert(oFT != NULL);
+   assert(pcFilename != NULL);
+
+   /* write a new file and rename it over pcFilename once complete,
+      so that a failed save leaves the old file as it was, and an
+      image mapped from the old one, which may hold the contents of
+      oFT's files, is not truncated */
+   pcTemp = malloc(strlen(pcFilename) + FT_TEMP_SUFFIX + 1);
+   if(pcTemp == NULL)
+      return MEMORY_ERROR;
+   bReplacing = (boolean) (stat(pcFilename, &sOld) == 0);
+   iFd = FT_createTemp(pcFilename, pcTemp);
+   if(iFd < 0) {
+      free(pcTemp);
+      return WRITE_ERROR;
+   }
+
+   /* an image needs no nodes to be written again */
+   FT_lockWriters(oFT, TRUE);
+   if(oFT->bInImage)
+      iStatus = Image_copy(oFT->oIImage, iFd);
+   else
+      iStatus = Image_write(oFT->oNRoot, oFT->ulCount, iFd);
+   FT_unlockWriters(oFT);
+
+   /* the new file takes the place of the old one with its mode, and
+      only once it is on the disk, so that a crash cannot leave the
+      name to a file that was never written out */
+   if(iStatus == SUCCESS && bReplacing
+      && fchmod(iFd, sOld.st_mode & 07777) != 0)
+      iStatus = WRITE_ERROR;
+   if(iStatus == SUCCESS && fsync(iFd) != 0)
+      iStatus = WRITE_ERROR;
+   if(close(iFd) != 0 && iStatus == SUCCESS)
+      iStatus = WRITE_ERROR;
+   if(iStatus == SUCCESS && rename(pcTemp, pcFilename) != 0)
+      iStatus = WRITE_ERROR;
+   if(iStatus != SUCCESS) {
+      /* keep errno as the call that failed set it */
+      iErrno = errno;
+      (void) unlink(pcTemp);
+      errno = iErrno;
+   }
+   else
+      /* and the rename itself is only on the disk with the directory */
+      iStatus = FT_syncDirectory(pcFilename, pcTemp);
+   free(pcTemp);
+   return iStatus;
+}
+
+int FT_setPathIndexIn(FT_T oFT, boolean bEnabled) {
+   int iStatus = SUCCESS;
+
+   assert(oFT != NULL);
+
+   /* lookups through the index would need locks */
+   if(oFT->bConcurrent)
+      return SUCCESS;
+   /* an image has no nodes to index until they are made from it */
+   if(oFT->bInImage) {
+      oFT->bIndexImage = bEnabled;
+      return SUCCESS;
+   }
+
+   if(!bEnabled) {
+      if(oFT->oPathIndex != NULL) {
+         PathIndex_free(oFT->oPathIndex);
+         oFT->oPathIndex = NULL;
+      }
+   }
+   else if(oFT->oPathIndex == NULL)
+      iStatus = FT_buildPathIndex(oFT);
+   return iStatus;
+}
+
+void FT_setIndexThresholdIn(FT_T oFT, size_t ulThreshold) {
+   assert(oFT != NULL);
+
+   /* concurrent directories keep no child index, and their writers
+      read the threshold without a lock */
+   if(oFT->bConcurrent)
+      return;
+   oFT->ulIndexThreshold = ulThreshold;
+}
+
+void FT_getSlabStatsIn(FT_T oFT, struct SlabStats *psStats) {
+   assert(oFT != NULL);
+   assert(psStats != NULL);
+
+   /* a concurrent FT's slab locks itself */
+   Slab_getStats(oFT->oSSlab, psStats);
 }
 
 /* --------------------------------------------------------------------
@@ -562,82 +1712,641 @@ int FT_destroy(void) {
 */
 
 /*
-  Performs a pre-order traversal of the tree rooted at n,
-  inserting each payload to DynArray_T d beginning at index i.
-  Returns the total length of all paths in the FT as totalStrLen.
+  Node_walk visitor that adds the length of oNNode's line in the
+  string representation, its path and a newline, to the size_t that
+  pvTotal points to.
 */
-static size_t FT_preOrderTraversal(DynArray_T d, Node_T n, 
-      size_t *totalStrLen) {
-   size_t c;
-   size_t j;
-   DynArray_T temp;
+static int FT_addLength(Node_T oNNode, int iOrder, void *pvTotal) {
+   assert(oNNode != NULL);
+   assert(pvTotal != NULL);
+   (void) iOrder;
 
-   assert(d != NULL);
-   assert(totalStrLen != NULL);
+   *(size_t *) pvTotal += Node_getPathLength(oNNode) + 1;
+   return SUCCESS;
+}
 
-   temp = DynArray_new(1);
+/*
+  Node_walk visitor that writes oNNode's path, followed by a newline
+  and a '\0', at the write cursor that pvCursor points to, and advances
+  the cursor to that '\0', where the next path goes. Unlike strcat,
+  never rescans what has been written, so writing all the paths takes
+  time linear in their total length.
+*/
+static int FT_writeAccumulate(Node_T oNNode, int iOrder,
+                              void *pvCursor) {
+   char **ppcCursor = pvCursor;
+   char *pcCursor;
+
+   assert(oNNode != NULL);
+   assert(ppcCursor != NULL);
+   assert(*ppcCursor != NULL);
+   (void) iOrder;
+
+   pcCursor = Node_writePath(oNNode, *ppcCursor);
+   *pcCursor++ = '\n';
+   *pcCursor = '\0';
+   *ppcCursor = pcCursor;
+   return SUCCESS;
+}
 
-   if(n != NULL) {
-      (void) DynArray_add(d, n);
-      *totalStrLen += (Path_getStrLength(Node_getPath(n)) + 1);
+/* Image_walk visitor that does as FT_addLength does for pcPath. */
+static int FT_addImageLength(Image_T oIImage, size_t ulRecord,
+                             const char *pcPath, int iOrder,
+                             void *pvTotal) {
+   assert(pcPath != NULL);
+   assert(pvTotal != NULL);
+   (void) oIImage;
+   (void) ulRecord;
+   (void) iOrder;
 
-      for(c = 0; c < Node_getNumChildren(n); c++) {
-         Node_T oNChild = NULL;
-         assert(!Node_getChild(n,c, &oNChild));
+   *(size_t *) pvTotal += strlen(pcPath) + 1;
+   return SUCCESS;
+}
 
-         if (Node_getState(oNChild) == A_FILE) {
-            (void) DynArray_add(d, oNChild);
-            *totalStrLen += 
-               (Path_getStrLength(Node_getPath(oNChild)) + 1);
-         }
-         else {
-            (void) DynArray_add(temp, oNChild);
-         }
-      }
-      for (j = 0; j< DynArray_getLength(temp); j++) {
-         (void) FT_preOrderTraversal(d, DynArray_get(temp, j), 
-            totalStrLen);
-      }
-   }
-   return *totalStrLen;
+/* Image_walk visitor that does as FT_writeAccumulate does for
+   pcPath. */
+static int FT_writeImageAccumulate(Image_T oIImage, size_t ulRecord,
+                                   const char *pcPath, int iOrder,
+                                   void *pvCursor) {
+   char **ppcCursor = pvCursor;
+   size_t ulLength;
+
+   assert(pcPath != NULL);
+   assert(ppcCursor != NULL);
+   assert(*ppcCursor != NULL);
+   (void) oIImage;
+   (void) ulRecord;
+   (void) iOrder;
+
+   ulLength = strlen(pcPath);
+   memcpy(*ppcCursor, pcPath, ulLength);
+   (*ppcCursor)[ulLength] = '\n';
+   (*ppcCursor)[ulLength + 1] = '\0';
+   *ppcCursor += ulLength + 1;
+   return SUCCESS;
 }
 
 /*
-  Alternate version of strcat that inverts the typical argument
-  order, appending oNNode's path onto pcAcc, and also always adds one
-  newline at the end of the concatenated string.
+  Returns the string representation of oFT, which is read from its
+  image, as FT_toStringIn does, or NULL if memory could not be
+  allocated or the image is bad.
 */
-static void FT_strcatAccumulate(Node_T oNNode, char *pcAcc) {
-   assert(pcAcc != NULL);
+static char *FT_imageToString(FT_T oFT) {
+   size_t totalStrlen = 1;
+   char *result;
+   char *pcCursor;
+
+   assert(oFT != NULL);
+   assert(oFT->bInImage);
+
+   if(Image_walk(oFT->oIImage, FT_addImageLength, &totalStrlen,
+                 FT_WALK_PREORDER | FT_WALK_FILES_FIRST) != SUCCESS)
+      return NULL;
+
+   result = malloc(totalStrlen);
+   if(result == NULL)
+      return NULL;
+   *result = '\0';
 
-   if(oNNode != NULL) {
-      strcat(pcAcc, Path_getPathname(Node_getPath(oNNode)));
-      strcat(pcAcc, "\n");
+   pcCursor = result;
+   if(Image_walk(oFT->oIImage, FT_writeImageAccumulate, &pcCursor,
+                 FT_WALK_PREORDER | FT_WALK_FILES_FIRST) != SUCCESS) {
+      free(result);
+      return NULL;
    }
+   assert(pcCursor == result + totalStrlen - 1);
+   return result;
 }
 /*--------------------------------------------------------------------*/
 
-char *FT_toString(void) {
-   DynArray_T nodes;
+char *FT_toStringIn(FT_T oFT) {
    size_t totalStrlen = 1;
    char *result = NULL;
+   char *pcCursor;
+   int iStatus;
 
-   if(!bIsInitialized)
-      return NULL;
+   assert(oFT != NULL);
 
-   nodes = DynArray_new(ulCount); 
+   /* with writers held off, the FT cannot change between the walks,
+      and readers change nothing */
+   FT_lockWriters(oFT, TRUE);
+   if(oFT->bInImage) {
+      result = FT_imageToString(oFT);
+      FT_unlockWriters(oFT);
+      return result;
+   }
 
-   result = malloc(FT_preOrderTraversal(nodes, oNRoot, &totalStrlen));
+   /* one walk to size the string and another to fill it, in the
+      order of the representation */
+   if(oFT->oNRoot != NULL) {
+      iStatus = Node_walk(oFT->oNRoot, FT_addLength, &totalStrlen,
+                          FT_WALK_PREORDER | FT_WALK_FILES_FIRST);
+      assert(iStatus == SUCCESS);
+      (void) iStatus;
+   }
+
+   result = malloc(totalStrlen);
    if(result == NULL) {
-      DynArray_free(nodes);
+      FT_unlockWriters(oFT);
       return NULL;
    }
    *result = '\0';
 
-   DynArray_map(nodes, (void (*)(void *, void*)) FT_strcatAccumulate,
-                (void *) result);
-
-   DynArray_free(nodes);
+   pcCursor = result;
+   if(oFT->oNRoot != NULL) {
+      iStatus = Node_walk(oFT->oNRoot, FT_writeAccumulate, &pcCursor,
+                          FT_WALK_PREORDER | FT_WALK_FILES_FIRST);
+      assert(iStatus == SUCCESS);
+      (void) iStatus;
+   }
+   assert(pcCursor == result + totalStrlen - 1);
+   FT_unlockWriters(oFT);
 
    return result;
 }
+
+/* --------------------------------------------------------------------
+
+  The following auxiliary functions are used for walking the FT on
+  behalf of a client.
+*/
+
+/* The state of a call to FT_walk */
+struct walker {
+   /* the client's function to visit each node with */
+   int (*pfVisit)(const char *pcPath, boolean bIsFile, int iOrder,
+                  void *pvContext);
+   /* the client's argument to pfVisit */
+   void *pvContext;
+   /* the buffer each node's path is written into for pfVisit */
+   char *pcPath;
+   /* the number of characters allocated for pcPath */
+   size_t ulSize;
+};
+
+/*
+  Node_walk visitor that writes oNNode's path into psWalker's buffer,
+  doubling the buffer if the path does not fit, and hands it to the
+  client. Returns the client's status, or MEMORY_ERROR if the buffer
+  could not be grown.
+*/
+static int FT_visitNode(Node_T oNNode, int iOrder, void *pvWalker) {
+   struct walker *psWalker = pvWalker;
+   boolean bIsFile;
+   size_t ulSize;
+   char *pcPath;
+
+   assert(oNNode != NULL);
+   assert(psWalker != NULL);
+
+   if(Node_getPathLength(oNNode) >= psWalker->ulSize) {
+      ulSize = 2 * psWalker->ulSize;
+      if(ulSize <= Node_getPathLength(oNNode))
+         ulSize = Node_getPathLength(oNNode) + 1;
+      pcPath = realloc(psWalker->pcPath, ulSize);
+      if(pcPath == NULL)
+         return MEMORY_ERROR;
+      psWalker->pcPath = pcPath;
+      psWalker->ulSize = ulSize;
+   }
+
+   (void) Node_writePath(oNNode, psWalker->pcPath);
+   bIsFile = (boolean) (Node_getState(oNNode) == A_FILE);
+   return (*psWalker->pfVisit)(psWalker->pcPath, bIsFile, iOrder,
+                               psWalker->pvContext);
+}
+
+/* Image_walk visitor that hands ulRecord of oIImage, at pcPath, to the
+   client of the walker pvWalker points to. Returns the client's
+   status. */
+static int FT_visitImage(Image_T oIImage, size_t ulRecord,
+                         const char *pcPath, int iOrder,
+                         void *pvWalker) {
+   struct walker *psWalker = pvWalker;
+
+   assert(oIImage != NULL);
+   assert(pcPath != NULL);
+   assert(psWalker != NULL);
+
+   return (*psWalker->pfVisit)(pcPath, Image_isFile(oIImage, ulRecord),
+                               iOrder, psWalker->pvContext);
+}
+/*--------------------------------------------------------------------*/
+
+int FT_walkIn(FT_T oFT,
+              int (*pfVisit)(const char *pcPath, boolean bIsFile,
+                             int iOrder, void *pvContext),
+              void *pvContext, int iFlags) {
+   struct walker sWalker;
+   Node_T oNRoot;
+   int iStatus;
+
+   assert(oFT != NULL);
+   assert(pfVisit != NULL);
+
+   sWalker.pfVisit = pfVisit;
+   sWalker.pvContext = pvContext;
+   sWalker.pcPath = NULL;
+   sWalker.ulSize = 0;
+
+   /* Image_walk keeps its own buffer for the paths */
+   if(oFT->bInImage)
+      return Image_walk(oFT->oIImage, FT_visitImage, &sWalker, iFlags);
+
+   /* in a concurrent FT, the walk keeps the directories it is in
+      from being freed, and nothing else it reaches is freed before
+      it goes on to another directory */
+   iStatus = SUCCESS;
+   FT_beginRead(oFT);
+   oNRoot = EPOCH_LOAD(&oFT->oNRoot);
+   if(oNRoot != NULL)
+      /* a status the client returns never prunes the walk */
+      iStatus = Node_walk(oNRoot, FT_visitNode, &sWalker,
+                          FT_walkFlags(oFT, iFlags));
+   FT_endRead(oFT);
+
+   free(sWalker.pcPath);
+   return iStatus;
+}
+
+/* --------------------------------------------------------------------
+
+  The following auxiliary functions are used for streaming the string
+  representation of the FT.
+*/
+
+/* The most characters handed to a serializer's client at once, unless
+   a single path is longer */
+enum { SERIALIZE_CHUNK_SIZE = 4096 };
+
+/* The state of a call to FT_serialize */
+struct serializer {
+   /* the client's function to hand each full chunk to */
+   int (*pfWrite)(const char *pcData, size_t ulLength,
+                  void *pvContext);
+   /* the client's argument to pfWrite */
+   void *pvContext;
+   /* the chunk being filled */
+   char *pcChunk;
+   /* the number of characters allocated for pcChunk, which is
+      SERIALIZE_CHUNK_SIZE unless a longer line has needed more */
+   size_t ulSize;
+   /* the number of characters in pcChunk so far */
+   size_t ulUsed;
+};
+
+/*
+  Hands the characters in psSerializer's chunk to its client, leaving
+  the chunk empty. Returns the client's status, or SUCCESS if there
+  was nothing to hand over.
+*/
+static int FT_flushChunk(struct serializer *psSerializer) {
+   int iStatus = SUCCESS;
+
+   assert(psSerializer != NULL);
+
+   if(psSerializer->ulUsed != 0)
+      iStatus = (*psSerializer->pfWrite)(psSerializer->pcChunk,
+                                         psSerializer->ulUsed,
+                                         psSerializer->pvContext);
+   psSerializer->ulUsed = 0;
+   return iStatus;
+}
+
+/*
+  Makes room for ulLine more characters in psSerializer's chunk, first
+  handing the chunk to the client if they would take it past
+  SERIALIZE_CHUNK_SIZE, and growing it if they alone do not fit.
+  Returns SUCCESS, the client's status if that is not SUCCESS, or
+  MEMORY_ERROR if the chunk could not be grown.
+*/
+static int FT_makeRoom(struct serializer *psSerializer, size_t ulLine) {
+   char *pcChunk;
+   int iStatus;
+
+   assert(psSerializer != NULL);
+
+   if(psSerializer->ulUsed + ulLine > SERIALIZE_CHUNK_SIZE) {
+      iStatus = FT_flushChunk(psSerializer);
+      if(iStatus != SUCCESS)
+         return iStatus;
+   }
+   /* only a chunk of a single long line needs more room */
+   if(ulLine > psSerializer->ulSize) {
+      pcChunk = realloc(psSerializer->pcChunk, ulLine);
+      if(pcChunk == NULL)
+         return MEMORY_ERROR;
+      psSerializer->pcChunk = pcChunk;
+      psSerializer->ulSize = ulLine;
+   }
+   return SUCCESS;
+}
+
+/*
+  Node_walk visitor that appends oNNode's path and a newline to the
+  chunk of the serializer pvSerializer points to, making room for
+  them with FT_makeRoom. Returns SUCCESS, or FT_makeRoom's status if
+  that is not SUCCESS.
+*/
+static int FT_serializeLine(Node_T oNNode, int iOrder,
+                            void *pvSerializer) {
+   struct serializer *psSerializer = pvSerializer;
+   char *pcChunk;
+   int iStatus;
+
+   assert(oNNode != NULL);
+   assert(psSerializer != NULL);
+   (void) iOrder;
+
+   /* the path, its newline, and the '\0' Node_writePath adds */
+   iStatus = FT_makeRoom(psSerializer, Node_getPathLength(oNNode) + 2);
+   if(iStatus != SUCCESS)
+      return iStatus;
+
+   pcChunk = Node_writePath(oNNode,
+                            psSerializer->pcChunk + psSerializer->ulUsed);
+   *pcChunk++ = '\n';
+   psSerializer->ulUsed = (size_t) (pcChunk - psSerializer->pcChunk);
+   return SUCCESS;
+}
+
+/* Image_walk visitor that does as FT_serializeLine does for
+   pcPath. */
+static int FT_serializeImageLine(Image_T oIImage, size_t ulRecord,
+                                 const char *pcPath, int iOrder,
+                                 void *pvSerializer) {
+   struct serializer *psSerializer = pvSerializer;
+   size_t ulLength;
+   int iStatus;
+
+   assert(pcPath != NULL);
+   assert(psSerializer != NULL);
+   (void) oIImage;
+   (void) ulRecord;
+   (void) iOrder;
+
+   ulLength = strlen(pcPath);
+   iStatus = FT_makeRoom(psSerializer, ulLength + 1);
+   if(iStatus != SUCCESS)
+      return iStatus;
+
+   memcpy(psSerializer->pcChunk + psSerializer->ulUsed, pcPath,
+          ulLength);
+   psSerializer->ulUsed += ulLength;
+   psSerializer->pcChunk[psSerializer->ulUsed++] = '\n';
+   return SUCCESS;
+}
+
+/*
+  Writes the ulLength characters at pcData to the file descriptor that
+  pvFd points to, retrying partial and interrupted writes. Returns
+  SUCCESS, or WRITE_ERROR if write fails.
+*/
+static int FT_writeChunk(const char *pcData, size_t ulLength,
+                         void *pvFd) {
+   ssize_t lWritten;
+
+   assert(pcData != NULL);
+   assert(pvFd != NULL);
+
+   while(ulLength != 0) {
+      lWritten = write(*(int *) pvFd, pcData, ulLength);
+      if(lWritten < 0) {
+         if(errno == EINTR)
+            continue;
+         return WRITE_ERROR;
+      }
+      pcData += lWritten;
+      ulLength -= (size_t) lWritten;
+   }
+   return SUCCESS;
+}
+/*--------------------------------------------------------------------*/
+
+int FT_serializeIn(FT_T oFT,
+                   int (*pfWrite)(const char *pcData, size_t ulLength,
+                                  void *pvContext),
+                   void *pvContext) {
+   struct serializer sSerializer;
+   Node_T oNRoot;
+   int iStatus = SUCCESS;
+
+   assert(oFT != NULL);
+   assert(pfWrite != NULL);
+
+   FT_beginRead(oFT);
+   oNRoot = EPOCH_LOAD(&oFT->oNRoot);
+   if(oNRoot == NULL && !oFT->bInImage) {
+      FT_endRead(oFT);
+      return SUCCESS;
+   }
+
+   sSerializer.pfWrite = pfWrite;
+   sSerializer.pvContext = pvContext;
+   sSerializer.ulSize = SERIALIZE_CHUNK_SIZE;
+   sSerializer.ulUsed = 0;
+   sSerializer.pcChunk = malloc(sSerializer.ulSize);
+   if(sSerializer.pcChunk == NULL) {
+      FT_endRead(oFT);
+      return MEMORY_ERROR;
+   }
+
+   if(oFT->bInImage)
+      iStatus = Image_walk(oFT->oIImage, FT_serializeImageLine,
+                           &sSerializer,
+                           FT_WALK_PREORDER | FT_WALK_FILES_FIRST);
+   else
+      iStatus = Node_walk(oNRoot, FT_serializeLine, &sSerializer,
+                          FT_walkFlags(oFT, FT_WALK_PREORDER
+                                            | FT_WALK_FILES_FIRST));
+   FT_endRead(oFT);
+   if(iStatus == SUCCESS)
+      iStatus = FT_flushChunk(&sSerializer);
+
+   free(sSerializer.pcChunk);
+   return iStatus;
+}
+
+int FT_writeToIn(FT_T oFT, int iFd) {
+   assert(oFT != NULL);
+
+   return FT_serializeIn(oFT, FT_writeChunk, &iFd);
+}
+
+/* --------------------------------------------------------------------
+
+  The following functions work on the default FT, which FT_init
+  creates and FT_destroy frees.
+*/
+
+int FT_init(void) {
+   if(oFTDefault != NULL)
+      return INITIALIZATION_ERROR;
+
+   oFTDefault = FT_new();
+   if(oFTDefault == NULL)
+      return MEMORY_ERROR;
+   return SUCCESS;
+}
+
+int FT_destroy(void) {
+   if(oFTDefault == NULL)
+      return INITIALIZATION_ERROR;
+
+   FT_free(oFTDefault);
+   oFTDefault = NULL;
+   return SUCCESS;
+}
+
+int FT_insertDir(const char *pcPath) {
+   assert(pcPath != NULL);
+
+   if(oFTDefault == NULL)
+      return INITIALIZATION_ERROR;
+   return FT_insertDirIn(oFTDefault, pcPath);
+}
+
+boolean FT_containsDir(const char *pcPath) {
+   assert(pcPath != NULL);
+
+   if(oFTDefault == NULL)
+      return FALSE;
+   return FT_containsDirIn(oFTDefault, pcPath);
+}
+
+int FT_rmDir(const char *pcPath) {
+   assert(pcPath != NULL);
+
+   if(oFTDefault == NULL)
+      return INITIALIZATION_ERROR;
+   return FT_rmDirIn(oFTDefault, pcPath);
+}
+
+int FT_insertFile(const char *pcPath, void *pvContents,
+                  size_t ulLength) {
+   assert(pcPath != NULL);
+
+   if(oFTDefault == NULL)
+      return INITIALIZATION_ERROR;
+   return FT_insertFileIn(oFTDefault, pcPath, pvContents, ulLength);
+}
+
+boolean FT_containsFile(const char *pcPath) {
+   assert(pcPath != NULL);
+
+   if(oFTDefault == NULL)
+      return FALSE;
+   return FT_containsFileIn(oFTDefault, pcPath);
+}
+
+int FT_rmFile(const char *pcPath) {
+   assert(pcPath != NULL);
+
+   if(oFTDefault == NULL)
+      return INITIALIZATION_ERROR;
+   return FT_rmFileIn(oFTDefault, pcPath);
+}
+
+void *FT_getFileContents(const char *pcPath) {
+   assert(pcPath != NULL);
+
+   if(oFTDefault == NULL)
+      return NULL;
+   return FT_getFileContentsIn(oFTDefault, pcPath);
+}
+
+void *FT_replaceFileContents(const char *pcPath, void *pvNewContents,
+                             size_t ulNewLength) {
+   assert(pcPath != NULL);
+
+   if(oFTDefault == NULL)
+      return NULL;
+   return FT_replaceFileContentsIn(oFTDefault, pcPath, pvNewContents,
+                                   ulNewLength);
+}
+
+int FT_stat(const char *pcPath, boolean *pbIsFile, size_t *pulSize) {
+   assert(pcPath != NULL);
+   assert(pbIsFile != NULL);
+   assert(pulSize != NULL);
+
+   if(oFTDefault == NULL)
+      return INITIALIZATION_ERROR;
+   return FT_statIn(oFTDefault, pcPath, pbIsFile, pulSize);
+}
+
+int FT_setPathIndex(boolean bEnabled) {
+   if(oFTDefault == NULL)
+      return INITIALIZATION_ERROR;
+   return FT_setPathIndexIn(oFTDefault, bEnabled);
+}
+
+int FT_setIndexThreshold(size_t ulThreshold) {
+   if(oFTDefault == NULL)
+      return INITIALIZATION_ERROR;
+   FT_setIndexThresholdIn(oFTDefault, ulThreshold);
+   return SUCCESS;
+}
+
+int FT_getSlabStats(struct SlabStats *psStats) {
+   assert(psStats != NULL);
+
+   if(oFTDefault == NULL)
+      return INITIALIZATION_ERROR;
+   FT_getSlabStatsIn(oFTDefault, psStats);
+   return SUCCESS;
+}
+
+char *FT_toString(void) {
+   if(oFTDefault == NULL)
+      return NULL;
+   return FT_toStringIn(oFTDefault);
+}
+
+int FT_walk(int (*pfVisit)(const char *pcPath, boolean bIsFile,
+                           int iOrder, void *pvContext),
+            void *pvContext, int iFlags) {
+   assert(pfVisit != NULL);
+
+   if(oFTDefault == NULL)
+      return INITIALIZATION_ERROR;
+   return FT_walkIn(oFTDefault, pfVisit, pvContext, iFlags);
+}
+
+int FT_serialize(int (*pfWrite)(const char *pcData, size_t ulLength,
+                                void *pvContext),
+                 void *pvContext) {
+   assert(pfWrite != NULL);
+
+   if(oFTDefault == NULL)
+      return INITIALIZATION_ERROR;
+   return FT_serializeIn(oFTDefault, pfWrite, pvContext);
+}
+
+int FT_writeTo(int iFd) {
+   if(oFTDefault == NULL)
+      return INITIALIZATION_ERROR;
+   return FT_writeToIn(oFTDefault, iFd);
+}
+
+FT_T FT_snapshot(void) {
+   if(oFTDefault == NULL)
+      return NULL;
+   return FT_snapshotIn(oFTDefault);
+}
+
+int FT_save(const char *pcFilename) {
+   assert(pcFilename != NULL);
+
+   if(oFTDefault == NULL)
+      return INITIALIZATION_ERROR;
+   return FT_saveIn(oFTDefault, pcFilename);
+}
+
+int FT_load(const char *pcFilename) {
+   assert(pcFilename != NULL);
+
+   if(oFTDefault != NULL)
+      return INITIALIZATION_ERROR;
+   return FT_newFromImage(pcFilename, &oFTDefault);
+}
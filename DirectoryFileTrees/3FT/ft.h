@@ -15,6 +15,35 @@
 #include <stddef.h>
 #include "a4def.h"
 
+/*
+  An FT_T object is a File Tree of its own. Each function below
+  without an FT_T works on a single default FT, which FT_init creates
+  and FT_destroy frees. For each there is one with the same name and
+  the suffix "In" that works on the FT_T it is given first, and
+  behaves the same, except that an FT_T is always in an initialized
+  state, so it never fails with INITIALIZATION_ERROR.
+
+  Any number of FT_T objects may be used at once, even an FT and its
+  snapshots (see FT_snapshot), which share nodes and memory: one
+  thread per FT_T may insert, remove and look up in it while other
+  threads do the same in theirs.
+  They do share the table that path components are interned in (see
+  atom.h), but its shards are locked separately, so such threads wait
+  for one another only briefly, and only while interning or freeing
+  names of the same shard; lookups, walks and serialization intern
+  nothing. An FT_T from FT_newConcurrent may be used by any number of
+  threads at once, and its writers synchronize with one another only,
+  not with those of other FTs.
+*/
+typedef struct FT *FT_T;
+
+/* Statuses numbered after those of a4def.h: WRITE_ERROR if writing
+   fails (see FT_writeTo and FT_save), READ_ONLY for the insertions
+   and removals of a snapshot (see FT_snapshot), and READ_ERROR and
+   BAD_IMAGE if an image cannot be read (see FT_load) */
+enum { WRITE_ERROR = MEMORY_ERROR + 1, READ_ONLY, READ_ERROR,
+       BAD_IMAGE };
+
 /*
    Inserts a new directory into the FT with absolute path pcPath.
    Returns SUCCESS if the new directory is inserted successfully.
@@ -109,6 +138,7 @@ void *FT_replaceFileContents(const char *pcPath, void *pvNewContents,
   * CONFLICTING_PATH if the root's path is not a prefix of pcPath
   * NO_SUCH_PATH if absolute path pcPath does not exist in the FT
   * MEMORY_ERROR if memory could not be allocated to complete request
+  * BAD_IMAGE if the FT is read from a damaged image (see FT_load)
 
   When returning SUCCESS,
   if path is a directory: sets *pbIsFile to FALSE, *pulSize unchanged
@@ -123,6 +153,7 @@ int FT_stat(const char *pcPath, boolean *pbIsFile, size_t *pulSize);
   Sets the FT data structure to an initialized state.
   The data structure is initially empty.
   Returns INITIALIZATION_ERROR if already initialized,
+  MEMORY_ERROR if memory could not be allocated for it,
   and SUCCESS otherwise.
 */
 int FT_init(void);
@@ -135,6 +166,36 @@ int FT_init(void);
 */
 int FT_destroy(void);
 
+/*
+  Enables the FT's pathname index if bEnabled is TRUE, or disables it
+  if not. The index is a hash table of every node by its absolute
+  path, which FT_containsDir, FT_containsFile, FT_getFileContents,
+  FT_replaceFileContents, FT_stat, FT_rmDir and FT_rmFile use to find
+  a node directly rather than walk down to it one level at a time.
+  Insertions and removals keep it up to date. It costs 32 to 64
+  bytes per node. It is disabled by FT_init.
+  Returns INITIALIZATION_ERROR if not already initialized,
+  MEMORY_ERROR if memory could not be allocated for the index (which
+  is then left disabled), and SUCCESS otherwise.
+*/
+int FT_setPathIndex(boolean bEnabled);
+
+/*
+  Sets the number of children above which a directory of the FT keeps
+  a hash index of its children by name, which finding a node one
+  level at a time uses rather than binary-search them. The index costs
+  32 to 128 bytes per child, is dropped once a directory has fewer
+  than half the threshold it was built above, and only speeds lookups
+  up: if memory cannot be allocated for it, the directory goes without
+  one. 0 indexes every directory, and (size_t) -1 none. Directories
+  are only indexed or unindexed as children are next added to or
+  removed from them. A concurrent FT indexes no directories, so
+  ignores the threshold. It is 64 after FT_init.
+  Returns INITIALIZATION_ERROR if not already initialized,
+  and SUCCESS otherwise.
+*/
+int FT_setIndexThreshold(size_t ulThreshold);
+
 /*
   Returns a string representation of the
   data structure, or NULL if the structure is
@@ -148,5 +209,235 @@ int FT_destroy(void);
   which is then owned by client!
 */
 char *FT_toString(void);
- 
+
+/* Flags for FT_walk, to be combined with | */
+enum {
+   /* visit each node before its descendents */
+   FT_WALK_PREORDER = 1,
+   /* visit each node after its descendents */
+   FT_WALK_POSTORDER = 2,
+   /* visit the files in each directory before its subdirectories */
+   FT_WALK_FILES_FIRST = 4
+};
+
+/*
+  Walks the FT depth-first from the root, calling
+  (*pfVisit)(pcPath, bIsFile, iOrder, pvContext) for each node, where
+  pcPath is the node's absolute path (valid only during the call),
+  bIsFile is TRUE for a file and FALSE for a directory, and iOrder
+  tells which visit this is. iFlags combines the FT_WALK_ flags: with
+  FT_WALK_PREORDER each node is visited before its descendents, with
+  FT_WALK_POSTORDER after them, and with both, twice. Siblings are
+  visited in lexicographic order, or with FT_WALK_FILES_FIRST files
+  before directories, each lexicographically, which with pre-order is
+  the order of FT_toString. pfVisit returns SUCCESS to go on or any
+  other status to stop the walk; it must not change the FT.
+  The walk neither recurses nor allocates memory for each node: it
+  only grows one buffer for the longest path.
+  Returns INITIALIZATION_ERROR if not already initialized,
+  MEMORY_ERROR if memory could not be allocated to complete request,
+  the first status other than SUCCESS that pfVisit returned, if any,
+  and SUCCESS otherwise.
+*/
+int FT_walk(int (*pfVisit)(const char *pcPath, boolean bIsFile,
+                           int iOrder, void *pvContext),
+            void *pvContext, int iFlags);
+
+/*
+  Streams the representation that FT_toString returns, without its
+  '\0', to pfWrite: calls (*pfWrite)(pcData, ulLength, pvContext)
+  with successive pieces of it, each the ulLength characters at pcData
+  (not '\0'-terminated), which are only valid during the call. Each
+  piece ends with a whole line and is at most 4096 characters, unless
+  a single path is longer. Memory used is bounded by the longest path,
+  not by the size of the FT. pfWrite returns SUCCESS to
+  be given the next piece or any other status to stop.
+  Returns INITIALIZATION_ERROR if not already initialized,
+  MEMORY_ERROR if memory could not be allocated to complete request,
+  the first status other than SUCCESS that pfWrite returned, if any,
+  and SUCCESS otherwise.
+*/
+int FT_serialize(int (*pfWrite)(const char *pcData, size_t ulLength,
+                                void *pvContext),
+                 void *pvContext);
+
+/*
+  Writes the representation that FT_toString returns, without its
+  '\0', to the open file descriptor iFd, as FT_serialize streams it.
+  Returns INITIALIZATION_ERROR if not already initialized,
+  MEMORY_ERROR if memory could not be allocated to complete request,
+  WRITE_ERROR if writing to iFd failed (with errno set by write),
+  and SUCCESS otherwise.
+*/
+int FT_writeTo(int iFd);
+
+/*
+  Returns a snapshot of the FT: a new FT_T that holds the FT as it is
+  now, for as long as it is not freed with FT_free, however the FT is
+  changed afterwards. Taking it costs constant time, and each snapshot
+  costs memory in proportion to the changes made since it was taken.
+
+  The snapshot can be looked up, walked, serialized and snapshotted
+  again like any FT_T, but not changed: its insertions and removals
+  return READ_ONLY, and FT_replaceFileContentsIn returns NULL. It
+  shares the contents of its files with the FT, which belong to the
+  client. It is not indexed (see FT_setPathIndex) until it is asked
+  to be. The callbacks of FT_walkIn and FT_serializeIn on a snapshot
+  may change the FT it was taken from. Other threads may use the FT
+  and its other snapshots meanwhile. Returns NULL if not already
+  initialized or if memory could not be allocated for the snapshot.
+*/
+FT_T FT_snapshot(void);
+
+/*
+  Saves the FT to a file named pcFilename, replacing any file of that
+  name, even one an FT is loaded from, as an image that FT_load can
+  read back. The file keeps the mode of the one it replaces, and holds
+  either the whole old contents or the whole new image, even after a
+  crash; it is left as it was if saving fails. An image is at most
+  4 GB, and reads the same on any machine.
+  Returns INITIALIZATION_ERROR if not already initialized,
+  MEMORY_ERROR if memory could not be allocated to complete request,
+  WRITE_ERROR if the file could not be created, written, flushed or
+  renamed, or the directory could not be flushed, when the new image
+  is in place but may not survive a crash (with errno set by the call
+  that failed), or the FT is too large for an image (with errno set
+  to EFBIG), and SUCCESS otherwise.
+*/
+int FT_save(const char *pcFilename);
+
+/*
+  Sets the FT data structure to an initialized state that holds the
+  FT saved in the file named pcFilename by FT_save. Loading takes the
+  same time and memory however large the FT is, and lookups, walks
+  and FT_toString read the file where it is mapped into memory. The
+  contents FT_getFileContents returns lie in the file, so must not be
+  changed or freed; they stay valid until the FT is destroyed. The
+  file must not be changed while it is loaded.
+
+  The first insertion, removal or FT_replaceFileContents builds the
+  FT's nodes from the file, in time linear in its size, before it
+  makes its change; the contents of the files stay in the file, and
+  FT_replaceFileContents may return such contents. Until then, the FT
+  keeps no path index (see FT_setPathIndex): one enabled meanwhile is
+  built along with the nodes, and if memory cannot be allocated for
+  it, the change fails with MEMORY_ERROR. Damage to the file is found
+  out only when the damaged part is reached: lookups then fail, and
+  FT_stat, FT_walk, FT_serialize and the first change return
+  BAD_IMAGE.
+  Returns INITIALIZATION_ERROR if already initialized,
+  READ_ERROR if the file could not be opened or mapped (with errno
+  set by the call that failed), BAD_IMAGE if it is not an image of
+  this version, MEMORY_ERROR if memory could not be allocated for the
+  FT, and SUCCESS otherwise.
+*/
+int FT_load(const char *pcFilename);
+
+/*
+  Returns a new, empty FT_T object, or NULL if memory could not be
+  allocated for it.
+*/
+FT_T FT_new(void);
+
+/*
+  Returns a new, empty FT_T object that any number of threads may use
+  at once, or NULL if memory could not be allocated for it. Readers
+  take no locks, so never wait for writers or for one another, and a
+  lookup sees each directory as it was at some point during the
+  lookup. Writers wait for one another only while changing the same
+  directory. Inserting or removing the root, FT_toStringIn, FT_saveIn
+  and FT_snapshotIn wait for the writers under way and hold off new
+  ones until they are done. If memory runs out partway through an
+  insertion, the directories already inserted on the way stay, since
+  other threads may be using them. A concurrent FT keeps no path
+  index: FT_setPathIndexIn leaves it without one and returns
+  SUCCESS. FT_walkIn and FT_serializeIn see each directory's
+  children as they were when the walk reached it or last came back to
+  it, and a subtree removed while the walk is in it as it was, so a
+  walk is not a snapshot of the whole FT; their callbacks must not
+  change oFT.
+*/
+FT_T FT_newConcurrent(void);
+
+/*
+  Frees oFT and all its nodes, but not the contents of its files,
+  which belong to the client, nor the nodes that other snapshots of
+  the same FT still hold (see FT_snapshot). An FT and its snapshots
+  may be freed in any order; the last of them to be freed unmaps the
+  image they were loaded from, if any (see FT_load).
+*/
+void FT_free(FT_T oFT);
+
+/* FT_insertDir on oFT. */
+int FT_insertDirIn(FT_T oFT, const char *pcPath);
+
+/* FT_containsDir on oFT. */
+boolean FT_containsDirIn(FT_T oFT, const char *pcPath);
+
+/* FT_rmDir on oFT. */
+int FT_rmDirIn(FT_T oFT, const char *pcPath);
+
+/* FT_insertFile on oFT. */
+int FT_insertFileIn(FT_T oFT, const char *pcPath, void *pvContents,
+                    size_t ulLength);
+
+/* FT_containsFile on oFT. */
+boolean FT_containsFileIn(FT_T oFT, const char *pcPath);
+
+/* FT_rmFile on oFT. */
+int FT_rmFileIn(FT_T oFT, const char *pcPath);
+
+/* FT_getFileContents on oFT. */
+void *FT_getFileContentsIn(FT_T oFT, const char *pcPath);
+
+/* FT_replaceFileContents on oFT. */
+void *FT_replaceFileContentsIn(FT_T oFT, const char *pcPath,
+                               void *pvNewContents, size_t ulNewLength);
+
+/* FT_stat on oFT. */
+int FT_statIn(FT_T oFT, const char *pcPath, boolean *pbIsFile,
+              size_t *pulSize);
+
+/* FT_setPathIndex on oFT. */
+int FT_setPathIndexIn(FT_T oFT, boolean bEnabled);
+
+/* FT_setIndexThreshold on oFT, which cannot fail. A snapshot starts
+   with the threshold of the FT it was taken of. */
+void FT_setIndexThresholdIn(FT_T oFT, size_t ulThreshold);
+
+/* FT_toString on oFT. */
+char *FT_toStringIn(FT_T oFT);
+
+/* FT_walk on oFT. */
+int FT_walkIn(FT_T oFT,
+              int (*pfVisit)(const char *pcPath, boolean bIsFile,
+                             int iOrder, void *pvContext),
+              void *pvContext, int iFlags);
+
+/* FT_serialize on oFT. */
+int FT_serializeIn(FT_T oFT,
+                   int (*pfWrite)(const char *pcData, size_t ulLength,
+                                  void *pvContext),
+                   void *pvContext);
+
+/* FT_writeTo on oFT. */
+int FT_writeToIn(FT_T oFT, int iFd);
+
+/*
+  FT_snapshot on oFT, which may itself be a snapshot, or concurrent
+  (see FT_newConcurrent), when the snapshot is not.
+*/
+FT_T FT_snapshotIn(FT_T oFT);
+
+/* FT_save on oFT, which cannot be uninitialized. An FT still read
+   from its image is saved by copying the image. */
+int FT_saveIn(FT_T oFT, const char *pcFilename);
+
+/*
+  FT_load into a new FT_T object, which is not concurrent: sets
+  *poFTResult to it and returns SUCCESS, or sets *poFTResult to NULL
+  and returns a status of FT_load other than INITIALIZATION_ERROR.
+*/
+int FT_newFromImage(const char *pcFilename, FT_T *poFTResult);
+
 #endif
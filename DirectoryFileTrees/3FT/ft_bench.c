@@ -0,0 +1,1585 @@
+/*--------------------------------------------------------------------*/
+/* ft_bench.c                                                         */
+/* Author: Jacob Santelli and Joshua Yang                             */
+/*--------------------------------------------------------------------*/
+
+/* for POSIX threads and clock_gettime */
+#define _POSIX_C_SOURCE 200112L
+
+#include <assert.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "alloccount.h"
+#include "atom.h"
+#include "chunkarray.h"
+#include "dynarray.h"
+#include "ft.h"
+#include "ftslab.h"
+#include "path.h"
+#include "nodeFT.h"
+#include "sortedarray.h"
+
+/* The number of distinct paths generated for the path benchmarks */
+enum { PATH_COUNT = 4096 };
+
+/* Component names to draw from when generating paths */
+static const char *apcNames[] = {
+   "src", "include", "build", "lib", "obj", "usr", "share", "doc",
+   "tests", "release", "debug", "x86_64-linux-gnu", "artifacts",
+   "cache", "node_modules", "CMakeFiles", "generated", "v2"
+};
+
+/* The number of elements in apcNames */
+#define NAME_COUNT (sizeof(apcNames) / sizeof(apcNames[0]))
+
+/*
+  Returns the number of seconds of processor time used between
+  clock() readings tStart and tEnd.
+*/
+static double Bench_seconds(clock_t tStart, clock_t tEnd) {
+   return (double)(tEnd - tStart) / CLOCKS_PER_SEC;
+}
+
+/*
+  Exits with a message naming pcWhat if iStatus is not SUCCESS. The
+  benchmarks are built with NDEBUG, so they check the statuses that
+  decide what is being measured with this rather than with assert.
+*/
+static void Bench_require(int iStatus, const char *pcWhat) {
+   if(iStatus != SUCCESS) {
+      fprintf(stderr, "ftbench: %s failed with status %d\n", pcWhat,
+              iStatus);
+      exit(EXIT_FAILURE);
+   }
+}
+
+/*
+  Writes into pcBuf (which must have room for ulDepth * 20 bytes) a
+  path of ulDepth components drawn pseudo-randomly from apcNames.
+  Returns the string length of the path written.
+*/
+static size_t Bench_makePath(char *pcBuf, size_t ulDepth) {
+   size_t ulLevel;
+   size_t ulLength = 0;
+
+   assert(pcBuf != NULL);
+   assert(ulDepth > 0);
+
+   for(ulLevel = 0; ulLevel < ulDepth; ulLevel++) {
+      const char *pcName = apcNames[(size_t)rand() % NAME_COUNT];
+      if(ulLevel > 0)
+         pcBuf[ulLength++] = '/';
+      strcpy(pcBuf + ulLength, pcName);
+      ulLength += strlen(pcName);
+   }
+   return ulLength;
+}
+
+/*
+  Measures Path_new throughput on paths of depth ulDepth, printing
+  the input bytes processed per second.
+*/
+static void Bench_pathNew(size_t ulDepth) {
+   enum { ROUNDS = 200 };
+   char **ppcPaths;
+   size_t ulBytes = 0;
+   size_t i, ulRound;
+   clock_t tStart;
+   double dSecs;
+
+   ppcPaths = calloc(PATH_COUNT, sizeof(char *));
+   assert(ppcPaths != NULL);
+   for(i = 0; i < PATH_COUNT; i++) {
+      ppcPaths[i] = malloc(ulDepth * 20);
+      assert(ppcPaths[i] != NULL);
+      ulBytes += Bench_makePath(ppcPaths[i], ulDepth);
+   }
+
+   tStart = clock();
+   for(ulRound = 0; ulRound < ROUNDS; ulRound++) {
+      for(i = 0; i < PATH_COUNT; i++) {
+         Path_T oPPath = NULL;
+         int iStatus = Path_new(ppcPaths[i], &oPPath);
+         assert(iStatus == SUCCESS);
+         (void) iStatus;
+         Path_free(oPPath);
+      }
+   }
+   dSecs = Bench_seconds(tStart, clock());
+
+   printf("Path_new  depth %3lu  avg %4lu bytes  %8.3f GB/s  "
+          "%7.1f ns/path\n",
+          (unsigned long) ulDepth,
+          (unsigned long) (ulBytes / PATH_COUNT),
+          (double) ulBytes * ROUNDS / dSecs / 1e9,
+          dSecs * 1e9 / ((double) PATH_COUNT * ROUNDS));
+
+   for(i = 0; i < PATH_COUNT; i++)
+      free(ppcPaths[i]);
+   free(ppcPaths);
+}
+
+/* Runs the path construction benchmarks. */
+static void Bench_path(void) {
+   static const size_t aulDepths[] = { 2, 4, 8, 16, 32, 64 };
+   size_t i;
+
+   for(i = 0; i < sizeof(aulDepths) / sizeof(aulDepths[0]); i++)
+      Bench_pathNew(aulDepths[i]);
+}
+
+/*
+  Holds PATH_COUNT paths of depth 8 at once and prints the atom
+  table's statistics for the components they share.
+*/
+static void Bench_atoms(void) {
+   enum { DEPTH = 8 };
+   Path_T *poPPaths;
+   struct AtomStats sStats;
+   char acBuf[DEPTH * 20];
+   size_t i;
+
+   poPPaths = calloc(PATH_COUNT, sizeof(Path_T));
+   assert(poPPaths != NULL);
+   for(i = 0; i < PATH_COUNT; i++) {
+      int iStatus;
+      (void) Bench_makePath(acBuf, DEPTH);
+      iStatus = Path_new(acBuf, &poPPaths[i]);
+      assert(iStatus == SUCCESS);
+      (void) iStatus;
+   }
+
+   Atom_getStats(&sStats);
+   printf("atoms %lu  references %lu  dedup ratio %.1f  "
+          "bytes stored %lu  bytes saved %lu\n",
+          (unsigned long) sStats.ulAtoms,
+          (unsigned long) sStats.ulReferences,
+          (double) sStats.ulReferences / (double) sStats.ulAtoms,
+          (unsigned long) sStats.ulBytes,
+          (unsigned long) sStats.ulBytesSaved);
+
+   for(i = 0; i < PATH_COUNT; i++)
+      Path_free(poPPaths[i]);
+   free(poPPaths);
+}
+
+/*
+  Measures Node_hasChild on a directory of FANOUT children at depth
+  ulDepth, whose ancestors all have long names, printing the time per
+  lookup. Siblings share every component but the last, so this time
+  should not depend on ulDepth.
+*/
+static void Bench_lookupAt(size_t ulDepth) {
+   enum { FANOUT = 256, ROUNDS = 2000 };
+   Path_T aoPChildren[FANOUT];
+   Slab_T oSSlab;
+   Node_T oNRoot = NULL;
+   Node_T oNDir = NULL;
+   char *pcBuf;
+   size_t ulLength = 0;
+   size_t ulLevel, i, ulRound, ulChildID;
+   size_t ulFound = 0;
+   clock_t tStart;
+   double dSecs;
+   int iStatus;
+
+   assert(ulDepth > 0);
+
+   pcBuf = malloc(ulDepth * 40 + 20);
+   assert(pcBuf != NULL);
+   oSSlab = Slab_new();
+   assert(oSSlab != NULL);
+
+   /* build the chain of directories down to the one being searched */
+   for(ulLevel = 0; ulLevel < ulDepth; ulLevel++) {
+      Path_T oPPath = NULL;
+      Node_T oNNew = NULL;
+      if(ulLevel > 0)
+         pcBuf[ulLength++] = '/';
+      sprintf(pcBuf + ulLength, "a_rather_long_directory_name_%03lu",
+              (unsigned long) ulLevel);
+      ulLength += strlen(pcBuf + ulLength);
+      iStatus = Path_new(pcBuf, &oPPath);
+      assert(iStatus == SUCCESS);
+      iStatus = Node_new(oPPath, oNDir, oSSlab, NODE_INDEX_THRESHOLD,
+                         &oNNew, DIRECTORY);
+      assert(iStatus == SUCCESS);
+      Path_free(oPPath);
+      if(oNRoot == NULL)
+         oNRoot = oNNew;
+      oNDir = oNNew;
+   }
+
+   for(i = 0; i < FANOUT; i++) {
+      Node_T oNNew = NULL;
+      sprintf(pcBuf + ulLength, "/child_%04lu", (unsigned long) i);
+      iStatus = Path_new(pcBuf, &aoPChildren[i]);
+      assert(iStatus == SUCCESS);
+      iStatus = Node_new(aoPChildren[i], oNDir, oSSlab,
+                         NODE_INDEX_THRESHOLD, &oNNew, DIRECTORY);
+      assert(iStatus == SUCCESS);
+   }
+   (void) iStatus;
+
+   tStart = clock();
+   for(ulRound = 0; ulRound < ROUNDS; ulRound++)
+      for(i = 0; i < FANOUT; i++)
+         ulFound += Node_hasChild(oNDir, aoPChildren[i], &ulChildID);
+   dSecs = Bench_seconds(tStart, clock());
+   assert(ulFound == (size_t) FANOUT * ROUNDS);
+
+   printf("Node_hasChild  depth %3lu  fanout %d  %7.1f ns/lookup\n",
+          (unsigned long) ulDepth, FANOUT,
+          dSecs * 1e9 / ((double) FANOUT * ROUNDS));
+
+   for(i = 0; i < FANOUT; i++)
+      Path_free(aoPChildren[i]);
+   (void) Node_free(oNRoot, oSSlab);
+   Slab_free(oSSlab);
+   free(pcBuf);
+}
+
+/* Runs the sibling lookup benchmarks. */
+static void Bench_lookup(void) {
+   static const size_t aulDepths[] = { 1, 4, 16, 64, 256 };
+   size_t i;
+
+   for(i = 0; i < sizeof(aulDepths) / sizeof(aulDepths[0]); i++)
+      Bench_lookupAt(aulDepths[i]);
+}
+
+/* The shape of the synthetic FT built by the tree benchmark */
+enum { TREE_FANOUT = 10, TREE_LEVELS = 6 };
+
+/*
+  Writes into pcBuf (which must have room for TREE_LEVELS * 20 bytes)
+  the path of leaf ulLeaf of the synthetic FT, whose digits in base
+  TREE_FANOUT choose the child taken at each level.
+*/
+static void Bench_treePath(char *pcBuf, size_t ulLeaf) {
+   size_t aulDigits[TREE_LEVELS];
+   size_t ulLength;
+   size_t ulLevel;
+
+   assert(pcBuf != NULL);
+
+   for(ulLevel = TREE_LEVELS; ulLevel-- > 0; ) {
+      aulDigits[ulLevel] = ulLeaf % TREE_FANOUT;
+      ulLeaf /= TREE_FANOUT;
+   }
+
+   ulLength = (size_t) sprintf(pcBuf, "root");
+   for(ulLevel = 0; ulLevel < TREE_LEVELS - 1; ulLevel++)
+      ulLength += (size_t) sprintf(pcBuf + ulLength, "/directory_%lu",
+                                   (unsigned long) aulDigits[ulLevel]);
+   sprintf(pcBuf + ulLength, "/file_%lu",
+           (unsigned long) aulDigits[TREE_LEVELS - 1]);
+}
+
+/*
+  Builds a synthetic FT of 1111111 nodes: a root, then five levels of
+  directories and one of files, each with TREE_FANOUT children. Prints
+  the heap bytes held and allocator calls made per node, the time
+  taken to build the tree, to look up random files in it, and to
+  destroy it. Then enables the FT's pathname index, printing the heap
+  bytes it adds per node, the time taken to build it, and the time
+  to look up random files with it.
+*/
+static void Bench_tree(void) {
+   enum { QUERIES = 1000000 };
+   char acBuf[TREE_LEVELS * 20];
+   struct AllocStats sBefore, sAfter;
+   struct SlabStats sSlab;
+   size_t ulNodes = 1;
+   size_t ulLeaves = 1;
+   size_t ulFound = 0;
+   size_t ulLevel, i;
+   clock_t tStart;
+   double dBuild, dQuery, dDestroy;
+
+   for(ulLevel = 0; ulLevel < TREE_LEVELS; ulLevel++) {
+      ulLeaves *= TREE_FANOUT;
+      ulNodes += ulLeaves;
+   }
+
+   AllocCount_get(&sBefore);
+   tStart = clock();
+   Bench_require(FT_init(), "FT_init");
+   Bench_require(FT_insertDir("root"), "FT_insertDir");
+   for(i = 0; i < ulLeaves; i++) {
+      Bench_treePath(acBuf, i);
+      Bench_require(FT_insertFile(acBuf, NULL, 0), "FT_insertFile");
+   }
+   dBuild = Bench_seconds(tStart, clock());
+   AllocCount_get(&sAfter);
+
+   printf("tree  %lu nodes  %lu bytes  %.1f bytes/node  "
+          "%.1f blocks/node  %.2f allocs/node  build %.2f s\n",
+          (unsigned long) ulNodes,
+          (unsigned long) (sAfter.ulLiveBytes - sBefore.ulLiveBytes),
+          (double) (sAfter.ulLiveBytes - sBefore.ulLiveBytes)
+             / (double) ulNodes,
+          (double) (sAfter.ulLiveBlocks - sBefore.ulLiveBlocks)
+             / (double) ulNodes,
+          (double) (sAfter.ulCalls - sBefore.ulCalls) / (double) ulNodes,
+          dBuild);
+
+   Bench_require(FT_getSlabStats(&sSlab), "FT_getSlabStats");
+   printf("tree  slab %lu pages  %.1f%% in use  %.1f%% lost to rounding  "
+          "%.1f%% on free lists  %lu large blocks\n",
+          (unsigned long) sSlab.ulPages,
+          100.0 * (double) sSlab.ulBlockBytes / (double) sSlab.ulPageBytes,
+          100.0 * (1.0 - (double) sSlab.ulRequestedBytes
+                            / (double) sSlab.ulBlockBytes),
+          100.0 * (double) sSlab.ulFreeBytes / (double) sSlab.ulPageBytes,
+          (unsigned long) sSlab.ulLargeBlocks);
+
+   tStart = clock();
+   for(i = 0; i < QUERIES; i++) {
+      Bench_treePath(acBuf, (size_t) rand() % ulLeaves);
+      ulFound += (size_t) FT_containsFile(acBuf);
+   }
+   dQuery = Bench_seconds(tStart, clock());
+   if(ulFound != QUERIES)
+      Bench_require(NO_SUCH_PATH, "FT_containsFile");
+   printf("tree  random FT_containsFile %.1f ns/query\n",
+          dQuery * 1e9 / QUERIES);
+
+   AllocCount_get(&sBefore);
+   tStart = clock();
+   Bench_require(FT_setPathIndex(TRUE), "FT_setPathIndex");
+   dBuild = Bench_seconds(tStart, clock());
+   AllocCount_get(&sAfter);
+
+   ulFound = 0;
+   tStart = clock();
+   for(i = 0; i < QUERIES; i++) {
+      Bench_treePath(acBuf, (size_t) rand() % ulLeaves);
+      ulFound += (size_t) FT_containsFile(acBuf);
+   }
+   dQuery = Bench_seconds(tStart, clock());
+   if(ulFound != QUERIES)
+      Bench_require(NO_SUCH_PATH, "FT_containsFile");
+
+   printf("tree  path index  %.1f bytes/node  build %.2f s  "
+          "random FT_containsFile %.1f ns/query\n",
+          (double) (sAfter.ulLiveBytes - sBefore.ulLiveBytes)
+             / (double) ulNodes,
+          dBuild, dQuery * 1e9 / QUERIES);
+
+   tStart = clock();
+   Bench_require(FT_destroy(), "FT_destroy");
+   dDestroy = Bench_seconds(tStart, clock());
+   printf("tree  destroy %.2f s\n", dDestroy);
+}
+
+/*
+  Builds a synthetic FT with ulLeaves of the files of the tree
+  benchmark, and the directories above them, and prints the time
+  FT_toString takes for it per node and per byte of the result, which
+  should stay flat as the tree grows.
+*/
+static void Bench_toStringAt(size_t ulLeaves) {
+   enum { ROUNDS = 3 };
+   char acBuf[TREE_LEVELS * 20];
+   char *pcResult;
+   const char *pc;
+   size_t ulNodes = 0;
+   size_t ulBytes;
+   size_t i;
+   clock_t tStart;
+   double dSecs;
+
+   Bench_require(FT_init(), "FT_init");
+   Bench_require(FT_insertDir("root"), "FT_insertDir");
+   for(i = 0; i < ulLeaves; i++) {
+      Bench_treePath(acBuf, i);
+      Bench_require(FT_insertFile(acBuf, NULL, 0), "FT_insertFile");
+   }
+
+   tStart = clock();
+   for(i = 0; i < ROUNDS; i++) {
+      pcResult = FT_toString();
+      if(pcResult == NULL)
+         Bench_require(MEMORY_ERROR, "FT_toString");
+      if(i < ROUNDS - 1)
+         free(pcResult);
+   }
+   dSecs = Bench_seconds(tStart, clock()) / ROUNDS;
+
+   /* each node is one line */
+   ulBytes = strlen(pcResult);
+   for(pc = pcResult; *pc != '\0'; pc++)
+      ulNodes += (*pc == '\n');
+   free(pcResult);
+   Bench_require(FT_destroy(), "FT_destroy");
+
+   printf("tostring  %7lu nodes  %9lu bytes  %.4f s  %6.1f ns/node  "
+          "%5.2f ns/byte\n",
+          (unsigned long) ulNodes, (unsigned long) ulBytes, dSecs,
+          dSecs * 1e9 / (double) ulNodes, dSecs * 1e9 / (double) ulBytes);
+}
+
+/* Runs the FT_toString benchmarks. */
+static void Bench_toString(void) {
+   static const size_t aulLeaves[] = { 9000, 90000, 900000 };
+   size_t i;
+
+   for(i = 0; i < sizeof(aulLeaves) / sizeof(aulLeaves[0]); i++)
+      Bench_toStringAt(aulLeaves[i]);
+}
+
+/* What Bench_countChunk learns of the chunks FT_serialize streams */
+struct chunkCount {
+   /* the number of chunks and of characters in them */
+   size_t ulChunks;
+   size_t ulBytes;
+   /* when serialization started and when the first chunk came */
+   clock_t tStart;
+   clock_t tFirst;
+};
+
+/*
+  Counts the chunk of ulLength characters at pcData in the struct
+  chunkCount that pvCount points to. Returns SUCCESS.
+*/
+static int Bench_countChunk(const char *pcData, size_t ulLength,
+                            void *pvCount) {
+   struct chunkCount *psCount = pvCount;
+
+   assert(pcData != NULL);
+   assert(pvCount != NULL);
+   (void) pcData;
+
+   if(psCount->ulChunks++ == 0)
+      psCount->tFirst = clock();
+   psCount->ulBytes += ulLength;
+   return SUCCESS;
+}
+
+/*
+  Builds the synthetic FT of the tree benchmark, then prints the time
+  to the first byte, the total time, and the peak heap use above that
+  of the tree for FT_toString, FT_serialize with a client that only
+  counts what it is given, and FT_writeTo writing to /dev/null.
+*/
+static void Bench_serialize(void) {
+   char acBuf[TREE_LEVELS * 20];
+   struct AllocStats sBefore, sAfter;
+   struct chunkCount sCount;
+   size_t ulLeaves = 1;
+   size_t ulLevel, i;
+   char *pcResult;
+   clock_t tStart;
+   double dSecs;
+   int iFd;
+
+   for(ulLevel = 0; ulLevel < TREE_LEVELS; ulLevel++)
+      ulLeaves *= TREE_FANOUT;
+   Bench_require(FT_init(), "FT_init");
+   Bench_require(FT_insertDir("root"), "FT_insertDir");
+   for(i = 0; i < ulLeaves; i++) {
+      Bench_treePath(acBuf, i);
+      Bench_require(FT_insertFile(acBuf, NULL, 0), "FT_insertFile");
+   }
+
+   AllocCount_resetPeak();
+   AllocCount_get(&sBefore);
+   tStart = clock();
+   pcResult = FT_toString();
+   dSecs = Bench_seconds(tStart, clock());
+   AllocCount_get(&sAfter);
+   if(pcResult == NULL)
+      Bench_require(MEMORY_ERROR, "FT_toString");
+   printf("serialize  FT_toString   %lu bytes  first byte %.3f s  "
+          "total %.3f s  peak +%lu bytes\n",
+          (unsigned long) strlen(pcResult), dSecs, dSecs,
+          (unsigned long) (sAfter.ulPeakBytes - sBefore.ulLiveBytes));
+   free(pcResult);
+
+   sCount.ulChunks = 0;
+   sCount.ulBytes = 0;
+   AllocCount_resetPeak();
+   AllocCount_get(&sBefore);
+   sCount.tStart = tStart = clock();
+   Bench_require(FT_serialize(Bench_countChunk, &sCount),
+                 "FT_serialize");
+   dSecs = Bench_seconds(tStart, clock());
+   AllocCount_get(&sAfter);
+   printf("serialize  FT_serialize  %lu bytes  first byte %.3f s  "
+          "total %.3f s  peak +%lu bytes  %lu chunks\n",
+          (unsigned long) sCount.ulBytes,
+          Bench_seconds(sCount.tStart, sCount.tFirst), dSecs,
+          (unsigned long) (sAfter.ulPeakBytes - sBefore.ulLiveBytes),
+          (unsigned long) sCount.ulChunks);
+
+   iFd = open("/dev/null", O_WRONLY);
+   if(iFd >= 0) {
+      tStart = clock();
+      Bench_require(FT_writeTo(iFd), "FT_writeTo");
+      dSecs = Bench_seconds(tStart, clock());
+      printf("serialize  FT_writeTo    /dev/null  total %.3f s\n", dSecs);
+      (void) close(iFd);
+   }
+
+   Bench_require(FT_destroy(), "FT_destroy");
+}
+
+/*
+  Writes into pcBuf (which must have room for 32 bytes) the path of
+  file ulIndex of the wide directory "root". The files are named
+  "entryNNNNNNN" in order of ulIndex, so that their names agree in the
+  first 8 characters in runs of 10000, unless bScattered is TRUE, in
+  which case they are named by 8 hexadecimal digits spread over the
+  whole range, so that names rarely agree that far. Returns the
+  length of the file's name.
+*/
+static size_t Bench_wideName(char *pcBuf, size_t ulIndex,
+                             boolean bScattered) {
+   assert(pcBuf != NULL);
+
+   if(bScattered)
+      return (size_t) sprintf(pcBuf, "root/%08lx",
+                (unsigned long) ulIndex * 2654435761UL & 0xffffffffUL)
+             - strlen("root/");
+   return (size_t) sprintf(pcBuf, "root/entry%07lu",
+                           (unsigned long) ulIndex)
+          - strlen("root/");
+}
+
+/*
+  Returns the key that nodeFT keeps beside each child: the first
+  sizeof(unsigned long) characters of the ulLength-character name
+  pcName, most significant first, padded with zero bytes.
+*/
+static unsigned long Bench_nameKey(const char *pcName,
+                                   size_t ulLength) {
+   unsigned long ulKey = 0;
+   size_t i;
+
+   for(i = 0; i < sizeof(unsigned long); i++) {
+      ulKey <<= CHAR_BIT;
+      if(i < ulLength)
+         ulKey |= (unsigned char) pcName[i];
+   }
+   return ulKey;
+}
+
+/* Compares the strings that ppvFirst and ppvSecond point to. */
+static int Bench_compareStrings(const void *ppvFirst,
+                                const void *ppvSecond) {
+   return strcmp(*(char * const *) ppvFirst,
+                 *(char * const *) ppvSecond);
+}
+
+/*
+  Replays a binary search for each of the ulCount names of the wide
+  directory in a sorted array of them, counting how many probes the
+  keys nodeFT keeps beside its children settle, and how many must
+  still follow the child's pointer to compare its name. Prints the
+  averages per lookup. This stands in for cache-miss counts, which
+  cannot be measured here: each pointer followed is a likely miss.
+*/
+static void Bench_wideProbes(size_t ulCount, boolean bScattered) {
+   char **ppcNames;
+   unsigned long *pulKeys;
+   char acBuf[32];
+   size_t ulProbes = 0;
+   size_t ulFollowed = 0;
+   size_t ulLength, ulLo, ulHi, ulMid;
+   unsigned long ulKey;
+   size_t i;
+   int iCompare;
+
+   ppcNames = malloc(ulCount * sizeof(char *));
+   pulKeys = malloc(ulCount * sizeof(unsigned long));
+   assert(ppcNames != NULL && pulKeys != NULL);
+   for(i = 0; i < ulCount; i++) {
+      ulLength = Bench_wideName(acBuf, i, bScattered);
+      ppcNames[i] = malloc(ulLength + 1);
+      assert(ppcNames[i] != NULL);
+      strcpy(ppcNames[i], acBuf + strlen("root/"));
+   }
+   qsort(ppcNames, ulCount, sizeof(char *), Bench_compareStrings);
+   for(i = 0; i < ulCount; i++)
+      pulKeys[i] = Bench_nameKey(ppcNames[i], strlen(ppcNames[i]));
+
+   for(i = 0; i < ulCount; i++) {
+      ulLength = strlen(ppcNames[i]);
+      ulKey = Bench_nameKey(ppcNames[i], ulLength);
+      ulLo = 0;
+      ulHi = ulCount;
+      for(;;) {
+         ulMid = ulLo + (ulHi - ulLo) / 2;
+         ulProbes++;
+         if(pulKeys[ulMid] != ulKey)
+            iCompare = pulKeys[ulMid] < ulKey ? -1 : 1;
+         else if(ulLength < sizeof(unsigned long))
+            iCompare = 0;
+         else {
+            ulFollowed++;
+            iCompare = strcmp(ppcNames[ulMid], ppcNames[i]);
+         }
+         if(iCompare == 0)
+            break;
+         if(iCompare > 0)
+            ulHi = ulMid;
+         else
+            ulLo = ulMid + 1;
+      }
+   }
+
+   printf("wide  %7lu children  %-9s  %.1f probes/lookup, "
+          "%.1f follow a child pointer (%.1f without keys)\n",
+          (unsigned long) ulCount, bScattered ? "scattered" : "entryNNN",
+          (double) ulProbes / (double) ulCount,
+          (double) ulFollowed / (double) ulCount,
+          (double) ulProbes / (double) ulCount);
+
+   for(i = 0; i < ulCount; i++)
+      free(ppcNames[i]);
+   free(ppcNames);
+   free(pulKeys);
+}
+
+/*
+  Fills the root directory of an FT with ulCount files, named by
+  Bench_wideName with bScattered, in order of their indices if bSorted
+  is TRUE or in random order if not, printing the time taken per
+  insertion, per lookup, and to destroy the FT.
+*/
+static void Bench_wideFill(size_t ulCount, boolean bSorted,
+                           boolean bScattered) {
+   size_t *pulOrder;
+   char acBuf[32];
+   size_t ulFound = 0;
+   size_t i, j, ulSwap;
+   clock_t tStart;
+   double dFill, dQuery, dDestroy;
+
+   pulOrder = malloc(ulCount * sizeof(size_t));
+   assert(pulOrder != NULL);
+   for(i = 0; i < ulCount; i++)
+      pulOrder[i] = i;
+   if(!bSorted) {
+      for(i = ulCount; i > 1; i--) {
+         j = (size_t) rand() % i;
+         ulSwap = pulOrder[i - 1];
+         pulOrder[i - 1] = pulOrder[j];
+         pulOrder[j] = ulSwap;
+      }
+   }
+
+   Bench_require(FT_init(), "FT_init");
+   Bench_require(FT_insertDir("root"), "FT_insertDir");
+   tStart = clock();
+   for(i = 0; i < ulCount; i++) {
+      (void) Bench_wideName(acBuf, pulOrder[i], bScattered);
+      Bench_require(FT_insertFile(acBuf, NULL, 0), "FT_insertFile");
+   }
+   dFill = Bench_seconds(tStart, clock());
+
+   tStart = clock();
+   for(i = 0; i < ulCount; i++) {
+      (void) Bench_wideName(acBuf, i, bScattered);
+      ulFound += (size_t) FT_containsFile(acBuf);
+   }
+   dQuery = Bench_seconds(tStart, clock());
+   if(ulFound != ulCount)
+      Bench_require(NO_SUCH_PATH, "FT_containsFile");
+
+   tStart = clock();
+   Bench_require(FT_destroy(), "FT_destroy");
+   dDestroy = Bench_seconds(tStart, clock());
+
+   printf("wide  %7lu children  %-9s  %-6s  fill %8.1f ns/insert  "
+          "lookup %6.1f ns  destroy %.3f s\n",
+          (unsigned long) ulCount, bScattered ? "scattered" : "entryNNN",
+          bSorted ? "sorted" : "random",
+          dFill * 1e9 / (double) ulCount,
+          dQuery * 1e9 / (double) ulCount, dDestroy);
+   free(pulOrder);
+}
+
+/* Runs the wide directory benchmarks. */
+static void Bench_wide(void) {
+   static const size_t aulCounts[] = { 1000, 10000, 100000, 1000000 };
+   size_t i;
+
+   for(i = 0; i < sizeof(aulCounts) / sizeof(aulCounts[0]); i++) {
+      Bench_wideFill(aulCounts[i], TRUE, FALSE);
+      Bench_wideFill(aulCounts[i], FALSE, FALSE);
+      Bench_wideFill(aulCounts[i], FALSE, TRUE);
+   }
+   for(i = 0; i < sizeof(aulCounts) / sizeof(aulCounts[0]); i++) {
+      Bench_wideProbes(aulCounts[i], FALSE);
+      Bench_wideProbes(aulCounts[i], TRUE);
+   }
+}
+
+/*
+  Times FT_rmDir of "root/cache", once filled with ulCount files if
+  bDeep is FALSE, or a chain of ulCount directories if it is TRUE,
+  with the FT's pathname index enabled if bIndexed is TRUE. The
+  directory has a sibling, so only it is torn down.
+*/
+static void Bench_teardownAt(size_t ulCount, boolean bDeep,
+                             boolean bIndexed) {
+   char *pcPath;
+   char acBuf[32];
+   size_t i;
+   clock_t tStart;
+   double dRemove;
+
+   Bench_require(FT_init(), "FT_init");
+   Bench_require(FT_setPathIndex(bIndexed), "FT_setPathIndex");
+   Bench_require(FT_insertDir("root/keep"), "FT_insertDir");
+   if(bDeep) {
+      /* "root/cache" then "/d" for each level below it */
+      pcPath = malloc(strlen("root/cache") + 2 * ulCount + 1);
+      assert(pcPath != NULL);
+      strcpy(pcPath, "root/cache");
+      for(i = 1; i < ulCount; i++)
+         strcat(pcPath + strlen("root/cache") + 2 * (i - 1), "/d");
+      Bench_require(FT_insertDir(pcPath), "FT_insertDir");
+      free(pcPath);
+   }
+   else {
+      Bench_require(FT_insertDir("root/cache"), "FT_insertDir");
+      for(i = 0; i < ulCount; i++) {
+         sprintf(acBuf, "root/cache/entry%07lu", (unsigned long) i);
+         Bench_require(FT_insertFile(acBuf, NULL, 0), "FT_insertFile");
+      }
+   }
+
+   tStart = clock();
+   Bench_require(FT_rmDir("root/cache"), "FT_rmDir");
+   dRemove = Bench_seconds(tStart, clock());
+   if(!FT_containsDir("root/keep"))
+      Bench_require(NO_SUCH_PATH, "FT_containsDir");
+
+   printf("teardown  %7lu %-5s  index %-3s  rmDir %.3f s  "
+          "%6.1f ns/node\n",
+          (unsigned long) ulCount, bDeep ? "deep" : "wide",
+          bIndexed ? "on" : "off", dRemove,
+          dRemove * 1e9 / (double) ulCount);
+   Bench_require(FT_destroy(), "FT_destroy");
+}
+
+/* Runs the subtree teardown benchmarks. */
+static void Bench_teardown(void) {
+   Bench_teardownAt(300000, FALSE, FALSE);
+   Bench_teardownAt(300000, FALSE, TRUE);
+   Bench_teardownAt(10000, TRUE, FALSE);
+   Bench_teardownAt(10000, TRUE, TRUE);
+}
+
+/*
+  Builds the synthetic FT of the tree benchmark, takes a snapshot of
+  it, and then replaces the contents of random files. Prints the time
+  the snapshot took, the slab bytes that the copies made for the
+  changes cost per change beside the bytes of the whole FT, and the
+  time to free the snapshot again.
+*/
+static void Bench_snapshot(void) {
+   enum { CHANGES = 10000 };
+   char acBuf[TREE_LEVELS * 20];
+   struct SlabStats sBefore, sAfter;
+   FT_T oFT, oFTSnapshot;
+   size_t ulLeaves = 1;
+   size_t ulLevel, i;
+   clock_t tStart;
+   double dSnapshot, dChange, dFree;
+
+   for(ulLevel = 0; ulLevel < TREE_LEVELS; ulLevel++)
+      ulLeaves *= TREE_FANOUT;
+
+   oFT = FT_new();
+   if(oFT == NULL)
+      Bench_require(MEMORY_ERROR, "FT_new");
+   Bench_require(FT_insertDirIn(oFT, "root"), "FT_insertDir");
+   for(i = 0; i < ulLeaves; i++) {
+      Bench_treePath(acBuf, i);
+      Bench_require(FT_insertFileIn(oFT, acBuf, NULL, 0),
+                    "FT_insertFile");
+   }
+   FT_getSlabStatsIn(oFT, &sBefore);
+
+   tStart = clock();
+   oFTSnapshot = FT_snapshotIn(oFT);
+   dSnapshot = Bench_seconds(tStart, clock());
+   if(oFTSnapshot == NULL)
+      Bench_require(MEMORY_ERROR, "FT_snapshot");
+
+   tStart = clock();
+   for(i = 0; i < CHANGES; i++) {
+      Bench_treePath(acBuf, (size_t) rand() % ulLeaves);
+      (void) FT_replaceFileContentsIn(oFT, acBuf, acBuf, 1);
+   }
+   dChange = Bench_seconds(tStart, clock());
+   FT_getSlabStatsIn(oFT, &sAfter);
+
+   tStart = clock();
+   FT_free(oFTSnapshot);
+   dFree = Bench_seconds(tStart, clock());
+
+   printf("snapshot  take %.1f us  FT %lu bytes  %.1f bytes/change  "
+          "%.1f us/change  free %.3f s\n",
+          dSnapshot * 1e6, (unsigned long) sBefore.ulBlockBytes,
+          (double) (sAfter.ulBlockBytes - sBefore.ulBlockBytes)
+             / (double) CHANGES,
+          dChange * 1e6 / (double) CHANGES, dFree);
+   FT_free(oFT);
+}
+
+/*
+  Builds the synthetic FT of the tree benchmark, saves it to an image,
+  and loads the image back. Prints the time saving took, the bytes of
+  the image per node, the time loading took, which should not grow
+  with the tree, the time to look up random files in the image, and
+  the time the first change took to build the nodes from it.
+*/
+static void Bench_image(void) {
+   enum { QUERIES = 1000000 };
+   static const char pcImage[] = "ftbench.img";
+   char acBuf[TREE_LEVELS * 20];
+   FT_T oFT, oFTLoaded;
+   size_t ulNodes = 1;
+   size_t ulLeaves = 1;
+   size_t ulFound = 0;
+   size_t ulLevel, i;
+   off_t lSize;
+   int iFd;
+   clock_t tStart;
+   double dSave, dLoad, dQuery, dUnpack;
+
+   for(ulLevel = 0; ulLevel < TREE_LEVELS; ulLevel++) {
+      ulLeaves *= TREE_FANOUT;
+      ulNodes += ulLeaves;
+   }
+
+   oFT = FT_new();
+   if(oFT == NULL)
+      Bench_require(MEMORY_ERROR, "FT_new");
+   Bench_require(FT_insertDirIn(oFT, "root"), "FT_insertDir");
+   for(i = 0; i < ulLeaves; i++) {
+      Bench_treePath(acBuf, i);
+      Bench_require(FT_insertFileIn(oFT, acBuf, NULL, 0),
+                    "FT_insertFile");
+   }
+
+   tStart = clock();
+   Bench_require(FT_saveIn(oFT, pcImage), "FT_save");
+   dSave = Bench_seconds(tStart, clock());
+   FT_free(oFT);
+
+   iFd = open(pcImage, O_RDONLY);
+   if(iFd < 0)
+      Bench_require(READ_ERROR, "open");
+   lSize = lseek(iFd, 0, SEEK_END);
+   (void) close(iFd);
+
+   tStart = clock();
+   Bench_require(FT_newFromImage(pcImage, &oFTLoaded), "FT_load");
+   dLoad = Bench_seconds(tStart, clock());
+   (void) remove(pcImage);
+
+   tStart = clock();
+   for(i = 0; i < QUERIES; i++) {
+      Bench_treePath(acBuf, (size_t) rand() % ulLeaves);
+      ulFound += (size_t) FT_containsFileIn(oFTLoaded, acBuf);
+   }
+   dQuery = Bench_seconds(tStart, clock());
+   if(ulFound != QUERIES)
+      Bench_require(NO_SUCH_PATH, "FT_containsFile");
+
+   tStart = clock();
+   Bench_require(FT_insertDirIn(oFTLoaded, "root/new"),
+                 "FT_insertDir");
+   dUnpack = Bench_seconds(tStart, clock());
+
+   printf("image  save %.2f s  %.1f bytes/node  load %.1f us  "
+          "random FT_containsFile %.1f ns/query  first change %.2f s\n",
+          dSave, (double) lSize / (double) ulNodes, dLoad * 1e6,
+          dQuery * 1e9 / QUERIES, dUnpack);
+   FT_free(oFTLoaded);
+}
+
+/* The shape of the tree the threads benchmark works on: groups of
+   directories of files, and the scratch files that writers add and
+   remove in each directory */
+enum { THREAD_GROUPS = 8, THREAD_DIRS = 8, THREAD_FILES = 256,
+       THREAD_SCRATCH = 4 };
+/* The number of operations shared among the threads of each run, and
+   the percentage of them that are writes */
+enum { THREAD_OPS = 1600000, THREAD_WRITE_PERCENT = 5 };
+/* The most threads a run uses */
+enum { MAX_THREADS = 16 };
+
+/* The state shared by the threads of a run of the threads benchmark */
+struct threadRun {
+   /* the FT the threads work on */
+   FT_T oFT;
+   /* a lock held around each operation in place of the FT's own
+      synchronization, or NULL */
+   pthread_mutex_t *psGlobalLock;
+   /* the paths of the files that are looked up */
+   char **ppcFiles;
+   /* the paths of the scratch files that are added and removed */
+   char **ppcScratch;
+   /* the number of operations each thread does */
+   size_t ulOps;
+};
+
+/* The state of one thread of the threads benchmark */
+struct benchThread {
+   /* the run it belongs to */
+   struct threadRun *psRun;
+   /* the state of its pseudo-random number generator */
+   unsigned long ulSeed;
+   /* the number of lookups that found a file, which is printed so
+      that the lookups cannot be optimized away */
+   size_t ulHits;
+};
+
+/*
+  Does the operations of the struct benchThread that pvThread points
+  to: 95% lookups of existing files and 5% writes, each adding a
+  scratch file, or removing it if it is already there, with the files
+  drawn pseudo-randomly. Returns NULL.
+*/
+static void *Bench_threadOps(void *pvThread) {
+   struct benchThread *psThread = pvThread;
+   struct threadRun *psRun;
+   unsigned long ulRandom;
+   size_t i;
+   int iStatus;
+
+   assert(psThread != NULL);
+
+   psRun = psThread->psRun;
+   for(i = 0; i < psRun->ulOps; i++) {
+      /* a linear congruential generator, so that threads do not share
+         rand's state */
+      psThread->ulSeed = psThread->ulSeed * 1103515245UL + 12345UL;
+      ulRandom = (psThread->ulSeed >> 8) & 0xffffffUL;
+      if(psRun->psGlobalLock != NULL)
+         (void) pthread_mutex_lock(psRun->psGlobalLock);
+      if(ulRandom % 100 < THREAD_WRITE_PERCENT) {
+         ulRandom = ulRandom / 100 % (THREAD_GROUPS * THREAD_DIRS
+                                      * THREAD_SCRATCH);
+         iStatus = FT_insertFileIn(psRun->oFT,
+                                   psRun->ppcScratch[ulRandom],
+                                   NULL, 0);
+         /* the FT reports a file already there as NOT_A_DIRECTORY */
+         if(iStatus == ALREADY_IN_TREE || iStatus == NOT_A_DIRECTORY)
+            iStatus = FT_rmFileIn(psRun->oFT,
+                                  psRun->ppcScratch[ulRandom]);
+         /* unless another thread removed it first */
+         if(iStatus == NO_SUCH_PATH)
+            iStatus = SUCCESS;
+         Bench_require(iStatus, "FT_insertFileIn or FT_rmFileIn");
+      }
+      else {
+         ulRandom = ulRandom / 100 % (THREAD_GROUPS * THREAD_DIRS
+                                      * THREAD_FILES);
+         if(FT_containsFileIn(psRun->oFT, psRun->ppcFiles[ulRandom]))
+            psThread->ulHits++;
+      }
+      if(psRun->psGlobalLock != NULL)
+         (void) pthread_mutex_unlock(psRun->psGlobalLock);
+   }
+   return NULL;
+}
+
+/*
+  Returns the number of seconds of wall-clock time between
+  clock_gettime readings sStart and sEnd.
+*/
+static double Bench_wallSeconds(struct timespec sStart,
+                                struct timespec sEnd) {
+   return (double) (sEnd.tv_sec - sStart.tv_sec)
+      + (double) (sEnd.tv_nsec - sStart.tv_nsec) / 1e9;
+}
+
+/*
+  Does THREAD_OPS operations of psRun, split evenly among ulThreads
+  threads, and returns the wall-clock seconds they took.
+*/
+static double Bench_threadsRun(struct threadRun *psRun,
+                               size_t ulThreads) {
+   pthread_t aThreads[MAX_THREADS];
+   struct benchThread asThreads[MAX_THREADS];
+   struct timespec sStart, sEnd;
+   size_t ulHits = 0;
+   size_t i;
+
+   assert(psRun != NULL);
+   assert(ulThreads > 0 && ulThreads <= MAX_THREADS);
+
+   psRun->ulOps = THREAD_OPS / ulThreads;
+   (void) clock_gettime(CLOCK_MONOTONIC, &sStart);
+   for(i = 0; i < ulThreads; i++) {
+      asThreads[i].psRun = psRun;
+      asThreads[i].ulSeed = 217 + i;
+      asThreads[i].ulHits = 0;
+      if(pthread_create(&aThreads[i], NULL, Bench_threadOps,
+                        &asThreads[i]) != 0)
+         Bench_require(MEMORY_ERROR, "pthread_create");
+   }
+   for(i = 0; i < ulThreads; i++) {
+      (void) pthread_join(aThreads[i], NULL);
+      ulHits += asThreads[i].ulHits;
+   }
+   (void) clock_gettime(CLOCK_MONOTONIC, &sEnd);
+
+   if(ulHits == 0)
+      Bench_require(NO_SUCH_PATH, "FT_containsFileIn");
+   return Bench_wallSeconds(sStart, sEnd);
+}
+
+/*
+  Returns an array of the ulCount paths of the files of the threads
+  benchmark named by pcFormat, a printf format taking the indices of
+  a group, a directory in it, and a file in that, with ulFiles files
+  per directory.
+*/
+static char **Bench_threadPaths(const char *pcFormat, size_t ulFiles) {
+   char acBuf[64];
+   char **ppcPaths;
+   size_t ulCount = THREAD_GROUPS * THREAD_DIRS * ulFiles;
+   size_t i;
+
+   assert(pcFormat != NULL);
+
+   ppcPaths = malloc(ulCount * sizeof(char *));
+   assert(ppcPaths != NULL);
+   for(i = 0; i < ulCount; i++) {
+      sprintf(acBuf, pcFormat,
+              (unsigned long) (i / ulFiles / THREAD_DIRS),
+              (unsigned long) (i / ulFiles % THREAD_DIRS),
+              (unsigned long) (i % ulFiles));
+      ppcPaths[i] = malloc(strlen(acBuf) + 1);
+      assert(ppcPaths[i] != NULL);
+      strcpy(ppcPaths[i], acBuf);
+   }
+   return ppcPaths;
+}
+
+/* Frees ppcPaths and the ulCount paths in it. */
+static void Bench_freePaths(char **ppcPaths, size_t ulCount) {
+   size_t i;
+
+   assert(ppcPaths != NULL);
+
+   for(i = 0; i < ulCount; i++)
+      free(ppcPaths[i]);
+   free(ppcPaths);
+}
+
+/*
+  Prints the throughput of a 95/5 mix of lookups and writes on a tree
+  of 16k files, split among 1, 2, 4, 8 and 16 threads, for an FT from
+  FT_newConcurrent, whose lookups take no locks, and for an FT from
+  FT_new with every operation under one mutex. The curve depends on
+  the cores available: on a single core the threads only take turns,
+  so it shows the cost of the synchronization rather than any
+  speedup.
+*/
+static void Bench_threads(void) {
+   enum { FILES = THREAD_GROUPS * THREAD_DIRS * THREAD_FILES,
+          SCRATCH = THREAD_GROUPS * THREAD_DIRS * THREAD_SCRATCH };
+   static const size_t aulThreads[] = { 1, 2, 4, 8, 16 };
+   pthread_mutex_t sGlobalLock = PTHREAD_MUTEX_INITIALIZER;
+   struct threadRun sConcurrent, sGlobal;
+   double dConcurrent, dGlobal;
+   size_t i;
+
+   sConcurrent.oFT = FT_newConcurrent();
+   sGlobal.oFT = FT_new();
+   if(sConcurrent.oFT == NULL || sGlobal.oFT == NULL)
+      Bench_require(MEMORY_ERROR, "FT_new");
+   sConcurrent.psGlobalLock = NULL;
+   sGlobal.psGlobalLock = &sGlobalLock;
+   sConcurrent.ppcFiles = sGlobal.ppcFiles =
+      Bench_threadPaths("root/group%lu/dir%lu/file%03lu",
+                        THREAD_FILES);
+   sConcurrent.ppcScratch = sGlobal.ppcScratch =
+      Bench_threadPaths("root/group%lu/dir%lu/scratch%lu",
+                        THREAD_SCRATCH);
+   Bench_require(FT_insertDirIn(sConcurrent.oFT, "root"),
+                 "FT_insertDirIn");
+   Bench_require(FT_insertDirIn(sGlobal.oFT, "root"), "FT_insertDirIn");
+   for(i = 0; i < FILES; i++) {
+      Bench_require(FT_insertFileIn(sConcurrent.oFT,
+                                    sConcurrent.ppcFiles[i], NULL, 0),
+                    "FT_insertFileIn");
+      Bench_require(FT_insertFileIn(sGlobal.oFT, sGlobal.ppcFiles[i],
+                                    NULL, 0), "FT_insertFileIn");
+   }
+
+   for(i = 0; i < sizeof(aulThreads) / sizeof(aulThreads[0]); i++) {
+      dConcurrent = Bench_threadsRun(&sConcurrent, aulThreads[i]);
+      dGlobal = Bench_threadsRun(&sGlobal, aulThreads[i]);
+      printf("threads   %2lu  95/5 read/write  lock-free reads "
+             "%6.2f Mops/s  one mutex %6.2f Mops/s\n",
+             (unsigned long) aulThreads[i],
+             (double) THREAD_OPS / dConcurrent / 1e6,
+             (double) THREAD_OPS / dGlobal / 1e6);
+   }
+
+   Bench_freePaths(sConcurrent.ppcFiles, FILES);
+   Bench_freePaths(sConcurrent.ppcScratch, SCRATCH);
+   FT_free(sConcurrent.oFT);
+   FT_free(sGlobal.oFT);
+}
+
+/*
+  Prints the time taken per element by the ulCount operations that
+  took dSeconds, labelled with pcWhat.
+*/
+static void Bench_perOp(const char *pcWhat, double dSeconds,
+                        size_t ulCount) {
+   printf("dynarray  %-36s %8.2f ns/element\n", pcWhat,
+          dSeconds * 1e9 / (double) ulCount);
+}
+
+/*
+  Times DynArray's element-at-a-time operations against its bulk ones:
+  inserting and removing at the front, one at a time and as a range,
+  and appending one at a time, after a reserve, and all at once.
+*/
+static void Bench_dynarray(void) {
+   enum { SHIFTS = 20000, APPENDS = 4000000, ROUNDS = 8 };
+   void **ppvElements;
+   DynArray_T oDArray;
+   size_t i, ulRound;
+   clock_t tStart;
+
+   ppvElements = malloc(APPENDS * sizeof(void *));
+   assert(ppvElements != NULL);
+   for(i = 0; i < APPENDS; i++)
+      ppvElements[i] = &ppvElements[i];
+
+   oDArray = DynArray_new(0);
+   assert(oDArray != NULL);
+   tStart = clock();
+   for(i = 0; i < SHIFTS; i++)
+      (void) DynArray_addAt(oDArray, 0, ppvElements[i]);
+   Bench_perOp("addAt front, 20k", Bench_seconds(tStart, clock()),
+               SHIFTS);
+   tStart = clock();
+   for(i = 0; i < SHIFTS; i++)
+      (void) DynArray_removeAt(oDArray, 0);
+   Bench_perOp("removeAt front, 20k", Bench_seconds(tStart, clock()),
+               SHIFTS);
+
+   (void) DynArray_add(oDArray, ppvElements[0]);
+   tStart = clock();
+   for(ulRound = 0; ulRound < ROUNDS; ulRound++) {
+      (void) DynArray_insertRange(oDArray, 0, ppvElements, APPENDS);
+      DynArray_removeRange(oDArray, 0, APPENDS);
+   }
+   Bench_perOp("insertRange+removeRange front, 4M",
+               Bench_seconds(tStart, clock()), ROUNDS * APPENDS);
+   DynArray_free(oDArray);
+
+   tStart = clock();
+   for(ulRound = 0; ulRound < ROUNDS; ulRound++) {
+      oDArray = DynArray_new(0);
+      for(i = 0; i < APPENDS; i++)
+         (void) DynArray_add(oDArray, ppvElements[i]);
+      DynArray_free(oDArray);
+   }
+   Bench_perOp("add, 4M", Bench_seconds(tStart, clock()),
+               ROUNDS * APPENDS);
+
+   tStart = clock();
+   for(ulRound = 0; ulRound < ROUNDS; ulRound++) {
+      oDArray = DynArray_new(0);
+      (void) DynArray_reserve(oDArray, APPENDS);
+      for(i = 0; i < APPENDS; i++)
+         (void) DynArray_add(oDArray, ppvElements[i]);
+      DynArray_free(oDArray);
+   }
+   Bench_perOp("reserve then add, 4M", Bench_seconds(tStart, clock()),
+               ROUNDS * APPENDS);
+
+   tStart = clock();
+   for(ulRound = 0; ulRound < ROUNDS; ulRound++) {
+      oDArray = DynArray_new(0);
+      (void) DynArray_addAll(oDArray, ppvElements, APPENDS);
+      DynArray_toArray(oDArray, ppvElements);
+      DynArray_free(oDArray);
+   }
+   Bench_perOp("addAll then toArray, 4M",
+               Bench_seconds(tStart, clock()), ROUNDS * APPENDS);
+
+   free(ppvElements);
+}
+
+/*
+  Compares the string pcElement with the key pcKey, for searching
+  arrays of strings both through a function pointer and inlined.
+*/
+static SORTEDARRAY_INLINE int Bench_compareString(
+   const char *pcElement, const char *pcKey) {
+   return strcmp(pcElement, pcKey);
+}
+
+/* StringArray_search searches arrays of strings, inlining strcmp */
+SORTEDARRAY_SEARCH(StringArray, char *, char, Bench_compareString)
+
+/*
+  Compares the string in sEntry with the key pcKey, for searching the
+  chunks of a ChunkArray_T of strings.
+*/
+static SORTEDARRAY_INLINE int Bench_compareEntry(
+   const struct ChunkEntry sEntry, const char *pcKey) {
+   return strcmp(sEntry.pvElement, pcKey);
+}
+
+/* EntryArray_search searches chunks of strings, inlining strcmp */
+SORTEDARRAY_SEARCH(EntryArray, struct ChunkEntry, char,
+                   Bench_compareEntry)
+
+/*
+  Binary-searches oCArray, which must be sorted by pfCompare, for an
+  element equal to pvKey, as DynArray_bsearch searches a DynArray_T,
+  calling pfCompare through a pointer. Returns 1 (TRUE) and stores
+  its index in *pulIndex if there is such an element; otherwise
+  returns 0 (FALSE) and stores in *pulIndex the index where it would
+  be inserted.
+*/
+static int Bench_chunkBsearch(ChunkArray_T oCArray, const void *pvKey,
+                              size_t *pulIndex,
+                              int (*pfCompare)(const void *pvElement,
+                                               const void *pvKey)) {
+   struct ChunkEntry *psChunk;
+   size_t ulCount, ulChunks, ulBase;
+   size_t ulLo, ulHi, ulMid;
+   int iCompare;
+
+   assert(oCArray != NULL);
+   assert(pulIndex != NULL);
+   assert(pfCompare != NULL);
+
+   ulChunks = ChunkArray_getChunkCount(oCArray);
+   if(ulChunks == 0) {
+      *pulIndex = 0;
+      return 0;
+   }
+
+   /* find the last chunk whose first element is not greater than
+      pvKey, or the first chunk if there is none */
+   ulLo = 1;
+   ulHi = ulChunks;
+   while(ulLo < ulHi) {
+      ulMid = ulLo + (ulHi - ulLo) / 2;
+      psChunk = ChunkArray_getChunk(oCArray, ulMid, &ulCount);
+      if((*pfCompare)(psChunk[0].pvElement, pvKey) > 0)
+         ulHi = ulMid;
+      else
+         ulLo = ulMid + 1;
+   }
+   psChunk = ChunkArray_getChunk(oCArray, ulLo - 1, &ulCount);
+   ulBase = ChunkArray_getChunkBase(oCArray, ulLo - 1);
+
+   /* then search within it */
+   ulLo = 0;
+   ulHi = ulCount;
+   while(ulLo < ulHi) {
+      ulMid = ulLo + (ulHi - ulLo) / 2;
+      iCompare = (*pfCompare)(psChunk[ulMid].pvElement, pvKey);
+      if(iCompare > 0)
+         ulHi = ulMid;
+      else if(iCompare < 0)
+         ulLo = ulMid + 1;
+      else {
+         *pulIndex = ulBase + ulMid;
+         return 1;
+      }
+   }
+   *pulIndex = ulBase + ulLo;
+   return 0;
+}
+
+/*
+  Searches a sorted array of ulCount strings for random members of it
+  through DynArray_bsearch and Bench_chunkBsearch, which call their
+  comparison function through a pointer, and through StringArray_search
+  and a chunk-by-chunk search with it, which inline theirs. Prints the
+  time taken per search by each.
+*/
+static void Bench_sortedAt(size_t ulCount) {
+   enum { SEARCHES = 2000000 };
+   char **ppcStrings;
+   struct ChunkEntry *psEntries;
+   struct ChunkEntry *psChunk;
+   size_t *pulKeys;
+   DynArray_T oDArray;
+   ChunkArray_T oCArray;
+   Slab_T oSSlab;
+   size_t ulFound[4] = { 0, 0, 0, 0 };
+   size_t ulIndex, ulChunkCount, ulChunks, ulLo, ulHi, ulMid;
+   size_t i;
+   clock_t tStart;
+   double adTime[4];
+
+   ppcStrings = malloc(ulCount * sizeof(char *));
+   psEntries = malloc(ulCount * sizeof(struct ChunkEntry));
+   pulKeys = malloc(SEARCHES * sizeof(size_t));
+   assert(ppcStrings != NULL && psEntries != NULL && pulKeys != NULL);
+   for(i = 0; i < ulCount; i++) {
+      ppcStrings[i] = malloc(32);
+      assert(ppcStrings[i] != NULL);
+      sprintf(ppcStrings[i], "entry%07lu", (unsigned long) i);
+      psEntries[i].ulKey = 0;
+      psEntries[i].pvElement = ppcStrings[i];
+   }
+   for(i = 0; i < SEARCHES; i++)
+      pulKeys[i] = (size_t) rand() % ulCount;
+
+   oDArray = DynArray_new(0);
+   assert(oDArray != NULL);
+   (void) DynArray_addAll(oDArray, (void **) ppcStrings, ulCount);
+   oSSlab = Slab_new();
+   assert(oSSlab != NULL);
+   oCArray = ChunkArray_new(oSSlab, psEntries, ulCount);
+   assert(oCArray != NULL);
+
+   tStart = clock();
+   for(i = 0; i < SEARCHES; i++)
+      ulFound[0] += (size_t) DynArray_bsearch(oDArray,
+         ppcStrings[pulKeys[i]], &ulIndex,
+         (int (*)(const void *, const void *)) Bench_compareString);
+   adTime[0] = Bench_seconds(tStart, clock());
+
+   tStart = clock();
+   for(i = 0; i < SEARCHES; i++)
+      ulFound[1] += (size_t) StringArray_search(ppcStrings, ulCount,
+                                 ppcStrings[pulKeys[i]], &ulIndex);
+   adTime[1] = Bench_seconds(tStart, clock());
+
+   tStart = clock();
+   for(i = 0; i < SEARCHES; i++)
+      ulFound[2] += (size_t) Bench_chunkBsearch(oCArray,
+         ppcStrings[pulKeys[i]], &ulIndex,
+         (int (*)(const void *, const void *)) Bench_compareString);
+   adTime[2] = Bench_seconds(tStart, clock());
+
+   /* the same two-level search nodeFT makes of wide directories */
+   tStart = clock();
+   ulChunks = ChunkArray_getChunkCount(oCArray);
+   for(i = 0; i < SEARCHES; i++) {
+      const char *pcKey = ppcStrings[pulKeys[i]];
+      ulLo = 1;
+      ulHi = ulChunks;
+      while(ulLo < ulHi) {
+         ulMid = ulLo + (ulHi - ulLo) / 2;
+         psChunk = ChunkArray_getChunk(oCArray, ulMid, &ulChunkCount);
+         if(Bench_compareEntry(psChunk[0], pcKey) > 0)
+            ulHi = ulMid;
+         else
+            ulLo = ulMid + 1;
+      }
+      psChunk = ChunkArray_getChunk(oCArray, ulLo - 1, &ulChunkCount);
+      ulFound[3] += (size_t) EntryArray_search(psChunk, ulChunkCount,
+                                               pcKey, &ulIndex);
+      ulIndex += ChunkArray_getChunkBase(oCArray, ulLo - 1);
+   }
+   adTime[3] = Bench_seconds(tStart, clock());
+
+   for(i = 0; i < 4; i++)
+      if(ulFound[i] != SEARCHES)
+         Bench_require(NO_SUCH_PATH, "sorted search");
+
+   printf("sorted  %7lu strings  DynArray_bsearch %6.1f ns  "
+          "StringArray_search %6.1f ns  chunk bsearch %6.1f ns  "
+          "inlined chunk search %6.1f ns\n",
+          (unsigned long) ulCount,
+          adTime[0] * 1e9 / SEARCHES, adTime[1] * 1e9 / SEARCHES,
+          adTime[2] * 1e9 / SEARCHES, adTime[3] * 1e9 / SEARCHES);
+
+   ChunkArray_free(oCArray);
+   Slab_free(oSSlab);
+   DynArray_free(oDArray);
+   for(i = 0; i < ulCount; i++)
+      free(ppcStrings[i]);
+   free(ppcStrings);
+   free(psEntries);
+   free(pulKeys);
+}
+
+/* Runs the sorted array benchmarks. */
+static void Bench_sorted(void) {
+   static const size_t aulCounts[] = { 16, 1024, 65536, 1000000 };
+   size_t i;
+
+   for(i = 0; i < sizeof(aulCounts) / sizeof(aulCounts[0]); i++)
+      Bench_sortedAt(aulCounts[i]);
+}
+
+/*
+  Measures Node_findChild on a directory of ulFanout children, named
+  by Bench_wideName with bScattered, looked up in random order, once
+  with every directory given a child index and once with none,
+  printing the time per lookup and the slab bytes used per child.
+*/
+static void Bench_indexAt(size_t ulFanout, boolean bScattered) {
+   enum { LOOKUPS = 2000000 };
+   Path_T *poPChildren;
+   Path_T oPPath = NULL;
+   size_t *pulOrder;
+   Slab_T oSSlab;
+   Node_T oNRoot = NULL;
+   Node_T oNChild = NULL;
+   struct SlabStats sStats;
+   char acBuf[32];
+   size_t ulRounds, ulRound, ulFound;
+   size_t i, j, ulSwap;
+   int iIndexed;
+   size_t ulThreshold;
+   clock_t tStart;
+   double dSecs;
+
+   ulRounds = LOOKUPS / ulFanout + 1;
+   poPChildren = malloc(ulFanout * sizeof(Path_T));
+   pulOrder = malloc(ulFanout * sizeof(size_t));
+   assert(poPChildren != NULL && pulOrder != NULL);
+   for(i = 0; i < ulFanout; i++) {
+      (void) Bench_wideName(acBuf, i, bScattered);
+      Bench_require(Path_new(acBuf, &poPChildren[i]), "Path_new");
+      pulOrder[i] = i;
+   }
+   for(i = ulFanout; i > 1; i--) {
+      j = (size_t) rand() % i;
+      ulSwap = pulOrder[i - 1];
+      pulOrder[i - 1] = pulOrder[j];
+      pulOrder[j] = ulSwap;
+   }
+
+   for(iIndexed = 0; iIndexed <= 1; iIndexed++) {
+      ulThreshold = iIndexed ? 0 : (size_t) -1;
+      oSSlab = Slab_new();
+      assert(oSSlab != NULL);
+      Bench_require(Path_new("root", &oPPath), "Path_new");
+      Bench_require(Node_new(oPPath, NULL, oSSlab, ulThreshold,
+                             &oNRoot, DIRECTORY), "Node_new");
+      Path_free(oPPath);
+      for(i = 0; i < ulFanout; i++)
+         Bench_require(Node_new(poPChildren[i], oNRoot, oSSlab,
+                                ulThreshold, &oNChild, A_FILE),
+                       "Node_new");
+      Slab_getStats(oSSlab, &sStats);
+
+      ulFound = 0;
+      tStart = clock();
+      for(ulRound = 0; ulRound < ulRounds; ulRound++)
+         for(i = 0; i < ulFanout; i++)
+            ulFound += (size_t) Node_findChild(oNRoot,
+                                   poPChildren[pulOrder[i]], &oNChild);
+      dSecs = Bench_seconds(tStart, clock());
+      if(ulFound != ulRounds * ulFanout)
+         Bench_require(NO_SUCH_PATH, "Node_findChild");
+
+      printf("index  fanout %7lu  %-9s  %-6s  %6.1f ns/lookup  "
+             "%6.1f bytes/child\n",
+             (unsigned long) ulFanout,
+             bScattered ? "scattered" : "entryNNN",
+             iIndexed ? "hash" : "binary",
+             dSecs * 1e9 / ((double) ulRounds * ulFanout),
+             (double) (sStats.ulBlockBytes + sStats.ulLargeBytes)
+             / (double) ulFanout);
+
+      (void) Node_free(oNRoot, oSSlab);
+      Slab_free(oSSlab);
+   }
+
+   for(i = 0; i < ulFanout; i++)
+      Path_free(poPChildren[i]);
+   free(poPChildren);
+   free(pulOrder);
+}
+
+/*
+  Runs the child index benchmarks, which show the fanout above which
+  hashing beats binary search (see NODE_INDEX_THRESHOLD).
+*/
+static void Bench_index(void) {
+   static const size_t aulFanouts[] = { 4, 16, 64, 256, 1024, 16384,
+                                        262144 };
+   size_t i;
+
+   for(i = 0; i < sizeof(aulFanouts) / sizeof(aulFanouts[0]); i++) {
+      Bench_indexAt(aulFanouts[i], FALSE);
+      Bench_indexAt(aulFanouts[i], TRUE);
+   }
+}
+
+/* A named benchmark */
+struct benchmark {
+   /* the name used to select the benchmark on the command line */
+   const char *pcName;
+   /* the function that runs it */
+   void (*pfRun)(void);
+};
+
+/* All the benchmarks, in the order they are run by default */
+static const struct benchmark asBenchmarks[] = {
+   { "path", Bench_path },
+   { "atoms", Bench_atoms },
+   { "lookup", Bench_lookup },
+   { "tree", Bench_tree },
+   { "tostring", Bench_toString },
+   { "serialize", Bench_serialize },
+   { "wide", Bench_wide },
+   { "teardown", Bench_teardown },
+   { "snapshot", Bench_snapshot },
+   { "image", Bench_image },
+   { "threads", Bench_threads },
+   { "dynarray", Bench_dynarray },
+   { "sorted", Bench_sorted },
+   { "index", Bench_index }
+};
+
+/*
+  Runs the benchmarks named in argv, or all of them if none are named.
+  Results are printed to stdout. Returns 0, or 1 if an unknown
+  benchmark was named.
+*/
+int main(int argc, char *argv[]) {
+   size_t ulCount = sizeof(asBenchmarks) / sizeof(asBenchmarks[0]);
+   size_t i;
+   int iArg;
+
+   srand(217);
+
+   if(argc < 2) {
+      for(i = 0; i < ulCount; i++)
+         asBenchmarks[i].pfRun();
+      return 0;
+   }
+
+   for(iArg = 1; iArg < argc; iArg++) {
+      for(i = 0; i < ulCount; i++) {
+         if(!strcmp(argv[iArg], asBenchmarks[i].pcName)) {
+            asBenchmarks[i].pfRun();
+            break;
+         }
+      }
+      if(i == ulCount) {
+         fprintf(stderr, "%s: unknown benchmark %s\n", argv[0],
+                 argv[iArg]);
+         return 1;
+      }
+   }
+   return 0;
+}
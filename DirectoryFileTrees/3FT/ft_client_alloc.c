@@ -0,0 +1,161 @@
+/*--------------------------------------------------------------------*/
+/* ft_client_alloc.c                                                  */
+/* Author: Jacob Santelli and Joshua Yang                             */
+/*--------------------------------------------------------------------*/
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "alloccount.h"
+#include "ft.h"
+
+/* The client must be linked as described in alloccount.h */
+
+/* The number of queries made by each run of Client_query */
+enum { QUERIES = 1000000 };
+
+/* Runs QUERIES queries of the ulQueryCount paths in apcQueries, hits
+   and misses alike, while counting calls to the allocator. Stores the
+   number of calls in *pulAllocCalls. Returns the number of hits. */
+static size_t Client_query(const char *apcQueries[],
+                           size_t ulQueryCount, size_t *pulAllocCalls) {
+   struct AllocStats sBefore, sAfter;
+   size_t ulHits = 0;
+   size_t i;
+   boolean bIsFile;
+   size_t ulSize;
+
+   AllocCount_get(&sBefore);
+   for(i = 0; i < QUERIES; i++) {
+      const char *pcPath = apcQueries[i % ulQueryCount];
+      switch(i % 4) {
+         case 0:
+            ulHits += FT_containsDir(pcPath);
+            break;
+         case 1:
+            ulHits += FT_containsFile(pcPath);
+            break;
+         case 2:
+            ulHits += (FT_stat(pcPath, &bIsFile, &ulSize) == SUCCESS);
+            break;
+         default:
+            ulHits += (FT_getFileContents(pcPath) != NULL);
+            break;
+      }
+   }
+   AllocCount_get(&sAfter);
+   *pulAllocCalls = sAfter.ulCalls - sBefore.ulCalls;
+   return ulHits;
+}
+
+/* FT_walk visitor that counts the visits in the size_t that
+   pvVisits points to */
+static int Client_countVisit(const char *pcPath, boolean bIsFile,
+                             int iOrder, void *pvVisits) {
+   assert(pcPath != NULL);
+   (void) bIsFile;
+   (void) iOrder;
+
+   ++*(size_t *) pvVisits;
+   return SUCCESS;
+}
+
+/* Tests that the FT's read-only queries never allocate memory, by
+   running 1M of them while counting calls to the allocator, and then
+   1M more with the FT's pathname index enabled, which must find the
+   same nodes. Then tests that walking the FT allocates only its path
+   buffer, however many nodes it visits, and that the FT loaded from
+   its image answers the same queries without allocating. Prints the
+   results to stderr. Returns 0. */
+int main(void) {
+   static const char *apcQueries[] = {
+      "1root",
+      "1root/2child/3gkid",
+      "1root/2child/3gkid/4ggk",
+      "1root/2second/3gfile",
+      "1root/2third",
+      "1root/2ok/3yes/4indeed/5deep/6deeper",
+      "1root/2ok/3yes/4indeed/5deep/6deeper/7file",
+      "1root/2ok/3yes/4nope",
+      "1root/2third/3notunderfile",
+      "1root/2a",
+      "1root/2zzz",
+      "1otherroot/2child",
+      "",
+      "/1root",
+      "1root/",
+      "1root//2child"
+   };
+   size_t ulQueryCount = sizeof(apcQueries) / sizeof(apcQueries[0]);
+   size_t ulAllocCalls;
+   size_t ulHits;
+   size_t ulIndexedHits;
+   struct AllocStats sBefore, sAfter;
+   size_t ulVisits = 0;
+   size_t i;
+
+   assert(FT_init() == SUCCESS);
+   assert(FT_insertDir("1root/2child/3gkid/4ggk") == SUCCESS);
+   assert(FT_insertFile("1root/2second/3gfile", "contents",
+                        strlen("contents")+1) == SUCCESS);
+   assert(FT_insertFile("1root/2third", NULL, 0) == SUCCESS);
+   assert(FT_insertFile("1root/2ok/3yes/4indeed/5deep/6deeper/7file",
+                        NULL, 0) == SUCCESS);
+   assert(FT_insertDir("1root/2b") == SUCCESS);
+   assert(FT_insertDir("1root/2y") == SUCCESS);
+
+   ulHits = Client_query(apcQueries, ulQueryCount, &ulAllocCalls);
+   fprintf(stderr, "%lu queries, %lu hits, %lu allocation calls\n",
+           (unsigned long) QUERIES, (unsigned long) ulHits,
+           (unsigned long) ulAllocCalls);
+   assert(ulHits > 0);
+   assert(ulAllocCalls == 0);
+
+   assert(FT_setPathIndex(TRUE) == SUCCESS);
+   ulIndexedHits = Client_query(apcQueries, ulQueryCount,
+                                &ulAllocCalls);
+   fprintf(stderr, "%lu indexed queries, %lu hits, "
+           "%lu allocation calls\n",
+           (unsigned long) QUERIES, (unsigned long) ulIndexedHits,
+           (unsigned long) ulAllocCalls);
+   assert(ulIndexedHits == ulHits);
+   assert(ulAllocCalls == 0);
+
+   /* 1000 walks, each visiting every node twice: each allocates
+      nothing per node, only a path buffer that doubles from the
+      root's 6 characters to the 48 the longest path needs */
+   AllocCount_get(&sBefore);
+   for(i = 0; i < 1000; i++)
+      assert(FT_walk(Client_countVisit, &ulVisits,
+                     FT_WALK_PREORDER | FT_WALK_POSTORDER
+                     | FT_WALK_FILES_FIRST) == SUCCESS);
+   AllocCount_get(&sAfter);
+   ulAllocCalls = sAfter.ulCalls - sBefore.ulCalls;
+   fprintf(stderr, "%lu walk visits, %lu allocation calls\n",
+           (unsigned long) ulVisits, (unsigned long) ulAllocCalls);
+   assert(ulVisits == 1000 * 2 * 15);
+   assert(ulAllocCalls == 1000 * 4);
+
+   /* loading the FT from its image allocates no node, and queries
+      read the image without allocating either */
+   assert(FT_save("ftalloc.img") == SUCCESS);
+   assert(FT_destroy() == SUCCESS);
+   AllocCount_get(&sBefore);
+   assert(FT_load("ftalloc.img") == SUCCESS);
+   AllocCount_get(&sAfter);
+   fprintf(stderr, "image loaded with %lu allocation calls\n",
+           (unsigned long) (sAfter.ulCalls - sBefore.ulCalls));
+   assert(remove("ftalloc.img") == 0);
+   ulHits = Client_query(apcQueries, ulQueryCount, &ulAllocCalls);
+   fprintf(stderr, "%lu image queries, %lu hits, "
+           "%lu allocation calls\n",
+           (unsigned long) QUERIES, (unsigned long) ulHits,
+           (unsigned long) ulAllocCalls);
+   assert(ulHits == ulIndexedHits);
+   assert(ulAllocCalls == 0);
+
+   assert(FT_destroy() == SUCCESS);
+   return 0;
+}
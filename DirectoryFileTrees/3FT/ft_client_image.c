@@ -0,0 +1,100 @@
+/*--------------------------------------------------------------------*/
+/* ft_client_image.c                                                  */
+/* Author: Jacob Santelli and Joshua Yang                             */
+/*--------------------------------------------------------------------*/
+
+/* for chmod and stat */
+#define _POSIX_C_SOURCE 200112L
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include "ft.h"
+
+/* The file the images are saved to, in the working directory */
+static const char pcImage[] = "ft_client.img";
+
+/* Tests that an FT loaded from the image it was saved to answers as it
+   did, and can be changed like any other, and that files that are not
+   images are refused. Returns 0. */
+int main(void) {
+   FT_T oFT, oFTLoaded, oFTSnap;
+   FILE *psFile;
+   struct stat sStat;
+   char *temp, *temp2;
+   boolean bIsFile;
+   size_t l;
+
+   assert(FT_save(pcImage) == INITIALIZATION_ERROR);
+
+   assert((oFT = FT_new()) != NULL);
+   assert(FT_insertDirIn(oFT, "1root/2child/3gkid") == SUCCESS);
+   assert(FT_insertFileIn(oFT, "1root/2child/3file", "one",
+                          strlen("one")+1) == SUCCESS);
+   assert(FT_insertFileIn(oFT, "1root/2empty", NULL, 0) == SUCCESS);
+   assert(FT_insertDirIn(oFT, "1root/2a") == SUCCESS);
+   assert(FT_saveIn(oFT, pcImage) == SUCCESS);
+   assert(FT_newFromImage(pcImage, &oFTLoaded) == SUCCESS);
+   assert((temp = FT_toStringIn(oFT)) != NULL);
+   assert((temp2 = FT_toStringIn(oFTLoaded)) != NULL);
+   assert(!strcmp(temp, temp2));
+   free(temp2);
+   assert(FT_containsDirIn(oFTLoaded, "1root/2child/3gkid") == TRUE);
+   assert(FT_containsFileIn(oFTLoaded, "1root/2child/3gkid") == FALSE);
+   assert(FT_containsDirIn(oFTLoaded, "1root/2b") == FALSE);
+   assert(FT_containsFileIn(oFTLoaded, "1root/2empty") == TRUE);
+   assert(FT_getFileContentsIn(oFTLoaded, "1root/2empty") == NULL);
+   assert(!strcmp(FT_getFileContentsIn(oFTLoaded,
+                                       "1root/2child/3file"), "one"));
+   assert(FT_statIn(oFTLoaded, "1root/2child/3file", &bIsFile, &l)
+          == SUCCESS);
+   assert(bIsFile == TRUE && l == strlen("one")+1);
+   assert(FT_statIn(oFTLoaded, "1other", &bIsFile, &l)
+          == CONFLICTING_PATH);
+   assert(FT_setPathIndexIn(oFTLoaded, TRUE) == SUCCESS);
+   assert((oFTSnap = FT_snapshotIn(oFTLoaded)) != NULL);
+   /* the first change builds the nodes, which the snapshot does not
+      share */
+   assert(FT_insertDirIn(oFTLoaded, "1root/2b") == SUCCESS);
+   assert(FT_rmDirIn(oFTLoaded, "1root/2child") == SUCCESS);
+   assert(FT_containsDirIn(oFTLoaded, "1root/2b") == TRUE);
+   assert(FT_containsDirIn(oFTLoaded, "1root/2child") == FALSE);
+   assert(FT_containsFileIn(oFTLoaded, "1root/2child/3file") == FALSE);
+   assert(!strcmp(FT_getFileContentsIn(oFTSnap, "1root/2child/3file"),
+                  "one"));
+   FT_free(oFTLoaded);
+   assert((temp2 = FT_toStringIn(oFTSnap)) != NULL);
+   assert(!strcmp(temp, temp2));
+   free(temp2);
+   FT_free(oFTSnap);
+   FT_free(oFT);
+
+   assert(FT_load(pcImage) == SUCCESS);
+   assert(FT_load(pcImage) == INITIALIZATION_ERROR);
+   /* saving over the image replaces the file, with the same mode,
+      leaving the one the FT is loaded from mapped as it was */
+   assert(chmod(pcImage, 0640) == 0);
+   assert(FT_save(pcImage) == SUCCESS);
+   assert(stat(pcImage, &sStat) == 0);
+   assert((sStat.st_mode & 0777) == 0640);
+   assert(FT_save("no such directory/ft_client.img") == WRITE_ERROR);
+   assert((temp2 = FT_toString()) != NULL);
+   assert(!strcmp(temp, temp2));
+   free(temp2);
+   free(temp);
+   assert(FT_destroy() == SUCCESS);
+
+   assert((psFile = fopen(pcImage, "w")) != NULL);
+   assert(fputs("not an image\n", psFile) != EOF);
+   assert(fclose(psFile) == 0);
+   assert(FT_load(pcImage) == BAD_IMAGE);
+   assert(remove(pcImage) == 0);
+   assert(FT_load(pcImage) == READ_ERROR);
+   assert(FT_containsDir("1root") == FALSE);
+
+   fprintf(stderr, "images passed\n");
+   return 0;
+}
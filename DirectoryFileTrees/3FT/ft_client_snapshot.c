@@ -0,0 +1,63 @@
+/*--------------------------------------------------------------------*/
+/* ft_client_snapshot.c                                               */
+/* Author: Jacob Santelli and Joshua Yang                             */
+/*--------------------------------------------------------------------*/
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "ft.h"
+
+/* Tests that a snapshot keeps the FT as it was when taken, cannot be
+   changed, and outlives the FT it was taken from. Returns 0. */
+int main(void) {
+   FT_T oFT, oFTSnap1, oFTSnap2;
+   char *temp;
+   boolean bIsFile;
+   size_t l;
+
+   assert(FT_snapshot() == NULL);
+
+   assert((oFT = FT_new()) != NULL);
+   assert(FT_insertDirIn(oFT, "1root/2child/3gkid") == SUCCESS);
+   assert(FT_insertFileIn(oFT, "1root/2child/3file", "one",
+                          strlen("one")+1) == SUCCESS);
+   assert((oFTSnap1 = FT_snapshotIn(oFT)) != NULL);
+   assert(FT_insertDirIn(oFT, "1root/2other") == SUCCESS);
+   assert(FT_rmDirIn(oFT, "1root/2child/3gkid") == SUCCESS);
+   assert(!strcmp(FT_replaceFileContentsIn(oFT, "1root/2child/3file",
+                                           "two", strlen("two")+1),
+                  "one"));
+   assert((oFTSnap2 = FT_snapshotIn(oFTSnap1)) != NULL);
+   assert(FT_containsDirIn(oFTSnap1, "1root/2child/3gkid") == TRUE);
+   assert(FT_containsDirIn(oFTSnap1, "1root/2other") == FALSE);
+   assert(!strcmp(FT_getFileContentsIn(oFTSnap1, "1root/2child/3file"),
+                  "one"));
+   assert(!strcmp(FT_getFileContentsIn(oFT, "1root/2child/3file"),
+                  "two"));
+   assert(FT_insertDirIn(oFTSnap1, "1root/2new") == READ_ONLY);
+   assert(FT_insertFileIn(oFTSnap1, "1root/2new", NULL, 0)
+          == READ_ONLY);
+   assert(FT_rmDirIn(oFTSnap1, "1root") == READ_ONLY);
+   assert(FT_rmFileIn(oFTSnap1, "1root/2child/3file") == READ_ONLY);
+   assert(FT_replaceFileContentsIn(oFTSnap1, "1root/2child/3file",
+                                   NULL, 0) == NULL);
+   assert(FT_setPathIndexIn(oFTSnap1, TRUE) == SUCCESS);
+   assert(FT_statIn(oFTSnap1, "1root/2child/3file", &bIsFile, &l)
+          == SUCCESS);
+   assert(bIsFile == TRUE && l == strlen("one")+1);
+   assert(FT_rmDirIn(oFT, "1root") == SUCCESS);
+   FT_free(oFT);
+   assert((temp = FT_toStringIn(oFTSnap1)) != NULL);
+   assert(!strcmp(temp, "1root\n1root/2child\n1root/2child/3file\n"
+                  "1root/2child/3gkid\n"));
+   free(temp);
+   FT_free(oFTSnap1);
+   assert(FT_containsDirIn(oFTSnap2, "1root/2child/3gkid") == TRUE);
+   FT_free(oFTSnap2);
+
+   fprintf(stderr, "snapshots passed\n");
+   return 0;
+}
@@ -0,0 +1,491 @@
+/*--------------------------------------------------------------------*/
+/* ft_client_threads.c                                                */
+/* Author: Jacob Santelli and Joshua Yang                             */
+/*--------------------------------------------------------------------*/
+
+/* for the POSIX threads */
+#define _POSIX_C_SOURCE 200112L
+
+#include <assert.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "ft.h"
+
+/* The client is meant to be built with -fsanitize=thread (see the
+   ftthreads target of the Makefile), which reports any data race
+   between the readers and the writers that free what they read */
+
+/* The number of threads of each kind; each writer has subtrees of its
+   own, which every reader looks into */
+enum { READERS = 4, WRITERS = 2 };
+/* The shape of each subtree a writer builds and removes: directories
+   of files, 16 * 33 + 1 = 529 nodes in all */
+enum { SUBTREE_DIRS = 16, SUBTREE_FILES = 32 };
+/* The number of subtrees each writer builds and removes */
+enum { ROUNDS = 20 };
+/* The number of lookups each reader makes, and how often it walks the
+   whole FT between them */
+enum { LOOKUPS = 40000, WALK_INTERVAL = 2000 };
+
+/* The FT the threads share */
+static FT_T oFT;
+
+/* The paths of each writer's directories and files; each file's
+   contents are its own path, so a reader can tell that what it found
+   is what was inserted there */
+static char *apcDirs[WRITERS][SUBTREE_DIRS];
+static char *apcFiles[WRITERS][SUBTREE_DIRS * SUBTREE_FILES];
+/* The root of each writer's subtree */
+static char *apcSubtrees[WRITERS];
+
+/* Returns a copy of the path that pcFormat makes of ul1, ul2 and
+   ul3, which must be short. */
+static char *Client_path(const char *pcFormat, size_t ul1, size_t ul2,
+                         size_t ul3) {
+   char acBuf[64];
+   char *pcPath;
+
+   sprintf(acBuf, pcFormat, (unsigned long) ul1, (unsigned long) ul2,
+           (unsigned long) ul3);
+   pcPath = malloc(strlen(acBuf) + 1);
+   assert(pcPath != NULL);
+   return strcpy(pcPath, acBuf);
+}
+
+/* Builds writer *pvWriter's subtree, replaces each file's contents
+   with the same ones again, and removes the subtree whole with
+   FT_rmDirIn, ROUNDS times, while readers may be inside it. Returns
+   NULL. */
+static void *Client_write(void *pvWriter) {
+   size_t ulWriter = *(size_t *) pvWriter;
+   char *pcPath;
+   void *pvOld;
+   size_t ulRound;
+   size_t i;
+   int iStatus;
+
+   for(ulRound = 0; ulRound < ROUNDS; ulRound++) {
+      for(i = 0; i < SUBTREE_DIRS * SUBTREE_FILES; i++) {
+         iStatus = FT_insertFileIn(oFT, apcFiles[ulWriter][i],
+                                   apcFiles[ulWriter][i],
+                                   strlen(apcFiles[ulWriter][i]));
+         assert(iStatus == SUCCESS);
+      }
+      for(i = 0; i < SUBTREE_DIRS * SUBTREE_FILES; i++) {
+         pcPath = apcFiles[ulWriter][i];
+         pvOld = FT_replaceFileContentsIn(oFT, pcPath, pcPath,
+                                          strlen(pcPath));
+         assert(pvOld == pcPath);
+         (void) pvOld;
+      }
+      iStatus = FT_rmDirIn(oFT, apcSubtrees[ulWriter]);
+      assert(iStatus == SUCCESS);
+      (void) iStatus;
+   }
+   return NULL;
+}
+
+/* Builds and removes the writers' subtrees in turn ROUNDS times, from
+   writer *pvWriter's on, so that the writers insert into the same
+   directories and remove the same subtrees at once, which only one
+   of them can. Returns NULL. */
+static void *Client_contend(void *pvWriter) {
+   size_t ulWriter = *(size_t *) pvWriter;
+   size_t ulRound;
+   size_t ulSubtree;
+   size_t i;
+   int iStatus;
+
+   for(ulRound = 0; ulRound < ROUNDS; ulRound++) {
+      ulSubtree = (ulWriter + ulRound) % WRITERS;
+      for(i = 0; i < SUBTREE_DIRS * SUBTREE_FILES; i++) {
+         iStatus = FT_insertFileIn(oFT, apcFiles[ulSubtree][i],
+                                   apcFiles[ulSubtree][i],
+                                   strlen(apcFiles[ulSubtree][i]));
+         /* a file already there is reported as on the way to the
+            path */
+         assert(iStatus == SUCCESS || iStatus == NOT_A_DIRECTORY);
+      }
+      iStatus = FT_rmDirIn(oFT, apcSubtrees[ulSubtree]);
+      assert(iStatus == SUCCESS || iStatus == NO_SUCH_PATH);
+      (void) iStatus;
+   }
+   return NULL;
+}
+
+/* Builds and removes writer *pvWriter's subtree ROUNDS times in an FT
+   of its own, which shares only the atom table with the FTs of the
+   other writers, whose paths have the same names. Returns NULL. */
+static void *Client_writeOwn(void *pvWriter) {
+   size_t ulWriter = *(size_t *) pvWriter;
+   FT_T oFTOwn;
+   char *pcString;
+   size_t ulRound;
+   size_t i;
+   int iStatus;
+
+   oFTOwn = FT_new();
+   assert(oFTOwn != NULL);
+   iStatus = FT_insertDirIn(oFTOwn, "root");
+   assert(iStatus == SUCCESS);
+   for(ulRound = 0; ulRound < ROUNDS; ulRound++) {
+      for(i = 0; i < SUBTREE_DIRS * SUBTREE_FILES; i++) {
+         iStatus = FT_insertFileIn(oFTOwn, apcFiles[ulWriter][i],
+                                   apcFiles[ulWriter][i],
+                                   strlen(apcFiles[ulWriter][i]));
+         assert(iStatus == SUCCESS);
+         assert(FT_containsFileIn(oFTOwn, apcFiles[ulWriter][i]));
+      }
+      iStatus = FT_rmDirIn(oFTOwn, apcSubtrees[ulWriter]);
+      assert(iStatus == SUCCESS);
+      (void) iStatus;
+   }
+   pcString = FT_toStringIn(oFTOwn);
+   assert(pcString != NULL);
+   assert(strcmp(pcString, "root\n") == 0);
+   free(pcString);
+   FT_free(oFTOwn);
+   return NULL;
+}
+
+/* FT_walk visitor that checks that pcPath is under the root and
+   counts the visits in the size_t that pvVisits points to */
+static int Client_countVisit(const char *pcPath, boolean bIsFile,
+                             int iOrder, void *pvVisits) {
+   assert(pcPath != NULL);
+   assert(strncmp(pcPath, "root", 4) == 0);
+   (void) bIsFile;
+   (void) iOrder;
+
+   ++*(size_t *) pvVisits;
+   return SUCCESS;
+}
+
+/* Makes LOOKUPS lookups of the writers' directories and files, each
+   drawn pseudo-randomly by the seed *pvSeed, walking the whole FT
+   every WALK_INTERVAL of them, and checks that whatever is found is
+   what was inserted. Stores the number of lookups that found
+   something in *pvSeed. Returns NULL. */
+static void *Client_read(void *pvSeed) {
+   unsigned long ulSeed = *(unsigned long *) pvSeed;
+   unsigned long ulRandom;
+   size_t ulHits = 0;
+   size_t ulVisits;
+   size_t ulWriter;
+   const char *pcPath;
+   void *pvContents;
+   boolean bIsFile;
+   size_t ulSize;
+   size_t i;
+   int iStatus;
+
+   for(i = 0; i < LOOKUPS; i++) {
+      /* a linear congruential generator, so that threads do not share
+         rand's state */
+      ulSeed = ulSeed * 1103515245UL + 12345UL;
+      ulRandom = (ulSeed >> 8) & 0xffffffUL;
+      ulWriter = ulRandom % WRITERS;
+      ulRandom /= WRITERS;
+      pcPath = apcFiles[ulWriter][ulRandom
+                                  % (SUBTREE_DIRS * SUBTREE_FILES)];
+      switch(i % 4) {
+         case 0:
+            ulHits += FT_containsDirIn(oFT, apcDirs[ulWriter][ulRandom
+                                                  % SUBTREE_DIRS]);
+            break;
+         case 1:
+            ulHits += FT_containsFileIn(oFT, pcPath);
+            break;
+         case 2:
+            pvContents = FT_getFileContentsIn(oFT, pcPath);
+            assert(pvContents == NULL || pvContents == pcPath);
+            ulHits += (pvContents != NULL);
+            break;
+         default:
+            iStatus = FT_statIn(oFT, pcPath, &bIsFile, &ulSize);
+            assert(iStatus == SUCCESS || iStatus == NO_SUCH_PATH);
+            if(iStatus == SUCCESS) {
+               assert(bIsFile);
+               assert(ulSize == strlen(pcPath));
+               ulHits++;
+            }
+            break;
+      }
+
+      if(i % WALK_INTERVAL == 0) {
+         ulVisits = 0;
+         iStatus = FT_walkIn(oFT, Client_countVisit, &ulVisits,
+                             FT_WALK_PREORDER | FT_WALK_FILES_FIRST);
+         assert(iStatus == SUCCESS);
+         assert(ulVisits >= 1);
+         assert(ulVisits <= 1 + WRITERS * (1 + SUBTREE_DIRS
+                                           * (1 + SUBTREE_FILES)));
+      }
+   }
+   *(unsigned long *) pvSeed = (unsigned long) ulHits;
+   return NULL;
+}
+
+/* The number of walks the slow walker makes, and how long it takes
+   over each node, in nanoseconds */
+enum { SLOW_WALKS = 8, SLOW_VISIT = 20000 };
+
+/* Client_countVisit, but taking SLOW_VISIT nanoseconds, as a client
+   writing each path to a slow device would */
+static int Client_slowVisit(const char *pcPath, boolean bIsFile,
+                            int iOrder, void *pvVisits) {
+   struct timespec sDelay;
+
+   sDelay.tv_sec = 0;
+   sDelay.tv_nsec = SLOW_VISIT;
+   (void) nanosleep(&sDelay, NULL);
+   return Client_countVisit(pcPath, bIsFile, iOrder, pvVisits);
+}
+
+/* Walks the FT SLOW_WALKS times with Client_slowVisit, so that
+   writers remove the subtrees the walks are in, and free them, while
+   the walks go on. Returns NULL. */
+static void *Client_walkSlowly(void *pvIgnored) {
+   size_t ulVisits;
+   size_t i;
+   int iStatus;
+
+   (void) pvIgnored;
+
+   for(i = 0; i < SLOW_WALKS; i++) {
+      ulVisits = 0;
+      iStatus = FT_walkIn(oFT, Client_slowVisit, &ulVisits,
+                          FT_WALK_PREORDER | FT_WALK_POSTORDER);
+      assert(iStatus == SUCCESS);
+      assert(ulVisits >= 2);
+      (void) iStatus;
+   }
+   return NULL;
+}
+
+/* The number of snapshots each snapshotter takes of the concurrent
+   FT while its writers change it */
+enum { SNAPSHOTS = 40 };
+
+/* Checks that oFTSnapshot, a snapshot, holds only what the writers
+   inserted and reads the same each time. */
+static void Client_checkSnapshot(FT_T oFTSnapshot) {
+   char *pcBefore;
+   char *pcAfter;
+   void *pvContents;
+   size_t ulVisits = 0;
+   size_t ulWriter;
+   size_t i;
+   int iStatus;
+
+   pcBefore = FT_toStringIn(oFTSnapshot);
+   assert(pcBefore != NULL);
+   iStatus = FT_walkIn(oFTSnapshot, Client_countVisit, &ulVisits,
+                       FT_WALK_PREORDER);
+   assert(iStatus == SUCCESS);
+   (void) iStatus;
+   for(ulWriter = 0; ulWriter < WRITERS; ulWriter++)
+      for(i = 0; i < SUBTREE_DIRS * SUBTREE_FILES; i++) {
+         pvContents = FT_getFileContentsIn(oFTSnapshot,
+                                           apcFiles[ulWriter][i]);
+         assert(pvContents == NULL
+                || pvContents == apcFiles[ulWriter][i]);
+         (void) pvContents;
+      }
+   pcAfter = FT_toStringIn(oFTSnapshot);
+   assert(pcAfter != NULL);
+   assert(strcmp(pcBefore, pcAfter) == 0);
+   free(pcBefore);
+   free(pcAfter);
+}
+
+/* Takes SNAPSHOTS snapshots of the concurrent FT while its writers
+   change it, checking each, and frees each after taking the next, so
+   that frees of one snapshot overlap reads of the others. Returns
+   NULL. */
+static void *Client_snapshot(void *pvIgnored) {
+   FT_T oFTPrevious = NULL;
+   FT_T oFTSnapshot;
+   size_t i;
+
+   (void) pvIgnored;
+
+   for(i = 0; i < SNAPSHOTS; i++) {
+      oFTSnapshot = FT_snapshotIn(oFT);
+      assert(oFTSnapshot != NULL);
+      Client_checkSnapshot(oFTSnapshot);
+      if(oFTPrevious != NULL)
+         FT_free(oFTPrevious);
+      oFTPrevious = oFTSnapshot;
+   }
+   FT_free(oFTPrevious);
+   return NULL;
+}
+
+/* Checks the snapshot pvSnapshot of an FT that another thread is
+   changing, then frees it. Returns NULL. */
+static void *Client_readSnapshot(void *pvSnapshot) {
+   FT_T oFTSnapshot = pvSnapshot;
+
+   Client_checkSnapshot(oFTSnapshot);
+   FT_free(oFTSnapshot);
+   return NULL;
+}
+
+/* Stresses a concurrent FT: WRITERS threads each build a subtree of
+   529 nodes, replace its files' contents and remove it whole with
+   FT_rmDirIn, ROUNDS times over, while READERS threads look up and
+   walk the nodes being replaced and removed, and another walks them
+   slowly.
+   Built with ThreadSanitizer, any read of freed or changing memory is
+   reported. Checks that readers find only what was inserted and that
+   the FT is left with its root alone. Then has the WRITERS threads
+   build and remove the same subtrees at once, and then do as they
+   did first in FTs of their own, which share only the atom table.
+   Then has them do as they did first again while other threads take
+   snapshots of the FT, and has a single thread change an FT that is
+   not concurrent while other threads read and free its snapshots.
+   Prints the results to stderr. Returns 0. */
+int main(void) {
+   pthread_t aWriterThreads[WRITERS];
+   pthread_t aReaderThreads[READERS];
+   pthread_t aSnapshotThreads[ROUNDS];
+   pthread_t sSlowThread;
+   FT_T oFTSnapshot;
+   size_t aulWriters[WRITERS];
+   unsigned long aulSeeds[READERS];
+   unsigned long ulHits = 0;
+   char *pcString;
+   size_t ulWriter;
+   size_t i;
+
+   for(ulWriter = 0; ulWriter < WRITERS; ulWriter++) {
+      apcSubtrees[ulWriter] = Client_path("root/big%lu", ulWriter, 0,
+                                          0);
+      for(i = 0; i < SUBTREE_DIRS; i++)
+         apcDirs[ulWriter][i] = Client_path("root/big%lu/dir%02lu",
+                                            ulWriter, i, 0);
+      for(i = 0; i < SUBTREE_DIRS * SUBTREE_FILES; i++)
+         apcFiles[ulWriter][i] =
+            Client_path("root/big%lu/dir%02lu/file%02lu", ulWriter,
+                        i / SUBTREE_FILES, i % SUBTREE_FILES);
+   }
+
+   oFT = FT_newConcurrent();
+   assert(oFT != NULL);
+   assert(FT_insertDirIn(oFT, "root") == SUCCESS);
+
+   for(i = 0; i < READERS; i++) {
+      aulSeeds[i] = 217 + i;
+      assert(pthread_create(&aReaderThreads[i], NULL, Client_read,
+                            &aulSeeds[i]) == 0);
+   }
+   assert(pthread_create(&sSlowThread, NULL, Client_walkSlowly, NULL)
+          == 0);
+   for(ulWriter = 0; ulWriter < WRITERS; ulWriter++) {
+      aulWriters[ulWriter] = ulWriter;
+      assert(pthread_create(&aWriterThreads[ulWriter], NULL,
+                            Client_write, &aulWriters[ulWriter]) == 0);
+   }
+   for(ulWriter = 0; ulWriter < WRITERS; ulWriter++)
+      assert(pthread_join(aWriterThreads[ulWriter], NULL) == 0);
+   assert(pthread_join(sSlowThread, NULL) == 0);
+   for(i = 0; i < READERS; i++) {
+      assert(pthread_join(aReaderThreads[i], NULL) == 0);
+      ulHits += aulSeeds[i];
+   }
+
+   fprintf(stderr, "%lu subtrees of %lu nodes removed, "
+           "%lu lookups, %lu hits\n",
+           (unsigned long) (WRITERS * ROUNDS),
+           (unsigned long) (1 + SUBTREE_DIRS * (1 + SUBTREE_FILES)),
+           (unsigned long) (READERS * LOOKUPS), ulHits);
+
+   pcString = FT_toStringIn(oFT);
+   assert(pcString != NULL);
+   assert(strcmp(pcString, "root\n") == 0);
+   free(pcString);
+
+   for(ulWriter = 0; ulWriter < WRITERS; ulWriter++)
+      assert(pthread_create(&aWriterThreads[ulWriter], NULL,
+                            Client_contend, &aulWriters[ulWriter])
+             == 0);
+   for(ulWriter = 0; ulWriter < WRITERS; ulWriter++)
+      assert(pthread_join(aWriterThreads[ulWriter], NULL) == 0);
+   for(ulWriter = 0; ulWriter < WRITERS; ulWriter++)
+      (void) FT_rmDirIn(oFT, apcSubtrees[ulWriter]);
+   pcString = FT_toStringIn(oFT);
+   assert(pcString != NULL);
+   assert(strcmp(pcString, "root\n") == 0);
+   free(pcString);
+   assert(FT_rmDirIn(oFT, "root") == SUCCESS);
+   FT_free(oFT);
+   fprintf(stderr, "%lu writers changed the same directories at "
+           "once\n", (unsigned long) WRITERS);
+
+   for(ulWriter = 0; ulWriter < WRITERS; ulWriter++)
+      assert(pthread_create(&aWriterThreads[ulWriter], NULL,
+                            Client_writeOwn, &aulWriters[ulWriter])
+             == 0);
+   for(ulWriter = 0; ulWriter < WRITERS; ulWriter++)
+      assert(pthread_join(aWriterThreads[ulWriter], NULL) == 0);
+   fprintf(stderr, "%lu separate FTs changed at once\n",
+           (unsigned long) WRITERS);
+
+   oFT = FT_newConcurrent();
+   assert(oFT != NULL);
+   assert(FT_insertDirIn(oFT, "root") == SUCCESS);
+   for(i = 0; i < READERS; i++)
+      assert(pthread_create(&aReaderThreads[i], NULL, Client_snapshot,
+                            NULL) == 0);
+   for(ulWriter = 0; ulWriter < WRITERS; ulWriter++)
+      assert(pthread_create(&aWriterThreads[ulWriter], NULL,
+                            Client_write, &aulWriters[ulWriter]) == 0);
+   for(ulWriter = 0; ulWriter < WRITERS; ulWriter++)
+      assert(pthread_join(aWriterThreads[ulWriter], NULL) == 0);
+   for(i = 0; i < READERS; i++)
+      assert(pthread_join(aReaderThreads[i], NULL) == 0);
+   FT_free(oFT);
+   fprintf(stderr, "%lu snapshots taken while %lu writers changed "
+           "the FT\n", (unsigned long) (READERS * SNAPSHOTS),
+           (unsigned long) WRITERS);
+
+   oFT = FT_new();
+   assert(oFT != NULL);
+   assert(FT_insertDirIn(oFT, "root") == SUCCESS);
+   for(i = 0; i < ROUNDS; i++) {
+      ulWriter = i % WRITERS;
+      assert(FT_insertFileIn(oFT, apcFiles[ulWriter][i],
+                             apcFiles[ulWriter][i],
+                             strlen(apcFiles[ulWriter][i]))
+             == SUCCESS);
+      oFTSnapshot = FT_snapshotIn(oFT);
+      assert(oFTSnapshot != NULL);
+      assert(pthread_create(&aSnapshotThreads[i], NULL,
+                            Client_readSnapshot, oFTSnapshot) == 0);
+      assert(FT_replaceFileContentsIn(oFT, apcFiles[ulWriter][i],
+                                      apcFiles[ulWriter][i],
+                                      strlen(apcFiles[ulWriter][i]))
+             == apcFiles[ulWriter][i]);
+      if(i % 2 == 1)
+         assert(FT_rmDirIn(oFT, apcDirs[ulWriter][0]) == SUCCESS);
+   }
+   FT_free(oFT);
+   for(i = 0; i < ROUNDS; i++)
+      assert(pthread_join(aSnapshotThreads[i], NULL) == 0);
+   fprintf(stderr, "%lu snapshots read and freed on other threads\n",
+           (unsigned long) ROUNDS);
+
+   for(ulWriter = 0; ulWriter < WRITERS; ulWriter++) {
+      free(apcSubtrees[ulWriter]);
+      for(i = 0; i < SUBTREE_DIRS; i++)
+         free(apcDirs[ulWriter][i]);
+      for(i = 0; i < SUBTREE_DIRS * SUBTREE_FILES; i++)
+         free(apcFiles[ulWriter][i]);
+   }
+   return 0;
+}
@@ -0,0 +1,139 @@
+/*--------------------------------------------------------------------*/
+/* ft_client_trees.c                                                  */
+/* Author: Jacob Santelli and Joshua Yang                             */
+/*--------------------------------------------------------------------*/
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "ft.h"
+#include "ftslab.h"
+
+/* Tests that FT_T objects are trees of their own: what is done to one
+   is not seen in another, or in the default FT. */
+static void Client_separateTrees(void) {
+   FT_T oFT1, oFT2;
+   char *temp, *temp2;
+   boolean bIsFile;
+   size_t l;
+
+   assert((oFT1 = FT_new()) != NULL);
+   assert((oFT2 = FT_new()) != NULL);
+   assert(FT_insertDirIn(oFT1, "1root/2child") == SUCCESS);
+   assert(FT_insertFileIn(oFT1, "1root/2file", "one",
+                          strlen("one")+1) == SUCCESS);
+   assert(FT_insertDirIn(oFT2, "1root/2child") == SUCCESS);
+   assert(FT_insertDirIn(oFT2, "1other") == CONFLICTING_PATH);
+   assert(FT_containsFileIn(oFT2, "1root/2file") == FALSE);
+   assert(FT_containsDir("1root/2child") == FALSE);
+   assert(FT_insertFileIn(oFT2, "1root/2file", "two",
+                          strlen("two")+1) == SUCCESS);
+   assert(!strcmp(FT_getFileContentsIn(oFT1, "1root/2file"), "one"));
+   assert(!strcmp(FT_getFileContentsIn(oFT2, "1root/2file"), "two"));
+   assert(FT_statIn(oFT1, "1root/2file", &bIsFile, &l) == SUCCESS);
+   assert(bIsFile == TRUE && l == strlen("one")+1);
+   assert(FT_setPathIndexIn(oFT2, TRUE) == SUCCESS);
+   assert(FT_rmDirIn(oFT2, "1root/2child") == SUCCESS);
+   assert(FT_containsDirIn(oFT2, "1root/2child") == FALSE);
+   assert(FT_containsDirIn(oFT1, "1root/2child") == TRUE);
+   assert((temp = FT_toStringIn(oFT1)) != NULL);
+   assert(!strcmp(temp, "1root\n1root/2file\n1root/2child\n"));
+   assert((temp2 = FT_toStringIn(oFT2)) != NULL);
+   assert(!strcmp(temp2, "1root\n1root/2file\n"));
+   free(temp);
+   free(temp2);
+   FT_free(oFT1);
+   assert(FT_containsFileIn(oFT2, "1root/2file") == TRUE);
+   FT_free(oFT2);
+}
+
+/* Tests that each FT_T object has a child index threshold of its own:
+   the FT that indexes every directory finds the same nodes as the one
+   that indexes none, but uses more of its slab. */
+static void Client_indexThresholds(void) {
+   FT_T oFT1, oFT2;
+   struct SlabStats sStats1, sStats2;
+   char acPath[32];
+   int i;
+
+   assert((oFT1 = FT_new()) != NULL);
+   assert((oFT2 = FT_new()) != NULL);
+   FT_setIndexThresholdIn(oFT1, 0);
+   FT_setIndexThresholdIn(oFT2, (size_t) -1);
+   for(i = 0; i < 200; i++) {
+      sprintf(acPath, "1root/2child%03d", i);
+      assert(FT_insertDirIn(oFT1, acPath) == SUCCESS);
+      assert(FT_insertDirIn(oFT2, acPath) == SUCCESS);
+   }
+   for(i = 0; i < 200; i += 7) {
+      sprintf(acPath, "1root/2child%03d", i);
+      assert(FT_containsDirIn(oFT1, acPath) == TRUE);
+      assert(FT_containsDirIn(oFT2, acPath) == TRUE);
+   }
+   assert(FT_containsDirIn(oFT1, "1root/2child200") == FALSE);
+   FT_getSlabStatsIn(oFT1, &sStats1);
+   FT_getSlabStatsIn(oFT2, &sStats2);
+   assert(sStats1.ulBlockBytes + sStats1.ulLargeBytes
+          > sStats2.ulBlockBytes + sStats2.ulLargeBytes);
+   FT_free(oFT1);
+   FT_free(oFT2);
+}
+
+/* Tests that a concurrent FT behaves the same to a single thread,
+   that enabling its path index, which it does not keep, changes
+   nothing, and that a snapshot of it keeps what it held. */
+static void Client_concurrentTree(void) {
+   FT_T oFT;
+   FT_T oFTSnapshot;
+   char *temp;
+
+   assert((oFT = FT_newConcurrent()) != NULL);
+   assert(FT_insertFileIn(oFT, "1root/2file", NULL, 0)
+          == CONFLICTING_PATH);
+   assert(FT_insertDirIn(oFT, "1root/2child/3gkid") == SUCCESS);
+   assert(FT_insertFileIn(oFT, "1root/2child/3file", "one",
+                          strlen("one")+1) == SUCCESS);
+   assert(FT_containsDirIn(oFT, "1root/2child/3gkid") == TRUE);
+   assert(FT_containsFileIn(oFT, "1root/2child/3file") == TRUE);
+   assert(FT_containsFileIn(oFT, "1root/2child/3file/4x") == FALSE);
+   assert(!strcmp(FT_replaceFileContentsIn(oFT, "1root/2child/3file",
+                                           "two", strlen("two")+1),
+                  "one"));
+   assert(FT_setPathIndexIn(oFT, TRUE) == SUCCESS);
+   assert(!strcmp(FT_getFileContentsIn(oFT, "1root/2child/3file"),
+                  "two"));
+   assert(FT_rmDirIn(oFT, "1root/2child/3gkid") == SUCCESS);
+   assert(FT_setPathIndexIn(oFT, FALSE) == SUCCESS);
+   assert(FT_containsDirIn(oFT, "1root/2child/3gkid") == FALSE);
+   assert((temp = FT_toStringIn(oFT)) != NULL);
+   assert(!strcmp(temp, "1root\n1root/2child\n1root/2child/3file\n"));
+   free(temp);
+   assert(FT_rmDirIn(oFT, "1root") == SUCCESS);
+   assert(FT_containsDirIn(oFT, "1root") == FALSE);
+   assert(FT_insertDirIn(oFT, "1other/2dir") == SUCCESS);
+   assert((oFTSnapshot = FT_snapshotIn(oFT)) != NULL);
+   assert(FT_insertFileIn(oFT, "1other/2dir/3file", "one",
+                          strlen("one")+1) == SUCCESS);
+   assert(FT_insertFileIn(oFTSnapshot, "1other/2file", NULL, 0)
+          == READ_ONLY);
+   assert(FT_rmDirIn(oFT, "1other") == SUCCESS);
+   assert((temp = FT_toStringIn(oFTSnapshot)) != NULL);
+   assert(!strcmp(temp, "1other\n1other/2dir\n"));
+   free(temp);
+   FT_free(oFT);
+   assert(FT_containsDirIn(oFTSnapshot, "1other/2dir") == TRUE);
+   FT_free(oFTSnapshot);
+}
+
+/* Tests the FT_T objects of FT_new and FT_newConcurrent, which the
+   sample implementation that ft_client.c is also linked with does not
+   have. Returns 0. */
+int main(void) {
+   Client_separateTrees();
+   Client_indexThresholds();
+   Client_concurrentTree();
+   fprintf(stderr, "separate and concurrent trees passed\n");
+   return 0;
+}
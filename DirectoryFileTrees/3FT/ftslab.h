@@ -0,0 +1,32 @@
+/*--------------------------------------------------------------------*/
+/* ftslab.h                                                           */
+/* Author: Jacob Santelli and Joshua Yang                             */
+/*--------------------------------------------------------------------*/
+
+#ifndef FTSLAB_INCLUDED
+#define FTSLAB_INCLUDED
+
+/*
+  The statistics of the slab an FT's nodes are allocated from (see
+  slab.h), for the benchmarks and tests that measure its memory use.
+  They are not part of the FT interface of ft.h, which a client can
+  use without knowing how an FT allocates.
+*/
+
+#include "ft.h"
+#include "slab.h"
+
+/*
+  Fills *psStats with the statistics of the slab that the default
+  FT's nodes, path index and child indexes are allocated from, from
+  which its memory occupancy and fragmentation can be computed. An FT
+  and its snapshots share one slab, so show the same statistics.
+  Returns INITIALIZATION_ERROR if not already initialized,
+  and SUCCESS otherwise.
+*/
+int FT_getSlabStats(struct SlabStats *psStats);
+
+/* FT_getSlabStats on oFT, which cannot fail. */
+void FT_getSlabStatsIn(FT_T oFT, struct SlabStats *psStats);
+
+#endif
@@ -0,0 +1,823 @@
+/*--------------------------------------------------------------------*/
+/* image.c                                                            */
+/* Author: Jacob Santelli and Joshua Yang                             */
+/*--------------------------------------------------------------------*/
+
+/* for mmap */
+#define _POSIX_C_SOURCE 200112L
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "atom.h"
+#include "ft.h"
+#include "image.h"
+#include "path.h"
+
+/* The number of bytes an image starts with to name its format */
+enum { IMAGE_MAGIC_SIZE = 8 };
+/* The version of the format, which an image must have to be opened */
+enum { IMAGE_VERSION = 1 };
+
+/* The offsets of the header's fields after the magic bytes: the
+   version, the number of nodes, and the size of the whole image; and
+   the size of the header, after which the root's record lies */
+enum { HEADER_VERSION = 8, HEADER_COUNT = 12, HEADER_SIZE = 16,
+       IMAGE_HEADER_SIZE = 20 };
+
+/* The offsets of a record's fields: where its name lies and its
+   length, its flags, and then for a directory where its children's
+   records start and their number, or for a file where its contents
+   lie and their length; and the size of a record */
+enum { RECORD_NAME = 0, RECORD_NAME_LENGTH = 4, RECORD_FLAGS = 8,
+       RECORD_FIRST = 12, RECORD_COUNT = 16, RECORD_SIZE = 20 };
+
+/* The flags of a record: a file, and a file with NULL contents */
+enum { FLAG_FILE = 1, FLAG_NO_CONTENTS = 2 };
+
+/* The alignment of each file's contents from the start of the image,
+   which is mapped at a page boundary */
+enum { CONTENTS_ALIGNMENT = 16 };
+
+/* The size of the buffer names and contents are written through */
+enum { WRITE_BUFFER_SIZE = 65536 };
+
+/* The largest number a field holds, so the largest image */
+#define IMAGE_MAX 0xFFFFFFFFUL
+
+/* The bytes an image starts with */
+static const char acMagic[IMAGE_MAGIC_SIZE] =
+   { 'F', 'T', 'i', 'm', 'a', 'g', 'e', '\n' };
+
+/* Zeros to pad contents to their alignment with */
+static const char acPadding[CONTENTS_ALIGNMENT];
+
+/* An image mapped into memory */
+struct image {
+   /* the image's bytes */
+   const unsigned char *pucBytes;
+   /* the number of bytes */
+   size_t ulSize;
+   /* the number of nodes */
+   size_t ulCount;
+   /* the offset just past the last record */
+   size_t ulRecordsEnd;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* Returns the number stored in the 4 bytes at pucField, least
+   significant first. */
+static unsigned long Image_get(const unsigned char *pucField) {
+   assert(pucField != NULL);
+
+   return (unsigned long) pucField[0]
+      | (unsigned long) pucField[1] << 8
+      | (unsigned long) pucField[2] << 16
+      | (unsigned long) pucField[3] << 24;
+}
+
+/* Stores the low 32 bits of ulValue in the 4 bytes at pucField,
+   least significant first. */
+static void Image_put(unsigned char *pucField, size_t ulValue) {
+   assert(pucField != NULL);
+
+   pucField[0] = (unsigned char) (ulValue & 0xFF);
+   pucField[1] = (unsigned char) (ulValue >> 8 & 0xFF);
+   pucField[2] = (unsigned char) (ulValue >> 16 & 0xFF);
+   pucField[3] = (unsigned char) (ulValue >> 24 & 0xFF);
+}
+
+/* Returns field ulField of the record at offset ulRecord of
+   oIImage. */
+static size_t Image_field(Image_T oIImage, size_t ulRecord,
+                          size_t ulField) {
+   assert(oIImage != NULL);
+   assert(ulRecord + RECORD_SIZE <= oIImage->ulRecordsEnd);
+
+   return (size_t) Image_get(oIImage->pucBytes + ulRecord + ulField);
+}
+
+/* Returns ulOffset rounded up to a multiple of CONTENTS_ALIGNMENT. */
+static size_t Image_align(size_t ulOffset) {
+   return (ulOffset + CONTENTS_ALIGNMENT - 1)
+      / CONTENTS_ALIGNMENT * CONTENTS_ALIGNMENT;
+}
+
+/* Returns TRUE if the ulLength bytes at offset ulOffset lie within
+   the ulSize bytes of an image, or FALSE if not. */
+static boolean Image_fits(size_t ulOffset, size_t ulLength,
+                          size_t ulSize) {
+   return (boolean) (ulLength <= ulSize
+                     && ulOffset <= ulSize - ulLength);
+}
+
+/*
+  Returns TRUE if the record at offset ulRecord of oIImage, which
+  must be one of its records, points only within the image: at a name
+  and any contents in it, or at children's records that follow its
+  own, so that descending through the records always ends. Returns
+  FALSE if not.
+*/
+static boolean Image_isValid(Image_T oIImage, size_t ulRecord) {
+   size_t ulFirst;
+   size_t ulCount;
+   size_t ulFlags;
+
+   assert(oIImage != NULL);
+
+   if(!Image_fits(Image_field(oIImage, ulRecord, RECORD_NAME),
+                  Image_field(oIImage, ulRecord, RECORD_NAME_LENGTH),
+                  oIImage->ulSize))
+      return FALSE;
+
+   ulFlags = Image_field(oIImage, ulRecord, RECORD_FLAGS);
+   ulFirst = Image_field(oIImage, ulRecord, RECORD_FIRST);
+   ulCount = Image_field(oIImage, ulRecord, RECORD_COUNT);
+   if(ulFlags & FLAG_FILE)
+      return (boolean) ((ulFlags & FLAG_NO_CONTENTS)
+                        || Image_fits(ulFirst, ulCount,
+                                      oIImage->ulSize));
+   if(ulCount == 0)
+      return TRUE;
+   return (boolean) (ulFirst > ulRecord
+                     && ulFirst <= oIImage->ulRecordsEnd
+                     && (ulFirst - IMAGE_HEADER_SIZE) % RECORD_SIZE
+                        == 0
+                     && ulCount <= (oIImage->ulRecordsEnd - ulFirst)
+                                   / RECORD_SIZE);
+}
+
+/* Returns the name of the record at offset ulRecord of oIImage, which
+   must be valid, and stores its length in *pulLength. */
+static const char *Image_getName(Image_T oIImage, size_t ulRecord,
+                                 size_t *pulLength) {
+   assert(oIImage != NULL);
+   assert(pulLength != NULL);
+
+   *pulLength = Image_field(oIImage, ulRecord, RECORD_NAME_LENGTH);
+   return (const char *) oIImage->pucBytes
+      + Image_field(oIImage, ulRecord, RECORD_NAME);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* The state of a call to Image_write */
+struct writer {
+   /* the records, put together here before they are written */
+   unsigned char *pucRecords;
+   /* the number of records given a place so far */
+   size_t ulPlaced;
+   /* for each depth, the place of the next child of the directory
+      being walked at that depth */
+   size_t *pulNext;
+   /* the number of depths pulNext has room for */
+   size_t ulDepths;
+   /* the bytes of names so far */
+   size_t ulNameBytes;
+   /* the bytes of contents so far, with their alignment */
+   size_t ulContentBytes;
+   /* the file descriptor the image is written to */
+   int iFd;
+   /* the buffer names and contents are written through */
+   char *pcBuffer;
+   /* the number of bytes in pcBuffer */
+   size_t ulBuffered;
+};
+
+/*
+  Writes the ulLength bytes at pvData to iFd, retrying partial and
+  interrupted writes. Returns SUCCESS, or WRITE_ERROR if write fails.
+*/
+static int Image_writeAll(int iFd, const void *pvData,
+                          size_t ulLength) {
+   const char *pcData = pvData;
+   ssize_t lWritten;
+
+   assert(pvData != NULL || ulLength == 0);
+
+   while(ulLength != 0) {
+      lWritten = write(iFd, pcData, ulLength);
+      if(lWritten < 0) {
+         if(errno == EINTR)
+            continue;
+         return WRITE_ERROR;
+      }
+      pcData += lWritten;
+      ulLength -= (size_t) lWritten;
+   }
+   return SUCCESS;
+}
+
+/*
+  Writes the ulLength bytes at pvData through psWriter's buffer,
+  writing the buffer out when they do not fit, and writing them
+  directly if they are no smaller than it. Returns SUCCESS, or
+  WRITE_ERROR if write fails.
+*/
+static int Image_buffer(struct writer *psWriter, const void *pvData,
+                        size_t ulLength) {
+   int iStatus;
+
+   assert(psWriter != NULL);
+
+   if(psWriter->ulBuffered + ulLength > WRITE_BUFFER_SIZE) {
+      iStatus = Image_writeAll(psWriter->iFd, psWriter->pcBuffer,
+                               psWriter->ulBuffered);
+      psWriter->ulBuffered = 0;
+      if(iStatus != SUCCESS)
+         return iStatus;
+   }
+   if(ulLength >= WRITE_BUFFER_SIZE)
+      return Image_writeAll(psWriter->iFd, pvData, ulLength);
+   memcpy(psWriter->pcBuffer + psWriter->ulBuffered, pvData, ulLength);
+   psWriter->ulBuffered += ulLength;
+   return SUCCESS;
+}
+
+/*
+  Node_walk visitor that gives oNNode the next place among the
+  records of psWriter, which pvWriter points to: its parent's next
+  child's place, so that each directory's children lie together in
+  the order of their names. Fills its record, with its name's and
+  contents' offsets from the starts of the names and the contents,
+  and a directory's children's places. Returns SUCCESS, or
+  MEMORY_ERROR if psWriter's stack of depths could not be grown.
+*/
+static int Image_placeNode(Node_T oNNode, int iOrder, void *pvWriter) {
+   struct writer *psWriter = pvWriter;
+   unsigned char *pucRecord;
+   size_t ulDepth;
+   size_t ulDepths;
+   size_t *pulNext;
+   size_t ulPlace;
+   void *pvContents;
+
+   assert(oNNode != NULL);
+   assert(psWriter != NULL);
+   (void) iOrder;
+
+   ulDepth = Node_getDepth(oNNode);
+   if(ulDepth > psWriter->ulDepths) {
+      ulDepths = 2 * psWriter->ulDepths;
+      if(ulDepths < ulDepth)
+         ulDepths = ulDepth;
+      pulNext = realloc(psWriter->pulNext, ulDepths * sizeof(size_t));
+      if(pulNext == NULL)
+         return MEMORY_ERROR;
+      psWriter->pulNext = pulNext;
+      psWriter->ulDepths = ulDepths;
+   }
+
+   /* the root comes first, and each other node where its parent's
+      children were placed */
+   ulPlace = ulDepth == 1 ? 0 : psWriter->pulNext[ulDepth - 2]++;
+   pucRecord = psWriter->pucRecords + ulPlace * RECORD_SIZE;
+
+   Image_put(pucRecord + RECORD_NAME, psWriter->ulNameBytes);
+   Image_put(pucRecord + RECORD_NAME_LENGTH,
+             Atom_getLength(Node_getName(oNNode)));
+   psWriter->ulNameBytes += Atom_getLength(Node_getName(oNNode));
+
+   if(Node_getState(oNNode) == A_FILE) {
+      pvContents = Node_getFile(oNNode);
+      Image_put(pucRecord + RECORD_FLAGS,
+                pvContents == NULL ? FLAG_FILE | FLAG_NO_CONTENTS
+                                   : FLAG_FILE);
+      Image_put(pucRecord + RECORD_COUNT, Node_getFileLength(oNNode));
+      if(Node_getFileLength(oNNode) > IMAGE_MAX) {
+         errno = EFBIG;
+         return WRITE_ERROR;
+      }
+      if(pvContents != NULL) {
+         psWriter->ulContentBytes =
+            Image_align(psWriter->ulContentBytes);
+         Image_put(pucRecord + RECORD_FIRST, psWriter->ulContentBytes);
+         psWriter->ulContentBytes += Node_getFileLength(oNNode);
+      }
+      else
+         Image_put(pucRecord + RECORD_FIRST, 0);
+   }
+   else {
+      Image_put(pucRecord + RECORD_FLAGS, 0);
+      Image_put(pucRecord + RECORD_FIRST, IMAGE_HEADER_SIZE
+                + psWriter->ulPlaced * RECORD_SIZE);
+      Image_put(pucRecord + RECORD_COUNT, Node_getNumChildren(oNNode));
+      psWriter->pulNext[ulDepth - 1] = psWriter->ulPlaced;
+      psWriter->ulPlaced += Node_getNumChildren(oNNode);
+   }
+   return SUCCESS;
+}
+
+/* Node_walk visitor that writes oNNode's name through the buffer of
+   psWriter, which pvWriter points to. Returns as Image_buffer. */
+static int Image_writeName(Node_T oNNode, int iOrder, void *pvWriter) {
+   assert(oNNode != NULL);
+   assert(pvWriter != NULL);
+   (void) iOrder;
+
+   return Image_buffer(pvWriter, Node_getName(oNNode),
+                       Atom_getLength(Node_getName(oNNode)));
+}
+
+/*
+  Node_walk visitor that writes the contents of oNNode, if it is a
+  file with contents, through the buffer of psWriter, which pvWriter
+  points to, after the zeros that align them. Returns as
+  Image_buffer.
+*/
+static int Image_writeContents(Node_T oNNode, int iOrder,
+                               void *pvWriter) {
+   struct writer *psWriter = pvWriter;
+   size_t ulAligned;
+   int iStatus;
+
+   assert(oNNode != NULL);
+   assert(psWriter != NULL);
+   (void) iOrder;
+
+   if(Node_getState(oNNode) != A_FILE || Node_getFile(oNNode) == NULL)
+      return SUCCESS;
+
+   ulAligned = Image_align(psWriter->ulContentBytes);
+   iStatus = Image_buffer(psWriter, acPadding,
+                          ulAligned - psWriter->ulContentBytes);
+   if(iStatus != SUCCESS)
+      return iStatus;
+   psWriter->ulContentBytes = ulAligned + Node_getFileLength(oNNode);
+   return Image_buffer(psWriter, Node_getFile(oNNode),
+                       Node_getFileLength(oNNode));
+}
+
+int Image_write(Node_T oNRoot, size_t ulCount, int iFd) {
+   struct writer sWriter;
+   unsigned char aucHeader[IMAGE_HEADER_SIZE];
+   unsigned char *pucRecord;
+   size_t ulNames, ulContents, ulSize;
+   size_t i;
+   int iStatus = SUCCESS;
+
+   assert(oNRoot != NULL || ulCount == 0);
+
+   sWriter.pucRecords = NULL;
+   sWriter.ulPlaced = 1;
+   sWriter.pulNext = NULL;
+   sWriter.ulDepths = 0;
+   sWriter.ulNameBytes = 0;
+   sWriter.ulContentBytes = 0;
+   sWriter.iFd = iFd;
+   sWriter.pcBuffer = NULL;
+   sWriter.ulBuffered = 0;
+
+   if(ulCount > (IMAGE_MAX - IMAGE_HEADER_SIZE) / RECORD_SIZE) {
+      errno = EFBIG;
+      return WRITE_ERROR;
+   }
+
+   /* place the records, with offsets from the starts of the names
+      and contents, then add the offsets of those starts */
+   if(ulCount != 0) {
+      sWriter.pucRecords = malloc(ulCount * RECORD_SIZE);
+      if(sWriter.pucRecords == NULL)
+         return MEMORY_ERROR;
+      iStatus = Node_walk(oNRoot, Image_placeNode, &sWriter,
+                          FT_WALK_PREORDER);
+      assert(iStatus != SUCCESS || sWriter.ulPlaced == ulCount);
+   }
+   ulNames = IMAGE_HEADER_SIZE + ulCount * RECORD_SIZE;
+   ulContents = Image_align(ulNames + sWriter.ulNameBytes);
+   ulSize = ulContents + sWriter.ulContentBytes;
+   /* the image of an empty tree is its header alone */
+   if(ulCount == 0)
+      ulSize = IMAGE_HEADER_SIZE;
+   if(iStatus == SUCCESS && ulSize > IMAGE_MAX) {
+      errno = EFBIG;
+      iStatus = WRITE_ERROR;
+   }
+   for(i = 0; iStatus == SUCCESS && i < ulCount; i++) {
+      pucRecord = sWriter.pucRecords + i * RECORD_SIZE;
+      Image_put(pucRecord + RECORD_NAME,
+                Image_get(pucRecord + RECORD_NAME) + ulNames);
+      if(Image_get(pucRecord + RECORD_FLAGS) == FLAG_FILE)
+         Image_put(pucRecord + RECORD_FIRST,
+                   Image_get(pucRecord + RECORD_FIRST) + ulContents);
+   }
+
+   memcpy(aucHeader, acMagic, IMAGE_MAGIC_SIZE);
+   Image_put(aucHeader + HEADER_VERSION, IMAGE_VERSION);
+   Image_put(aucHeader + HEADER_COUNT, ulCount);
+   Image_put(aucHeader + HEADER_SIZE, ulSize);
+   if(iStatus == SUCCESS)
+      iStatus = Image_writeAll(iFd, aucHeader, IMAGE_HEADER_SIZE);
+   if(iStatus == SUCCESS)
+      iStatus = Image_writeAll(iFd, sWriter.pucRecords,
+                               ulCount * RECORD_SIZE);
+   free(sWriter.pucRecords);
+   free(sWriter.pulNext);
+   if(iStatus != SUCCESS || ulCount == 0)
+      return iStatus;
+
+   /* then the names and contents, in the order they were placed */
+   sWriter.pcBuffer = malloc(WRITE_BUFFER_SIZE);
+   if(sWriter.pcBuffer == NULL)
+      return MEMORY_ERROR;
+   iStatus = Node_walk(oNRoot, Image_writeName, &sWriter,
+                       FT_WALK_PREORDER);
+   if(iStatus == SUCCESS)
+      iStatus = Image_buffer(&sWriter, acPadding,
+                             ulContents - ulNames
+                             - sWriter.ulNameBytes);
+   sWriter.ulContentBytes = 0;
+   if(iStatus == SUCCESS)
+      iStatus = Node_walk(oNRoot, Image_writeContents, &sWriter,
+                          FT_WALK_PREORDER);
+   if(iStatus == SUCCESS)
+      iStatus = Image_writeAll(iFd, sWriter.pcBuffer,
+                               sWriter.ulBuffered);
+   free(sWriter.pcBuffer);
+   return iStatus;
+}
+
+int Image_copy(Image_T oIImage, int iFd) {
+   assert(oIImage != NULL);
+
+   return Image_writeAll(iFd, oIImage->pucBytes, oIImage->ulSize);
+}
+
+/*--------------------------------------------------------------------*/
+
+int Image_open(const char *pcFilename, Image_T *poIResult) {
+   struct stat sStat;
+   Image_T oIImage;
+   const unsigned char *pucBytes;
+   void *pvMapped;
+   size_t ulSize;
+   size_t ulCount;
+   int iFd;
+   int iErrno;
+
+   assert(pcFilename != NULL);
+   assert(poIResult != NULL);
+
+   *poIResult = NULL;
+
+   iFd = open(pcFilename, O_RDONLY);
+   if(iFd < 0)
+      return READ_ERROR;
+   if(fstat(iFd, &sStat) != 0) {
+      iErrno = errno;
+      (void) close(iFd);
+      errno = iErrno;
+      return READ_ERROR;
+   }
+   if(sStat.st_size < IMAGE_HEADER_SIZE
+      || (unsigned long) sStat.st_size > IMAGE_MAX) {
+      (void) close(iFd);
+      return BAD_IMAGE;
+   }
+   ulSize = (size_t) sStat.st_size;
+
+   /* the mapping outlives the descriptor */
+   pvMapped = mmap(NULL, ulSize, PROT_READ, MAP_PRIVATE, iFd, 0);
+   iErrno = errno;
+   (void) close(iFd);
+   if(pvMapped == MAP_FAILED) {
+      errno = iErrno;
+      return READ_ERROR;
+   }
+   pucBytes = pvMapped;
+
+   ulCount = (size_t) Image_get(pucBytes + HEADER_COUNT);
+   if(memcmp(pucBytes, acMagic, IMAGE_MAGIC_SIZE) != 0
+      || Image_get(pucBytes + HEADER_VERSION) != IMAGE_VERSION
+      || Image_get(pucBytes + HEADER_SIZE) != ulSize
+      || ulCount > (ulSize - IMAGE_HEADER_SIZE) / RECORD_SIZE) {
+      (void) munmap(pvMapped, ulSize);
+      return BAD_IMAGE;
+   }
+
+   oIImage = malloc(sizeof(struct image));
+   if(oIImage == NULL) {
+      (void) munmap(pvMapped, ulSize);
+      return MEMORY_ERROR;
+   }
+   oIImage->pucBytes = pucBytes;
+   oIImage->ulSize = ulSize;
+   oIImage->ulCount = ulCount;
+   oIImage->ulRecordsEnd = IMAGE_HEADER_SIZE + ulCount * RECORD_SIZE;
+
+   *poIResult = oIImage;
+   return SUCCESS;
+}
+
+void Image_close(Image_T oIImage) {
+   assert(oIImage != NULL);
+
+   (void) munmap((void *) oIImage->pucBytes, oIImage->ulSize);
+   free(oIImage);
+}
+
+size_t Image_getCount(Image_T oIImage) {
+   assert(oIImage != NULL);
+
+   return oIImage->ulCount;
+}
+
+/*--------------------------------------------------------------------*/
+
+/*
+  Compares the ulLength characters at pcName with the ulKeyLength at
+  pcKey, neither '\0'-terminated, as Node_T siblings are ordered.
+  Returns <0, 0, or >0 if pcName is "less than", "equal to", or
+  "greater than" pcKey, respectively.
+*/
+static int Image_compareName(const char *pcName, size_t ulLength,
+                             const char *pcKey, size_t ulKeyLength) {
+   int iCompare;
+
+   assert(pcName != NULL);
+   assert(pcKey != NULL);
+
+   iCompare = memcmp(pcName, pcKey,
+                     ulLength < ulKeyLength ? ulLength : ulKeyLength);
+   if(iCompare != 0 || ulLength == ulKeyLength)
+      return iCompare;
+   return ulLength < ulKeyLength ? -1 : 1;
+}
+
+/*
+  Finds the child of ulDirectory, a valid record of oIImage, whose
+  name is the ulLength characters at pcName, by binary search. Returns
+  SUCCESS and stores the child's record in *pulRecord if it has such
+  a child, NO_SUCH_PATH if it does not or is a file, or BAD_IMAGE if
+  the child found is not valid.
+*/
+static int Image_findChild(Image_T oIImage, size_t ulDirectory,
+                           const char *pcName, size_t ulLength,
+                           size_t *pulRecord) {
+   size_t ulFirst;
+   size_t ulLow = 0;
+   size_t ulHigh;
+   size_t ulMid;
+   size_t ulChild;
+   const char *pcChild;
+   size_t ulChildLength;
+   int iCompare;
+
+   assert(oIImage != NULL);
+   assert(pcName != NULL);
+   assert(pulRecord != NULL);
+
+   if(Image_isFile(oIImage, ulDirectory))
+      return NO_SUCH_PATH;
+
+   ulFirst = Image_field(oIImage, ulDirectory, RECORD_FIRST);
+   ulHigh = Image_field(oIImage, ulDirectory, RECORD_COUNT);
+   while(ulLow < ulHigh) {
+      ulMid = ulLow + (ulHigh - ulLow) / 2;
+      ulChild = ulFirst + ulMid * RECORD_SIZE;
+      if(!Image_isValid(oIImage, ulChild))
+         return BAD_IMAGE;
+      pcChild = Image_getName(oIImage, ulChild, &ulChildLength);
+      iCompare = Image_compareName(pcChild, ulChildLength, pcName,
+                                   ulLength);
+      if(iCompare == 0) {
+         *pulRecord = ulChild;
+         return SUCCESS;
+      }
+      if(iCompare < 0)
+         ulLow = ulMid + 1;
+      else
+         ulHigh = ulMid;
+   }
+   return NO_SUCH_PATH;
+}
+
+int Image_find(Image_T oIImage, const char *pcPath,
+               size_t *pulRecord) {
+   const char *pcName;
+   const char *pcRootName;
+   size_t ulLength;
+   size_t ulRootLength;
+   size_t ulRecord = IMAGE_HEADER_SIZE;
+   int iStatus;
+
+   assert(oIImage != NULL);
+   assert(pcPath != NULL);
+   assert(pulRecord != NULL);
+
+   iStatus = Path_validate(pcPath);
+   if(iStatus != SUCCESS)
+      return iStatus;
+   if(oIImage->ulCount == 0)
+      return NO_SUCH_PATH;
+   if(!Image_isValid(oIImage, ulRecord))
+      return BAD_IMAGE;
+
+   /* the first component must name the root */
+   ulLength = strcspn(pcPath, "/");
+   pcRootName = Image_getName(oIImage, ulRecord, &ulRootLength);
+   if(ulLength != ulRootLength
+      || memcmp(pcRootName, pcPath, ulLength) != 0)
+      return CONFLICTING_PATH;
+
+   /* each later component must name a child of the node before */
+   pcName = pcPath + ulLength;
+   while(*pcName != '\0') {
+      pcName++;
+      ulLength = strcspn(pcName, "/");
+      iStatus = Image_findChild(oIImage, ulRecord, pcName, ulLength,
+                                &ulRecord);
+      if(iStatus != SUCCESS)
+         return iStatus;
+      pcName += ulLength;
+   }
+
+   *pulRecord = ulRecord;
+   return SUCCESS;
+}
+
+boolean Image_isFile(Image_T oIImage, size_t ulRecord) {
+   assert(oIImage != NULL);
+
+   return (boolean) ((Image_field(oIImage, ulRecord, RECORD_FLAGS)
+                      & FLAG_FILE) != 0);
+}
+
+void *Image_getContents(Image_T oIImage, size_t ulRecord) {
+   assert(oIImage != NULL);
+   assert(Image_isFile(oIImage, ulRecord));
+
+   if(Image_field(oIImage, ulRecord, RECORD_FLAGS) & FLAG_NO_CONTENTS)
+      return NULL;
+   return (void *) (oIImage->pucBytes
+                    + Image_field(oIImage, ulRecord, RECORD_FIRST));
+}
+
+size_t Image_getLength(Image_T oIImage, size_t ulRecord) {
+   assert(oIImage != NULL);
+   assert(Image_isFile(oIImage, ulRecord));
+
+   return Image_field(oIImage, ulRecord, RECORD_COUNT);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* A directory that Image_walk is below, and where the walk is among
+   its children */
+struct level {
+   /* the directory's record */
+   size_t ulRecord;
+   /* the position of the next child to go to, with the children
+      counted twice under FT_WALK_FILES_FIRST: the files the first
+      time, and the directories the second */
+   size_t ulNext;
+   /* the length of the directory's path */
+   size_t ulPathLength;
+};
+
+/*
+  Appends to the path that *ppcPath holds, of length *pulPathLength,
+  a '/' if it is not empty and the name of ulRecord, a record of
+  oIImage, growing the buffer, of *pulSize characters, as needed.
+  Returns SUCCESS, BAD_IMAGE if ulRecord is not valid, or
+  MEMORY_ERROR if the buffer could not be grown.
+*/
+static int Image_appendName(Image_T oIImage, size_t ulRecord,
+                            char **ppcPath, size_t *pulSize,
+                            size_t *pulPathLength) {
+   const char *pcName;
+   size_t ulLength;
+   size_t ulNeeded;
+   size_t ulSize;
+   char *pcPath;
+
+   assert(oIImage != NULL);
+   assert(ppcPath != NULL);
+   assert(pulSize != NULL);
+   assert(pulPathLength != NULL);
+
+   if(!Image_isValid(oIImage, ulRecord))
+      return BAD_IMAGE;
+   pcName = Image_getName(oIImage, ulRecord, &ulLength);
+
+   /* the '/', the name and the '\0' */
+   ulNeeded = *pulPathLength + ulLength + 2;
+   if(ulNeeded > *pulSize) {
+      ulSize = 2 * *pulSize;
+      if(ulSize < ulNeeded)
+         ulSize = ulNeeded;
+      pcPath = realloc(*ppcPath, ulSize);
+      if(pcPath == NULL)
+         return MEMORY_ERROR;
+      *ppcPath = pcPath;
+      *pulSize = ulSize;
+   }
+
+   if(*pulPathLength != 0)
+      (*ppcPath)[(*pulPathLength)++] = '/';
+   memcpy(*ppcPath + *pulPathLength, pcName, ulLength);
+   *pulPathLength += ulLength;
+   (*ppcPath)[*pulPathLength] = '\0';
+   return SUCCESS;
+}
+
+int Image_walk(Image_T oIImage,
+               int (*pfVisit)(Image_T oIImage, size_t ulRecord,
+                              const char *pcPath, int iOrder,
+                              void *pvContext),
+               void *pvContext, int iFlags) {
+   struct level *psLevels = NULL;
+   struct level *psLevel;
+   size_t ulLevels = 0;
+   size_t ulDepth = 0;
+   char *pcPath = NULL;
+   size_t ulSize = 0;
+   size_t ulPathLength = 0;
+   size_t ulRecord = IMAGE_HEADER_SIZE;
+   size_t ulChildren;
+   size_t ulChild;
+   boolean bFilesFirst;
+   boolean bFilePass;
+   int iStatus = SUCCESS;
+
+   assert(oIImage != NULL);
+   assert(pfVisit != NULL);
+
+   if(oIImage->ulCount == 0)
+      return SUCCESS;
+
+   bFilesFirst = (boolean) ((iFlags & FT_WALK_FILES_FIRST) != 0);
+   for(;;) {
+      /* visit ulRecord, below the directory on top of the stack */
+      iStatus = Image_appendName(oIImage, ulRecord, &pcPath, &ulSize,
+                                 &ulPathLength);
+      if(iStatus == SUCCESS && (iFlags & FT_WALK_PREORDER))
+         iStatus = (*pfVisit)(oIImage, ulRecord, pcPath,
+                              FT_WALK_PREORDER, pvContext);
+      if(iStatus == SUCCESS && !Image_isFile(oIImage, ulRecord)) {
+         if(ulDepth == ulLevels) {
+            ulLevels = ulLevels == 0 ? 16 : 2 * ulLevels;
+            psLevel = realloc(psLevels,
+                              ulLevels * sizeof(struct level));
+            if(psLevel == NULL)
+               iStatus = MEMORY_ERROR;
+            else
+               psLevels = psLevel;
+         }
+         if(iStatus == SUCCESS) {
+            psLevels[ulDepth].ulRecord = ulRecord;
+            psLevels[ulDepth].ulNext = 0;
+            psLevels[ulDepth].ulPathLength = ulPathLength;
+            ulDepth++;
+         }
+      }
+      else if(iStatus == SUCCESS && (iFlags & FT_WALK_POSTORDER))
+         iStatus = (*pfVisit)(oIImage, ulRecord, pcPath,
+                              FT_WALK_POSTORDER, pvContext);
+      if(iStatus != SUCCESS)
+         break;
+
+      /* find the next node, leaving the directories that have no
+         more children to go to */
+      ulRecord = 0;
+      while(ulRecord == 0 && ulDepth > 0) {
+         psLevel = &psLevels[ulDepth - 1];
+         ulChildren = Image_field(oIImage, psLevel->ulRecord,
+                                  RECORD_COUNT);
+         if(psLevel->ulNext == (bFilesFirst ? 2 : 1) * ulChildren) {
+            pcPath[psLevel->ulPathLength] = '\0';
+            if(iFlags & FT_WALK_POSTORDER)
+               iStatus = (*pfVisit)(oIImage, psLevel->ulRecord, pcPath,
+                                    FT_WALK_POSTORDER, pvContext);
+            ulDepth--;
+            if(iStatus != SUCCESS)
+               break;
+            continue;
+         }
+         ulChild = psLevel->ulNext++;
+         bFilePass = (boolean) (ulChild < ulChildren);
+         if(!bFilePass)
+            ulChild -= ulChildren;
+         ulChild = Image_field(oIImage, psLevel->ulRecord, RECORD_FIRST)
+            + ulChild * RECORD_SIZE;
+         if(bFilesFirst && Image_isFile(oIImage, ulChild) != bFilePass)
+            continue;
+         ulRecord = ulChild;
+         ulPathLength = psLevel->ulPathLength;
+      }
+      if(iStatus != SUCCESS || ulRecord == 0)
+         break;
+   }
+
+   free(psLevels);
+   free(pcPath);
+   return iStatus;
+}
@@ -0,0 +1,119 @@
+/*--------------------------------------------------------------------*/
+/* image.h                                                            */
+/* Author: Jacob Santelli and Joshua Yang                             */
+/*--------------------------------------------------------------------*/
+
+#ifndef IMAGE_INCLUDED
+#define IMAGE_INCLUDED
+
+#include <stddef.h>
+#include "a4def.h"
+#include "nodeFT.h"
+
+/*
+  An image is a File Tree written out as one block of bytes, to be
+  mapped into memory and read where it lies: it holds offsets from its
+  start rather than pointers, so it reads the same wherever it is
+  mapped, and no node of it is ever allocated. It starts with a
+  header, naming the format and its version, followed by a record for
+  each node: a directory's record gives where the records of its
+  children lie, one after another in the order of their names, so
+  they are binary-searched, and a file's where its contents lie. The
+  nodes' names follow the records, and the files' contents the names.
+  Every number is 4 bytes, least significant first, so an image is
+  the same on every machine, and it is at most 4 GB.
+
+  Opening an image reads only its header, so costs the same however
+  large it is; the pages of the rest are read as they are first
+  touched. A node of an open image is named by its record's offset
+  from the start of the image. The statuses READ_ERROR and BAD_IMAGE
+  are those of ft.h.
+*/
+typedef struct image *Image_T;
+
+/*
+  Writes an image of the subtree rooted at oNRoot, of ulCount nodes,
+  or of an empty tree if oNRoot is NULL, to the open file descriptor
+  iFd. The records are put together in memory, 20 bytes per node,
+  before they are written, and the names and contents are then
+  written from the nodes. Returns SUCCESS, MEMORY_ERROR if memory
+  could not be allocated, or WRITE_ERROR if writing to iFd failed,
+  with errno set by write, or if the image would be larger than 4 GB,
+  with errno set to EFBIG.
+*/
+int Image_write(Node_T oNRoot, size_t ulCount, int iFd);
+
+/*
+  Writes the bytes of oIImage, an image already, to the open file
+  descriptor iFd. Returns SUCCESS, or WRITE_ERROR if writing failed,
+  with errno set by write.
+*/
+int Image_copy(Image_T oIImage, int iFd);
+
+/*
+  Maps the image in the file named pcFilename into memory, read-only,
+  reading nothing of it but its header. Returns SUCCESS and sets
+  *poIResult to the image, or otherwise sets *poIResult to NULL and
+  returns:
+  * READ_ERROR if the file could not be opened or mapped, with errno
+                set by the call that failed
+  * BAD_IMAGE if the file is not an image of this version, or is not
+               the size its header gives
+  * MEMORY_ERROR if memory could not be allocated to complete request
+*/
+int Image_open(const char *pcFilename, Image_T *poIResult);
+
+/* Unmaps oIImage and frees it. */
+void Image_close(Image_T oIImage);
+
+/* Returns the number of nodes in oIImage. */
+size_t Image_getCount(Image_T oIImage);
+
+/*
+  Finds the node of oIImage with absolute path pcPath by descending
+  from the root, binary-searching the children at each level. Reads
+  only the records, names and pages on its way, and allocates no
+  memory. Returns SUCCESS and sets *pulRecord to the node, or
+  otherwise returns:
+  * BAD_PATH if pcPath does not represent a well-formatted path
+  * CONFLICTING_PATH if the root's path is not a prefix of pcPath
+  * NO_SUCH_PATH if no node with pcPath exists in the image
+  * BAD_IMAGE if a record on the way points outside the image
+*/
+int Image_find(Image_T oIImage, const char *pcPath,
+               size_t *pulRecord);
+
+/* Returns TRUE if ulRecord, a node of oIImage, is a file, or FALSE if
+   it is a directory. */
+boolean Image_isFile(Image_T oIImage, size_t ulRecord);
+
+/*
+  Returns the contents of ulRecord, a file of oIImage, which lie in
+  the image, so are read-only and valid until it is closed, or NULL if
+  the file was written with NULL contents.
+*/
+void *Image_getContents(Image_T oIImage, size_t ulRecord);
+
+/* Returns the length of the contents of ulRecord, a file of
+   oIImage. */
+size_t Image_getLength(Image_T oIImage, size_t ulRecord);
+
+/*
+  Walks oIImage depth-first as Node_walk does, calling
+  (*pfVisit)(oIImage, ulRecord, pcPath, iOrder, pvContext) for its
+  nodes as iFlags, a combination of the FT_WALK_ flags of ft.h, asks,
+  where pcPath is ulRecord's absolute path, valid only during the
+  call. pfVisit returns SUCCESS to go on or any other status to stop
+  the walk. Allocates only a buffer for the longest path and a stack
+  of the levels above the node it is at. Returns the first status
+  other than SUCCESS that pfVisit returned, MEMORY_ERROR if memory
+  could not be allocated, BAD_IMAGE if a record points outside the
+  image, or SUCCESS.
+*/
+int Image_walk(Image_T oIImage,
+               int (*pfVisit)(Image_T oIImage, size_t ulRecord,
+                              const char *pcPath, int iOrder,
+                              void *pvContext),
+               void *pvContext, int iFlags);
+
+#endif
@@ -3,234 +3,2755 @@
 /* Authors: Jacob Santelli and Joshua Yang                            */
 /*--------------------------------------------------------------------*/
 
+/* for the POSIX threads mutex */
+#define _POSIX_C_SOURCE 200112L
+
 #include <stdlib.h>
 #include <assert.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stddef.h>
 #include <string.h>
-#include "dynarray.h"
+#include "atom.h"
+#include "chunkarray.h"
+#include "epoch.h"
+#include "ft.h"
 #include "nodeFT.h"
+#include "sortedarray.h"
 
 /* A node in a FT */
 struct node {
-   /* the object corresponding to the node's absolute path */
-   Path_T oPPath;
-   /* this node's parent */
+   /* the last component of the node's absolute path, as an atom */
+   const char *pcName;
+   /* the number of components in the node's absolute path */
+   size_t ulDepth;
+   /* the string length of the node's absolute path */
+   size_t ulPathLength;
+   /* this node's parent: of the copies of the parent that hold the
+      node (see Node_copy), the oldest, published with EPOCH_PUBLISH
+      when that is freed */
    Node_T oNParent;
-   /* the object containing links to this node's children */
-   DynArray_T oDChildren;
+   /* the number of directories, or trees for a root, that hold the
+      node: more than one while versions of a tree share it (see
+      Node_share); changed atomically, and but for Node_share only
+      with the versions' lock held */
+   size_t ulRefs;
+   /* the next newer copy of the node (see Node_copy), in a ring of
+      every copy still held, in the order they were made, which the
+      newest closes; the node itself if it has no other */
+   Node_T oNCopy;
+   /* the node's children in sorted order, each beside the key of its
+      name (see Node_nameKey), in an array allocated from the tree's
+      slab, or NULL if it has never had any or has too many for one
+      array, or is concurrent */
+   struct ChunkEntry *psChildren;
+   /* the number of children */
+   size_t ulChildCount;
+   /* the node's children in sorted order once there are more than
+      MAX_FLAT_CHILDREN, or NULL */
+   ChunkArray_T oCChildren;
+   /* a hash index of the node's children by name, kept while it has
+      more than its tree's index threshold of them (see Node_new), or
+      NULL */
+   struct childIndex *psIndex;
    /* the state of the node (either directory or file) */
    int state;
-   /* void pointer to content */
-   void* a_file;
-   /* size of file */
-   size_t size_of_file;
+   /* the number of elements allocated for psChildren, at most
+      MAX_FLAT_CHILDREN, so kept beside state in what would otherwise
+      be padding */
+   unsigned int uChildCapacity;
+   /* what the node holds, by its state */
+   union {
+      /* a file's contents */
+      struct {
+         /* void pointer to content */
+         void* a_file;
+         /* size of file */
+         size_t size_of_file;
+         /* in a concurrent tree, the record that holds the contents
+            and their size in place of the two above, published with
+            EPOCH_PUBLISH, or NULL in other trees */
+         struct fileRecord *psRecord;
+      } sFile;
+      /* a concurrent directory's children and writers' lock, or
+         NULLs for the directories of other trees */
+      struct {
+         /* the children, published with EPOCH_PUBLISH */
+         struct childArray *psPublished;
+         /* the lock of the writers that change them */
+         struct dirLock *psLock;
+      } sDir;
+   } uContents;
+};
+
+/*
+  The lock of a concurrent directory, held by each writer that adds a
+  child to it or removes one from it, for as long as it takes to
+  publish the change, so writers wait only for those changing the
+  same directory. Readers never take it. It also counts the walks
+  that keep the directory between epochs (see Node_walk).
+*/
+struct dirLock {
+   /* the lock's record while the last walk to let go of the directory
+      retires it (see Node_unpin), which is its first member so that
+      the lock is found from the record */
+   struct EpochRetired sRetired;
+   /* the mutex */
+   pthread_mutex_t sMutex;
+   /* the versions of the tree, whose list the directory's writers
+      retire to */
+   NodeVersions_T oVVersions;
+   /* TRUE once the directory is being retired with a subtree above
+      it or at it (see Node_retire), or has been replaced by a copy
+      (see Node_copy), after which its children never change again;
+      read and written with sMutex held */
+   boolean bRetired;
+   /* the number of walks that keep the directory, plus NODE_ORPHANED
+      once no version of the tree holds it, after which the last of
+      them frees it; changed atomically */
+   size_t ulPins;
+   /* the slab the directory was allocated from */
+   Slab_T oSSlab;
+   /* the nodes that the last walk left to be released (see
+      Node_freeShared), or NULL */
+   Node_T oNDead;
+};
+
+/* The bit of a dirLock's ulPins that tells that the tree let go of
+   the directory while walks kept it */
+#define NODE_ORPHANED (((size_t) -1 >> 1) + 1)
+
+/*
+  What the versions of a tree have in common. The lock is held while
+  holds on shared nodes are added or dropped, so that a version whose
+  hold is the last releases the node, and while the ring of a node's
+  copies and their parent links change.
+*/
+struct nodeVersions {
+   /* the lock */
+   pthread_mutex_t sMutex;
+   /* the list that the versions retire to (see epoch.h) */
+   EpochList_T oEList;
+};
+
+/*
+  The contents of a file of a concurrent tree with their length. A
+  record is never changed once published: a writer publishes a new one
+  in its place and retires the old one, so a reader that loads the
+  record once sees a length with the contents it goes with.
+*/
+struct fileRecord {
+   /* the record of the record while it is retired (see epoch.h) */
+   struct EpochRetired sRetired;
+   /* the slab the record is allocated from, the tree's */
+   Slab_T oSSlab;
+   /* the contents */
+   void *pvContents;
+   /* the length of the contents */
+   size_t ulLength;
+};
+
+/* The most children in a chunk of a concurrent directory's children;
+   a writer copies the chunk it changes and the table of chunks, which
+   cost about the same for CHUNK_CHILDREN * CHUNK_CHILDREN children */
+enum { CHUNK_CHILDREN = 64 };
+
+/*
+  A chunk of the children of a concurrent directory, consecutive in
+  sorted order, each beside the key of its name. Once published, a
+  chunk is never changed, so arrays may share it (see struct
+  childArray).
+*/
+struct childChunk {
+   /* the number of children, from 1 to CHUNK_CHILDREN */
+   size_t ulCount;
+   /* the children, extended past the end of the struct */
+   struct ChunkEntry asEntries[1];
+};
+
+/* A chunk of a children array */
+struct chunkRef {
+   /* the index of the chunk's first child among all the children */
+   size_t ulBase;
+   /* the chunk */
+   struct childChunk *psChunk;
+};
+
+/*
+  The children of a concurrent directory (see Node_makeConcurrent), in
+  sorted order, in a table of chunks. Once published, an array is
+  never changed: a writer publishes a changed copy in its place and
+  retires it (see epoch.h), so readers can search it with no locks.
+  The copy shares all of the array's chunks but the one changed,
+  which it replaces with a changed copy, so a change copies one chunk
+  and the table rather than all the children, in time linear in the
+  number of children divided by CHUNK_CHILDREN, plus CHUNK_CHILDREN.
+  Once removals leave the chunks an eighth full, the removal that
+  finds them so copies all the children into new chunks (see
+  Node_repackArray). An array allocated from the tree's slab is
+  freed, with the chunk and the subtree it was replaced to unlink,
+  once no reader can be in it.
+*/
+struct childArray {
+   /* the array's record while retired, which is its first member so
+      that the array is found from the record */
+   struct EpochRetired sRetired;
+   /* the slab the array was allocated from */
+   Slab_T oSSlab;
+   /* the child unlinked by the array's replacement, freed with its
+      descendants along with the array, or NULL */
+   Node_T oNRemoved;
+   /* the versions of the tree, whose lock oNRemoved is freed with */
+   NodeVersions_T oVVersions;
+   /* the chunk that the array's replacement does not share, freed
+      along with the array, or NULL */
+   struct childChunk *psReplaced;
+   /* TRUE if the array's replacement shares none of its chunks,
+      which are then all freed along with it (see Node_repackArray) */
+   boolean bRepacked;
+   /* the number of children */
+   size_t ulCount;
+   /* the number of chunks */
+   size_t ulChunks;
+   /* the chunks in order, extended past the end of the struct */
+   struct chunkRef asChunks[1];
+};
+
+/* The array of every concurrent directory without children, which is
+   never freed */
+static struct childArray sNoChildren;
+
+/* The number of elements first allocated for a children array */
+enum { MIN_CHILD_CAPACITY = 2 };
+/* The most children kept in a single array, which must be a power of
+   two times MIN_CHILD_CAPACITY; wider directories use a ChunkArray_T,
+   which does not have to shift every later child on each change */
+enum { MAX_FLAT_CHILDREN = 1024 };
+
+/* A slot of a child index */
+struct indexSlot {
+   /* the name of the child in the slot, as an atom, or NULL if the
+      slot is empty */
+   const char *pcName;
+   /* the child in the slot */
+   Node_T oNChild;
+};
+
+/*
+  An open-addressing hash table of a node's children, keyed by the
+  hashes of their names, which are the hashes the names were interned
+  with. Each child is in the first empty slot at or after (wrapping
+  around) the slot its hash picks, so a lookup probes from there to
+  the next empty slot. At most half the slots are full.
+*/
+struct childIndex {
+   /* the number of slots, a power of two */
+   size_t ulSlots;
+   /* the threshold the directory was indexed above (see Node_new),
+      below half of which the index is dropped */
+   size_t ulThreshold;
+   /* the slots, extended past the end of the struct */
+   struct indexSlot asSlots[1];
+};
+
+/* The fewest slots in a child index */
+enum { MIN_INDEX_SLOTS = 8 };
+
+/* The number of levels below its root for which Node_walk keeps the
+   index of the next child to visit on its stack; deeper down it finds
+   the index again when it returns to a level, by searching */
+enum { WALK_STACK_DEPTH = 64 };
+
+/* A component name being searched for among a node's children */
+struct name {
+   /* the first character of the name, which need not be
+      '\0'-terminated */
+   const char *pcName;
+   /* the string length of the name */
+   size_t ulLength;
+   /* the key of the name (see Node_nameKey) */
+   unsigned long ulKey;
+};
+
+/* ChildArray_insertAt and ChildArray_removeAt shift arrays of
+   children */
+SORTEDARRAY_SHIFT(ChildArray, struct ChunkEntry)
+
+/*
+  Returns the key of the name of ulLength characters at pcName: its
+  first sizeof(unsigned long) characters packed into an unsigned long,
+  the first most significant, padded with zero bytes. Names contain no
+  '\0', so when two keys differ they order their names the same way
+  the names themselves compare, and a search only has to follow a
+  child's pointer to its name when their keys are equal.
+*/
+static unsigned long Node_nameKey(const char *pcName, size_t ulLength) {
+   unsigned long ulKey = 0;
+   size_t i;
+
+   assert(pcName != NULL);
+
+   for(i = 0; i < sizeof(unsigned long); i++) {
+      ulKey <<= CHAR_BIT;
+      if(i < ulLength)
+         ulKey |= (unsigned char) pcName[i];
+   }
+   return ulKey;
+}
+
+/* Returns the size in bytes of a child index with ulSlots slots. */
+static size_t Node_indexSize(size_t ulSlots) {
+   return offsetof(struct childIndex, asSlots)
+      + ulSlots * sizeof(struct indexSlot);
+}
+
+/*
+  Puts oNChild, which must not already be there, into the first empty
+  slot of psIndex from the one its name's hash picks. psIndex must
+  have an empty slot.
+*/
+static void Node_indexInsert(struct childIndex *psIndex,
+                             Node_T oNChild) {
+   size_t ulMask;
+   size_t i;
+
+   assert(psIndex != NULL);
+   assert(oNChild != NULL);
+
+   ulMask = psIndex->ulSlots - 1;
+   i = (size_t) Atom_getHash(oNChild->pcName) & ulMask;
+   while(psIndex->asSlots[i].pcName != NULL)
+      i = (i + 1) & ulMask;
+   psIndex->asSlots[i].pcName = oNChild->pcName;
+   psIndex->asSlots[i].oNChild = oNChild;
+}
+
+/*
+  Takes oNChild, which must be there, out of psIndex, moving back into
+  the emptied slot any later child in the same run of full slots that
+  would otherwise no longer be found from the slot its hash picks.
+*/
+static void Node_indexRemove(struct childIndex *psIndex,
+                             Node_T oNChild) {
+   size_t ulMask;
+   size_t i, j, ulHome;
+
+   assert(psIndex != NULL);
+   assert(oNChild != NULL);
+
+   ulMask = psIndex->ulSlots - 1;
+   i = (size_t) Atom_getHash(oNChild->pcName) & ulMask;
+   while(psIndex->asSlots[i].pcName != oNChild->pcName) {
+      assert(psIndex->asSlots[i].pcName != NULL);
+      i = (i + 1) & ulMask;
+   }
+
+   for(j = (i + 1) & ulMask; psIndex->asSlots[j].pcName != NULL;
+       j = (j + 1) & ulMask) {
+      ulHome = (size_t) Atom_getHash(psIndex->asSlots[j].pcName)
+         & ulMask;
+      /* the child in slot j stays if its home is cyclically in
+         (i, j], since it is still reached from there */
+      if(i <= j ? (i < ulHome && ulHome <= j)
+                : (i < ulHome || ulHome <= j))
+         continue;
+      psIndex->asSlots[i] = psIndex->asSlots[j];
+      i = j;
+   }
+   psIndex->asSlots[i].pcName = NULL;
+}
+
+/*
+  Puts oNChild into the slot of psIndex that holds the child of the
+  same name, which must be there.
+*/
+static void Node_indexReplace(struct childIndex *psIndex,
+                              Node_T oNChild) {
+   size_t ulMask;
+   size_t i;
+
+   assert(psIndex != NULL);
+   assert(oNChild != NULL);
+
+   ulMask = psIndex->ulSlots - 1;
+   i = (size_t) Atom_getHash(oNChild->pcName) & ulMask;
+   while(psIndex->asSlots[i].pcName != oNChild->pcName) {
+      assert(psIndex->asSlots[i].pcName != NULL);
+      i = (i + 1) & ulMask;
+   }
+   psIndex->asSlots[i].oNChild = oNChild;
+}
+
+/* Releases oNParent's child index, if any, to oSSlab. */
+static void Node_dropIndex(Node_T oNParent, Slab_T oSSlab) {
+   assert(oNParent != NULL);
+   assert(oSSlab != NULL);
+
+   if(oNParent->psIndex != NULL) {
+      Slab_release(oSSlab, oNParent->psIndex,
+                   Node_indexSize(oNParent->psIndex->ulSlots));
+      oNParent->psIndex = NULL;
+   }
+}
+
+/*
+  Replaces oNParent's child index, if any, with a new one from oSSlab
+  holding all of its children, sized so that between a quarter and
+  half of its slots are full, and kept until oNParent has fewer than
+  half of ulThreshold children. The index is only an aid to lookups,
+  so if memory cannot be allocated oNParent is simply left without
+  one.
+*/
+static void Node_buildIndex(Node_T oNParent, size_t ulThreshold,
+                            Slab_T oSSlab) {
+   struct childIndex *psIndex;
+   struct ChunkEntry *psEntries;
+   size_t ulSlots = MIN_INDEX_SLOTS;
+   size_t ulChunk, ulChunks;
+   size_t ulCount;
+   size_t i;
+
+   assert(oNParent != NULL);
+   assert(oSSlab != NULL);
+
+   Node_dropIndex(oNParent, oSSlab);
+
+   while(ulSlots < 2 * oNParent->ulChildCount)
+      ulSlots *= 2;
+   psIndex = Slab_alloc(oSSlab, Node_indexSize(ulSlots));
+   if(psIndex == NULL)
+      return;
+   psIndex->ulSlots = ulSlots;
+   psIndex->ulThreshold = ulThreshold;
+   for(i = 0; i < ulSlots; i++)
+      psIndex->asSlots[i].pcName = NULL;
+
+   /* a flat children array is walked as a single chunk */
+   psEntries = oNParent->psChildren;
+   ulCount = oNParent->ulChildCount;
+   ulChunks = 1;
+   if(oNParent->oCChildren != NULL)
+      ulChunks = ChunkArray_getChunkCount(oNParent->oCChildren);
+   for(ulChunk = 0; ulChunk < ulChunks; ulChunk++) {
+      if(oNParent->oCChildren != NULL)
+         psEntries = ChunkArray_getChunk(oNParent->oCChildren, ulChunk,
+                                         &ulCount);
+      for(i = 0; i < ulCount; i++)
+         Node_indexInsert(psIndex, psEntries[i].pvElement);
+   }
+
+   oNParent->psIndex = psIndex;
+}
+
+/*
+  Adds oNChild, just linked into oNParent's children array, to
+  oNParent's child index, first building the index from oSSlab if
+  oNParent now has more than ulIndexThreshold children, or growing it
+  if more than half its slots would be full.
+*/
+static void Node_indexChild(Node_T oNParent, Node_T oNChild,
+                            size_t ulIndexThreshold, Slab_T oSSlab) {
+   assert(oNParent != NULL);
+   assert(oNChild != NULL);
+   assert(oSSlab != NULL);
+
+   if(oNParent->psIndex == NULL) {
+      if(oNParent->ulChildCount > ulIndexThreshold)
+         Node_buildIndex(oNParent, ulIndexThreshold, oSSlab);
+   }
+   else if(2 * oNParent->ulChildCount > oNParent->psIndex->ulSlots)
+      Node_buildIndex(oNParent, ulIndexThreshold, oSSlab);
+   else
+      Node_indexInsert(oNParent->psIndex, oNChild);
+}
+
+/*
+  Takes oNChild, just unlinked from oNParent's children array, out of
+  oNParent's child index, if any. Drops the index once oNParent has
+  fewer than half of the children it was built above, so that a
+  directory near the threshold does not build and drop it over and
+  over, and shrinks it once fewer than an eighth of its slots are
+  full.
+*/
+static void Node_unindexChild(Node_T oNParent, Node_T oNChild,
+                              Slab_T oSSlab) {
+   assert(oNParent != NULL);
+   assert(oNChild != NULL);
+   assert(oSSlab != NULL);
+
+   if(oNParent->psIndex == NULL)
+      return;
+   if(oNParent->ulChildCount < oNParent->psIndex->ulThreshold / 2)
+      Node_dropIndex(oNParent, oSSlab);
+   else if(8 * oNParent->ulChildCount < oNParent->psIndex->ulSlots
+           && oNParent->psIndex->ulSlots > MIN_INDEX_SLOTS)
+      Node_buildIndex(oNParent, oNParent->psIndex->ulThreshold,
+                      oSSlab);
+   else
+      Node_indexRemove(oNParent->psIndex, oNChild);
+}
+
+/*
+  Links new child oNChild into oNParent's children array at index
+  ulIndex, growing the array from oSSlab if it is full. Returns
+  SUCCESS if the new child was added successfully, or MEMORY_ERROR if
+  allocation fails adding oNChild to the array.
+*/
+static int Node_addChild(Node_T oNParent, Node_T oNChild,
+                         size_t ulIndex, Slab_T oSSlab) {
+   struct ChunkEntry *psChildren;
+   struct ChunkEntry sEntry;
+   size_t ulCapacity;
+
+   assert(oNParent != NULL);
+   assert(oNChild != NULL);
+   assert(ulIndex <= oNParent->ulChildCount);
+   assert(oSSlab != NULL);
+
+   sEntry.ulKey = Node_nameKey(oNChild->pcName,
+                               Atom_getLength(oNChild->pcName));
+   sEntry.pvElement = oNChild;
+
+   if(oNParent->oCChildren == NULL
+      && oNParent->ulChildCount == MAX_FLAT_CHILDREN) {
+      /* move the children into chunks */
+      oNParent->oCChildren = ChunkArray_new(oSSlab,
+                                oNParent->psChildren,
+                                oNParent->ulChildCount);
+      if(oNParent->oCChildren == NULL)
+         return MEMORY_ERROR;
+      Slab_release(oSSlab, oNParent->psChildren,
+                   oNParent->uChildCapacity
+                   * sizeof(struct ChunkEntry));
+      oNParent->psChildren = NULL;
+      oNParent->uChildCapacity = 0;
+   }
+
+   if(oNParent->oCChildren != NULL) {
+      if(!ChunkArray_addAt(oNParent->oCChildren, ulIndex, oNChild,
+                           sEntry.ulKey))
+         return MEMORY_ERROR;
+      oNParent->ulChildCount++;
+      return SUCCESS;
+   }
+
+   if(oNParent->ulChildCount == oNParent->uChildCapacity) {
+      if(oNParent->uChildCapacity == 0)
+         ulCapacity = MIN_CHILD_CAPACITY;
+      else
+         ulCapacity = 2 * oNParent->uChildCapacity;
+      psChildren = Slab_resize(oSSlab, oNParent->psChildren,
+                      oNParent->uChildCapacity
+                      * sizeof(struct ChunkEntry),
+                      ulCapacity * sizeof(struct ChunkEntry));
+      if(psChildren == NULL)
+         return MEMORY_ERROR;
+      oNParent->psChildren = psChildren;
+      oNParent->uChildCapacity = (unsigned int) ulCapacity;
+   }
+
+   ChildArray_insertAt(oNParent->psChildren, oNParent->ulChildCount,
+                       ulIndex, sEntry);
+   oNParent->ulChildCount++;
+   return SUCCESS;
+}
+
+/*
+  Unlinks the child at index ulIndex from oNParent's children array
+  and child index, releasing any index memory no longer needed to
+  oSSlab.
+*/
+static void Node_removeChild(Node_T oNParent, size_t ulIndex,
+                             Slab_T oSSlab) {
+   Node_T oNChild;
+
+   assert(oNParent != NULL);
+   assert(ulIndex < oNParent->ulChildCount);
+   assert(oSSlab != NULL);
+
+   if(oNParent->oCChildren != NULL)
+      oNChild = ChunkArray_removeAt(oNParent->oCChildren, ulIndex);
+   else
+      oNChild = ChildArray_removeAt(oNParent->psChildren,
+                                    oNParent->ulChildCount,
+                                    ulIndex).pvElement;
+   oNParent->ulChildCount--;
+   Node_unindexChild(oNParent, oNChild, oSSlab);
+}
+
+/* Returns the number of holds on oNNode (see struct node). */
+static size_t Node_refs(Node_T oNNode) {
+   assert(oNNode != NULL);
+
+   return __atomic_load_n(&oNNode->ulRefs, __ATOMIC_ACQUIRE);
+}
+
+/* Adds a hold on oNNode. */
+static void Node_hold(Node_T oNNode) {
+   assert(oNNode != NULL);
+
+   (void) __atomic_add_fetch(&oNNode->ulRefs, 1, __ATOMIC_RELAXED);
+}
+
+/*
+  Drops a hold on oNNode and returns the number left. What the caller
+  published before, a moved parent link, is seen by any thread that
+  then finds the hold gone.
+*/
+static size_t Node_unhold(Node_T oNNode) {
+   assert(oNNode != NULL);
+   assert(Node_refs(oNNode) != 0);
+
+   return __atomic_sub_fetch(&oNNode->ulRefs, 1, __ATOMIC_ACQ_REL);
+}
+
+/*
+  Returns oNNode's published children array (see struct childArray) if
+  it is a concurrent directory, or NULL if it is a file or a directory
+  of a tree that is not concurrent. A reader loads the array once and
+  then looks only at that, since a writer may replace it at any time.
+*/
+static struct childArray *Node_published(Node_T oNNode) {
+   assert(oNNode != NULL);
+
+   if(oNNode->state == A_FILE)
+      return NULL;
+   return EPOCH_LOAD(&oNNode->uContents.sDir.psPublished);
+}
+
+/*
+  Returns the number of children of oNParent, whose published children
+  array is psArray, or NULL if it is not concurrent.
+*/
+static size_t Node_countIn(Node_T oNParent,
+                           const struct childArray *psArray) {
+   assert(oNParent != NULL);
+
+   if(psArray != NULL)
+      return psArray->ulCount;
+   return oNParent->ulChildCount;
+}
+
+/*
+  Returns the index in psArray, a concurrent directory's children
+  array with at least one chunk, of the last chunk whose first child
+  is at an index not greater than ulIndex.
+*/
+static size_t Node_chunkOf(const struct childArray *psArray,
+                           size_t ulIndex) {
+   size_t ulLo, ulHi, ulMid;
+
+   assert(psArray != NULL);
+   assert(psArray->ulChunks > 0);
+
+   ulLo = 1;
+   ulHi = psArray->ulChunks;
+   while(ulLo < ulHi) {
+      ulMid = ulLo + (ulHi - ulLo) / 2;
+      if(psArray->asChunks[ulMid].ulBase > ulIndex)
+         ulHi = ulMid;
+      else
+         ulLo = ulMid + 1;
+   }
+   return ulLo - 1;
+}
+
+/*
+  Returns the child at index ulIndex of oNParent, whose published
+  children array is psArray, or NULL if it is not concurrent.
+*/
+static Node_T Node_childAt(Node_T oNParent,
+                           const struct childArray *psArray,
+                           size_t ulIndex) {
+   size_t ulChunk;
+
+   assert(oNParent != NULL);
+   assert(ulIndex < Node_countIn(oNParent, psArray));
+
+   if(psArray != NULL) {
+      ulChunk = Node_chunkOf(psArray, ulIndex);
+      return psArray->asChunks[ulChunk].psChunk->asEntries[
+         ulIndex - psArray->asChunks[ulChunk].ulBase].pvElement;
+   }
+   if(oNParent->oCChildren != NULL)
+      return ChunkArray_get(oNParent->oCChildren, ulIndex);
+   return oNParent->psChildren[ulIndex].pvElement;
+}
+
+/*
+  Sets *psName to the component of oPPath at level ulLevel, whose
+  length is known without scanning because the component is an atom.
+*/
+static void Node_componentName(Path_T oPPath, size_t ulLevel,
+                               struct name *psName) {
+   assert(oPPath != NULL);
+   assert(ulLevel < Path_getDepth(oPPath));
+   assert(psName != NULL);
+
+   psName->pcName = Path_getComponent(oPPath, ulLevel);
+   psName->ulLength = Atom_getLength(psName->pcName);
+   psName->ulKey = Node_nameKey(psName->pcName, psName->ulLength);
+}
+
+/*
+  Returns TRUE if oNNode's path is a prefix of oPPath (or equal to
+  it), or FALSE if it is not. Compares the atoms along the way up from
+  oNNode to the root, so allocates no memory.
+*/
+static boolean Node_isPrefixOf(Node_T oNNode, Path_T oPPath) {
+   assert(oNNode != NULL);
+   assert(oPPath != NULL);
+
+   if(oNNode->ulDepth > Path_getDepth(oPPath))
+      return FALSE;
+   for(; oNNode != NULL; oNNode = EPOCH_LOAD(&oNNode->oNParent))
+      if(Path_getComponent(oPPath, oNNode->ulDepth - 1)
+         != oNNode->pcName)
+         return FALSE;
+   return TRUE;
+}
+
+/*
+  Compares the last component of oNFirst's path with the name
+  psSecond lexicographically. Among siblings, whose paths differ only
+  in that component, this orders nodes the same way as their paths.
+  Returns <0, 0, or >0 if oNFirst is "less than", "equal to", or
+  "greater than" psSecond, respectively.
+*/
+static int Node_compareName(const Node_T oNFirst,
+                            const struct name *psSecond) {
+   struct name sFirst;
+   int iCompare;
+
+   assert(oNFirst != NULL);
+   assert(psSecond != NULL);
+
+   /* equal atoms are equal names */
+   if(oNFirst->pcName == psSecond->pcName)
+      return 0;
+   sFirst.pcName = oNFirst->pcName;
+   sFirst.ulLength = Atom_getLength(oNFirst->pcName);
+   if(sFirst.ulLength < psSecond->ulLength) {
+      iCompare = memcmp(sFirst.pcName, psSecond->pcName,
+                        sFirst.ulLength);
+      return iCompare != 0 ? iCompare : -1;
+   }
+   iCompare = memcmp(sFirst.pcName, psSecond->pcName,
+                     psSecond->ulLength);
+   if(iCompare != 0 || sFirst.ulLength == psSecond->ulLength)
+      return iCompare;
+   return 1;
+}
+
+/*
+  Compares the name of the child in sEntry with the name psName like
+  Node_compareName, but from their keys alone unless those are equal.
+  Equal keys are equal names if psName is shorter than a key, since
+  a name ends at the first zero byte of its key.
+*/
+static SORTEDARRAY_INLINE int Node_compareEntry(
+   const struct ChunkEntry sEntry, const struct name *psName) {
+   assert(psName != NULL);
+
+   if(sEntry.ulKey != psName->ulKey)
+      return sEntry.ulKey < psName->ulKey ? -1 : 1;
+   if(psName->ulLength < sizeof(unsigned long))
+      return 0;
+   return Node_compareName(sEntry.pvElement, psName);
+}
+
+/* ChildArray_search finds a name in an array of children, with
+   Node_compareEntry inlined rather than called through a pointer */
+SORTEDARRAY_SEARCH(ChildArray, struct ChunkEntry, struct name,
+                   Node_compareEntry)
+
+/*
+  Binary-searches oNParent's children for the one named psName, in
+  psArray if oNParent is concurrent and that is its published children
+  array, or NULL if it is not. Returns TRUE and stores its index in
+  *pulIndex if there is one; otherwise returns FALSE and stores in
+  *pulIndex the index such a child would have if inserted.
+*/
+static boolean Node_searchChildren(Node_T oNParent,
+                                   struct childArray *psArray,
+                                   const struct name *psName,
+                                   size_t *pulIndex) {
+   ChunkArray_T oCChildren;
+   struct ChunkEntry *psChunk;
+   size_t ulLo, ulHi, ulMid;
+   size_t ulCount;
+   boolean bFound;
+
+   assert(oNParent != NULL);
+   assert(psName != NULL);
+   assert(pulIndex != NULL);
+
+   if(psArray != NULL) {
+      if(psArray->ulChunks == 0) {
+         *pulIndex = 0;
+         return FALSE;
+      }
+      /* find the last chunk whose first child is not greater than
+         psName, or the first chunk if there is none */
+      ulLo = 1;
+      ulHi = psArray->ulChunks;
+      while(ulLo < ulHi) {
+         ulMid = ulLo + (ulHi - ulLo) / 2;
+         if(Node_compareEntry(
+               psArray->asChunks[ulMid].psChunk->asEntries[0],
+               psName) > 0)
+            ulHi = ulMid;
+         else
+            ulLo = ulMid + 1;
+      }
+      /* then search within it */
+      bFound = (boolean) ChildArray_search(
+         psArray->asChunks[ulLo - 1].psChunk->asEntries,
+         psArray->asChunks[ulLo - 1].psChunk->ulCount, psName,
+         pulIndex);
+      *pulIndex += psArray->asChunks[ulLo - 1].ulBase;
+      return bFound;
+   }
+
+   oCChildren = oNParent->oCChildren;
+   if(oCChildren == NULL)
+      return (boolean) ChildArray_search(oNParent->psChildren,
+                          oNParent->ulChildCount, psName, pulIndex);
+
+   if(ChunkArray_getChunkCount(oCChildren) == 0) {
+      *pulIndex = 0;
+      return FALSE;
+   }
+
+   /* find the last chunk whose first child is not greater than
+      psName, or the first chunk if there is none */
+   ulLo = 1;
+   ulHi = ChunkArray_getChunkCount(oCChildren);
+   while(ulLo < ulHi) {
+      ulMid = ulLo + (ulHi - ulLo) / 2;
+      psChunk = ChunkArray_getChunk(oCChildren, ulMid, &ulCount);
+      if(Node_compareEntry(psChunk[0], psName) > 0)
+         ulHi = ulMid;
+      else
+         ulLo = ulMid + 1;
+   }
+
+   /* then search within it */
+   psChunk = ChunkArray_getChunk(oCChildren, ulLo - 1, &ulCount);
+   bFound = (boolean) ChildArray_search(psChunk, ulCount, psName,
+                                        pulIndex);
+   *pulIndex += ChunkArray_getChunkBase(oCChildren, ulLo - 1);
+   return bFound;
+}
+
+/* Returns the size in bytes of a chunk of ulCount children. */
+static size_t Node_chunkSize(size_t ulCount) {
+   return offsetof(struct childChunk, asEntries)
+      + ulCount * sizeof(struct ChunkEntry);
+}
+
+/* Returns the size in bytes of a children array of ulChunks chunks. */
+static size_t Node_arraySize(size_t ulChunks) {
+   return offsetof(struct childArray, asChunks)
+      + ulChunks * sizeof(struct chunkRef);
+}
+
+/*
+  Returns a new chunk holding copies of the ulCount children that
+  psEntries points to, allocated from oSSlab, or NULL if insufficient
+  memory is available.
+*/
+static struct childChunk *Node_newChunk(
+   Slab_T oSSlab, const struct ChunkEntry *psEntries, size_t ulCount) {
+   struct childChunk *psChunk;
+
+   assert(oSSlab != NULL);
+   assert(psEntries != NULL);
+   assert(ulCount > 0 && ulCount <= CHUNK_CHILDREN);
+
+   psChunk = Slab_alloc(oSSlab, Node_chunkSize(ulCount));
+   if(psChunk == NULL)
+      return NULL;
+   psChunk->ulCount = ulCount;
+   memcpy(psChunk->asEntries, psEntries,
+          ulCount * sizeof(struct ChunkEntry));
+   return psChunk;
+}
+
+/* Releases psChunk, if not NULL, to oSSlab. */
+static void Node_freeChunk(Slab_T oSSlab, struct childChunk *psChunk) {
+   assert(oSSlab != NULL);
+
+   if(psChunk != NULL)
+      Slab_release(oSSlab, psChunk, Node_chunkSize(psChunk->ulCount));
+}
+
+/*
+  Releases the children array psArray, which nothing may hold any
+  more, to its slab, with all its chunks if bChunks is TRUE.
+*/
+static void Node_freeArray(struct childArray *psArray,
+                           boolean bChunks) {
+   size_t i;
+
+   assert(psArray != NULL);
+   assert(psArray != &sNoChildren);
+
+   if(bChunks)
+      for(i = 0; i < psArray->ulChunks; i++)
+         Node_freeChunk(psArray->oSSlab, psArray->asChunks[i].psChunk);
+   Slab_release(psArray->oSSlab, psArray,
+                Node_arraySize(psArray->ulChunks));
+}
+
+/*
+  Releases the storage of oNNode alone to oSSlab, which nothing may
+  hold any more and which is out of the ring of its copies: its
+  children array, lock and child index, or its file's record, its
+  name, and the node itself. Leaves its parent's children array as it
+  is.
+*/
+static void Node_release(Node_T oNNode, Slab_T oSSlab) {
+   struct childArray *psArray;
+
+   assert(oNNode != NULL);
+   assert(oSSlab != NULL);
+   assert(Node_refs(oNNode) == 0);
+
+   if(oNNode->state == A_FILE
+      && oNNode->uContents.sFile.psRecord != NULL)
+      Slab_release(oSSlab, oNNode->uContents.sFile.psRecord,
+                   sizeof(struct fileRecord));
+   psArray = Node_published(oNNode);
+   if(psArray != NULL && psArray != &sNoChildren)
+      Node_freeArray(psArray, TRUE);
+   if(psArray != NULL) {
+      (void) pthread_mutex_destroy(
+         &oNNode->uContents.sDir.psLock->sMutex);
+      Slab_release(oSSlab, oNNode->uContents.sDir.psLock,
+                   sizeof(struct dirLock));
+   }
+   Node_dropIndex(oNNode, oSSlab);
+   ChunkArray_free(oNNode->oCChildren);
+   Slab_release(oSSlab, oNNode->psChildren,
+                oNNode->uChildCapacity * sizeof(struct ChunkEntry));
+   Atom_free(oNNode->pcName);
+   Slab_release(oSSlab, oNNode, sizeof(struct node));
+}
+
+/* The state of a call to Node_freeSubtree */
+struct release {
+   /* the slab the nodes were allocated from */
+   Slab_T oSSlab;
+   /* the root of the subtree being released */
+   Node_T oNRoot;
+   /* the number of nodes released so far */
+   size_t ulCount;
+   /* TRUE if the nodes are only put in oNDead, to be released later
+      (see Node_freeShared) */
+   boolean bDefer;
+   /* the nodes put off so far, linked through oNCopy */
+   Node_T oNDead;
 };
 
 /*
-  Links new child oNChild into oNParent's children array at index
-  ulIndex. Returns SUCCESS if the new child was added successfully,
-  or  MEMORY_ERROR if allocation fails adding oNChild to the array.
+  Takes oNNode, which nothing holds any more, out of the ring of its
+  copies, and releases it as psRelease asks: at once, or by putting it
+  in psRelease's list.
+*/
+static void Node_dispose(Node_T oNNode, struct release *psRelease) {
+   Node_T oNPrevious;
+
+   assert(oNNode != NULL);
+   assert(psRelease != NULL);
+
+   for(oNPrevious = oNNode; oNPrevious->oNCopy != oNNode;
+       oNPrevious = oNPrevious->oNCopy)
+      ;
+   oNPrevious->oNCopy = oNNode->oNCopy;
+
+   if(psRelease->bDefer) {
+      oNNode->oNCopy = psRelease->oNDead;
+      psRelease->oNDead = oNNode;
+   }
+   else
+      Node_release(oNNode, psRelease->oSSlab);
+   psRelease->ulCount++;
+}
+
+/*
+  Returns TRUE if oNNode, which no version of its tree holds any more,
+  is a directory that walks still keep between epochs (see Node_walk),
+  or FALSE if not. The last of the walks is then to free it, and this
+  holds it for them; otherwise it can no longer be kept, and is to be
+  released.
+*/
+static boolean Node_leaveToWalks(Node_T oNNode) {
+   size_t ulPins;
+
+   assert(oNNode != NULL);
+   assert(Node_refs(oNNode) == 0);
+
+   if(Node_published(oNNode) == NULL)
+      return FALSE;
+   ulPins = __atomic_fetch_or(&oNNode->uContents.sDir.psLock->ulPins,
+                              NODE_ORPHANED, __ATOMIC_ACQ_REL);
+   if((ulPins & ~NODE_ORPHANED) == 0)
+      return FALSE;
+   Node_hold(oNNode);
+   return TRUE;
+}
+
+/*
+  Node_walk visitor for Node_freeSubtree. In pre-order, drops the hold
+  that oNNode's parent, which is being released, has on oNNode, and
+  passes over oNNode and its descendants if another version of the
+  tree still holds it, moving its parent link to the next newer copy
+  of the parent if that was the link, or a walk keeps it. In
+  post-order, once the walk is done with the directory oNNode,
+  releases each of its children that nothing holds any more, whose
+  own children have been released by then. oNNode itself is released
+  with its parent, so the walk never looks at a node after releasing
+  it.
+*/
+static int Node_releaseNode(Node_T oNNode, int iOrder,
+                            void *pvRelease) {
+   struct release *psRelease = pvRelease;
+   struct childArray *psArray;
+   Node_T oNParent;
+   Node_T oNChild;
+   size_t ulCount;
+   size_t i;
+
+   assert(oNNode != NULL);
+   assert(psRelease != NULL);
+
+   if(iOrder == FT_WALK_PREORDER) {
+      if(oNNode == psRelease->oNRoot)
+         return SUCCESS;
+      /* the copies holding oNNode were made one after another, so
+         the next newer copy of a parent being released holds it; the
+         link moves first, so that a walk of another version that
+         finds oNNode held once finds it linked to its parent */
+      oNParent = oNNode->oNParent;
+      if(Node_refs(oNNode) > 1 && Node_refs(oNParent) == 0) {
+         EPOCH_PUBLISH(&oNNode->oNParent, oNParent->oNCopy);
+         assert(Node_refs(oNParent->oNCopy) != 0);
+      }
+      if(Node_unhold(oNNode) == 0 && !Node_leaveToWalks(oNNode))
+         return SUCCESS;
+      return NODE_WALK_SKIP;
+   }
+
+   psArray = Node_published(oNNode);
+   ulCount = Node_countIn(oNNode, psArray);
+   for(i = 0; i < ulCount; i++) {
+      oNChild = Node_childAt(oNNode, psArray, i);
+      if(Node_refs(oNChild) == 0)
+         Node_dispose(oNChild, psRelease);
+   }
+   return SUCCESS;
+}
+
+/*
+  Drops a hold on oNNode, and if that was the last, releases it and
+  the descendants that only it holds to oSSlab, bottom-up, but for
+  those that walks keep, which the last of them frees, leaving its
+  parent's children as they are, or if poNDead is not NULL, puts them
+  in a list stored in *poNDead instead (see Node_freeShared). Returns
+  the number released. The caller holds the versions' lock if any
+  other version may hold them.
+*/
+static size_t Node_freeSubtree(Node_T oNNode, Slab_T oSSlab,
+                               Node_T *poNDead) {
+   struct release sRelease;
+   int iStatus;
+
+   assert(oNNode != NULL);
+   assert(oSSlab != NULL);
+
+   if(poNDead != NULL)
+      *poNDead = NULL;
+   if(Node_unhold(oNNode) != 0 || Node_leaveToWalks(oNNode))
+      return 0;
+
+   sRelease.oSSlab = oSSlab;
+   sRelease.oNRoot = oNNode;
+   sRelease.ulCount = 0;
+   sRelease.bDefer = (boolean) (poNDead != NULL);
+   sRelease.oNDead = NULL;
+   iStatus = Node_walk(oNNode, Node_releaseNode, &sRelease,
+                       FT_WALK_PREORDER | FT_WALK_POSTORDER
+                       | NODE_WALK_PRUNE);
+   assert(iStatus == SUCCESS);
+   (void) iStatus;
+   Node_dispose(oNNode, &sRelease);
+   if(poNDead != NULL)
+      *poNDead = sRelease.oNDead;
+   return sRelease.ulCount;
+}
+
+/*
+  Returns a new children array for ulCount children in ulChunks
+  chunks, allocated from oSSlab and carrying no removed subtree or
+  chunk, or NULL if insufficient memory is available. The caller fills
+  in the chunks.
+*/
+static struct childArray *Node_newArray(Slab_T oSSlab, size_t ulCount,
+                                        size_t ulChunks) {
+   struct childArray *psArray;
+
+   assert(oSSlab != NULL);
+
+   psArray = Slab_alloc(oSSlab, Node_arraySize(ulChunks));
+   if(psArray == NULL)
+      return NULL;
+   psArray->oSSlab = oSSlab;
+   psArray->oNRemoved = NULL;
+   psArray->oVVersions = NULL;
+   psArray->psReplaced = NULL;
+   psArray->bRepacked = FALSE;
+   psArray->ulCount = ulCount;
+   psArray->ulChunks = ulChunks;
+   return psArray;
+}
+
+/* Waits for the lock of oVVersions and takes it. */
+static void Node_lockVersions(NodeVersions_T oVVersions) {
+   int iStatus;
+
+   assert(oVVersions != NULL);
+
+   iStatus = pthread_mutex_lock(&oVVersions->sMutex);
+   assert(iStatus == 0);
+   (void) iStatus;
+}
+
+/* Gives up the lock of oVVersions. */
+static void Node_unlockVersions(NodeVersions_T oVVersions) {
+   int iStatus;
+
+   assert(oVVersions != NULL);
+
+   iStatus = pthread_mutex_unlock(&oVVersions->sMutex);
+   assert(iStatus == 0);
+   (void) iStatus;
+}
+
+/*
+  Epoch_retire callback that frees the children array psRetired is the
+  record of, after the subtree it carries, if any, and the chunks its
+  replacement does not share. The subtree came from the newest version
+  of the tree, whose frees move no parent link, so its nodes are
+  released at once.
+*/
+static void Node_reclaimArray(struct EpochRetired *psRetired) {
+   struct childArray *psArray = (struct childArray *) psRetired;
+
+   assert(psArray != NULL);
+
+   if(psArray->oNRemoved != NULL) {
+      Node_lockVersions(psArray->oVVersions);
+      (void) Node_freeSubtree(psArray->oNRemoved, psArray->oSSlab,
+                              NULL);
+      Node_unlockVersions(psArray->oVVersions);
+   }
+   Node_freeChunk(psArray->oSSlab, psArray->psReplaced);
+   Node_freeArray(psArray, psArray->bRepacked);
+}
+
+/*
+  Returns a copy of the concurrent directory's children array psOld
+  without the child at index ulSkip, in new chunks allocated from
+  oSSlab that are half full, or NULL if insufficient memory is
+  available. psOld must hold more than one child.
+*/
+static struct childArray *Node_repackArray(struct childArray *psOld,
+                                           size_t ulSkip,
+                                           Slab_T oSSlab) {
+   struct ChunkEntry asEntries[CHUNK_CHILDREN / 2];
+   struct childArray *psNew;
+   struct childChunk *psFrom;
+   size_t ulChunks;
+   size_t ulChunk = 0;
+   size_t ulEntries = 0;
+   size_t ulIndex = 0;
+   size_t i, j;
+
+   assert(psOld != NULL);
+   assert(psOld->ulCount > 1);
+   assert(ulSkip < psOld->ulCount);
+   assert(oSSlab != NULL);
+
+   ulChunks = (psOld->ulCount - 1 + CHUNK_CHILDREN / 2 - 1)
+      / (CHUNK_CHILDREN / 2);
+   psNew = Node_newArray(oSSlab, psOld->ulCount - 1, ulChunks);
+   if(psNew == NULL)
+      return NULL;
+
+   for(i = 0; i < psOld->ulChunks; i++) {
+      psFrom = psOld->asChunks[i].psChunk;
+      for(j = 0; j < psFrom->ulCount; j++, ulIndex++) {
+         if(ulIndex == ulSkip)
+            continue;
+         asEntries[ulEntries++] = psFrom->asEntries[j];
+         if(ulEntries < CHUNK_CHILDREN / 2
+            && ulChunk * (CHUNK_CHILDREN / 2) + ulEntries
+               < psNew->ulCount)
+            continue;
+         psNew->asChunks[ulChunk].ulBase =
+            ulChunk * (CHUNK_CHILDREN / 2);
+         psNew->asChunks[ulChunk].psChunk =
+            Node_newChunk(oSSlab, asEntries, ulEntries);
+         if(psNew->asChunks[ulChunk].psChunk == NULL) {
+            psNew->ulChunks = ulChunk;
+            Node_freeArray(psNew, TRUE);
+            return NULL;
+         }
+         ulChunk++;
+         ulEntries = 0;
+      }
+   }
+   assert(ulChunk == ulChunks);
+   return psNew;
+}
+
+/*
+  Returns a copy of the concurrent directory's children array psOld
+  with a copy of *psEntry inserted at index ulIndex, or if psEntry is
+  NULL, with the child at index ulIndex removed, or NULL if
+  insufficient memory is available. The copy shares all psOld's chunks
+  but the one changed, which it replaces with one or, if full, two new
+  ones, allocated with the copy from oSSlab, and psOld is marked to
+  free the chunk along with it. Once removals leave a copy's chunks
+  an eighth full, it shares none of them instead, but repacks the
+  children (see Node_repackArray).
+*/
+static struct childArray *Node_changeArray(
+   struct childArray *psOld, size_t ulIndex,
+   const struct ChunkEntry *psEntry, Slab_T oSSlab) {
+   struct ChunkEntry asEntries[CHUNK_CHILDREN + 1];
+   struct childChunk *apsChunks[2];
+   struct childChunk *psChunk = NULL;
+   struct childArray *psNew;
+   size_t ulChunk = 0;
+   size_t ulBase = 0;
+   size_t ulAt = 0;
+   size_t ulEntries = 0;
+   size_t ulFirst;
+   size_t ulNewChunks;
+   size_t i;
+
+   assert(psOld != NULL);
+   assert(ulIndex <= psOld->ulCount);
+   assert(psEntry != NULL || ulIndex < psOld->ulCount);
+   assert(oSSlab != NULL);
+
+   if(psEntry == NULL && psOld->ulChunks > 1
+      && (psOld->ulCount - 1) * 8 < psOld->ulChunks * CHUNK_CHILDREN) {
+      psNew = Node_repackArray(psOld, ulIndex, oSSlab);
+      if(psNew != NULL)
+         psOld->bRepacked = TRUE;
+      return psNew;
+   }
+
+   /* copy the chunk holding index ulIndex with the change made */
+   if(psOld->ulChunks != 0) {
+      ulChunk = Node_chunkOf(psOld, ulIndex);
+      psChunk = psOld->asChunks[ulChunk].psChunk;
+      ulBase = psOld->asChunks[ulChunk].ulBase;
+      ulAt = ulIndex - ulBase;
+      memcpy(asEntries, psChunk->asEntries,
+             ulAt * sizeof(struct ChunkEntry));
+      ulEntries = ulAt;
+   }
+   if(psEntry != NULL)
+      asEntries[ulEntries++] = *psEntry;
+   else
+      ulAt++;
+   if(psChunk != NULL) {
+      memcpy(asEntries + ulEntries, psChunk->asEntries + ulAt,
+             (psChunk->ulCount - ulAt) * sizeof(struct ChunkEntry));
+      ulEntries += psChunk->ulCount - ulAt;
+   }
+   if(ulEntries == 0)
+      ulNewChunks = 0;
+   else if(ulEntries > CHUNK_CHILDREN)
+      ulNewChunks = 2;
+   else
+      ulNewChunks = 1;
+
+   /* a full chunk splits in halves */
+   ulFirst = ulNewChunks == 2 ? ulEntries / 2 : ulEntries;
+   apsChunks[0] = apsChunks[1] = NULL;
+   for(i = 0; i < ulNewChunks; i++) {
+      apsChunks[i] = Node_newChunk(oSSlab,
+                                   asEntries + (i == 0 ? 0 : ulFirst),
+                                   i == 0 ? ulFirst
+                                   : ulEntries - ulFirst);
+      if(apsChunks[i] == NULL)
+         break;
+   }
+
+   if(psOld->ulCount == 1 && psEntry == NULL)
+      psNew = &sNoChildren;
+   else if(i == ulNewChunks)
+      psNew = Node_newArray(oSSlab, psEntry != NULL
+                            ? psOld->ulCount + 1 : psOld->ulCount - 1,
+                            psOld->ulChunks
+                            - (psChunk != NULL ? 1 : 0) + ulNewChunks);
+   else
+      psNew = NULL;
+   if(psNew == NULL) {
+      Node_freeChunk(oSSlab, apsChunks[0]);
+      Node_freeChunk(oSSlab, apsChunks[1]);
+      return NULL;
+   }
+
+   if(psNew != &sNoChildren) {
+      memcpy(psNew->asChunks, psOld->asChunks,
+             ulChunk * sizeof(struct chunkRef));
+      for(i = 0; i < ulNewChunks; i++) {
+         psNew->asChunks[ulChunk + i].ulBase =
+            ulBase + (i == 0 ? 0 : ulFirst);
+         psNew->asChunks[ulChunk + i].psChunk = apsChunks[i];
+      }
+      /* the chunks after the changed one each move by one child */
+      for(i = ulChunk + (psChunk != NULL ? 1 : 0);
+          i < psOld->ulChunks; i++) {
+         psNew->asChunks[i - (psChunk != NULL ? 1 : 0)
+                         + ulNewChunks].psChunk =
+            psOld->asChunks[i].psChunk;
+         psNew->asChunks[i - (psChunk != NULL ? 1 : 0)
+                         + ulNewChunks].ulBase =
+            psEntry != NULL ? psOld->asChunks[i].ulBase + 1
+                            : psOld->asChunks[i].ulBase - 1;
+      }
+   }
+   if(psOld != &sNoChildren)
+      psOld->psReplaced = psChunk;
+   return psNew;
+}
+
+/*
+  Retires psArray, which readers starting from now on cannot reach,
+  with the subtree rooted at oNRemoved, if not NULL, which they cannot
+  reach either, to the list of oVVersions, to be freed once no reader
+  can still be looking at them.
+*/
+static void Node_retireArray(struct childArray *psArray,
+                             Node_T oNRemoved,
+                             NodeVersions_T oVVersions) {
+   assert(psArray != NULL);
+   assert(psArray != &sNoChildren);
+   assert(oVVersions != NULL);
+
+   psArray->oNRemoved = oNRemoved;
+   psArray->oVVersions = oVVersions;
+   psArray->sRetired.pfFree = Node_reclaimArray;
+   Epoch_retire(oVVersions->oEList, &psArray->sRetired);
+}
+
+/*
+  Publishes psNew as oNParent's children array in place of psOld, and
+  retires psOld with oNRemoved, the child that psNew no longer holds,
+  if not NULL. The caller holds oNParent's lock.
+*/
+static void Node_replaceArray(Node_T oNParent, struct childArray *psOld,
+                              struct childArray *psNew,
+                              Node_T oNRemoved) {
+   assert(oNParent != NULL);
+   assert(psOld != NULL);
+   assert(psNew != NULL);
+
+   EPOCH_PUBLISH(&oNParent->uContents.sDir.psPublished, psNew);
+   if(psOld != &sNoChildren)
+      Node_retireArray(psOld, oNRemoved,
+                       oNParent->uContents.sDir.psLock->oVVersions);
+}
+
+/*
+  Returns a new lock for a concurrent directory of a tree with
+  versions oVVersions, allocated from oSSlab, or NULL if insufficient
+  memory is available.
+*/
+static struct dirLock *Node_newLock(Slab_T oSSlab,
+                                    NodeVersions_T oVVersions) {
+   struct dirLock *psLock;
+
+   assert(oSSlab != NULL);
+   assert(oVVersions != NULL);
+
+   psLock = Slab_alloc(oSSlab, sizeof(struct dirLock));
+   if(psLock == NULL)
+      return NULL;
+   if(pthread_mutex_init(&psLock->sMutex, NULL) != 0) {
+      Slab_release(oSSlab, psLock, sizeof(struct dirLock));
+      return NULL;
+   }
+   psLock->oVVersions = oVVersions;
+   psLock->bRetired = FALSE;
+   psLock->ulPins = 0;
+   psLock->oSSlab = oSSlab;
+   psLock->oNDead = NULL;
+   return psLock;
+}
+
+/*
+  Returns a new record of contents pvContents of length ulLength for a
+  file of a concurrent tree, allocated from oSSlab, or NULL if
+  insufficient memory is available.
+*/
+static struct fileRecord *Node_newRecord(Slab_T oSSlab,
+                                         void *pvContents,
+                                         size_t ulLength) {
+   struct fileRecord *psRecord;
+
+   assert(oSSlab != NULL);
+
+   psRecord = Slab_alloc(oSSlab, sizeof(struct fileRecord));
+   if(psRecord == NULL)
+      return NULL;
+   psRecord->oSSlab = oSSlab;
+   psRecord->pvContents = pvContents;
+   psRecord->ulLength = ulLength;
+   return psRecord;
+}
+
+/*
+  Epoch_retire callback that frees the file record psRetired is the
+  record of.
+*/
+static void Node_reclaimRecord(struct EpochRetired *psRetired) {
+   struct fileRecord *psRecord = (struct fileRecord *) psRetired;
+
+   assert(psRecord != NULL);
+
+   Slab_release(psRecord->oSSlab, psRecord, sizeof(struct fileRecord));
+}
+
+/* Waits for the lock of the concurrent directory oNDir and takes it. */
+static void Node_lock(Node_T oNDir) {
+   int iStatus;
+
+   assert(oNDir != NULL);
+   assert(Node_published(oNDir) != NULL);
+
+   iStatus = pthread_mutex_lock(&oNDir->uContents.sDir.psLock->sMutex);
+   assert(iStatus == 0);
+   (void) iStatus;
+}
+
+/* Gives up the lock of the concurrent directory oNDir. */
+static void Node_unlock(Node_T oNDir) {
+   int iStatus;
+
+   assert(oNDir != NULL);
+
+   iStatus =
+      pthread_mutex_unlock(&oNDir->uContents.sDir.psLock->sMutex);
+   assert(iStatus == 0);
+   (void) iStatus;
+}
+
+/*
+  Takes the lock of the concurrent directory oNDir and returns TRUE,
+  unless a writer is retiring oNDir or has replaced it with a copy:
+  then waits until that writer has unlinked it, and returns FALSE
+  without the lock. The writer marks the directories it retires
+  holding the lock of the nearest ancestor it does not retire, until
+  it unlinks them, so waiting for each lock on the way up to that
+  ancestor is waiting for the writer. A copy's parent link may lead
+  instead to an older copy of its parent, whose ancestors were
+  replaced too, and then this returns as soon as it runs out of them.
+*/
+static boolean Node_lockUnlessRetired(Node_T oNDir) {
+   Node_T oNAncestor;
+   boolean bRetired;
+
+   assert(oNDir != NULL);
+
+   Node_lock(oNDir);
+   if(!oNDir->uContents.sDir.psLock->bRetired)
+      return TRUE;
+   Node_unlock(oNDir);
+
+   oNAncestor = oNDir;
+   do {
+      /* only an older copy's ancestors run out, as a root is only
+         retired by a writer with the tree to itself */
+      oNAncestor = EPOCH_LOAD(&oNAncestor->oNParent);
+      if(oNAncestor == NULL)
+         break;
+      Node_lock(oNAncestor);
+      bRetired = oNAncestor->uContents.sDir.psLock->bRetired;
+      Node_unlock(oNAncestor);
+   } while(bRetired);
+   return FALSE;
+}
+
+/*
+  Returns TRUE if oNChild is a child of the concurrent directory
+  oNParent, whose published children array is psArray, and stores
+  its index in *pulIndex, or returns FALSE if it is not, having been
+  unlinked.
+*/
+static boolean Node_holdsChild(Node_T oNParent,
+                               struct childArray *psArray,
+                               Node_T oNChild, size_t *pulIndex) {
+   struct name sName;
+
+   assert(oNParent != NULL);
+   assert(psArray != NULL);
+   assert(oNChild != NULL);
+   assert(pulIndex != NULL);
+
+   sName.pcName = oNChild->pcName;
+   sName.ulLength = Atom_getLength(oNChild->pcName);
+   sName.ulKey = Node_nameKey(sName.pcName, sName.ulLength);
+   return (boolean) (Node_searchChildren(oNParent, psArray, &sName,
+                                         pulIndex)
+                     && Node_childAt(oNParent, psArray, *pulIndex)
+                        == oNChild);
+}
+
+/*
+  Links new child oNChild into the concurrent directory oNParent, whose
+  published children array is psOld, at index ulIndex, by publishing
+  a copy of psOld with oNChild in it, allocated from oSSlab (see
+  Node_changeArray). Returns SUCCESS, or MEMORY_ERROR if the copy
+  could not be allocated.
+*/
+static int Node_publishChild(Node_T oNParent, struct childArray *psOld,
+                             Node_T oNChild, size_t ulIndex,
+                             Slab_T oSSlab) {
+   struct childArray *psNew;
+   struct ChunkEntry sEntry;
+
+   assert(oNParent != NULL);
+   assert(psOld != NULL);
+   assert(oNChild != NULL);
+   assert(ulIndex <= psOld->ulCount);
+   assert(oSSlab != NULL);
+
+   sEntry.ulKey =
+      Node_nameKey(oNChild->pcName, Atom_getLength(oNChild->pcName));
+   sEntry.pvElement = oNChild;
+   psNew = Node_changeArray(psOld, ulIndex, &sEntry, oSSlab);
+   if(psNew == NULL)
+      return MEMORY_ERROR;
+
+   Node_replaceArray(oNParent, psOld, psNew, NULL);
+   return SUCCESS;
+}
+
+/*
+  Node_new, giving a new file contents pvContents of length ulLength
+  before linking it into oNParent, where readers of a concurrent tree
+  may see it at once. The caller holds the lock of a concurrent
+  oNParent.
+*/
+static int Node_create(Path_T oPPath, Node_T oNParent, Slab_T oSSlab,
+                       size_t ulIndexThreshold, Node_T *poNResult,
+                       int state, void *pvContents, size_t ulLength) {
+   struct node *psNew;
+   struct childArray *psArray = NULL;
+   struct dirLock *psLock = NULL;
+   struct fileRecord *psRecord = NULL;
+   size_t ulDepth;
+   size_t ulIndex = 0;
+   int iStatus;
+
+   assert(oPPath != NULL);
+   assert(oSSlab != NULL);
+   assert(poNResult != NULL);
+
+   ulDepth = Path_getDepth(oPPath);
+
+   /* validate the new node's place under its parent */
+   if(oNParent != NULL) {
+      assert(!Node_isShared(oNParent));
+
+      /* parent must be an ancestor of child */
+      if(!Node_isPrefixOf(oNParent, oPPath)) {
+         *poNResult = NULL;
+         return CONFLICTING_PATH;
+      }
+
+      /* parent must be exactly one level up from child */
+      if(ulDepth != oNParent->ulDepth + 1) {
+         *poNResult = NULL;
+         return NO_SUCH_PATH;
+      }
+
+      /* parent must not already have child with this path */
+      if(Node_hasChild(oNParent, oPPath, &ulIndex)) {
+         *poNResult = NULL;
+         return ALREADY_IN_TREE;
+      }
+   }
+   else {
+      /* new node must be root */
+      /* can only create one "level" at a time */
+      if(ulDepth != 1) {
+         *poNResult = NULL;
+         return NO_SUCH_PATH;
+      }
+   }
+
+   /* the directories of a concurrent directory are concurrent, with
+      locks of their own, and its files keep their contents in records
+      of their own */
+   if(oNParent != NULL)
+      psArray = Node_published(oNParent);
+   if(psArray != NULL && state != A_FILE) {
+      psLock = oNParent->uContents.sDir.psLock;
+      psLock = Node_newLock(oSSlab, psLock->oVVersions);
+      if(psLock == NULL) {
+         *poNResult = NULL;
+         return MEMORY_ERROR;
+      }
+   }
+   else if(psArray != NULL) {
+      psRecord = Node_newRecord(oSSlab, pvContents, ulLength);
+      if(psRecord == NULL) {
+         *poNResult = NULL;
+         return MEMORY_ERROR;
+      }
+   }
+
+   /* allocate space for a new node */
+   psNew = Slab_alloc(oSSlab, sizeof(struct node));
+   if(psNew == NULL) {
+      if(psLock != NULL) {
+         (void) pthread_mutex_destroy(&psLock->sMutex);
+         Slab_release(oSSlab, psLock, sizeof(struct dirLock));
+      }
+      Slab_release(oSSlab, psRecord, sizeof(struct fileRecord));
+      *poNResult = NULL;
+      return MEMORY_ERROR;
+   }
+
+   /* keep only the new node's own name; the rest of its path is
+      recovered through its ancestors */
+   psNew->pcName = Atom_dup(Path_getComponent(oPPath, ulDepth - 1));
+   psNew->ulDepth = ulDepth;
+   psNew->ulPathLength = Atom_getLength(psNew->pcName);
+   if(oNParent != NULL)
+      psNew->ulPathLength += oNParent->ulPathLength + 1;
+   psNew->oNParent = oNParent;
+   psNew->ulRefs = 1;
+   psNew->oNCopy = psNew;
+   psNew->state = state;
+   if(state == A_FILE) {
+      psNew->uContents.sFile.a_file = psRecord == NULL ? pvContents
+                                                       : NULL;
+      psNew->uContents.sFile.size_of_file = psRecord == NULL ? ulLength
+                                                             : 0;
+      psNew->uContents.sFile.psRecord = psRecord;
+   }
+   else {
+      psNew->uContents.sDir.psPublished =
+         psLock != NULL ? &sNoChildren : NULL;
+      psNew->uContents.sDir.psLock = psLock;
+   }
+   psNew->psChildren = NULL;
+   psNew->ulChildCount = 0;
+   psNew->uChildCapacity = 0;
+   psNew->oCChildren = NULL;
+   psNew->psIndex = NULL;
+
+   /* Link into parent's children list, where readers of a concurrent
+      tree may see it at once */
+   if(oNParent != NULL) {
+      if(psArray != NULL)
+         iStatus = Node_publishChild(oNParent, psArray, psNew, ulIndex,
+                                     oSSlab);
+      else
+         iStatus = Node_addChild(oNParent, psNew, ulIndex, oSSlab);
+      if(iStatus != SUCCESS) {
+         if(psLock != NULL) {
+            (void) pthread_mutex_destroy(&psLock->sMutex);
+            Slab_release(oSSlab, psLock, sizeof(struct dirLock));
+         }
+         Slab_release(oSSlab, psRecord, sizeof(struct fileRecord));
+         Atom_free(psNew->pcName);
+         Slab_release(oSSlab, psNew, sizeof(struct node));
+         *poNResult = NULL;
+         return iStatus;
+      }
+      if(psArray == NULL)
+         Node_indexChild(oNParent, psNew, ulIndexThreshold, oSSlab);
+   }
+
+   *poNResult = psNew;
+   return SUCCESS;
+}
+
+/*
+  Node_create, holding oNParent's lock if it is a concurrent directory,
+  so that writers adding to it or removing from it at once wait for
+  one another. Returns NO_SUCH_PATH if a writer is retiring oNParent,
+  once that writer has unlinked it.
+*/
+static int Node_insert(Path_T oPPath, Node_T oNParent, Slab_T oSSlab,
+                       size_t ulIndexThreshold, Node_T *poNResult,
+                       int state, void *pvContents, size_t ulLength) {
+   int iStatus;
+
+   assert(poNResult != NULL);
+
+   if(oNParent == NULL || Node_published(oNParent) == NULL)
+      return Node_create(oPPath, oNParent, oSSlab, ulIndexThreshold,
+                         poNResult, state, pvContents, ulLength);
+
+   if(!Node_lockUnlessRetired(oNParent)) {
+      *poNResult = NULL;
+      return NO_SUCH_PATH;
+   }
+   iStatus = Node_create(oPPath, oNParent, oSSlab, ulIndexThreshold,
+                         poNResult, state, pvContents, ulLength);
+   Node_unlock(oNParent);
+   return iStatus;
+}
+
+int Node_new(Path_T oPPath, Node_T oNParent, Slab_T oSSlab,
+             size_t ulIndexThreshold, Node_T *poNResult, int state) {
+   return Node_insert(oPPath, oNParent, oSSlab, ulIndexThreshold,
+                      poNResult, state, NULL, 0);
+}
+
+int Node_newFile(Path_T oPPath, Node_T oNParent, Slab_T oSSlab,
+                 size_t ulIndexThreshold, Node_T *poNResult,
+                 void *pvContents, size_t ulLength) {
+   return Node_insert(oPPath, oNParent, oSSlab, ulIndexThreshold,
+                      poNResult, A_FILE, pvContents, ulLength);
+}
+
+/*
+  Takes oNNode out of its parent's children, if it has a parent, which
+  must not be concurrent, returning the parent's slots for it to
+  oSSlab.
+*/
+static void Node_unlink(Node_T oNNode, Slab_T oSSlab) {
+   Node_T oNParent;
+   size_t ulIndex = 0;
+
+   assert(oNNode != NULL);
+   assert(oSSlab != NULL);
+
+   oNParent = EPOCH_LOAD(&oNNode->oNParent);
+   if(oNParent == NULL)
+      return;
+   assert(Node_published(oNParent) == NULL);
+   assert(!Node_isShared(oNNode));
+   assert(!Node_isShared(oNParent));
+   if(Node_hasChildNamed(oNParent, oNNode->pcName,
+                         Atom_getLength(oNNode->pcName), &ulIndex))
+      Node_removeChild(oNParent, ulIndex, oSSlab);
+}
+
+size_t Node_free(Node_T oNNode, Slab_T oSSlab) {
+   assert(oNNode != NULL);
+   assert(oSSlab != NULL);
+   /* assert(CheckerDT_Node_isValid(oNNode)); */
+
+   /* remove from parent's list */
+   Node_unlink(oNNode, oSSlab);
+
+   /* release the descendents bottom-up, then the node itself */
+   return Node_freeSubtree(oNNode, oSSlab, NULL);
+}
+
+size_t Node_freeShared(Node_T oNNode, Slab_T oSSlab,
+                       NodeVersions_T oVVersions, Node_T *poNDead) {
+   size_t ulCount;
+
+   assert(oNNode != NULL);
+   assert(oSSlab != NULL);
+   assert(oVVersions != NULL);
+
+   Node_unlink(oNNode, oSSlab);
+   Node_lockVersions(oVVersions);
+   ulCount = Node_freeSubtree(oNNode, oSSlab, poNDead);
+   Node_unlockVersions(oVVersions);
+   return ulCount;
+}
+
+void Node_releaseDead(Node_T oNDead, Slab_T oSSlab) {
+   Node_T oNNext;
+
+   assert(oSSlab != NULL);
+
+   for(; oNDead != NULL; oNDead = oNNext) {
+      oNNext = oNDead->oNCopy;
+      Node_release(oNDead, oSSlab);
+   }
+}
+
+NodeVersions_T Node_newVersions(EpochList_T oEList) {
+   NodeVersions_T oVVersions;
+
+   assert(oEList != NULL);
+
+   oVVersions = malloc(sizeof(struct nodeVersions));
+   if(oVVersions == NULL)
+      return NULL;
+   if(pthread_mutex_init(&oVVersions->sMutex, NULL) != 0) {
+      free(oVVersions);
+      return NULL;
+   }
+   oVVersions->oEList = oEList;
+   return oVVersions;
+}
+
+void Node_freeVersions(NodeVersions_T oVVersions) {
+   assert(oVVersions != NULL);
+
+   (void) pthread_mutex_destroy(&oVVersions->sMutex);
+   free(oVVersions);
+}
+
+void Node_share(Node_T oNNode) {
+   assert(oNNode != NULL);
+   assert(Node_getParent(oNNode) == NULL);
+
+   Node_hold(oNNode);
+}
+
+boolean Node_isShared(Node_T oNNode) {
+   assert(oNNode != NULL);
+
+   return (boolean) (Node_refs(oNNode) > 1);
+}
+
+/*
+  Puts oNChild, which has the same name as the child at index ulIndex
+  of oNParent, in that child's place in oNParent's children array and
+  child index.
+*/
+static void Node_setChild(Node_T oNParent, size_t ulIndex,
+                          Node_T oNChild) {
+   assert(oNParent != NULL);
+   assert(ulIndex < oNParent->ulChildCount);
+   assert(oNChild != NULL);
+
+   if(oNParent->oCChildren != NULL)
+      (void) ChunkArray_set(oNParent->oCChildren, ulIndex, oNChild);
+   else
+      oNParent->psChildren[ulIndex].pvElement = oNChild;
+   if(oNParent->psIndex != NULL)
+      Node_indexReplace(oNParent->psIndex, oNChild);
+}
+
+/*
+  Gives psCopy, a new copy of oNNode without children, a children
+  array of its own from oSSlab, of the same kind as oNNode's and with
+  the same children. Returns SUCCESS, or MEMORY_ERROR, leaving psCopy
+  without children, if memory could not be allocated.
+*/
+static int Node_copyChildren(struct node *psCopy, Node_T oNNode,
+                             Slab_T oSSlab) {
+   struct ChunkEntry *psEntries = oNNode->psChildren;
+   struct ChunkEntry *psChunk;
+   size_t ulChunk, ulCount;
+   size_t i = 0;
+   boolean bCopied;
+
+   assert(psCopy != NULL);
+   assert(oNNode != NULL);
+   assert(oSSlab != NULL);
+
+   if(oNNode->ulChildCount == 0)
+      return SUCCESS;
+
+   /* chunks are copied by way of a flat array */
+   if(oNNode->oCChildren != NULL) {
+      psEntries = malloc(oNNode->ulChildCount
+                         * sizeof(struct ChunkEntry));
+      if(psEntries == NULL)
+         return MEMORY_ERROR;
+      for(ulChunk = 0;
+          ulChunk < ChunkArray_getChunkCount(oNNode->oCChildren);
+          ulChunk++) {
+         psChunk = ChunkArray_getChunk(oNNode->oCChildren, ulChunk,
+                                       &ulCount);
+         memcpy(psEntries + i, psChunk,
+                ulCount * sizeof(struct ChunkEntry));
+         i += ulCount;
+      }
+      psCopy->oCChildren = ChunkArray_new(oSSlab, psEntries,
+                                          oNNode->ulChildCount);
+   }
+   else {
+      psCopy->psChildren = Slab_alloc(oSSlab, oNNode->uChildCapacity
+                                      * sizeof(struct ChunkEntry));
+      if(psCopy->psChildren != NULL) {
+         memcpy(psCopy->psChildren, psEntries, oNNode->ulChildCount
+                * sizeof(struct ChunkEntry));
+         psCopy->uChildCapacity = oNNode->uChildCapacity;
+      }
+   }
+
+   bCopied = (boolean) (psCopy->psChildren != NULL
+                        || psCopy->oCChildren != NULL);
+   if(oNNode->oCChildren != NULL)
+      free(psEntries);
+   return bCopied ? SUCCESS : MEMORY_ERROR;
+}
+
+/*
+  Gives psCopy, a new copy of the concurrent directory oNNode, whose
+  published children array is psArray, a lock of its own for a tree
+  with versions oVVersions and a copy of psArray, both allocated from
+  oSSlab. The copy of psArray shares none of its chunks, as a change
+  to the copy must not free one that oNNode still has. Returns
+  SUCCESS, or MEMORY_ERROR, leaving psCopy without either, if memory
+  could not be allocated.
 */
-static int Node_addChild(Node_T oNParent, Node_T oNChild,
-                         size_t ulIndex) {
-   assert(oNParent != NULL);
-   assert(oNChild != NULL);
+static int Node_copyPublished(struct node *psCopy,
+                              const struct childArray *psArray,
+                              Slab_T oSSlab,
+                              NodeVersions_T oVVersions) {
+   struct childArray *psNew = &sNoChildren;
+   struct dirLock *psLock;
+   struct childChunk *psChunk;
+   size_t i;
 
-   if(DynArray_addAt(oNParent->oDChildren, ulIndex, oNChild))
-      return SUCCESS;
-   else
+   assert(psCopy != NULL);
+   assert(psArray != NULL);
+   assert(oSSlab != NULL);
+
+   psCopy->uContents.sDir.psPublished = NULL;
+   psCopy->uContents.sDir.psLock = NULL;
+   psLock = Node_newLock(oSSlab, oVVersions);
+   if(psLock == NULL)
+      return MEMORY_ERROR;
+   if(psArray != &sNoChildren)
+      psNew = Node_newArray(oSSlab, psArray->ulCount,
+                            psArray->ulChunks);
+   for(i = 0; psNew != NULL && i < psArray->ulChunks; i++) {
+      psChunk = psArray->asChunks[i].psChunk;
+      psNew->asChunks[i].ulBase = psArray->asChunks[i].ulBase;
+      psNew->asChunks[i].psChunk = Node_newChunk(oSSlab,
+                                                 psChunk->asEntries,
+                                                 psChunk->ulCount);
+      if(psNew->asChunks[i].psChunk == NULL) {
+         psNew->ulChunks = i;
+         Node_freeArray(psNew, TRUE);
+         psNew = NULL;
+      }
+   }
+   if(psNew == NULL) {
+      (void) pthread_mutex_destroy(&psLock->sMutex);
+      Slab_release(oSSlab, psLock, sizeof(struct dirLock));
       return MEMORY_ERROR;
+   }
+
+   psCopy->uContents.sDir.psPublished = psNew;
+   psCopy->uContents.sDir.psLock = psLock;
+   return SUCCESS;
 }
 
 /*
-  Compares the string representation of oNfirst with a string
-  pcSecond representing a node's path.
-  Returns <0, 0, or >0 if oNFirst is "less than", "equal to", or
-  "greater than" pcSecond, respectively.
+  Returns a copy of the concurrent directory's children array psOld
+  with oNChild, which has the same name, in place of the child at
+  index ulIndex, or NULL if insufficient memory is available. The copy
+  shares all psOld's chunks but that child's, which it replaces with a
+  changed copy allocated with it from oSSlab, and psOld is marked to
+  free the chunk along with it.
 */
-static int Node_compareString(const Node_T oNFirst,
-                                 const char *pcSecond) {
-   assert(oNFirst != NULL);
-   assert(pcSecond != NULL);
+static struct childArray *Node_replaceEntry(struct childArray *psOld,
+                                            size_t ulIndex,
+                                            Node_T oNChild,
+                                            Slab_T oSSlab) {
+   struct childArray *psNew;
+   struct childChunk *psChunk;
+   size_t ulChunk;
+
+   assert(psOld != NULL);
+   assert(ulIndex < psOld->ulCount);
+   assert(oNChild != NULL);
+   assert(oSSlab != NULL);
+
+   ulChunk = Node_chunkOf(psOld, ulIndex);
+   psChunk = Node_newChunk(oSSlab, psOld->asChunks[ulChunk]
+                           .psChunk->asEntries,
+                           psOld->asChunks[ulChunk].psChunk->ulCount);
+   if(psChunk == NULL)
+      return NULL;
+   psNew = Node_newArray(oSSlab, psOld->ulCount, psOld->ulChunks);
+   if(psNew == NULL) {
+      Node_freeChunk(oSSlab, psChunk);
+      return NULL;
+   }
+
+   psChunk->asEntries[ulIndex - psOld->asChunks[ulChunk].ulBase]
+      .pvElement = oNChild;
+   memcpy(psNew->asChunks, psOld->asChunks,
+          psOld->ulChunks * sizeof(struct chunkRef));
+   psNew->asChunks[ulChunk].psChunk = psChunk;
+   psOld->psReplaced = psOld->asChunks[ulChunk].psChunk;
+   return psNew;
+}
+
+/* Adds a hold on each child of the directory oNNode. */
+static void Node_holdChildren(Node_T oNNode) {
+   struct childArray *psArray;
+   size_t ulCount;
+   size_t i;
 
-   return Path_compareString(oNFirst->oPPath, pcSecond);
+   assert(oNNode != NULL);
+
+   psArray = Node_published(oNNode);
+   ulCount = Node_countIn(oNNode, psArray);
+   for(i = 0; i < ulCount; i++)
+      Node_hold(Node_childAt(oNNode, psArray, i));
 }
 
 /*
-  Compares oNFirst and oNSecond lexicographically based on their paths.
-  Returns <0, 0, or >0 if onFirst is "less than", "equal to", or
-  "greater than" oNSecond, respectively.
+  Returns a new copy of oNNode for parent oNParent, allocated from
+  oSSlab, with oNNode's name and contents and its own copy of
+  oNNode's children, indexed if there are more than ulIndexThreshold
+  of them, but holding none of them and not yet in the ring of
+  oNNode's copies, or NULL if insufficient memory is available. The
+  fields of oNNode are read one by one, since other versions may be
+  changing its holds and parent link meanwhile.
 */
-static int Node_compare(Node_T oNFirst, Node_T oNSecond) {
-   assert(oNFirst != NULL);
-   assert(oNSecond != NULL);
+static struct node *Node_newCopy(Node_T oNNode, Node_T oNParent,
+                                 Slab_T oSSlab,
+                                 NodeVersions_T oVVersions,
+                                 size_t ulIndexThreshold) {
+   struct node *psCopy;
+   struct childArray *psArray;
+   struct fileRecord *psRecord;
+   int iStatus = SUCCESS;
+
+   assert(oNNode != NULL);
+   assert(oSSlab != NULL);
+
+   psCopy = Slab_alloc(oSSlab, sizeof(struct node));
+   if(psCopy == NULL)
+      return NULL;
+   psCopy->pcName = Atom_dup(oNNode->pcName);
+   psCopy->ulDepth = oNNode->ulDepth;
+   psCopy->ulPathLength = oNNode->ulPathLength;
+   psCopy->oNParent = oNParent;
+   psCopy->ulRefs = 0;
+   psCopy->oNCopy = psCopy;
+   psCopy->psChildren = NULL;
+   psCopy->ulChildCount = oNNode->ulChildCount;
+   psCopy->oCChildren = NULL;
+   psCopy->psIndex = NULL;
+   psCopy->state = oNNode->state;
+   psCopy->uChildCapacity = 0;
+   psCopy->uContents = oNNode->uContents;
 
-   return Path_comparePath(oNFirst->oPPath, oNSecond->oPPath);
+   psArray = Node_published(oNNode);
+   psRecord = NULL;
+   if(oNNode->state == A_FILE)
+      psRecord = EPOCH_LOAD(&oNNode->uContents.sFile.psRecord);
+   if(psArray != NULL)
+      iStatus = Node_copyPublished(psCopy, psArray, oSSlab,
+                                   oVVersions);
+   else if(psRecord != NULL) {
+      psCopy->uContents.sFile.psRecord =
+         Node_newRecord(oSSlab, psRecord->pvContents,
+                        psRecord->ulLength);
+      if(psCopy->uContents.sFile.psRecord == NULL)
+         iStatus = MEMORY_ERROR;
+   }
+   else if(oNNode->state != A_FILE) {
+      iStatus = Node_copyChildren(psCopy, oNNode, oSSlab);
+      if(iStatus == SUCCESS && psCopy->ulChildCount > ulIndexThreshold)
+         Node_buildIndex(psCopy, ulIndexThreshold, oSSlab);
+   }
+   if(iStatus != SUCCESS) {
+      Node_release(psCopy, oSSlab);
+      return NULL;
+   }
+   return psCopy;
 }
 
-int Node_new(Path_T oPPath, Node_T oNParent, Node_T *poNResult, int state) {
-   struct node *psNew;
-   Path_T oPParentPath = NULL;
-   Path_T oPNewPath = NULL;
-   size_t ulParentDepth;
+int Node_copy(Node_T oNNode, Node_T oNParent, Slab_T oSSlab,
+              NodeVersions_T oVVersions, size_t ulIndexThreshold,
+              Node_T *poNResult) {
+   struct node *psCopy;
+   struct childArray *psParentArray = NULL;
+   struct childArray *psNewArray = NULL;
+   boolean bConcurrent;
+   boolean bShared;
    size_t ulIndex = 0;
-   int iStatus;
+   boolean bFound;
+   int iStatus = SUCCESS;
 
-   assert(oPPath != NULL);
+   assert(oNNode != NULL);
+   assert(oSSlab != NULL);
+   assert(oVVersions != NULL);
    assert(poNResult != NULL);
 
-   /* allocate space for a new node */
-   psNew = malloc(sizeof(struct node));
-   if(psNew == NULL) {
-      *poNResult = NULL;
+   *poNResult = NULL;
+   bConcurrent = (boolean) (Node_published(oNNode) != NULL);
+   psCopy = Node_newCopy(oNNode, oNParent, oSSlab, oVVersions,
+                         ulIndexThreshold);
+   if(psCopy == NULL)
       return MEMORY_ERROR;
-   }
 
-   /* set the new node's path */
-   iStatus = Path_dup(oPPath, &oPNewPath);
-   if(iStatus != SUCCESS) {
-      free(psNew);
-      *poNResult = NULL;
-      return iStatus;
-   }
-   psNew->oPPath = oPNewPath;
-   psNew->state = state;
-   psNew->size_of_file = 0;
-
-   /* validate and set the new node's parent */
-   if(oNParent != NULL) {
-      size_t ulSharedDepth;
-
-      oPParentPath = oNParent->oPPath;
-      ulParentDepth = Path_getDepth(oPParentPath);
-      ulSharedDepth = Path_getSharedPrefixDepth(psNew->oPPath,
-                                                oPParentPath);
-      /* parent must be an ancestor of child */
-      if(ulSharedDepth < ulParentDepth) {
-         Path_free(psNew->oPPath);
-         free(psNew);
-         *poNResult = NULL;
-         return CONFLICTING_PATH;
+   /* a concurrent parent stays locked until the copy has taken
+      oNNode's place, and a concurrent oNNode until it is marked as
+      replaced, so writers that found it before find it gone */
+   if(oNParent != NULL)
+      psParentArray = Node_published(oNParent);
+   if(psParentArray != NULL) {
+      if(!Node_lockUnlessRetired(oNParent)) {
+         Node_release(psCopy, oSSlab);
+         return NO_SUCH_PATH;
       }
-
-      /* parent must be exactly one level up from child */
-      if(Path_getDepth(psNew->oPPath) != ulParentDepth + 1) {
-         Path_free(psNew->oPPath);
-         free(psNew);
-         *poNResult = NULL;
+      psParentArray = Node_published(oNParent);
+      if(!Node_holdsChild(oNParent, psParentArray, oNNode, &ulIndex)) {
+         Node_unlock(oNParent);
+         Node_release(psCopy, oSSlab);
          return NO_SUCH_PATH;
       }
+   }
+   else if(oNParent != NULL) {
+      assert(!Node_isShared(oNParent));
+      bFound = Node_hasChildNamed(oNParent, oNNode->pcName,
+                                  Atom_getLength(oNNode->pcName),
+                                  &ulIndex);
+      assert(bFound);
+      assert(Node_childAt(oNParent, NULL, ulIndex) == oNNode);
+      (void) bFound;
+   }
+   if(bConcurrent)
+      Node_lock(oNNode);
 
-      /* parent must not already have child with this path */
-      if(Node_hasChild(oNParent, oPPath, &ulIndex)) {
-         Path_free(psNew->oPPath);
-         free(psNew);
-         *poNResult = NULL;
-         return ALREADY_IN_TREE;
-      }
+   /* the other versions may have let go of oNNode since the caller
+      found it shared, leaving it to oNParent alone */
+   Node_lockVersions(oVVersions);
+   bShared = Node_isShared(oNNode);
+   if(bShared && psParentArray != NULL) {
+      psNewArray = Node_replaceEntry(psParentArray, ulIndex, psCopy,
+                                     oSSlab);
+      if(psNewArray == NULL)
+         iStatus = MEMORY_ERROR;
    }
-   else {
-      /* new node must be root */
-      /* can only create one "level" at a time */
-      if(Path_getDepth(psNew->oPPath) != 1) {
-         Path_free(psNew->oPPath);
-         free(psNew);
-         *poNResult = NULL;
-         return NO_SUCH_PATH;
-      }
+   if(bShared && iStatus == SUCCESS) {
+      /* oNNode was the newest copy, and the copy is newer */
+      Node_holdChildren(psCopy);
+      psCopy->ulRefs = 1;
+      psCopy->oNCopy = oNNode->oNCopy;
+      oNNode->oNCopy = psCopy;
+
+      /* oNParent's hold on oNNode passes to the copy */
+      if(psNewArray != NULL)
+         Node_replaceArray(oNParent, psParentArray, psNewArray, NULL);
+      else if(oNParent != NULL)
+         Node_setChild(oNParent, ulIndex, psCopy);
+      (void) Node_unhold(oNNode);
    }
-   psNew->oNParent = oNParent;
+   Node_unlockVersions(oVVersions);
 
-   /* initialize the new node */
-   psNew->oDChildren = DynArray_new(0);
-   if(psNew->oDChildren == NULL) {
-      Path_free(psNew->oPPath);
-      free(psNew);
-      *poNResult = NULL;
-      return MEMORY_ERROR;
+   if(bConcurrent) {
+      if(bShared && iStatus == SUCCESS)
+         oNNode->uContents.sDir.psLock->bRetired = TRUE;
+      Node_unlock(oNNode);
    }
+   if(psParentArray != NULL)
+      Node_unlock(oNParent);
 
-   /* Link into parent's children list */
-   if(oNParent != NULL) {
-      iStatus = Node_addChild(oNParent, psNew, ulIndex);
-      if(iStatus != SUCCESS) {
-         Path_free(psNew->oPPath);
-         free(psNew);
-         *poNResult = NULL;
-         return iStatus;
-      }
+   if(!bShared || iStatus != SUCCESS) {
+      Node_release(psCopy, oSSlab);
+      if(iStatus == SUCCESS)
+         *poNResult = oNNode;
+      return iStatus;
    }
+   *poNResult = psCopy;
+   return SUCCESS;
+}
 
-   *poNResult = psNew;
+/*
+  Node_walk visitor that counts the nodes in the size_t that pvCount
+  points to, and marks each directory as being retired, holding its
+  lock, so that no writer changes its children from then on. The walk
+  loads a directory's children after its pre-order visit, so finds
+  all it will ever have.
+*/
+static int Node_markRetired(Node_T oNNode, int iOrder, void *pvCount) {
+   assert(oNNode != NULL);
+   assert(pvCount != NULL);
+   (void) iOrder;
+
+   if(oNNode->state != A_FILE) {
+      Node_lock(oNNode);
+      oNNode->uContents.sDir.psLock->bRetired = TRUE;
+      Node_unlock(oNNode);
+   }
+   (*(size_t *) pvCount)++;
    return SUCCESS;
 }
 
-size_t Node_free(Node_T oNNode) {
+int Node_retire(Node_T oNNode, Node_T *poNRoot, Slab_T oSSlab,
+                size_t *pulCount) {
+   Node_T oNParent;
+   struct childArray *psOld;
+   struct childArray *psNew;
    size_t ulIndex = 0;
-   size_t ulCount = 0;
+   int iStatus;
 
    assert(oNNode != NULL);
-   /* assert(CheckerDT_Node_isValid(oNNode)); */
+   assert(oSSlab != NULL);
+   assert(pulCount != NULL);
 
-   /* remove from parent's list */
-   if(oNNode->oNParent != NULL) {
-      if(DynArray_bsearch(
-            oNNode->oNParent->oDChildren,
-            oNNode, &ulIndex,
-            (int (*)(const void *, const void *)) Node_compare)
-        )
-         (void) DynArray_removeAt(oNNode->oNParent->oDChildren,
-                                  ulIndex);
+   /* allocate all that is needed before changing anything: for the
+      root, an empty array just to carry it to Epoch_retire */
+   oNParent = EPOCH_LOAD(&oNNode->oNParent);
+   if(oNParent == NULL) {
+      assert(poNRoot != NULL);
+      assert(*poNRoot == oNNode);
+      psNew = NULL;
+      psOld = Node_newArray(oSSlab, 0, 0);
+      if(psOld == NULL)
+         return MEMORY_ERROR;
+   }
+   else {
+      /* another writer may have unlinked oNNode or its parent since
+         the caller found it */
+      if(!Node_lockUnlessRetired(oNParent))
+         return NO_SUCH_PATH;
+      psOld = Node_published(oNParent);
+      assert(psOld != NULL);
+      if(!Node_holdsChild(oNParent, psOld, oNNode, &ulIndex)) {
+         Node_unlock(oNParent);
+         return NO_SUCH_PATH;
+      }
+      psNew = Node_changeArray(psOld, ulIndex, NULL, oSSlab);
+      if(psNew == NULL) {
+         Node_unlock(oNParent);
+         return MEMORY_ERROR;
+      }
    }
 
-   /* recursively remove children */
-   while(DynArray_getLength(oNNode->oDChildren) != 0) {
-      ulCount += Node_free(DynArray_get(oNNode->oDChildren, 0));
+   *pulCount = 0;
+   iStatus = Node_walk(oNNode, Node_markRetired, pulCount,
+                       FT_WALK_PREORDER);
+   assert(iStatus == SUCCESS);
+   (void) iStatus;
+
+   if(oNParent == NULL) {
+      EPOCH_PUBLISH(poNRoot, NULL);
+      Node_retireArray(psOld, oNNode,
+                       oNNode->uContents.sDir.psLock->oVVersions);
+   }
+   else {
+      Node_replaceArray(oNParent, psOld, psNew, oNNode);
+      Node_unlock(oNParent);
    }
-   DynArray_free(oNNode->oDChildren);
+   return SUCCESS;
+}
 
-   /* free path */
-   Path_free(oNNode->oPPath);
+size_t Node_getDepth(Node_T oNNode) {
+   assert(oNNode != NULL);
 
-   /* finally, free the struct node */
-   free(oNNode);
-   ulCount++;
-   return ulCount;
+   return oNNode->ulDepth;
+}
+
+const char *Node_getName(Node_T oNNode) {
+   assert(oNNode != NULL);
+
+   return oNNode->pcName;
+}
+
+size_t Node_getPathLength(Node_T oNNode) {
+   assert(oNNode != NULL);
+
+   return oNNode->ulPathLength;
 }
 
-Path_T Node_getPath(Node_T oNNode) {
+char *Node_writePath(Node_T oNNode, char *pcDest) {
+   char *pcEnd;
+   char *pc;
+   size_t ulLength;
+
    assert(oNNode != NULL);
+   assert(pcDest != NULL);
 
-   return oNNode->oPPath;
+   /* fill in the components from the last one back to the root */
+   pcEnd = pcDest + oNNode->ulPathLength;
+   *pcEnd = '\0';
+   pc = pcEnd;
+   for(;;) {
+      ulLength = Atom_getLength(oNNode->pcName);
+      pc -= ulLength;
+      memcpy(pc, oNNode->pcName, ulLength);
+      oNNode = EPOCH_LOAD(&oNNode->oNParent);
+      if(oNNode == NULL)
+         break;
+      *--pc = '/';
+   }
+   assert(pc == pcDest);
+
+   return pcEnd;
 }
 
 boolean Node_hasChild(Node_T oNParent, Path_T oPPath,
                          size_t *pulChildID) {
+   struct name sName;
+
    assert(oNParent != NULL);
    assert(oPPath != NULL);
    assert(pulChildID != NULL);
+   /* siblings differ only in their last component */
+   assert(Path_getDepth(oPPath) == oNParent->ulDepth + 1);
+   assert(Node_isPrefixOf(oNParent, oPPath));
+
+   Node_componentName(oPPath, oNParent->ulDepth, &sName);
+   return Node_searchChildren(oNParent, Node_published(oNParent),
+                              &sName, pulChildID);
+}
+
+boolean Node_hasChildNamed(Node_T oNParent, const char *pcName,
+                           size_t ulLength, size_t *pulChildID) {
+   struct name sName;
+
+   assert(oNParent != NULL);
+   assert(pcName != NULL);
+   assert(pulChildID != NULL);
+
+   sName.pcName = pcName;
+   sName.ulLength = ulLength;
+   sName.ulKey = Node_nameKey(pcName, ulLength);
+   return Node_searchChildren(oNParent, Node_published(oNParent),
+                              &sName, pulChildID);
+}
+
+boolean Node_findChild(Node_T oNParent, Path_T oPPath,
+                       Node_T *poNResult) {
+   struct childArray *psArray;
+   struct childIndex *psIndex;
+   struct name sName;
+   const char *pcName;
+   size_t ulMask;
+   size_t ulIndex;
+
+   assert(oNParent != NULL);
+   assert(oPPath != NULL);
+   assert(poNResult != NULL);
+   assert(Path_getDepth(oPPath) > oNParent->ulDepth);
+
+   /* a concurrent directory has no index */
+   psArray = Node_published(oNParent);
+   psIndex = oNParent->psIndex;
+   if(psIndex != NULL) {
+      /* names are atoms, so the child's is the same pointer */
+      pcName = Path_getComponent(oPPath, oNParent->ulDepth);
+      ulMask = psIndex->ulSlots - 1;
+      ulIndex = (size_t) Path_getComponentHash(oPPath,
+                                               oNParent->ulDepth)
+         & ulMask;
+      for(; psIndex->asSlots[ulIndex].pcName != NULL;
+          ulIndex = (ulIndex + 1) & ulMask)
+         if(psIndex->asSlots[ulIndex].pcName == pcName) {
+            *poNResult = psIndex->asSlots[ulIndex].oNChild;
+            return TRUE;
+         }
+      *poNResult = NULL;
+      return FALSE;
+   }
+
+   Node_componentName(oPPath, oNParent->ulDepth, &sName);
+   if(!Node_searchChildren(oNParent, psArray, &sName, &ulIndex)) {
+      *poNResult = NULL;
+      return FALSE;
+   }
+   *poNResult = Node_childAt(oNParent, psArray, ulIndex);
+   return TRUE;
+}
+
+boolean Node_findChildNamed(Node_T oNParent, const char *pcName,
+                            size_t ulLength, Node_T *poNResult) {
+   struct childArray *psArray;
+   struct childIndex *psIndex;
+   struct name sName;
+   const char *pcSlotName;
+   size_t ulMask;
+   size_t ulIndex;
+
+   assert(oNParent != NULL);
+   assert(pcName != NULL);
+   assert(poNResult != NULL);
+
+   /* a concurrent directory has no index */
+   psArray = Node_published(oNParent);
+   psIndex = oNParent->psIndex;
+   if(psIndex != NULL) {
+      ulMask = psIndex->ulSlots - 1;
+      ulIndex = (size_t) Path_hashComponent(pcName, ulLength) & ulMask;
+      for(; psIndex->asSlots[ulIndex].pcName != NULL;
+          ulIndex = (ulIndex + 1) & ulMask) {
+         /* strncmp stops at the end of a shorter slot name */
+         pcSlotName = psIndex->asSlots[ulIndex].pcName;
+         if(strncmp(pcSlotName, pcName, ulLength) == 0
+            && pcSlotName[ulLength] == '\0') {
+            *poNResult = psIndex->asSlots[ulIndex].oNChild;
+            return TRUE;
+         }
+      }
+      *poNResult = NULL;
+      return FALSE;
+   }
+
+   sName.pcName = pcName;
+   sName.ulLength = ulLength;
+   sName.ulKey = Node_nameKey(pcName, ulLength);
+   if(!Node_searchChildren(oNParent, psArray, &sName, &ulIndex)) {
+      *poNResult = NULL;
+      return FALSE;
+   }
+   *poNResult = Node_childAt(oNParent, psArray, ulIndex);
+   return TRUE;
+}
+
+/*
+  Returns TRUE if iStatus, returned by a pre-order visit of a walk with
+  flags iFlags, asks the walk to pass over the node's descendants, or
+  FALSE if not.
+*/
+static boolean Node_skips(int iStatus, int iFlags) {
+   return (boolean) (iStatus == NODE_WALK_SKIP
+                     && (iFlags & NODE_WALK_PRUNE) != 0);
+}
+
+/*
+  Calls pfVisit for the file oNNode as Node_walk does: in pre-order
+  and then post-order, as iFlags asks. Returns the first status other
+  than SUCCESS that pfVisit returns, or SUCCESS.
+*/
+static int Node_visitFile(Node_T oNNode,
+                          int (*pfVisit)(Node_T oNNode, int iOrder,
+                                         void *pvContext),
+                          void *pvContext, int iFlags) {
+   int iStatus;
+
+   assert(oNNode != NULL);
+   assert(pfVisit != NULL);
+
+   if(iFlags & FT_WALK_PREORDER) {
+      iStatus = (*pfVisit)(oNNode, FT_WALK_PREORDER, pvContext);
+      if(Node_skips(iStatus, iFlags))
+         return SUCCESS;
+      if(iStatus != SUCCESS)
+         return iStatus;
+   }
+   if(iFlags & FT_WALK_POSTORDER)
+      return (*pfVisit)(oNNode, FT_WALK_POSTORDER, pvContext);
+   return SUCCESS;
+}
+
+/*
+  Epoch_retire callback that releases the nodes that the last walk to
+  let go of a directory left, which include the directory and so the
+  lock psRetired is the record of.
+*/
+static void Node_reclaimPinned(struct EpochRetired *psRetired) {
+   struct dirLock *psLock = (struct dirLock *) psRetired;
+
+   assert(psLock != NULL);
+
+   Node_releaseDead(psLock->oNDead, psLock->oSSlab);
+}
+
+/* Keeps oNDir, if it is a concurrent directory, for a walk. */
+static void Node_pin(Node_T oNDir) {
+   assert(oNDir != NULL);
+
+   if(Node_published(oNDir) != NULL)
+      (void) __atomic_add_fetch(&oNDir->uContents.sDir.psLock->ulPins,
+                                1, __ATOMIC_ACQ_REL);
+}
+
+/*
+  Lets go of oNDir, kept with Node_pin. If no version of the tree
+  holds it any more, and no other walk keeps it, frees it with the
+  descendants that only it holds: unlinks them from other versions
+  at once, and retires them to be released once no reader can still
+  be looking at them.
+*/
+static void Node_unpin(Node_T oNDir) {
+   struct dirLock *psLock;
+   NodeVersions_T oVVersions;
+
+   assert(oNDir != NULL);
+
+   if(Node_published(oNDir) == NULL)
+      return;
+   psLock = oNDir->uContents.sDir.psLock;
+   if(__atomic_sub_fetch(&psLock->ulPins, 1, __ATOMIC_ACQ_REL)
+      != NODE_ORPHANED)
+      return;
+
+   /* oNDir is released along with its lock, after the record */
+   oVVersions = psLock->oVVersions;
+   Node_lockVersions(oVVersions);
+   (void) Node_freeSubtree(oNDir, psLock->oSSlab, &psLock->oNDead);
+   Node_unlockVersions(oVVersions);
+   psLock->sRetired.pfFree = Node_reclaimPinned;
+   Epoch_retire(oVVersions->oEList, &psLock->sRetired);
+}
+
+/*
+  Lets go of the directories that a walk with NODE_WALK_REENTER keeps
+  on its way down to oNNode, which is ulLevel levels below the walk's
+  root, whose ancestors are on the walk's stack aoNParents.
+*/
+static void Node_unpinPath(Node_T oNNode, size_t ulLevel,
+                           Node_T aoNParents[]) {
+   assert(oNNode != NULL);
+   assert(aoNParents != NULL);
+
+   if(ulLevel <= WALK_STACK_DEPTH)
+      Node_unpin(oNNode);
+   else
+      ulLevel = WALK_STACK_DEPTH;
+   while(ulLevel > 0)
+      Node_unpin(aoNParents[--ulLevel]);
+}
+
+/* Ends the caller's read and starts another (see epoch.h). */
+static void Node_reenter(void) {
+   Epoch_leave();
+   Epoch_enter();
+}
+
+/*
+  Returns the parent of oNNode in the version of the tree that
+  oNAncestor, an ancestor of oNNode at least two levels up, is in.
+  oNNode's parent link may be to a copy of its parent that another
+  version holds, but the names on its path are the same in every
+  version, so the parent is found from oNAncestor down by them, which
+  takes time quadratic in the number of levels in between.
+*/
+static Node_T Node_parentBelow(Node_T oNAncestor, Node_T oNNode) {
+   Node_T oNCurr = oNAncestor;
+   Node_T oNOnPath;
+   size_t ulDepth;
+   boolean bFound;
+
+   assert(oNAncestor != NULL);
+   assert(oNNode != NULL);
+   assert(oNAncestor->ulDepth + 1 < oNNode->ulDepth);
+
+   for(ulDepth = oNAncestor->ulDepth + 1; ulDepth < oNNode->ulDepth;
+       ulDepth++) {
+      for(oNOnPath = oNNode; oNOnPath->ulDepth > ulDepth;
+          oNOnPath = EPOCH_LOAD(&oNOnPath->oNParent))
+         ;
+      bFound = Node_findChildNamed(oNCurr, oNOnPath->pcName,
+                                   Atom_getLength(oNOnPath->pcName),
+                                   &oNCurr);
+      assert(bFound);
+      (void) bFound;
+   }
+   return oNCurr;
+}
+
+int Node_walk(Node_T oNRoot,
+              int (*pfVisit)(Node_T oNNode, int iOrder,
+                             void *pvContext),
+              void *pvContext, int iFlags) {
+   /* the index to resume from at each level above oNNode */
+   size_t aulNext[WALK_STACK_DEPTH];
+   /* the children array of each level above oNNode, if concurrent */
+   struct childArray *apsArrays[WALK_STACK_DEPTH];
+   /* the node at each level above oNNode, which is not always the one
+      its parent link leads to when versions of the tree share nodes
+      (see Node_copy) */
+   Node_T aoNParents[WALK_STACK_DEPTH];
+   /* the number of levels oNNode is below oNRoot */
+   size_t ulLevel = 0;
+   /* the next of oNNode's children to look at; with files first, a
+      first pass over the children visits the files, then a second,
+      numbered on from the first, descends into the directories */
+   size_t ulNext = 0;
+   /* oNNode's children array, loaded once when the walk reaches it so
+      that both passes see the same children, if it is concurrent */
+   struct childArray *psArray;
+   size_t ulCount;
+   boolean bFilesFirst;
+   boolean bDirectoryPass;
+   boolean bReenter;
+   Node_T oNNode = oNRoot;
+   Node_T oNChild;
+   Node_T oNParent;
+   struct name sName;
+   size_t ulIndex;
+   int iStatus;
+
+   assert(oNRoot != NULL);
+   assert(pfVisit != NULL);
+
+   bFilesFirst = (boolean) ((iFlags & FT_WALK_FILES_FIRST) != 0);
+   bReenter = (boolean) ((iFlags & NODE_WALK_REENTER) != 0);
+   if(oNRoot->state == A_FILE)
+      return Node_visitFile(oNRoot, pfVisit, pvContext, iFlags);
+
+   if(iFlags & FT_WALK_PREORDER) {
+      iStatus = (*pfVisit)(oNRoot, FT_WALK_PREORDER, pvContext);
+      if(Node_skips(iStatus, iFlags))
+         return SUCCESS;
+      if(iStatus != SUCCESS)
+         return iStatus;
+   }
+
+   if(bReenter)
+      Node_pin(oNRoot);
+   psArray = Node_published(oNRoot);
+   for(;;) {
+      ulCount = Node_countIn(oNNode, psArray);
+      if(ulNext < (bFilesFirst ? 2 : 1) * ulCount) {
+         ulIndex = ulNext++;
+         bDirectoryPass = TRUE;
+         if(bFilesFirst) {
+            bDirectoryPass = (boolean) (ulIndex >= ulCount);
+            if(bDirectoryPass)
+               ulIndex -= ulCount;
+         }
+         oNChild = Node_childAt(oNNode, psArray, ulIndex);
+
+         if(oNChild->state == A_FILE) {
+            if(bFilesFirst && bDirectoryPass)
+               continue;
+            iStatus = Node_visitFile(oNChild, pfVisit, pvContext,
+                                     iFlags);
+            if(iStatus != SUCCESS)
+               break;
+            continue;
+         }
+         if(!bDirectoryPass)
+            continue;
+
+         /* descend into the directory */
+         if(iFlags & FT_WALK_PREORDER) {
+            iStatus = (*pfVisit)(oNChild, FT_WALK_PREORDER, pvContext);
+            if(Node_skips(iStatus, iFlags))
+               continue;
+            if(iStatus != SUCCESS)
+               break;
+         }
+         if(ulLevel < WALK_STACK_DEPTH) {
+            aulNext[ulLevel] = ulNext;
+            apsArrays[ulLevel] = psArray;
+            aoNParents[ulLevel] = oNNode;
+         }
+         ulLevel++;
+         oNNode = oNChild;
+         ulNext = 0;
+         /* the directories on the way down stay while the walk is
+            out of its read, as do those on the stack */
+         if(bReenter && ulLevel <= WALK_STACK_DEPTH) {
+            Node_pin(oNNode);
+            Node_reenter();
+         }
+         psArray = Node_published(oNNode);
+         continue;
+      }
+
+      /* done with oNNode's children: find where to resume in its
+         parent before visiting it, so the visitor may then release
+         oNNode's children */
+      if(ulLevel == 0) {
+         iStatus = SUCCESS;
+         break;
+      }
+      ulLevel--;
+      if(ulLevel < WALK_STACK_DEPTH)
+         oNParent = aoNParents[ulLevel];
+      /* the parent link of a node that only one directory holds leads
+         to that directory */
+      else if(Node_isShared(oNNode))
+         oNParent = Node_parentBelow(aoNParents[WALK_STACK_DEPTH - 1],
+                                     oNNode);
+      else
+         oNParent = EPOCH_LOAD(&oNNode->oNParent);
+      if(ulLevel < WALK_STACK_DEPTH && !bReenter) {
+         ulNext = aulNext[ulLevel];
+         psArray = apsArrays[ulLevel];
+      }
+      else {
+         /* what the walk loaded before a new read may be gone */
+         if(ulLevel < WALK_STACK_DEPTH)
+            Node_reenter();
+         /* a concurrent parent's children may have changed since, and
+            oNNode may be gone, so resume after where its name sorts */
+         psArray = Node_published(oNParent);
+         sName.pcName = oNNode->pcName;
+         sName.ulLength = Atom_getLength(oNNode->pcName);
+         sName.ulKey = Node_nameKey(sName.pcName, sName.ulLength);
+         if(Node_searchChildren(oNParent, psArray, &sName, &ulNext))
+            ulNext++;
+         else
+            assert(psArray != NULL);
+         if(bFilesFirst)
+            ulNext += Node_countIn(oNParent, psArray);
+      }
+      if(iFlags & FT_WALK_POSTORDER) {
+         iStatus = (*pfVisit)(oNNode, FT_WALK_POSTORDER, pvContext);
+         if(iStatus != SUCCESS) {
+            ulLevel++;
+            break;
+         }
+      }
+      if(bReenter && ulLevel < WALK_STACK_DEPTH)
+         Node_unpin(oNNode);
+      oNNode = oNParent;
+   }
+
+   if(iStatus == SUCCESS && (iFlags & FT_WALK_POSTORDER))
+      iStatus = (*pfVisit)(oNRoot, FT_WALK_POSTORDER, pvContext);
+   if(bReenter)
+      Node_unpinPath(oNNode, ulLevel, aoNParents);
+   return iStatus;
+}
+
+int Node_makeConcurrent(Node_T oNNode, Slab_T oSSlab,
+                        NodeVersions_T oVVersions) {
+   struct dirLock *psLock;
 
-   return DynArray_bsearch(oNParent->oDChildren,
-            (char*) Path_getPathname(oPPath), pulChildID,
-            (int (*)(const void*,const void*)) Node_compareString);
+   assert(oNNode != NULL);
+   assert(oNNode->state != A_FILE);
+   assert(oNNode->oNParent == NULL);
+   assert(oNNode->ulChildCount == 0);
+   assert(oSSlab != NULL);
+   assert(oVVersions != NULL);
+
+   psLock = Node_newLock(oSSlab, oVVersions);
+   if(psLock == NULL)
+      return MEMORY_ERROR;
+   oNNode->uContents.sDir.psPublished = &sNoChildren;
+   oNNode->uContents.sDir.psLock = psLock;
+   return SUCCESS;
 }
 
 size_t Node_getNumChildren(Node_T oNParent) {
    assert(oNParent != NULL);
 
-   return DynArray_getLength(oNParent->oDChildren);
+   return Node_countIn(oNParent, Node_published(oNParent));
 }
 
 int Node_getChild(Node_T oNParent, size_t ulChildID,
                    Node_T *poNResult) {
+   struct childArray *psArray;
+
    assert(oNParent != NULL);
    assert(poNResult != NULL);
 
-   if(ulChildID >= Node_getNumChildren(oNParent)) {
+   psArray = Node_published(oNParent);
+   if(ulChildID >= Node_countIn(oNParent, psArray)) {
       *poNResult = NULL;
       return NO_SUCH_PATH;
    }
    else {
-      *poNResult = DynArray_get(oNParent->oDChildren, ulChildID);
+      *poNResult = Node_childAt(oNParent, psArray, ulChildID);
       return SUCCESS;
    }
 }
@@ -238,7 +2759,7 @@ int Node_getChild(Node_T oNParent, size_t ulChildID,
 Node_T Node_getParent(Node_T oNNode) {
    assert(oNNode != NULL);
 
-   return oNNode->oNParent;
+   return EPOCH_LOAD(&oNNode->oNParent);
 }
 
 char *Node_toString(Node_T oNNode) {
@@ -246,11 +2767,11 @@ char *Node_toString(Node_T oNNode) {
 
    assert(oNNode != NULL);
 
-   copyPath = malloc(Path_getStrLength(Node_getPath(oNNode))+1);
+   copyPath = malloc(oNNode->ulPathLength + 1);
    if(copyPath == NULL)
       return NULL;
-   else
-      return strcpy(copyPath, Path_getPathname(Node_getPath(oNNode)));
+   (void) Node_writePath(oNNode, copyPath);
+   return copyPath;
 }
 
 int Node_getState(Node_T oNNode) {
@@ -258,30 +2779,94 @@ int Node_getState(Node_T oNNode) {
    return oNNode->state;
 }
 
+int Node_replaceFile(Node_T oNNode, void *pvContents, size_t ulLength,
+                     void **ppvOld) {
+   Node_T oNParent;
+   struct fileRecord *psOld;
+   struct fileRecord *psNew;
+   size_t ulIndex;
+
+   assert(oNNode != NULL);
+   assert(oNNode->state == A_FILE);
+   assert(ppvOld != NULL);
+
+   oNParent = EPOCH_LOAD(&oNNode->oNParent);
+   assert(oNParent != NULL);
+   psOld = EPOCH_LOAD(&oNNode->uContents.sFile.psRecord);
+   if(psOld == NULL) {
+      *ppvOld = Node_getFile(oNNode);
+      Node_setFile(oNNode, pvContents);
+      Node_setFileLength(oNNode, ulLength);
+      return SUCCESS;
+   }
+
+   psNew = Node_newRecord(psOld->oSSlab, pvContents, ulLength);
+   if(psNew == NULL)
+      return MEMORY_ERROR;
+   if(!Node_lockUnlessRetired(oNParent)) {
+      Slab_release(psNew->oSSlab, psNew, sizeof(struct fileRecord));
+      return NO_SUCH_PATH;
+   }
+   if(!Node_holdsChild(oNParent, Node_published(oNParent), oNNode,
+                       &ulIndex)) {
+      Node_unlock(oNParent);
+      Slab_release(psNew->oSSlab, psNew, sizeof(struct fileRecord));
+      return NO_SUCH_PATH;
+   }
+
+   /* the record is only replaced under the parent's lock */
+   psOld = oNNode->uContents.sFile.psRecord;
+   *ppvOld = psOld->pvContents;
+   EPOCH_PUBLISH(&oNNode->uContents.sFile.psRecord, psNew);
+   psOld->sRetired.pfFree = Node_reclaimRecord;
+   Epoch_retire(oNParent->uContents.sDir.psLock->oVVersions->oEList,
+                &psOld->sRetired);
+
+   Node_unlock(oNParent);
+   return SUCCESS;
+}
+
 void Node_setFile(Node_T oNNode, void* a_file) {
    assert(oNNode != NULL);
    assert(oNNode->state == A_FILE);
+   assert(oNNode->uContents.sFile.psRecord == NULL);
 
-   oNNode->a_file = a_file;
+   oNNode->uContents.sFile.a_file = a_file;
 }
 
 void* Node_getFile(Node_T oNNode) {
+   size_t ulLength;
+
+   return Node_getFileContents(oNNode, &ulLength);
+}
+
+void *Node_getFileContents(Node_T oNNode, size_t *pulLength) {
+   struct fileRecord *psRecord;
+
    assert(oNNode != NULL);
    assert(oNNode->state == A_FILE);
+   assert(pulLength != NULL);
 
-   return oNNode->a_file;
+   psRecord = EPOCH_LOAD(&oNNode->uContents.sFile.psRecord);
+   if(psRecord != NULL) {
+      *pulLength = psRecord->ulLength;
+      return psRecord->pvContents;
+   }
+   *pulLength = oNNode->uContents.sFile.size_of_file;
+   return oNNode->uContents.sFile.a_file;
 }
 
 void Node_setFileLength(Node_T oNNode, size_t ulLength) {
    assert(oNNode != NULL);
    assert(oNNode->state == A_FILE);
+   assert(oNNode->uContents.sFile.psRecord == NULL);
 
-   oNNode->size_of_file = ulLength;
+   oNNode->uContents.sFile.size_of_file = ulLength;
 }
 
 size_t Node_getFileLength(Node_T oNNode) {
-   assert(oNNode != NULL);
-   assert(oNNode->state == A_FILE);
+   size_t ulLength;
 
-   return oNNode->size_of_file;
+   (void) Node_getFileContents(oNNode, &ulLength);
+   return ulLength;
 }
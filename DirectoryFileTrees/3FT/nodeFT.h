@@ -8,36 +8,220 @@
 
 #include <stddef.h>
 #include "a4def.h"
+#include "epoch.h"
 #include "path.h"
+#include "slab.h"
 
 
 /* A Node_T is a node in a Directory Tree */
 typedef struct node *Node_T;
 
+/*
+  A NodeVersions_T is what the versions of a tree that share nodes
+  (see Node_share) have in common, so that threads may use different
+  versions at once: a lock held while nodes are copied and freed, and
+  the list that they retire what readers may still be looking at to
+  (see epoch.h). A concurrent tree (see Node_makeConcurrent) has one
+  from the start.
+*/
+typedef struct nodeVersions *NodeVersions_T;
+
 /*
   Creates a new node in the Directory Tree, with path oPPath and
   parent oNParent. The node is either a file or a directory, depending
-  on state. Returns an int SUCCESS status and sets *poNResult
-  to be the new node if successful. Otherwise, sets *poNResult to NULL
-  and returns status:
+  on state. The node, and the array of its children, are allocated
+  from oSSlab, the slab of the tree it belongs to. oNParent must not
+  be shared (see Node_share). Returns an int SUCCESS status and sets
+  *poNResult to be the new node if successful. Otherwise, sets
+  *poNResult to NULL and returns status:
   * MEMORY_ERROR if memory could not be allocated to complete request
   * CONFLICTING_PATH if oNParent's path is not an ancestor of oPPath
   * NO_SUCH_PATH if oPPath is of depth 0
                  or oNParent's path is not oPPath's direct parent
                  or oNParent is NULL but oPPath is not of depth 1
+                 or oNParent is concurrent and another writer has
+                 unlinked it (see Node_retire)
   * ALREADY_IN_TREE if oNParent already has a child with this path
+  A concurrent oNParent is locked while the child is linked in, so
+  writers adding to or removing from it at once wait for one another.
+
+  A directory that is not concurrent keeps a hash index of its
+  children by name once it has more than ulIndexThreshold of them, so
+  that Node_findChild and Node_findChildNamed do not have to
+  binary-search them. The index costs 32 to 128 bytes per child, is
+  dropped once the directory has fewer than half the threshold it was
+  built above, and is never needed for correctness: if memory for it
+  cannot be allocated, lookups fall back to binary search. 0 indexes
+  every directory, and (size_t) -1 none. A tree passes its threshold
+  to every call, so that a directory is only indexed or unindexed as
+  children are next added to or removed from it.
+*/
+int Node_new(Path_T oPPath, Node_T oNParent, Slab_T oSSlab,
+             size_t ulIndexThreshold, Node_T *poNResult, int state);
+
+/* The index threshold (see Node_new) above which hashing was measured
+   to beat binary search */
+enum { NODE_INDEX_THRESHOLD = 64 };
+
+/*
+  Like Node_new for a file, but gives the new file contents pvContents
+  of length ulLength before linking it into oNParent, so that readers
+  of a concurrent tree never see it without them.
 */
-int Node_new(Path_T oPPath, Node_T oNParent, Node_T *poNResult, int state);
+int Node_newFile(Path_T oPPath, Node_T oNParent, Slab_T oSSlab,
+                 size_t ulIndexThreshold, Node_T *poNResult,
+                 void *pvContents, size_t ulLength);
 
 /*
   Destroys and frees all memory allocated for the subtree rooted at
-  oNNode, i.e., deletes this node and all its descendents. Returns the
-  number of nodes deleted.
+  oNNode, i.e., deletes this node and all its descendents, but for
+  those that other versions of the tree still hold (see Node_copy),
+  which the subtree's version just stops holding. Returns the number
+  of nodes deleted. oSSlab must be the slab the nodes were allocated
+  from. Walks the subtree with Node_walk, so allocates no memory and
+  does not recurse, and passes over what other versions hold, so
+  takes time linear in the number deleted. oNNode and its parent must
+  not be shared unless oNNode is a root. Readers may be looking at any
+  node of a concurrent tree that has a parent, so such a node must be
+  removed with Node_retire instead. No other version of the tree may
+  be in use meanwhile; see Node_freeShared.
+*/
+size_t Node_free(Node_T oNNode, Slab_T oSSlab);
+
+/*
+  Node_free for a tree with versions oVVersions that other threads may
+  be using, holding oVVersions' lock meanwhile. Freeing a version that
+  is not the newest moves the parent links of the nodes it still
+  shares to newer copies, and a reader of another version may have
+  followed one just before, so if poNDead is not NULL, the nodes are
+  not released but stored in a list in *poNDead, for Node_releaseDead
+  to release once no reader can still be looking at them. The newest
+  version moves no link, so may pass NULL to release them at once.
+*/
+size_t Node_freeShared(Node_T oNNode, Slab_T oSSlab,
+                       NodeVersions_T oVVersions, Node_T *poNDead);
+
+/*
+  Releases to oSSlab the nodes of the list oNDead that Node_freeShared
+  stored, if any.
+*/
+void Node_releaseDead(Node_T oNDead, Slab_T oSSlab);
+
+/*
+  Returns a new NodeVersions_T for the versions of a tree that retire
+  to oEList, or NULL if insufficient memory is available.
+*/
+NodeVersions_T Node_newVersions(EpochList_T oEList);
+
+/* Frees oVVersions, which no version of its tree may use any more. */
+void Node_freeVersions(NodeVersions_T oVVersions);
+
+/*
+  Adds a hold on oNNode, the root of a tree, for a new version of the
+  tree to share it and all its descendants with the version that holds
+  it already, in constant time. Node_free on the root of each version
+  later drops its hold. A shared node must not be changed, so a
+  version that is to be changed first puts copies in place of the
+  shared nodes on the way to what it changes, with Node_copy. Holds
+  are counted atomically, so this may run while other threads use
+  other versions, but no writer may be changing oNNode's version.
+*/
+void Node_share(Node_T oNNode);
+
+/*
+  Returns TRUE if oNNode is held by more than one directory, or tree
+  for a root, so is shared by versions of its tree (see Node_share),
+  or FALSE if not.
 */
-size_t Node_free(Node_T oNNode);
+boolean Node_isShared(Node_T oNNode);
 
-/* Returns the path object representing oNNode's absolute path. */
-Path_T Node_getPath(Node_T oNNode);
+/*
+  Makes a copy of oNNode, which must be shared, for the version of its
+  tree that is being changed, which must be the newest version that
+  holds it, allocated from oSSlab, holding the lock of the tree's
+  versions oVVersions meanwhile. The copy takes oNNode's place in
+  oNParent, which must hold oNNode and not be shared, or if oNParent
+  is NULL, oNNode must be a root, and the caller puts the copy in its
+  place. The copy has oNNode's name, contents and children, which it
+  holds too, so costs time linear in its number of children; oNNode
+  is left as it is for the other versions. Nodes keep a link to their
+  parent, of which each is given the oldest copy that holds it, so
+  that freeing a version never leaves a link to what it freed. In a
+  concurrent tree, other writers find a directory that was copied as
+  they find one retired (see Node_retire), and the root must only be
+  copied by a writer that no other writer runs beside. Returns SUCCESS
+  and sets *poNResult to the copy, or to oNNode itself if the other
+  versions have let go of it since the caller found it shared, or
+  returns NO_SUCH_PATH if another writer to a concurrent tree has
+  unlinked oNNode or oNParent since, or MEMORY_ERROR, leaving the
+  tree unchanged, if memory could not be allocated. The copy is
+  indexed as Node_new would index it under ulIndexThreshold.
+*/
+int Node_copy(Node_T oNNode, Node_T oNParent, Slab_T oSSlab,
+              NodeVersions_T oVVersions, size_t ulIndexThreshold,
+              Node_T *poNResult);
+
+/*
+  Makes oNNode, a directory without a parent or children, the root of
+  a concurrent tree, in which readers may look up and walk nodes with
+  no locks while writers change the tree. Each directory of such a
+  tree publishes an array of its children that is never changed once
+  readers may see it: adding or removing a child publishes a copy,
+  and the old array is retired to the list of the tree's versions
+  oVVersions (see epoch.h). The array holds the children in chunks
+  that copies share, so the copy only copies the chunk that changes
+  and the list of chunks, costing time linear in the number of
+  siblings divided by the chunk size, plus the chunk size. Readers
+  must hold an epoch with Epoch_enter while they look at the tree,
+  and so must those of any version of a tree whose versions threads
+  use at once, as Node_freeShared explains. Each directory also has a
+  lock, allocated from oSSlab, that the writers adding a child to it
+  or removing one from it hold while they do, so writers changing
+  different directories never wait for one another; oSSlab must
+  therefore be locked (see Slab_newLocked). Concurrent directories
+  keep no child index, and the directories later created below
+  oNNode are concurrent too. Returns SUCCESS, or MEMORY_ERROR if the
+  lock could not be allocated.
+*/
+int Node_makeConcurrent(Node_T oNNode, Slab_T oSSlab,
+                        NodeVersions_T oVVersions);
+
+/*
+  Unlinks oNNode, a node of a concurrent tree, and its descendants
+  from the tree: from its parent's children, or if it is the root,
+  from *poNRoot, which must be the tree's link to it and is set to
+  NULL. They are retired rather than freed, and freed from oSSlab
+  once no reader can still be looking at them, so this never waits
+  for readers. Holds the parent's lock while it marks each directory
+  of the subtree as retired, after which writers find them gone, so
+  the subtree cannot change while it is counted. The root must only
+  be retired by a writer that no other writer runs beside. Stores the
+  number of nodes removed in *pulCount and returns SUCCESS, or returns
+  NO_SUCH_PATH if another writer has unlinked oNNode since the caller
+  found it, or MEMORY_ERROR, leaving the tree as it was, if the copy
+  of the parent's children could not be allocated.
+*/
+int Node_retire(Node_T oNNode, Node_T *poNRoot, Slab_T oSSlab,
+                size_t *pulCount);
+
+/* Returns the number of components in oNNode's absolute path. */
+size_t Node_getDepth(Node_T oNNode);
+
+/*
+  Returns the last component of oNNode's absolute path. The string is
+  an atom (see atom.h), valid for as long as oNNode is.
+*/
+const char *Node_getName(Node_T oNNode);
+
+/* Returns the string length of oNNode's absolute path. */
+size_t Node_getPathLength(Node_T oNNode);
+
+/*
+  Writes oNNode's absolute path, followed by a '\0', into pcDest, which
+  must have room for Node_getPathLength(oNNode) + 1 chars. Returns a
+  pointer to the '\0' written, where more text may be appended.
+*/
+char *Node_writePath(Node_T oNNode, char *pcDest);
 
 /*
   Returns TRUE if oNParent has a child with path oPPath. Returns
@@ -47,10 +231,91 @@ Path_T Node_getPath(Node_T oNNode);
   identifier (as used in Node_getChild). If oNParent does not have
   such a child, stores in *pulChildID the identifier that such a
   child _would_ have if inserted.
+
+  oPPath must be one level below oNParent's path. Only its last
+  component is compared, so the cost does not depend on its depth.
 */
 boolean Node_hasChild(Node_T oNParent, Path_T oPPath,
                          size_t *pulChildID);
 
+/*
+  Returns TRUE if oNParent has a child whose last path component is
+  the ulLength characters starting at pcName, which need not be
+  '\0'-terminated. Returns FALSE if it does not. Allocates no memory.
+
+  Sets *pulChildID as Node_hasChild does.
+*/
+boolean Node_hasChildNamed(Node_T oNParent, const char *pcName,
+                           size_t ulLength, size_t *pulChildID);
+
+/*
+  Returns TRUE and sets *poNResult to oNParent's child whose last path
+  component is oPPath's component one level below oNParent, if there
+  is one. Otherwise, sets *poNResult to NULL and returns FALSE.
+
+  oPPath must be below oNParent's path, but need not be just one level
+  below it, so a traversal can pass the same path at every level. In
+  a directory with a child index (see Node_new) this
+  takes expected constant time; otherwise it binary-searches the
+  children. Allocates no memory.
+*/
+boolean Node_findChild(Node_T oNParent, Path_T oPPath,
+                       Node_T *poNResult);
+
+/*
+  Like Node_findChild, but looks for the child whose last path
+  component is the ulLength characters starting at pcName, which need
+  not be '\0'-terminated.
+*/
+boolean Node_findChildNamed(Node_T oNParent, const char *pcName,
+                            size_t ulLength, Node_T *poNResult);
+
+/* A flag for Node_walk beside the FT_WALK_ ones of ft.h, with which
+   a pre-order visit may return NODE_WALK_SKIP */
+enum { NODE_WALK_PRUNE = 8 };
+/* A flag for Node_walk with which the walk, which must be made in an
+   epoch (see epoch.h), ends it and starts another as it goes from
+   one directory to another, so that what writers retire meanwhile is
+   not kept from being freed until the walk ends */
+enum { NODE_WALK_REENTER = 16 };
+/* The status with which, under NODE_WALK_PRUNE, a pre-order visit
+   has the walk pass over the node's descendants and post-order
+   visit */
+enum { NODE_WALK_SKIP = -1 };
+
+/*
+  Walks the subtree rooted at oNRoot depth-first, calling
+  (*pfVisit)(oNNode, iOrder, pvContext) for its nodes as iFlags, a
+  combination of the FT_WALK_ flags of ft.h, asks: with iOrder
+  FT_WALK_PREORDER before a node's descendents, and FT_WALK_POSTORDER
+  after them. Children are visited in sorted order, or files before
+  directories with FT_WALK_FILES_FIRST. pfVisit returns SUCCESS to go
+  on or any other status to stop the walk. pfVisit must not change the
+  subtree, except that in post-order it may release the children of
+  the node it is given. Returns the first status other than SUCCESS
+  that pfVisit returned, or SUCCESS.
+
+  The walk keeps a fixed-size stack of where it is in each level, and
+  past that many levels finds its place again by searching, so it
+  never allocates memory and takes no more stack however deep the
+  subtree is. Past the stack's depth, a node that versions of the
+  tree share (see Node_copy) has its parent found again from the top
+  of the levels past the stack, at a cost quadratic in their number.
+  A reader may walk a concurrent tree while a writer changes it: each
+  directory's children are then those it had when the walk reached
+  it, except past the stack's depth, where the walk goes on among the
+  children its parent has when it returns there. With
+  NODE_WALK_REENTER, the walk also goes on among those a directory
+  has when it returns there within the stack's depth, where it starts
+  each new epoch, and keeps the directories on its way down from
+  being freed meanwhile, so a subtree removed while the walk is in it
+  is walked as it was.
+*/
+int Node_walk(Node_T oNRoot,
+              int (*pfVisit)(Node_T oNNode, int iOrder,
+                             void *pvContext),
+              void *pvContext, int iFlags);
+
 /* Returns the number of children that oNParent has. */
 size_t Node_getNumChildren(Node_T oNParent);
 
@@ -66,6 +331,8 @@ int Node_getChild(Node_T oNParent, size_t ulChildID,
 /*
   Returns a the parent node of oNNode.
   Returns NULL if oNNode is the root and thus has no parent.
+  If versions of the tree share oNNode, this is the oldest copy of
+  its parent that holds it (see Node_copy), which has the same path.
 */
 Node_T Node_getParent(Node_T oNNode);
 
@@ -82,17 +349,40 @@ char *Node_toString(Node_T oNNode);
 or file). */
 int Node_getState(Node_T oNNode);
 
+/*
+  Gives oNNode, a file node with a parent, contents pvContents of
+  length ulLength in place of its old ones, which it stores in
+  *ppvOld. In a concurrent tree, publishes the new contents and length
+  together in a new record (see Node_getFileContents) and retires the
+  old one, holding the parent's lock meanwhile, so that the file is
+  not replaced twice at once nor once removed. Returns SUCCESS, or
+  MEMORY_ERROR if memory for the record could not be allocated, or
+  NO_SUCH_PATH if another writer has unlinked oNNode since the caller
+  found it, changing nothing either way.
+*/
+int Node_replaceFile(Node_T oNNode, void *pvContents, size_t ulLength,
+                     void **ppvOld);
+
 /* Takes oNNode, a file node, and set the value of its file 
-pointer to a_file. */
+pointer to a_file. oNNode must not be concurrent. */
 void Node_setFile(Node_T oNNode, void* a_file);
 
 /* Returns a pointer to oNNode's file. */
 void* Node_getFile(Node_T oNNode);
 
-/* Takes oNNode, a file node, and sets its length to ulLength. */
+/* Takes oNNode, a file node, and sets its length to ulLength.
+   oNNode must not be concurrent. */
 void Node_setFileLength(Node_T oNNode, size_t ulLength);
 
 /* Returns the length of oNNode's file. */
 size_t Node_getFileLength(Node_T oNNode);
 
+/*
+  Returns a pointer to oNNode's file and stores its length in
+  *pulLength. A concurrent file's contents and length are loaded
+  together from one record, so a reader sees the length that the
+  contents were given with, even while a writer replaces them.
+*/
+void *Node_getFileContents(Node_T oNNode, size_t *pulLength);
+
 #endif
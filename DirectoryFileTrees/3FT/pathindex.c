@@ -0,0 +1,213 @@
+/*--------------------------------------------------------------------*/
+/* pathindex.c                                                        */
+/* Author: Jacob Santelli and Joshua Yang                             */
+/*--------------------------------------------------------------------*/
+
+#include <assert.h>
+#include <stddef.h>
+
+#include "pathindex.h"
+
+/* The number of slots first allocated */
+enum { MIN_INDEX_SLOTS = 16 };
+
+/* A slot of the table */
+struct slot {
+   /* the hash the element was added with */
+   unsigned long ulHash;
+   /* the element, or NULL if the slot is empty */
+   void *pvElement;
+};
+
+/*
+  A hash table with open addressing: each element is in the first
+  empty slot at or after (wrapping around) the slot its hash picks,
+  so a lookup probes from there to the next empty slot. At most half
+  the slots are full.
+*/
+struct PathIndex {
+   /* the slab that the object and its table are allocated from */
+   Slab_T oSSlab;
+   /* the slots, or NULL if none have been allocated */
+   struct slot *psSlots;
+   /* the number of slots, 0 or a power of two */
+   size_t ulSlots;
+   /* the number of elements */
+   size_t ulLength;
+};
+
+/*
+  Puts pvElement, with hash ulHash, into the first empty slot of the
+  ulSlots slots of psSlots from the one ulHash picks. There must be
+  an empty slot.
+*/
+static void PathIndex_place(struct slot *psSlots, size_t ulSlots,
+                            unsigned long ulHash, void *pvElement) {
+   size_t ulMask = ulSlots - 1;
+   size_t i;
+
+   assert(psSlots != NULL);
+   assert(pvElement != NULL);
+
+   i = (size_t) ulHash & ulMask;
+   while(psSlots[i].pvElement != NULL)
+      i = (i + 1) & ulMask;
+   psSlots[i].ulHash = ulHash;
+   psSlots[i].pvElement = pvElement;
+}
+
+PathIndex_T PathIndex_new(Slab_T oSSlab) {
+   PathIndex_T oPathIndex;
+
+   assert(oSSlab != NULL);
+
+   oPathIndex = Slab_alloc(oSSlab, sizeof(struct PathIndex));
+   if(oPathIndex == NULL)
+      return NULL;
+   oPathIndex->oSSlab = oSSlab;
+   oPathIndex->psSlots = NULL;
+   oPathIndex->ulSlots = 0;
+   oPathIndex->ulLength = 0;
+   return oPathIndex;
+}
+
+void PathIndex_free(PathIndex_T oPathIndex) {
+   assert(oPathIndex != NULL);
+
+   Slab_release(oPathIndex->oSSlab, oPathIndex->psSlots,
+                oPathIndex->ulSlots * sizeof(struct slot));
+   Slab_release(oPathIndex->oSSlab, oPathIndex, sizeof(struct PathIndex));
+}
+
+size_t PathIndex_getLength(PathIndex_T oPathIndex) {
+   assert(oPathIndex != NULL);
+
+   return oPathIndex->ulLength;
+}
+
+int PathIndex_reserve(PathIndex_T oPathIndex, size_t ulCount) {
+   struct slot *psSlots;
+   size_t ulNeeded;
+   size_t ulSlots;
+   size_t i;
+
+   assert(oPathIndex != NULL);
+
+   ulNeeded = oPathIndex->ulLength + ulCount;
+   if(ulNeeded < ulCount)
+      return 0;
+   if(ulNeeded <= oPathIndex->ulSlots / 2)
+      return 1;
+
+   ulSlots = oPathIndex->ulSlots;
+   if(ulSlots == 0)
+      ulSlots = MIN_INDEX_SLOTS;
+   while(ulSlots / 2 < ulNeeded) {
+      if(ulSlots > (size_t) -1 / 2 / sizeof(struct slot))
+         return 0;
+      ulSlots *= 2;
+   }
+
+   psSlots = Slab_alloc(oPathIndex->oSSlab,
+                        ulSlots * sizeof(struct slot));
+   if(psSlots == NULL)
+      return 0;
+   for(i = 0; i < ulSlots; i++)
+      psSlots[i].pvElement = NULL;
+
+   /* move the elements over */
+   for(i = 0; i < oPathIndex->ulSlots; i++)
+      if(oPathIndex->psSlots[i].pvElement != NULL)
+         PathIndex_place(psSlots, ulSlots,
+                         oPathIndex->psSlots[i].ulHash,
+                         oPathIndex->psSlots[i].pvElement);
+   Slab_release(oPathIndex->oSSlab, oPathIndex->psSlots,
+                oPathIndex->ulSlots * sizeof(struct slot));
+
+   oPathIndex->psSlots = psSlots;
+   oPathIndex->ulSlots = ulSlots;
+   return 1;
+}
+
+int PathIndex_add(PathIndex_T oPathIndex, unsigned long ulHash,
+                  void *pvElement) {
+   assert(oPathIndex != NULL);
+   assert(pvElement != NULL);
+
+   if(!PathIndex_reserve(oPathIndex, 1))
+      return 0;
+   PathIndex_place(oPathIndex->psSlots, oPathIndex->ulSlots, ulHash,
+                   pvElement);
+   oPathIndex->ulLength++;
+   return 1;
+}
+
+void PathIndex_remove(PathIndex_T oPathIndex, unsigned long ulHash,
+                      void *pvElement) {
+   struct slot *psSlots;
+   size_t ulMask;
+   size_t i, j, ulHome;
+
+   assert(oPathIndex != NULL);
+   assert(oPathIndex->ulLength > 0);
+   assert(pvElement != NULL);
+
+   psSlots = oPathIndex->psSlots;
+   ulMask = oPathIndex->ulSlots - 1;
+   i = (size_t) ulHash & ulMask;
+   while(psSlots[i].pvElement != pvElement) {
+      assert(psSlots[i].pvElement != NULL);
+      i = (i + 1) & ulMask;
+   }
+
+   /* move back into the emptied slot any later element in the same
+      run of full slots that would otherwise no longer be found from
+      the slot its hash picks */
+   for(j = (i + 1) & ulMask; psSlots[j].pvElement != NULL;
+       j = (j + 1) & ulMask) {
+      ulHome = (size_t) psSlots[j].ulHash & ulMask;
+      /* the element in slot j stays if its home is cyclically in
+         (i, j], since it is still reached from there */
+      if(i <= j ? (i < ulHome && ulHome <= j)
+                : (i < ulHome || ulHome <= j))
+         continue;
+      psSlots[i] = psSlots[j];
+      i = j;
+   }
+   psSlots[i].pvElement = NULL;
+   oPathIndex->ulLength--;
+}
+
+void PathIndex_clear(PathIndex_T oPathIndex) {
+   size_t i;
+
+   assert(oPathIndex != NULL);
+
+   for(i = 0; i < oPathIndex->ulSlots; i++)
+      oPathIndex->psSlots[i].pvElement = NULL;
+   oPathIndex->ulLength = 0;
+}
+
+void *PathIndex_find(PathIndex_T oPathIndex, unsigned long ulHash,
+                     int (*pfMatches)(const void *pvElement,
+                                      const void *pvKey),
+                     const void *pvKey) {
+   struct slot *psSlots;
+   size_t ulMask;
+   size_t i;
+
+   assert(oPathIndex != NULL);
+   assert(pfMatches != NULL);
+
+   if(oPathIndex->ulSlots == 0)
+      return NULL;
+
+   psSlots = oPathIndex->psSlots;
+   ulMask = oPathIndex->ulSlots - 1;
+   for(i = (size_t) ulHash & ulMask; psSlots[i].pvElement != NULL;
+       i = (i + 1) & ulMask)
+      if(psSlots[i].ulHash == ulHash
+         && (*pfMatches)(psSlots[i].pvElement, pvKey))
+         return psSlots[i].pvElement;
+   return NULL;
+}
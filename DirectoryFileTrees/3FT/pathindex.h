@@ -0,0 +1,73 @@
+/*--------------------------------------------------------------------*/
+/* pathindex.h                                                        */
+/* Author: Jacob Santelli and Joshua Yang                             */
+/*--------------------------------------------------------------------*/
+
+#ifndef PATHINDEX_INCLUDED
+#define PATHINDEX_INCLUDED
+
+#include <stddef.h>
+#include "slab.h"
+
+/*
+  A PathIndex_T object is a hash table of pointers, each added with a
+  hash that the client computes, such as the hash of a node's absolute
+  path (see Path_getPrefixHash). The index does not know what its
+  elements are: a lookup by hash hands each element added with that
+  hash to a client function that decides whether it is the one
+  wanted. The table is allocated from a slab and doubles as needed to
+  keep it at most half full, so each element costs from 32 to 64
+  bytes of it. Removing elements does not shrink the table.
+*/
+typedef struct PathIndex *PathIndex_T;
+
+/*
+  Returns a new, empty PathIndex_T object, allocated from oSSlab, or
+  NULL if insufficient memory is available.
+*/
+PathIndex_T PathIndex_new(Slab_T oSSlab);
+
+/* Frees oPathIndex, but not its elements. */
+void PathIndex_free(PathIndex_T oPathIndex);
+
+/* Returns the number of elements in oPathIndex. */
+size_t PathIndex_getLength(PathIndex_T oPathIndex);
+
+/*
+  Makes room in oPathIndex for ulCount more elements than it holds,
+  so that adding that many cannot fail. Returns 1 (TRUE) if
+  successful, or 0 (FALSE) if insufficient memory is available, in
+  which case oPathIndex is unchanged.
+*/
+int PathIndex_reserve(PathIndex_T oPathIndex, size_t ulCount);
+
+/*
+  Adds pvElement, which must not be NULL or already in oPathIndex,
+  with hash ulHash. Returns 1 (TRUE) if successful, or 0 (FALSE) if
+  insufficient memory is available, in which case oPathIndex is
+  unchanged.
+*/
+int PathIndex_add(PathIndex_T oPathIndex, unsigned long ulHash,
+                  void *pvElement);
+
+/*
+  Removes pvElement, which must be in oPathIndex with hash ulHash.
+*/
+void PathIndex_remove(PathIndex_T oPathIndex, unsigned long ulHash,
+                      void *pvElement);
+
+/* Removes every element of oPathIndex, keeping its table. */
+void PathIndex_clear(PathIndex_T oPathIndex);
+
+/*
+  Returns the first element of oPathIndex added with hash ulHash for
+  which pfMatches, given the element and pvKey, returns nonzero, or
+  NULL if there is none. pfMatches is only called for elements with
+  hash ulHash, so with a good hash it is usually called once at most.
+*/
+void *PathIndex_find(PathIndex_T oPathIndex, unsigned long ulHash,
+                     int (*pfMatches)(const void *pvElement,
+                                      const void *pvKey),
+                     const void *pvKey);
+
+#endif
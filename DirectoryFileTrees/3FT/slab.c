@@ -0,0 +1,292 @@
+/*--------------------------------------------------------------------*/
+/* slab.c                                                             */
+/* Author: Jacob Santelli and Joshua Yang                             */
+/*--------------------------------------------------------------------*/
+
+/* for the POSIX threads mutex */
+#define _POSIX_C_SOURCE 200112L
+
+#include <assert.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "slab.h"
+
+/* The granularity of the size classes, which is also the alignment
+   of every small block */
+enum { SLAB_GRAIN = 16 };
+/* The number of size classes; requests up to
+   SLAB_GRAIN * SLAB_CLASSES bytes are small */
+enum { SLAB_CLASSES = 32 };
+/* The number of bytes obtained from malloc for each page */
+enum { SLAB_PAGE_SIZE = 65536 };
+
+/* The header at the start of each page, padded to SLAB_GRAIN so the
+   blocks that follow it are aligned */
+union page {
+   /* the next page held by the same slab */
+   union page *psNext;
+   /* padding */
+   char acPad[SLAB_GRAIN];
+};
+
+/* A released block, linked through its first bytes */
+struct freeBlock {
+   /* the next released block of the same size class */
+   struct freeBlock *psNext;
+};
+
+/* The blocks of one size class */
+struct sizeClass {
+   /* the next unused byte of the class's current page */
+   char *pcNext;
+   /* the end of the class's current page */
+   char *pcLimit;
+   /* the released blocks of the class */
+   struct freeBlock *psFree;
+};
+
+/* A pool of pages for the small blocks of one tree */
+struct slab {
+   /* the classes, where class i holds blocks of (i + 1) * SLAB_GRAIN
+      bytes */
+   struct sizeClass asClasses[SLAB_CLASSES];
+   /* every page held by the slab */
+   union page *psPages;
+   /* the statistics so far */
+   struct SlabStats sStats;
+   /* 1 (TRUE) if each call locks sLock (see Slab_newLocked), or 0
+      (FALSE) if the slab is not synchronized */
+   int bLocked;
+   /* guards the other fields of a locked slab */
+   pthread_mutex_t sLock;
+};
+
+/* Returns the index of the size class for requests of ulSize bytes,
+   which must be small. */
+static size_t Slab_classOf(size_t ulSize) {
+   assert(ulSize > 0);
+   assert(ulSize <= SLAB_GRAIN * SLAB_CLASSES);
+
+   return (ulSize - 1) / SLAB_GRAIN;
+}
+
+/*
+  Gives class ulClass of oSSlab a fresh page to carve blocks from.
+  Whatever was left of its previous page is abandoned. Returns 1
+  (TRUE) if successful, or 0 (FALSE) if insufficient memory is
+  available.
+*/
+static int Slab_addPage(Slab_T oSSlab, size_t ulClass) {
+   union page *psPage;
+
+   psPage = malloc(SLAB_PAGE_SIZE);
+   if(psPage == NULL)
+      return 0;
+
+   psPage->psNext = oSSlab->psPages;
+   oSSlab->psPages = psPage;
+   oSSlab->asClasses[ulClass].pcNext = (char *) (psPage + 1);
+   oSSlab->asClasses[ulClass].pcLimit = (char *) psPage + SLAB_PAGE_SIZE;
+
+   oSSlab->sStats.ulPages++;
+   oSSlab->sStats.ulPageBytes += SLAB_PAGE_SIZE - sizeof(union page);
+   return 1;
+}
+
+Slab_T Slab_new(void) {
+   return calloc(1, sizeof(struct slab));
+}
+
+Slab_T Slab_newLocked(void) {
+   Slab_T oSSlab;
+
+   oSSlab = Slab_new();
+   if(oSSlab == NULL)
+      return NULL;
+   if(!Slab_makeLocked(oSSlab)) {
+      free(oSSlab);
+      return NULL;
+   }
+   return oSSlab;
+}
+
+int Slab_makeLocked(Slab_T oSSlab) {
+   assert(oSSlab != NULL);
+
+   if(oSSlab->bLocked)
+      return 1;
+   if(pthread_mutex_init(&oSSlab->sLock, NULL) != 0)
+      return 0;
+   oSSlab->bLocked = 1;
+   return 1;
+}
+
+/* Locks oSSlab if it is locked (see Slab_newLocked). */
+static void Slab_lock(Slab_T oSSlab) {
+   if(oSSlab->bLocked)
+      (void) pthread_mutex_lock(&oSSlab->sLock);
+}
+
+/* Unlocks oSSlab if it is locked (see Slab_newLocked). */
+static void Slab_unlock(Slab_T oSSlab) {
+   if(oSSlab->bLocked)
+      (void) pthread_mutex_unlock(&oSSlab->sLock);
+}
+
+void Slab_free(Slab_T oSSlab) {
+   union page *psPage;
+   union page *psNext;
+
+   if(oSSlab == NULL)
+      return;
+
+   for(psPage = oSSlab->psPages; psPage != NULL; psPage = psNext) {
+      psNext = psPage->psNext;
+      free(psPage);
+   }
+   if(oSSlab->bLocked)
+      (void) pthread_mutex_destroy(&oSSlab->sLock);
+   free(oSSlab);
+}
+
+/* Slab_alloc, with oSSlab locked if it is locked. */
+static void *Slab_allocBlock(Slab_T oSSlab, size_t ulSize) {
+   struct sizeClass *psClass;
+   size_t ulClass;
+   size_t ulBlockSize;
+   void *pv;
+
+   assert(oSSlab != NULL);
+   assert(ulSize > 0);
+
+   if(ulSize > SLAB_GRAIN * SLAB_CLASSES) {
+      pv = malloc(ulSize);
+      if(pv == NULL)
+         return NULL;
+      oSSlab->sStats.ulLargeBlocks++;
+      oSSlab->sStats.ulLargeBytes += ulSize;
+      return pv;
+   }
+
+   ulClass = Slab_classOf(ulSize);
+   ulBlockSize = (ulClass + 1) * SLAB_GRAIN;
+   psClass = &oSSlab->asClasses[ulClass];
+
+   if(psClass->psFree != NULL) {
+      /* reuse the most recently released block */
+      pv = psClass->psFree;
+      psClass->psFree = psClass->psFree->psNext;
+      oSSlab->sStats.ulFreeBytes -= ulBlockSize;
+   }
+   else {
+      /* carve the next block from the class's page */
+      if((size_t) (psClass->pcLimit - psClass->pcNext) < ulBlockSize)
+         if(!Slab_addPage(oSSlab, ulClass))
+            return NULL;
+      pv = psClass->pcNext;
+      psClass->pcNext += ulBlockSize;
+   }
+
+   oSSlab->sStats.ulBlocks++;
+   oSSlab->sStats.ulBlockBytes += ulBlockSize;
+   oSSlab->sStats.ulRequestedBytes += ulSize;
+   return pv;
+}
+
+/* Slab_release, with oSSlab locked if it is locked. */
+static void Slab_releaseBlock(Slab_T oSSlab, void *pv, size_t ulSize) {
+   struct sizeClass *psClass;
+   struct freeBlock *psBlock;
+   size_t ulClass;
+   size_t ulBlockSize;
+
+   assert(oSSlab != NULL);
+
+   if(pv == NULL)
+      return;
+
+   if(ulSize > SLAB_GRAIN * SLAB_CLASSES) {
+      assert(oSSlab->sStats.ulLargeBlocks > 0);
+      oSSlab->sStats.ulLargeBlocks--;
+      oSSlab->sStats.ulLargeBytes -= ulSize;
+      free(pv);
+      return;
+   }
+
+   ulClass = Slab_classOf(ulSize);
+   ulBlockSize = (ulClass + 1) * SLAB_GRAIN;
+   psClass = &oSSlab->asClasses[ulClass];
+
+   psBlock = pv;
+   psBlock->psNext = psClass->psFree;
+   psClass->psFree = psBlock;
+
+   assert(oSSlab->sStats.ulBlocks > 0);
+   oSSlab->sStats.ulBlocks--;
+   oSSlab->sStats.ulBlockBytes -= ulBlockSize;
+   oSSlab->sStats.ulRequestedBytes -= ulSize;
+   oSSlab->sStats.ulFreeBytes += ulBlockSize;
+}
+
+void *Slab_alloc(Slab_T oSSlab, size_t ulSize) {
+   void *pv;
+
+   assert(oSSlab != NULL);
+
+   Slab_lock(oSSlab);
+   pv = Slab_allocBlock(oSSlab, ulSize);
+   Slab_unlock(oSSlab);
+   return pv;
+}
+
+void Slab_release(Slab_T oSSlab, void *pv, size_t ulSize) {
+   assert(oSSlab != NULL);
+
+   if(pv == NULL)
+      return;
+
+   Slab_lock(oSSlab);
+   Slab_releaseBlock(oSSlab, pv, ulSize);
+   Slab_unlock(oSSlab);
+}
+
+void *Slab_resize(Slab_T oSSlab, void *pvOld, size_t ulOldSize,
+                  size_t ulNewSize) {
+   void *pvNew;
+
+   assert(oSSlab != NULL);
+   assert(ulNewSize > 0);
+
+   if(pvOld == NULL)
+      return Slab_alloc(oSSlab, ulNewSize);
+
+   /* a block already big enough for the new size stays put */
+   if(ulOldSize <= SLAB_GRAIN * SLAB_CLASSES
+      && ulNewSize <= SLAB_GRAIN * SLAB_CLASSES
+      && Slab_classOf(ulOldSize) == Slab_classOf(ulNewSize)) {
+      Slab_lock(oSSlab);
+      oSSlab->sStats.ulRequestedBytes += ulNewSize;
+      oSSlab->sStats.ulRequestedBytes -= ulOldSize;
+      Slab_unlock(oSSlab);
+      return pvOld;
+   }
+
+   pvNew = Slab_alloc(oSSlab, ulNewSize);
+   if(pvNew == NULL)
+      return NULL;
+   memcpy(pvNew, pvOld, ulOldSize < ulNewSize ? ulOldSize : ulNewSize);
+   Slab_release(oSSlab, pvOld, ulOldSize);
+   return pvNew;
+}
+
+void Slab_getStats(Slab_T oSSlab, struct SlabStats *psStats) {
+   assert(oSSlab != NULL);
+   assert(psStats != NULL);
+
+   Slab_lock(oSSlab);
+   *psStats = oSSlab->sStats;
+   Slab_unlock(oSSlab);
+}
@@ -0,0 +1,105 @@
+/*--------------------------------------------------------------------*/
+/* slab.h                                                             */
+/* Author: Jacob Santelli and Joshua Yang                             */
+/*--------------------------------------------------------------------*/
+
+#ifndef SLAB_INCLUDED
+#define SLAB_INCLUDED
+
+#include <stddef.h>
+
+/*
+  A Slab_T is a pool of memory for the small blocks of one tree. Small
+  requests are rounded up to a size class and carved in order out of
+  large pages, each holding blocks of one class, so blocks allocated
+  one after another end up next to each other. Released blocks go on
+  their class's free list for reuse. Larger requests are passed on to
+  malloc. Blocks are released with their size, so they carry no
+  header.
+*/
+typedef struct slab *Slab_T;
+
+/* Statistics describing the memory held by a slab */
+struct SlabStats {
+   /* the number of pages obtained from malloc */
+   size_t ulPages;
+   /* the bytes in those pages, excluding their headers */
+   size_t ulPageBytes;
+   /* the number of small blocks allocated and not yet released */
+   size_t ulBlocks;
+   /* the bytes in those blocks, each rounded up to its size class */
+   size_t ulBlockBytes;
+   /* the bytes originally requested for those blocks */
+   size_t ulRequestedBytes;
+   /* the bytes in released blocks waiting on free lists */
+   size_t ulFreeBytes;
+   /* the number of large blocks passed on to malloc */
+   size_t ulLargeBlocks;
+   /* the bytes requested for those large blocks */
+   size_t ulLargeBytes;
+};
+
+/*
+  Returns a new, empty slab, or NULL if insufficient memory is
+  available. The slab holds no pages until its first allocation.
+*/
+Slab_T Slab_new(void);
+
+/*
+  Like Slab_new, but the slab returned locks a mutex of its own
+  around each call, so that any number of threads may allocate from
+  it and release to it at once. Each call holds the lock only while
+  it finds or takes back one block.
+*/
+Slab_T Slab_newLocked(void);
+
+/*
+  Makes oSSlab, which no other thread may be using meanwhile, lock
+  itself from now on as one from Slab_newLocked does. Returns 1 (TRUE),
+  or 0 (FALSE), leaving it as it was, if its mutex could not be
+  created.
+*/
+int Slab_makeLocked(Slab_T oSSlab);
+
+/*
+  Frees oSSlab and every page it holds. Blocks still allocated from
+  its pages become invalid. Large blocks must have been released. No
+  other thread may be using a locked slab.
+*/
+void Slab_free(Slab_T oSSlab);
+
+/*
+  Returns a block of ulSize bytes from oSSlab, aligned for any type,
+  or NULL if insufficient memory is available. ulSize must be
+  positive.
+*/
+void *Slab_alloc(Slab_T oSSlab, size_t ulSize);
+
+/*
+  Returns pv, a block of ulSize bytes allocated from oSSlab, to it for
+  reuse. ulSize must be the size the block was allocated (or last
+  resized) with. Does nothing if pv is NULL.
+*/
+void Slab_release(Slab_T oSSlab, void *pv, size_t ulSize);
+
+/*
+  Returns a block of ulNewSize bytes from oSSlab holding the first
+  ulOldSize (or ulNewSize, if less) bytes of pvOld, a block of
+  ulOldSize bytes from oSSlab, which is released, or is allocated
+  fresh if NULL. Returns pvOld itself if both sizes fall in the same
+  size class. Returns NULL, leaving pvOld untouched, if insufficient
+  memory is available.
+*/
+void *Slab_resize(Slab_T oSSlab, void *pvOld, size_t ulOldSize,
+                  size_t ulNewSize);
+
+/*
+  Fills *psStats with the current statistics of oSSlab. The share of
+  page bytes in use is ulBlockBytes / ulPageBytes; the share of them
+  lost to rounding (internal fragmentation) is 1 - ulRequestedBytes /
+  ulBlockBytes, and the share on free lists (external fragmentation)
+  is ulFreeBytes / ulPageBytes.
+*/
+void Slab_getStats(Slab_T oSSlab, struct SlabStats *psStats);
+
+#endif